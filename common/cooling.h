@@ -0,0 +1,151 @@
+/*
+Optically thin radiative cooling (header only, include after physics.h)
+        du/dt = -COOL_RATE_UNIT * rho * LAMBDA(T), T = COOL_T_UNIT * u, u = specific internal energy
+
+        LAMBDA is read from a table of N nodes log-uniformly spaced in T and treated as a piecewise power law, which
+        allows the exact integration scheme of Townsend (2009, ApJS 181, 391): the temporal evolution function Y(T) is
+        known analytically on every segment, so one step of any length costs one Y evaluation, one linear update and
+        one inversion, independent of the cooling time. Gas is not cooled below the first table node.
+
+        File format (text):
+                N
+                LOG_T_MIN LOG_T_MAX
+                N lines of LAMBDA
+*/
+
+#ifndef COOLING_H
+#define COOLING_H
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define COOL_BLOCK 256          // vertices per batched cooling call
+
+class cooling_table{
+private:
+        struct grid{
+                int N = 0, SEARCH_STEP = 1;             // SEARCH_STEP = largest power of 2 below N
+                double LOG_T_MIN = 0.0, INV_D_LOG_T = 0.0;
+                double T_REF = 0.0, LAMBDA_REF = 0.0;   // top node, Y(T_REF) = 0
+                std::vector<double> T;                  // node temperatures
+                std::vector<double> LAMBDA;             // cooling function at the nodes
+                std::vector<double> ALPHA;              // power law slope of segment k (T[k] -> T[k+1])
+                std::vector<double> C;                  // (LAMBDA_REF/LAMBDA[k])*(T[k]/T_REF)
+                std::vector<double> Y;                  // Y(T[k])
+        };
+
+        static grid &table(){
+                static grid TABLE;
+                return TABLE;
+        }
+
+        // Y(T) - Y(T[k]) on segment k
+        static inline double segment_y(const grid &G, int k, double TEMP){
+                double ONE_ALPHA = 1.0 - G.ALPHA[k];
+                if(fabs(ONE_ALPHA) < 1.0e-10){return G.C[k]*log(G.T[k]/TEMP);}
+                return G.C[k]*(1.0 - pow(G.T[k]/TEMP, -ONE_ALPHA))/ONE_ALPHA;
+        }
+
+public:
+        static bool load(std::string FILE_NAME){
+                grid &G = table();
+                double LOG_T_MAX;
+                std::ifstream FILE(FILE_NAME);
+                if(!FILE.is_open()){
+                        std::cout << "CWARNING: Cannot open cooling table " << FILE_NAME << std::endl;
+                        return false;
+                }
+                FILE >> G.N >> G.LOG_T_MIN >> LOG_T_MAX;
+                if(FILE.fail()){
+                        std::cout << "CWARNING: Cooling table " << FILE_NAME << " has a malformed header" << std::endl;
+                        return false;
+                }
+                if(G.N < 2){
+                        std::cout << "CWARNING: Cooling table needs at least 2 nodes" << std::endl;
+                        return false;
+                }
+                if(!(LOG_T_MAX > G.LOG_T_MIN)){
+                        std::cout << "CWARNING: Cooling table " << FILE_NAME << " needs an increasing log10(T) range" << std::endl;
+                        return false;
+                }
+                G.INV_D_LOG_T = (G.N-1)/(LOG_T_MAX - G.LOG_T_MIN);
+                G.SEARCH_STEP = 1;
+                while(2*G.SEARCH_STEP < G.N){G.SEARCH_STEP = 2*G.SEARCH_STEP;}
+                G.T.resize(G.N);
+                G.ALPHA.resize(G.N);
+                G.C.resize(G.N);
+                G.Y.resize(G.N);
+                G.LAMBDA.resize(G.N);
+                for(int k=0; k<G.N; ++k){
+                        FILE >> G.LAMBDA[k];
+                        if(FILE.fail() or !(G.LAMBDA[k] > 0.0)){               // end of file is fine after the last node
+                                std::cout << "CWARNING: Cooling table " << FILE_NAME << " ends or has LAMBDA <= 0 at node " << k << " of " << G.N << std::endl;
+                                return false;
+                        }
+                        G.T[k] = pow(10.0, G.LOG_T_MIN + k/G.INV_D_LOG_T);
+                }
+                G.T_REF      = G.T[G.N-1];
+                G.LAMBDA_REF = G.LAMBDA[G.N-1];
+                for(int k=0; k<G.N-1; ++k){
+                        G.ALPHA[k] = log(G.LAMBDA[k+1]/G.LAMBDA[k])/log(G.T[k+1]/G.T[k]);
+                        G.C[k]     = (G.LAMBDA_REF/G.LAMBDA[k])*(G.T[k]/G.T_REF);
+                }
+                G.Y[G.N-1] = 0.0;
+                for(int k=G.N-2; k>=0; --k){G.Y[k] = G.Y[k+1] - segment_y(G, k, G.T[k+1]);}
+                std::cout << "Read cooling table " << FILE_NAME << " (" << G.N << " nodes)" << std::endl;
+                return true;
+        }
+
+        // cooling time u/|du/dt| (infinite at or below the first table node)
+        static inline double cooling_time(double RHO, double E_INT){
+                const grid &G = table();
+                double TEMP = COOL_T_UNIT*E_INT;
+                if(!(TEMP > G.T[0])){return HUGE_VAL;}                  // also zero, negative and NaN energies
+                int k = int((log10(TEMP) - G.LOG_T_MIN)*G.INV_D_LOG_T);
+                k = k > G.N-2 ? G.N-2 : k;
+                return E_INT/(COOL_RATE_UNIT*RHO*G.LAMBDA[k]*pow(TEMP/G.T[k], G.ALPHA[k]));
+        }
+
+        // advance N specific internal energies E_INT at fixed density RHO over DT[i] (E_NEW may alias E_INT)
+        static void batch_cool(int N, const double *RHO, const double *E_INT, const double *DT, double *E_NEW){
+                const grid &G = table();
+                const double T_MIN = G.T[0];
+                PHYSICS_SIMD
+                for(int i=0; i<N; ++i){
+                        double TEMP = COOL_T_UNIT*E_INT[i];
+                        double TEMP_NEW = TEMP;                 // not cooled at or below the first node (nor NaN)
+
+                        // segment of the current temperature (log-uniform nodes, last segment extended above the table),
+                        // floored at the first node before the log so the index stays in the table for any energy
+                        int k = int((log10(TEMP > T_MIN ? TEMP : T_MIN) - G.LOG_T_MIN)*G.INV_D_LOG_T);
+                        k = k > G.N-2 ? G.N-2 : k;
+                        if(TEMP > T_MIN){
+                                TEMP_NEW = T_MIN;
+                                double Y_NEW = G.Y[k] + segment_y(G, k, TEMP) + COOL_T_UNIT*COOL_RATE_UNIT*RHO[i]*G.LAMBDA_REF*DT[i]/G.T_REF;
+
+                                // segment of the new temperature, Y decreases with k so search for the last Y[k] >= Y_NEW
+                                if(Y_NEW < G.Y[0]){
+                                        for(int STEP=G.SEARCH_STEP; STEP>0; STEP>>=1){
+                                                k = (k-STEP >= 0 and G.Y[k-STEP] < Y_NEW) ? k-STEP : k;
+                                        }
+                                        k = G.Y[k] < Y_NEW ? k-1 : k;
+                                        k = k < 0 ? 0 : k;
+                                        double ONE_ALPHA = 1.0 - G.ALPHA[k];
+                                        if(fabs(ONE_ALPHA) < 1.0e-10){
+                                                TEMP_NEW = G.T[k]*exp(-(Y_NEW - G.Y[k])/G.C[k]);
+                                        }
+                                        else{
+                                                TEMP_NEW = G.T[k]*pow(1.0 - ONE_ALPHA*(Y_NEW - G.Y[k])/G.C[k], 1.0/ONE_ALPHA);
+                                        }
+                                        TEMP_NEW = TEMP_NEW < T_MIN ? T_MIN : TEMP_NEW;
+                                }
+                        }
+                        E_NEW[i] = TEMP_NEW/COOL_T_UNIT;
+                }
+        }
+};
+
+#endif
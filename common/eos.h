@@ -0,0 +1,261 @@
+/*
+Equations of state for the Roe and RD solvers (header only, included by physics.h)
+        Each EOS class provides the same static functions so the solvers are specialised at compile time:
+        pressure(RHO, E_INT)                         => pressure from mass density and specific internal energy
+        internal_energy(RHO, PRESSURE)               => specific internal energy from mass density and pressure
+        sound_speed_sq(RHO, E_INT, PRESSURE)         => squared adiabatic sound speed of a point state
+        sound_speed_sq_enthalpy(RHO, H, VEL_SQ_SUM)  => squared sound speed from total specific enthalpy (Roe averaged states)
+        derivatives(RHO, E_INT, CHI, KAPPA)          => dP/drho at fixed e_int (CHI) and dP/de_int at fixed rho over rho (KAPPA)
+
+        Select with EOS_ISOTHERMAL, EOS_POLYTROPIC or EOS_TABLE in the constants file (none for ideal gas), the
+        selected class is available as EOS. eos_linearise builds the RD (Roe) linearisation of the pressure from the
+        derivatives, EOS_NON_IDEAL is defined when the pressure is not quadratic in the Roe parameter vector.
+*/
+
+#ifndef EOS_H
+#define EOS_H
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// ideal gas with adiabatic index GAMMA (same expressions as the original hard-coded versions)
+class eos_ideal{
+public:
+        static inline double pressure(double RHO, double E_INT){
+                return (GAMMA-1.0) * RHO * E_INT;
+        }
+
+        static inline double internal_energy(double RHO, double PRESSURE){
+                return PRESSURE/((GAMMA-1.0)*RHO);
+        }
+
+        static inline double sound_speed_sq(double RHO, [[maybe_unused]] double E_INT, double PRESSURE){
+                return GAMMA*PRESSURE/RHO;
+        }
+
+        static inline double sound_speed_sq_enthalpy([[maybe_unused]] double RHO, double H, double VEL_SQ_SUM){
+                return (GAMMA-1.0) * H - (GAMMA-1.0) * VEL_SQ_SUM/2.0;
+        }
+
+        static inline void derivatives([[maybe_unused]] double RHO, double E_INT, double &CHI, double &KAPPA){
+                CHI   = (GAMMA-1.0) * E_INT;
+                KAPPA = GAMMA-1.0;
+        }
+};
+
+#ifdef EOS_ISOTHERMAL
+// isothermal gas, P = C_ISO^2 rho (energy is still evolved but does not feed back on the pressure)
+class eos_isothermal{
+public:
+        static inline double pressure(double RHO, [[maybe_unused]] double E_INT){
+                return EOS_C_ISO*EOS_C_ISO * RHO;
+        }
+
+        static inline double internal_energy(double RHO, double PRESSURE){
+                return PRESSURE/((GAMMA-1.0)*RHO);
+        }
+
+        static inline double sound_speed_sq([[maybe_unused]] double RHO, [[maybe_unused]] double E_INT, [[maybe_unused]] double PRESSURE){
+                return EOS_C_ISO*EOS_C_ISO;
+        }
+
+        static inline double sound_speed_sq_enthalpy([[maybe_unused]] double RHO, [[maybe_unused]] double H, [[maybe_unused]] double VEL_SQ_SUM){
+                return EOS_C_ISO*EOS_C_ISO;
+        }
+
+        static inline void derivatives([[maybe_unused]] double RHO, [[maybe_unused]] double E_INT, double &CHI, double &KAPPA){
+                CHI   = EOS_C_ISO*EOS_C_ISO;
+                KAPPA = 0.0;
+        }
+};
+#endif
+
+#ifdef EOS_POLYTROPIC
+// barotropic polytrope, P = K_POLY rho^GAMMA_POLY
+class eos_polytropic{
+public:
+        static inline double pressure(double RHO, [[maybe_unused]] double E_INT){
+                return EOS_K_POLY * pow(RHO, EOS_GAMMA_POLY);
+        }
+
+        static inline double internal_energy(double RHO, double PRESSURE){
+                return PRESSURE/((EOS_GAMMA_POLY-1.0)*RHO);
+        }
+
+        static inline double sound_speed_sq(double RHO, [[maybe_unused]] double E_INT, [[maybe_unused]] double PRESSURE){
+                return EOS_GAMMA_POLY * EOS_K_POLY * pow(RHO, EOS_GAMMA_POLY-1.0);
+        }
+
+        static inline double sound_speed_sq_enthalpy(double RHO, [[maybe_unused]] double H, [[maybe_unused]] double VEL_SQ_SUM){
+                return EOS_GAMMA_POLY * EOS_K_POLY * pow(RHO, EOS_GAMMA_POLY-1.0);
+        }
+
+        static inline void derivatives(double RHO, [[maybe_unused]] double E_INT, double &CHI, double &KAPPA){
+                CHI   = EOS_GAMMA_POLY * EOS_K_POLY * pow(RHO, EOS_GAMMA_POLY-1.0);
+                KAPPA = 0.0;
+        }
+};
+#endif
+
+#ifdef EOS_TABLE
+/*
+Tabulated EOS, bilinear in log10(rho) and log10(e_int) and clamped at the table edges.
+        File format (text):
+                N_RHO N_E
+                LOG_RHO_MIN LOG_RHO_MAX LOG_E_MIN LOG_E_MAX
+                N_RHO*N_E lines of "PRESSURE SOUND_SPEED_SQ", e varying fastest
+        The table is stored as the dimensionless ratios P/(rho e) and c^2/e, interleaved per node, so one lookup
+        touches two adjacent cache lines and a 64x64 table (64 kB) stays resident in L2.
+*/
+class eos_table{
+private:
+        struct grid{
+                int N_RHO = 0, N_E = 0;
+                double LOG_RHO_MIN = 0.0, LOG_E_MIN = 0.0;
+                double RHO_MIN = 0.0, E_MIN = 0.0;     // table edges, states below (or NaN) are looked up there
+                double INV_D_RHO = 0.0, INV_D_E = 0.0;
+                std::vector<double> NODE;       // NODE[2*(i*N_E+j)] = P/(rho e), NODE[2*(i*N_E+j)+1] = c^2/e
+        };
+
+        static grid &table(){
+                static grid TABLE;
+                return TABLE;
+        }
+
+        // bilinear interpolation of both ratios at (rho, e_int). Values at or below the table minimum, zero, negative
+        // (after the M_LIM/E_LIM floors or a negative half step energy) and NaN are looked up at the minimum, never
+        // passed to log10, so the node index always lies in the table.
+        static inline void lookup(double RHO, double E_INT, double &P_RATIO, double &C_RATIO){
+                const grid &T = table();
+                double X = (log10(RHO > T.RHO_MIN ? RHO : T.RHO_MIN) - T.LOG_RHO_MIN)*T.INV_D_RHO;
+                double Y = (log10(E_INT > T.E_MIN ? E_INT : T.E_MIN) - T.LOG_E_MIN)*T.INV_D_E;
+                X = !(X >= 0.0) ? 0.0 : (X > T.N_RHO-1.000001 ? T.N_RHO-1.000001 : X);
+                Y = !(Y >= 0.0) ? 0.0 : (Y > T.N_E-1.000001 ? T.N_E-1.000001 : Y);
+                int I = int(X), J = int(Y);
+                double FX = X - I, FY = Y - J;
+                const double *N00 = &T.NODE[2*(I*T.N_E + J)];
+                const double *N10 = N00 + 2*T.N_E;
+                P_RATIO = (1.0-FX)*((1.0-FY)*N00[0] + FY*N00[2]) + FX*((1.0-FY)*N10[0] + FY*N10[2]);
+                C_RATIO = (1.0-FX)*((1.0-FY)*N00[1] + FY*N00[3]) + FX*((1.0-FY)*N10[1] + FY*N10[3]);
+        }
+
+public:
+        static bool load(std::string FILE_NAME){
+                grid &T = table();
+                double LOG_RHO_MAX, LOG_E_MAX, P, C_SQ, RHO, E_INT;
+                std::ifstream FILE(FILE_NAME);
+                if(!FILE.is_open()){
+                        std::cout << "EWARNING: Cannot open EOS table " << FILE_NAME << std::endl;
+                        return false;
+                }
+                FILE >> T.N_RHO >> T.N_E;
+                FILE >> T.LOG_RHO_MIN >> LOG_RHO_MAX >> T.LOG_E_MIN >> LOG_E_MAX;
+                if(FILE.fail()){
+                        std::cout << "EWARNING: EOS table " << FILE_NAME << " has a malformed header" << std::endl;
+                        return false;
+                }
+                if(T.N_RHO < 2 or T.N_E < 2){
+                        std::cout << "EWARNING: EOS table needs at least 2x2 nodes" << std::endl;
+                        return false;
+                }
+                if(!(LOG_RHO_MAX > T.LOG_RHO_MIN) or !(LOG_E_MAX > T.LOG_E_MIN)){
+                        std::cout << "EWARNING: EOS table " << FILE_NAME << " needs increasing log10(rho) and log10(e) ranges" << std::endl;
+                        return false;
+                }
+                T.RHO_MIN   = pow(10.0, T.LOG_RHO_MIN);
+                T.E_MIN     = pow(10.0, T.LOG_E_MIN);
+                T.INV_D_RHO = (T.N_RHO-1)/(LOG_RHO_MAX - T.LOG_RHO_MIN);
+                T.INV_D_E   = (T.N_E-1)/(LOG_E_MAX - T.LOG_E_MIN);
+                T.NODE.resize(2*T.N_RHO*T.N_E);
+                for(int i=0; i<T.N_RHO; ++i){
+                        RHO = pow(10.0, T.LOG_RHO_MIN + i/T.INV_D_RHO);
+                        for(int j=0; j<T.N_E; ++j){
+                                E_INT = pow(10.0, T.LOG_E_MIN + j/T.INV_D_E);
+                                FILE >> P >> C_SQ;
+                                if(FILE.fail()){                                        // end of file is fine after the last node
+                                        std::cout << "EWARNING: EOS table " << FILE_NAME << " ends at node " << i*T.N_E + j << " of " << T.N_RHO*T.N_E << std::endl;
+                                        return false;
+                                }
+                                T.NODE[2*(i*T.N_E+j)]   = P/(RHO*E_INT);
+                                T.NODE[2*(i*T.N_E+j)+1] = C_SQ/E_INT;
+                        }
+                }
+                std::cout << "Read EOS table " << FILE_NAME << " (" << T.N_RHO << "x" << T.N_E << ")" << std::endl;
+                return true;
+        }
+
+        static inline double pressure(double RHO, double E_INT){
+                double P_RATIO, C_RATIO;
+                lookup(RHO, E_INT, P_RATIO, C_RATIO);
+                return P_RATIO * RHO * E_INT;
+        }
+
+        // invert P = rho e P_RATIO(rho,e) by fixed point iteration (P_RATIO varies slowly with e)
+        static inline double internal_energy(double RHO, double PRESSURE){
+                double P_RATIO, C_RATIO;
+                double E_INT = PRESSURE/((GAMMA-1.0)*RHO);
+                for(int k=0; k<4; ++k){
+                        lookup(RHO, E_INT, P_RATIO, C_RATIO);
+                        E_INT = PRESSURE/(P_RATIO*RHO);
+                }
+                return E_INT;
+        }
+
+        static inline double sound_speed_sq(double RHO, double E_INT, [[maybe_unused]] double PRESSURE){
+                double P_RATIO, C_RATIO;
+                lookup(RHO, E_INT, P_RATIO, C_RATIO);
+                return C_RATIO * E_INT;
+        }
+
+        // specific enthalpy h = e (1 + P_RATIO), solved for e by fixed point iteration
+        static inline double sound_speed_sq_enthalpy(double RHO, double H, double VEL_SQ_SUM){
+                double P_RATIO, C_RATIO;
+                double H_INT = H - VEL_SQ_SUM/2.0;
+                double E_INT = H_INT/GAMMA;
+                for(int k=0; k<3; ++k){
+                        lookup(RHO, E_INT, P_RATIO, C_RATIO);
+                        E_INT = H_INT/(1.0 + P_RATIO);
+                }
+                lookup(RHO, E_INT, P_RATIO, C_RATIO);
+                return C_RATIO * E_INT;
+        }
+
+        // central differences of the interpolated pressure (relative step, the table is bilinear in the logarithms)
+        static inline void derivatives(double RHO, double E_INT, double &CHI, double &KAPPA){
+                const double D = 1.0e-4;
+                CHI   = (pressure(RHO*(1.0+D), E_INT) - pressure(RHO*(1.0-D), E_INT))/(2.0*D*RHO);
+                KAPPA = (pressure(RHO, E_INT*(1.0+D)) - pressure(RHO, E_INT*(1.0-D)))/(2.0*D*E_INT*RHO);
+        }
+};
+#endif
+
+#if defined(EOS_ISOTHERMAL)
+typedef eos_isothermal EOS;
+#elif defined(EOS_POLYTROPIC)
+typedef eos_polytropic EOS;
+#elif defined(EOS_TABLE)
+typedef eos_table EOS;
+#else
+typedef eos_ideal EOS;
+#endif
+
+#if defined(EOS_ISOTHERMAL) or defined(EOS_POLYTROPIC) or defined(EOS_TABLE)
+#define EOS_NON_IDEAL
+#endif
+
+/*
+Linearisation of the pressure about a Roe averaged state, dP = ALPHA drho - KAPPA vel.d(rho vel) + KAPPA dE, and the sound
+speed of the linearised flux Jacobian C_SQ = ALPHA + KAPPA (H - vel^2). E_INT is the Roe (sqrt(rho) weighted) average of the
+vertex internal energies. Ideal gas: ALPHA = (GAMMA-1) vel^2/2, KAPPA = GAMMA-1; barotropic EOS: KAPPA = 0.
+*/
+inline void eos_linearise(double RHO, double E_INT, double H, double VEL_SQ_SUM, double &ALPHA, double &KAPPA, double &C_SQ){
+        double CHI;
+        EOS::derivatives(RHO, E_INT, CHI, KAPPA);
+        ALPHA = CHI - KAPPA*E_INT + 0.5*KAPPA*VEL_SQ_SUM;
+        C_SQ  = ALPHA + KAPPA*(H - VEL_SQ_SUM);
+}
+
+#endif
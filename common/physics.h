@@ -0,0 +1,82 @@
+/*
+Shared physics core for the Roe and RD solvers (header only, include after constants file)
+        N_DIM  => number of velocity components (1, 2 or 3)
+        N_VAR  => number of conserved variables (N_DIM + 2): mass density, N_DIM momenta, energy density
+        state_*  => act on the state of a single point/vertex/cell
+        batch_*  => the same for a block of up to PHYSICS_BLOCK points stored lane-major (one row per variable), so the
+                    EOS calls vectorise, bitwise identical to the state_* routines point by point
+*/
+
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <cmath>
+
+#include "eos.h"
+
+#ifdef _OPENMP
+#define PHYSICS_SIMD _Pragma("omp simd")
+#else
+#define PHYSICS_SIMD
+#endif
+
+#define PHYSICS_BLOCK 256       // points per batched call (row length of the batch_* arrays)
+
+// sum of squared velocity components
+template<int N_DIM>
+inline double state_velocity_sq(const double *VEL){
+        double VEL_SQ_SUM = VEL[0]*VEL[0];
+        for(int d=1; d<N_DIM; ++d){VEL_SQ_SUM = VEL_SQ_SUM + VEL[d]*VEL[d];}
+        return VEL_SQ_SUM;
+}
+
+// pressure from mass density, specific (total) energy and squared velocity
+inline double state_pressure(double RHO, double SPECIFIC_ENERGY, double VEL_SQ_SUM){
+        return EOS::pressure(RHO, SPECIFIC_ENERGY - VEL_SQ_SUM/2.0);
+}
+
+// specific (total) energy from pressure, mass density and squared velocity
+inline double state_specific_energy(double RHO, double PRESSURE, double VEL_SQ_SUM){
+        return EOS::internal_energy(RHO, PRESSURE) + VEL_SQ_SUM/2.0;
+}
+
+// primitive (rho, v, e) -> conserved (rho, rho v, rho e)
+template<int N_DIM>
+inline void state_prim_to_con(double RHO, const double *VEL, double SPECIFIC_ENERGY, double *U){
+        U[0] = RHO;
+        for(int d=0; d<N_DIM; ++d){U[d+1] = RHO * VEL[d];}
+        U[N_DIM+1] = RHO * SPECIFIC_ENERGY;
+}
+
+// conserved (rho, rho v, rho e) -> primitive (rho, v, e)
+template<int N_DIM>
+inline void state_con_to_prim(const double *U, double &RHO, double *VEL, double &SPECIFIC_ENERGY){
+        RHO = U[0];
+        for(int d=0; d<N_DIM; ++d){VEL[d] = U[d+1]/RHO;}
+        SPECIFIC_ENERGY = U[N_DIM+1]/RHO;
+}
+
+// Roe average of left (density L1, value L2) and right (density R1, value R2) states
+inline double roe_avg(double L1, double L2, double R1, double R2){
+        return (sqrt(L1)*L2 + sqrt(R1)*R2)/(sqrt(L1) + sqrt(R1));
+}
+
+//**********************************************************************************************************************
+// batched kernels, U[N_VAR][PHYSICS_BLOCK] and VEL[N_DIM][PHYSICS_BLOCK] hold point i in column i
+
+// conserved -> primitive including the pressure, floored at P_MIN (-HUGE_VAL for none)
+template<int N_DIM, int N_VAR = N_DIM+2>
+inline void batch_con_to_prim(int N, const double U[][PHYSICS_BLOCK], double *RHO, double VEL[][PHYSICS_BLOCK], double *SPECIFIC_ENERGY, double *PRESSURE, double P_MIN){
+        static_assert(N_VAR == N_DIM+2, "mass density, N_DIM momenta and energy density");
+        PHYSICS_SIMD
+        for(int i=0; i<N; ++i){
+                double VEL_I[N_DIM];
+                RHO[i] = U[0][i];
+                for(int d=0; d<N_DIM; ++d){VEL_I[d] = VEL[d][i] = U[d+1][i]/RHO[i];}
+                SPECIFIC_ENERGY[i] = U[N_VAR-1][i]/RHO[i];
+                PRESSURE[i] = state_pressure(RHO[i], SPECIFIC_ENERGY[i], state_velocity_sq<N_DIM>(VEL_I));
+                PRESSURE[i] = PRESSURE[i] < P_MIN ? P_MIN : PRESSURE[i];
+        }
+}
+
+#endif
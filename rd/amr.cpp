@@ -0,0 +1,331 @@
+/*
+Adaptive refinement by vertex insertion and removal (AMR)
+        Every MAX_TBIN steps, before the time bins are reset, triangles whose density or pressure varies across them by
+        more than AMR_REFINE (or, with SELF_GRAVITY, that are coarser than 1/AMR_JEANS of the local Jeans length) are
+        split at their centroid, and vertices whose triangles all vary by less than AMR_DEREFINE are removed: their
+        incident edges are flipped until three remain and the three triangles are merged. Both end with Lawson flips of
+        the surrounding edges (moving_mesh.cpp), so the mesh stays Delaunay and the changes stay local.
+
+        Each change records the duals it alters (DUAL_LEDGER, moving_mesh.cpp). Vertices whose dual shrank keep their
+        state, and those whose dual grew (the new vertex, the neighbours of a removed one) share what was given up in
+        proportion to their gains, so mass, momentum and energy summed over the vertices are conserved. Vertices touched
+        by a removal are locked for the rest of the pass, and a split is only made if its triangle still needs it. Dead
+        vertices and triangles are compacted at the end of the pass, keeping the vertex IDs equal to their index.
+
+        Needs MOVING_MESH (edge neighbours, flips, geometry recomputed every step).
+*/
+
+#ifndef MOVING_MESH
+#error "AMR: needs MOVING_MESH"
+#endif
+
+#define AMR_MAX_STAR 32                                 // vertices of higher valence are not removed
+
+struct AMR_COUNTS{
+        double A_MEAN, D_MEAN;                          // initial mean triangle area and dual
+        int N_REFINED, N_DEREFINED;                     // vertices inserted and removed in the last pass
+} AMR_STATE;
+
+void set_corner(TRIANGLE &T, int m, VERTEX *V){
+        if(m == 0){T.set_vertex_0(V);}
+        else if(m == 1){T.set_vertex_1(V);}
+        else{T.set_vertex_2(V);}
+}
+
+double triangle_area(TRIANGLE &T){
+        double P[3][2];
+        for(int m=0;m<3;++m){corner_position(T, m, P[m]);}
+        return 0.5*orient(P[0], P[1], P[2]);
+}
+
+void amr_setup(std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        AMR_STATE.A_MEAN = SIDE_LENGTH_X*SIDE_LENGTH_Y/MESH.size();
+        AMR_STATE.D_MEAN = SIDE_LENGTH_X*SIDE_LENGTH_Y/POINTS.size();
+}
+
+// largest relative variation of density and pressure over the corners. With SELF_GRAVITY, at least AMR_REFINE times
+// the triangle size in units of 1/AMR_JEANS of the smallest corner Jeans length
+double amr_indicator(TRIANGLE &T){
+        double IND = 0.0;
+        VERTEX *V[3] = {T.get_vertex_0(), T.get_vertex_1(), T.get_vertex_2()};
+        double R_MIN = V[0]->get_mass_density(), R_MAX = R_MIN, P_MIN = V[0]->get_pressure(), P_MAX = P_MIN;
+        for(int m=1;m<3;++m){
+                R_MIN = min_val(R_MIN, V[m]->get_mass_density());
+                R_MAX = max_val(R_MAX, V[m]->get_mass_density());
+                P_MIN = min_val(P_MIN, V[m]->get_pressure());
+                P_MAX = max_val(P_MAX, V[m]->get_pressure());
+        }
+        IND = max_val((R_MAX - R_MIN)/R_MIN, (P_MAX - P_MIN)/P_MIN);
+#ifdef SELF_GRAVITY
+        double SIZE = sqrt(2.0*std::abs(triangle_area(T)));
+        for(int m=0;m<3;++m){
+                double U = V[m]->get_x_velocity(), W = V[m]->get_y_velocity(), RHO = V[m]->get_mass_density();
+                double C2 = EOS::sound_speed_sq_enthalpy(RHO, (V[m]->get_u3() + V[m]->get_pressure())/RHO, U*U + W*W);
+                IND = max_val(IND, AMR_REFINE*AMR_JEANS*SIZE/sqrt(M_PI*C2/(GRAV*RHO)));
+        }
+#endif
+        return IND;
+}
+
+// Lawson flips from the edges on the STACK, skipping dead triangles
+void amr_lawson(std::vector<int> &STACK, std::vector<TRIANGLE> &MESH, const std::vector<char> &DEAD, DUAL_LEDGER &LEDGER){
+        while(not STACK.empty()){
+                int E = STACK.back();
+                STACK.pop_back();
+                if(E/3 < int(DEAD.size()) and DEAD[E/3]){continue;}
+                flip_edge(MESH, E/3, E%3, STACK, false, &LEDGER);
+        }
+}
+
+// room for N_NEW more vertices: if the vertices have to move, the triangles are pointed at the new storage by ID
+void amr_reserve(int N_NEW, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        if(POINTS.size() + N_NEW <= POINTS.capacity()){return;}
+        int N_TRIANG = MESH.size();
+        std::vector<int> ID(3*N_TRIANG);
+
+#pragma omp parallel for
+        for(int j=0;j<N_TRIANG;++j){
+                for(int m=0;m<3;++m){ID[3*j+m] = corner_vertex(MESH[j], m)->get_id();}
+        }
+        POINTS.reserve(POINTS.size() + N_NEW);
+#pragma omp parallel for
+        for(int j=0;j<N_TRIANG;++j){
+                for(int m=0;m<3;++m){set_corner(MESH[j], m, &POINTS[ID[3*j+m]]);}
+        }
+}
+
+// split triangle J (A,B,C) at its centroid P into J (A,B,P), K1 (B,C,P) and K2 (C,A,P), capacity for P reserved
+void amr_insert(int J, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH, const std::vector<char> &DEAD, DUAL_LEDGER &LEDGER){
+        VERTEX *V[3];
+        double P[3][2], C[2] = {0.0, 0.0};
+        for(int m=0;m<3;++m){
+                V[m] = corner_vertex(MESH[J], m);
+                corner_position(MESH[J], m, P[m]);
+                C[0] += P[m][0]/3.0;
+                C[1] += P[m][1]/3.0;
+        }
+
+        int N = POINTS.size();
+        POINTS.push_back(*V[0]);                                        // state set by ledger_settle
+        VERTEX *V_P = &POINTS[N];
+        V_P->set_id(N);
+        V_P->set_x(gen_wrap(C[0], SIDE_LENGTH_X));
+        V_P->set_y(gen_wrap(C[1], SIDE_LENGTH_Y));
+        V_P->set_dual(0.0);
+
+        for(int m=0;m<3;++m){ledger_add(&LEDGER, V[m]);}
+        ledger_add(&LEDGER, V_P);
+        MESH[J].setup_normals(false);
+        MESH[J].remove_dual();
+
+        int N_A = MESH_NEIGH[3*J], N_B = MESH_NEIGH[3*J+1], N_C = MESH_NEIGH[3*J+2];
+        int K1 = MESH.size(), K2 = K1 + 1, TRI[3] = {J, K1, K2};
+        TRIANGLE COPY = MESH[J];
+        MESH.push_back(COPY);
+        MESH.push_back(COPY);
+        MESH_NEIGH.resize(3*MESH.size());
+
+        for(int t=0;t<3;++t){
+                VERTEX *V_T[3] = {V[t], V[(t + 1) % 3], V_P};
+                double P_T[3][2] = {{P[t][0], P[t][1]}, {P[(t + 1) % 3][0], P[(t + 1) % 3][1]}, {C[0], C[1]}};
+                int CODE[3];
+                image_codes(V_T, P_T, CODE);                            // within the image of the parent triangle
+                for(int m=0;m<3;++m){
+                        set_corner(MESH[TRI[t]], m, V_T[m]);
+                        MESH[TRI[t]].set_shift(m, CODE[m]);
+                }
+                MESH[TRI[t]].set_boundary(CODE[0] or CODE[1] or CODE[2]);
+                MESH[TRI[t]].set_id(TRI[t]);
+                MESH[TRI[t]].setup_normals(false);
+                MESH[TRI[t]].add_dual();
+        }
+
+        MESH_NEIGH[3*J+0]  = K1; MESH_NEIGH[3*J+1]  = K2; MESH_NEIGH[3*J+2]  = N_C;
+        MESH_NEIGH[3*K1+0] = K2; MESH_NEIGH[3*K1+1] = J;  MESH_NEIGH[3*K1+2] = N_A;
+        MESH_NEIGH[3*K2+0] = J;  MESH_NEIGH[3*K2+1] = K1; MESH_NEIGH[3*K2+2] = N_B;
+        repoint_neighbour(MESH, N_A, J, K1, V[1], V[2]);
+        repoint_neighbour(MESH, N_B, J, K2, V[2], V[0]);
+
+        std::vector<int> STACK = {3*J+2, 3*K1+2, 3*K2+2};
+        amr_lawson(STACK, MESH, DEAD, LEDGER);
+}
+
+// remove V, incident to triangle J: flip its edges until three triangles remain, then merge them. False if it could
+// not be removed (the mesh stays valid, with the flipped edges made Delaunay again)
+bool amr_remove(VERTEX *V, int J, std::vector<TRIANGLE> &MESH, std::vector<char> &DEAD, DUAL_LEDGER &LEDGER){
+        std::vector<int> STAR, STACK;
+        auto fail = [&](){
+                amr_lawson(STACK, MESH, DEAD, LEDGER);
+                return false;
+        };
+        if(not vertex_star(MESH, J, V, STAR, AMR_MAX_STAR)){return false;}
+
+        while(STAR.size() > 3){
+                int FLIPPED = -1;
+                for(size_t n=0;n<STAR.size() and FLIPPED<0;++n){
+                        int T = STAR[n], m = corner_of(MESH[T], V), K = MESH_NEIGH[3*T + (m + 1) % 3];
+                        if(flip_edge(MESH, T, (m + 1) % 3, STACK, true, &LEDGER)){FLIPPED = corner_of(MESH[T], V) >= 0 ? T : K;}
+                }
+                if(FLIPPED < 0 or not vertex_star(MESH, FLIPPED, V, STAR, AMR_MAX_STAR)){return fail();}
+        }
+
+        // outer edge X -> Y of each triangle, the merged triangle is (X0, Y0, Z) in the frame of STAR[0]
+        int T[3], M[3], O[3];
+        VERTEX *X[3], *Y[3];
+        for(int n=0;n<3;++n){
+                T[n] = STAR[n];
+                M[n] = corner_of(MESH[T[n]], V);
+                O[n] = MESH_NEIGH[3*T[n] + M[n]];
+                X[n] = corner_vertex(MESH[T[n]], (M[n] + 1) % 3);
+                Y[n] = corner_vertex(MESH[T[n]], (M[n] + 2) % 3);
+                if(O[n] == STAR[0] or O[n] == STAR[1] or O[n] == STAR[2]){return fail();}
+        }
+        int YZ = -1, ZX = -1;
+        VERTEX *Z = (X[1] != X[0] and X[1] != Y[0]) ? X[1] : Y[1];
+        for(int n=1;n<3;++n){
+                if(X[n] == Y[0] and Y[n] == Z){YZ = n;}
+                if(X[n] == Z and Y[n] == X[0]){ZX = n;}
+        }
+        if(YZ < 0 or ZX < 0 or Z == X[0] or Z == Y[0]){return fail();}
+
+        double P[3][2], P_S[2], P_Z[2];
+        corner_position(MESH[T[0]], (M[0] + 1) % 3, P[0]);
+        corner_position(MESH[T[0]], (M[0] + 2) % 3, P[1]);
+        corner_position(MESH[T[YZ]], corner_of(MESH[T[YZ]], Y[0]), P_S);
+        corner_position(MESH[T[YZ]], corner_of(MESH[T[YZ]], Z), P_Z);
+        P[2][0] = P_Z[0] + P[1][0] - P_S[0];
+        P[2][1] = P_Z[1] + P[1][1] - P_S[1];
+
+        VERTEX *V_NEW[3] = {X[0], Y[0], Z};
+        int CODE[3];
+        if(orient(P[0], P[1], P[2]) <= 0.0 or not image_codes(V_NEW, P, CODE)){return fail();}
+
+        for(VERTEX *W : {V, X[0], Y[0], Z}){ledger_add(&LEDGER, W);}
+        int TBIN = min_val(MESH[T[0]].get_tbin(), min_val(MESH[T[1]].get_tbin(), MESH[T[2]].get_tbin()));
+        for(int n=0;n<3;++n){
+                MESH[T[n]].setup_normals(false);
+                MESH[T[n]].remove_dual();
+        }
+        for(int m=0;m<3;++m){
+                set_corner(MESH[T[0]], m, V_NEW[m]);
+                MESH[T[0]].set_shift(m, CODE[m]);
+        }
+        MESH[T[0]].set_boundary(CODE[0] or CODE[1] or CODE[2]);
+        MESH[T[0]].set_tbin(TBIN);
+        MESH[T[0]].setup_normals(false);
+        MESH[T[0]].add_dual();
+        V->set_dual(0.0);                                               // all of it given up, up to rounding
+        DEAD[T[1]] = DEAD[T[2]] = 1;
+
+        MESH_NEIGH[3*T[0]+0] = O[YZ];
+        MESH_NEIGH[3*T[0]+1] = O[ZX];
+        MESH_NEIGH[3*T[0]+2] = O[0];
+        repoint_neighbour(MESH, O[YZ], T[YZ], T[0], Y[0], Z);
+        repoint_neighbour(MESH, O[ZX], T[ZX], T[0], Z, X[0]);
+
+        for(int m=0;m<3;++m){STACK.push_back(3*T[0]+m);}
+        amr_lawson(STACK, MESH, DEAD, LEDGER);
+        return true;
+}
+
+// one refinement pass, true if the mesh changed. Vertex IDs stay equal to their index
+bool amr_update(std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        int N_POINTS = POINTS.size(), N_TRIANG = MESH.size(), N_SPLIT = 0;
+        std::vector<double> IND(N_TRIANG), V_MAX(N_POINTS, 0.0);
+        std::vector<int> INCIDENT(N_POINTS, -1);
+        std::vector<char> DEAD(N_TRIANG, 0), GONE(N_POINTS, 0), LOCKED(N_POINTS, 0);
+        DUAL_LEDGER LEDGER;
+
+        AMR_STATE.N_REFINED = AMR_STATE.N_DEREFINED = 0;
+
+#pragma omp parallel for reduction(+:N_SPLIT)
+        for(int j=0;j<N_TRIANG;++j){
+                IND[j] = amr_indicator(MESH[j]);
+                if(IND[j] > AMR_REFINE){N_SPLIT++;}
+        }
+        for(int j=0;j<N_TRIANG;++j){
+                for(int m=0;m<3;++m){
+                        int ID = corner_vertex(MESH[j], m)->get_id();
+                        V_MAX[ID] = max_val(V_MAX[ID], IND[j]);
+                        INCIDENT[ID] = j;
+                }
+        }
+        // and over the neighbours, so a smooth vertex next to a front is kept
+        std::vector<double> V_NEAR(V_MAX);
+        for(int j=0;j<N_TRIANG;++j){
+                double T_MAX = 0.0;
+                for(int m=0;m<3;++m){T_MAX = max_val(T_MAX, V_MAX[corner_vertex(MESH[j], m)->get_id()]);}
+                for(int m=0;m<3;++m){
+                        int ID = corner_vertex(MESH[j], m)->get_id();
+                        V_NEAR[ID] = max_val(V_NEAR[ID], T_MAX);
+                }
+        }
+
+        auto lock = [&](){
+                for(size_t n=0;n<LEDGER.size();++n){
+                        int ID = LEDGER[n].first->get_id();
+                        LOCKED[ID] = 1;
+                }
+                ledger_settle(LEDGER);
+                LEDGER.clear();
+        };
+
+        // removals in smooth regions, never of neighbours of a vertex changed in this pass
+        for(int i=0;i<N_POINTS;++i){
+                if(LOCKED[i] or INCIDENT[i] < 0 or V_NEAR[i] >= AMR_DEREFINE or POINTS[i].get_dual() >= AMR_MAX_AREA*AMR_STATE.D_MEAN){continue;}
+                if(amr_remove(&POINTS[i], INCIDENT[i], MESH, DEAD, LEDGER)){
+                        GONE[i] = 1;
+                        AMR_STATE.N_DEREFINED++;
+                }
+                lock();
+        }
+
+        // splits of the triangles above AMR_REFINE, checked again as earlier changes may have replaced them
+        amr_reserve(N_SPLIT, POINTS, MESH);
+        for(int j=0;j<N_TRIANG;++j){
+                if(DEAD[j] or IND[j] <= AMR_REFINE or triangle_area(MESH[j]) <= AMR_MIN_AREA*AMR_STATE.A_MEAN){continue;}
+                if(amr_indicator(MESH[j]) <= AMR_REFINE){continue;}
+                amr_insert(j, POINTS, MESH, DEAD, LEDGER);
+                AMR_STATE.N_REFINED++;
+                ledger_settle(LEDGER);
+                LEDGER.clear();
+        }
+
+        if(AMR_STATE.N_REFINED + AMR_STATE.N_DEREFINED == 0){return false;}
+
+        // compact the vertices and triangles, pointers and neighbours through the new indices
+        int N_NEW = POINTS.size(), K = 0;
+        std::vector<int> NEW_ID(N_NEW), NEW_J(MESH.size());
+        GONE.resize(N_NEW, 0);
+        DEAD.resize(MESH.size(), 0);
+        for(int i=0;i<N_NEW;++i){
+                NEW_ID[i] = K;
+                if(GONE[i]){continue;}
+                if(K != i){POINTS[K] = POINTS[i];}
+                POINTS[K].set_id(K);
+                K++;
+        }
+        VERTEX *BASE = POINTS.data();
+#pragma omp parallel for
+        for(int j=0;j<int(MESH.size());++j){
+                for(int m=0;m<3;++m){set_corner(MESH[j], m, &POINTS[NEW_ID[corner_vertex(MESH[j], m) - BASE]]);}
+        }
+        POINTS.resize(K);
+
+        K = 0;
+        for(int j=0;j<int(MESH.size());++j){
+                NEW_J[j] = K;
+                if(not DEAD[j]){K++;}
+        }
+        for(int j=0;j<int(MESH.size());++j){
+                if(DEAD[j]){continue;}
+                int J = NEW_J[j];
+                if(J != j){MESH[J] = MESH[j];}
+                MESH[J].set_id(J);
+                for(int m=0;m<3;++m){MESH_NEIGH[3*J+m] = MESH_NEIGH[3*j+m] < 0 ? -1 : NEW_J[MESH_NEIGH[3*j+m]];}
+        }
+        MESH.resize(K);
+        MESH_NEIGH.resize(3*K);
+
+        return true;
+}
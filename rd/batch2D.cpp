@@ -0,0 +1,333 @@
+/*
+Batched first half residual kernel (2D)
+        Processes L triangles per call with every per-element quantity stored lane-major (last index = lane), so each
+        lane loop maps onto one SIMD register (L = 4 for AVX2, 8 for AVX-512 with double precision). The arithmetic is
+        the same as TRIANGLE::calculate_first_half, except INFLOW_MINUS_SUM is inverted in closed form (adjugate) instead
+        of with LAPACK. Lanes with a singular INFLOW_MINUS_SUM are recomputed with the scalar kernel, which reports them.
+*/
+
+#define LANE_LOOP PHYSICS_SIMD for(int l=0;l<L;++l)
+
+// closed form inverse of L 4x4 matrices, A[i][j][l] -> INV[i][j][l], DET[l] = determinant
+template<int L>
+inline void inverse_4x4_lanes(double A[4][4][L], double INV[4][4][L], double DET[L]){
+        LANE_LOOP{
+                double S0 = A[0][0][l]*A[1][1][l] - A[1][0][l]*A[0][1][l];
+                double S1 = A[0][0][l]*A[1][2][l] - A[1][0][l]*A[0][2][l];
+                double S2 = A[0][0][l]*A[1][3][l] - A[1][0][l]*A[0][3][l];
+                double S3 = A[0][1][l]*A[1][2][l] - A[1][1][l]*A[0][2][l];
+                double S4 = A[0][1][l]*A[1][3][l] - A[1][1][l]*A[0][3][l];
+                double S5 = A[0][2][l]*A[1][3][l] - A[1][2][l]*A[0][3][l];
+
+                double C5 = A[2][2][l]*A[3][3][l] - A[3][2][l]*A[2][3][l];
+                double C4 = A[2][1][l]*A[3][3][l] - A[3][1][l]*A[2][3][l];
+                double C3 = A[2][1][l]*A[3][2][l] - A[3][1][l]*A[2][2][l];
+                double C2 = A[2][0][l]*A[3][3][l] - A[3][0][l]*A[2][3][l];
+                double C1 = A[2][0][l]*A[3][2][l] - A[3][0][l]*A[2][2][l];
+                double C0 = A[2][0][l]*A[3][1][l] - A[3][0][l]*A[2][1][l];
+
+                DET[l] = S0*C5 - S1*C4 + S2*C3 + S3*C2 - S4*C1 + S5*C0;
+                double INV_DET = 1.0/DET[l];
+
+                INV[0][0][l] = ( A[1][1][l]*C5 - A[1][2][l]*C4 + A[1][3][l]*C3)*INV_DET;
+                INV[0][1][l] = (-A[0][1][l]*C5 + A[0][2][l]*C4 - A[0][3][l]*C3)*INV_DET;
+                INV[0][2][l] = ( A[3][1][l]*S5 - A[3][2][l]*S4 + A[3][3][l]*S3)*INV_DET;
+                INV[0][3][l] = (-A[2][1][l]*S5 + A[2][2][l]*S4 - A[2][3][l]*S3)*INV_DET;
+
+                INV[1][0][l] = (-A[1][0][l]*C5 + A[1][2][l]*C2 - A[1][3][l]*C1)*INV_DET;
+                INV[1][1][l] = ( A[0][0][l]*C5 - A[0][2][l]*C2 + A[0][3][l]*C1)*INV_DET;
+                INV[1][2][l] = (-A[3][0][l]*S5 + A[3][2][l]*S2 - A[3][3][l]*S1)*INV_DET;
+                INV[1][3][l] = ( A[2][0][l]*S5 - A[2][2][l]*S2 + A[2][3][l]*S1)*INV_DET;
+
+                INV[2][0][l] = ( A[1][0][l]*C4 - A[1][1][l]*C2 + A[1][3][l]*C0)*INV_DET;
+                INV[2][1][l] = (-A[0][0][l]*C4 + A[0][1][l]*C2 - A[0][3][l]*C0)*INV_DET;
+                INV[2][2][l] = ( A[3][0][l]*S4 - A[3][1][l]*S2 + A[3][3][l]*S0)*INV_DET;
+                INV[2][3][l] = (-A[2][0][l]*S4 + A[2][1][l]*S2 - A[2][3][l]*S0)*INV_DET;
+
+                INV[3][0][l] = (-A[1][0][l]*C3 + A[1][1][l]*C1 - A[1][2][l]*C0)*INV_DET;
+                INV[3][1][l] = ( A[0][0][l]*C3 - A[0][1][l]*C1 + A[0][2][l]*C0)*INV_DET;
+                INV[3][2][l] = (-A[3][0][l]*S3 + A[3][1][l]*S1 - A[3][2][l]*S0)*INV_DET;
+                INV[3][3][l] = ( A[2][0][l]*S3 - A[2][1][l]*S1 + A[2][2][l]*S0)*INV_DET;
+        }
+}
+
+// Calculate first half timestep change for L triangles at once (results are passed on with pass_update_half as usual)
+template<int L>
+void calculate_first_half_batch(TRIANGLE **TRI, double T, double DT){
+        int i,j,m;
+
+        double U_N[4][3][L], PRESSURE[3][L], SQ_RHO[3][L];
+        double N_X[3][L], N_Y[3][L], HALF_MAG[3][L], DUAL[3][L];
+
+        // Gather vertex states and geometry into lane-major arrays
+
+        for(int l=0;l<L;++l){
+                TRIANGLE &E = *TRI[l];
+                E.setup_positions();
+                E.setup_initial_state();
+                for(i=0;i<4;++i){for(m=0;m<3;++m){U_N[i][m][l] = E.U_N[i][m];}}
+                for(m=0;m<3;++m){
+                        SQ_RHO[m][l]   = sqrt(E.U_N[0][m]);                         // square roots stay out of the lane loops (errno)
+                        PRESSURE[m][l] = E.PRESSURE[m];
+                        N_X[m][l]      = E.NORMAL[m][0];
+                        N_Y[m][l]      = E.NORMAL[m][1];
+                        HALF_MAG[m][l] = E.HALF_MAG[m];
+                }
+                DUAL[0][l] = E.VERTEX_0->get_dual();
+                DUAL[1][l] = E.VERTEX_1->get_dual();
+                DUAL[2][l] = E.VERTEX_2->get_dual();
+        }
+
+        // Roe vector Z, parameter vector W_HAT and average state for each element
+
+        double Z[4][3][L], Z_BAR[4][L], W_HAT[4][3][L];
+        double C[L], U[L], V[L], H_AVG[L], U_C[L], V_C[L], H_C[L], ALPHA_C[L], KAPPA[L], KAPPA_2[L];
+
+        for(m=0;m<3;++m){
+                LANE_LOOP{
+                        Z[0][m][l] = SQ_RHO[m][l];
+                        Z[1][m][l] = U_N[1][m][l]/Z[0][m][l];
+                        Z[2][m][l] = U_N[2][m][l]/Z[0][m][l];
+                        Z[3][m][l] = (U_N[3][m][l] + PRESSURE[m][l])/Z[0][m][l];
+                }
+        }
+
+        for(i=0;i<4;++i){LANE_LOOP{Z_BAR[i][l] = (Z[i][0][l] + Z[i][1][l] + Z[i][2][l])/3.0;}}
+
+        LANE_LOOP{
+                U[l]     = Z_BAR[1][l]/Z_BAR[0][l];
+                V[l]     = Z_BAR[2][l]/Z_BAR[0][l];
+                H_AVG[l] = Z_BAR[3][l]/Z_BAR[0][l];
+        }
+
+#ifdef EOS_NON_IDEAL
+        // pressure linearised with the EOS derivatives (see TRIANGLE::build_inflow), EOS calls stay out of the lane loops
+        double ALPHA[L];
+        for(int l=0;l<L;++l){
+                double E_BAR = 0.0;
+                for(m=0;m<3;++m){E_BAR += Z[0][m][l]*(U_N[3][m][l] - 0.5*(U_N[1][m][l]*U_N[1][m][l] + U_N[2][m][l]*U_N[2][m][l])/U_N[0][m][l])/U_N[0][m][l];}
+                E_BAR /= 3.0*Z_BAR[0][l];
+                eos_linearise(Z_BAR[0][l]*Z_BAR[0][l], E_BAR, H_AVG[l], U[l]*U[l] + V[l]*V[l], ALPHA[l], KAPPA[l], C[l]);
+                KAPPA_2[l] = KAPPA[l] - 1.0;
+        }
+#else
+        LANE_LOOP{KAPPA[l] = GAMMA_1; KAPPA_2[l] = GAMMA_2;}
+#endif
+
+        for(m=0;m<3;++m){
+                LANE_LOOP{
+                        W_HAT[0][m][l] =  2.0*Z_BAR[0][l]*Z[0][m][l];
+                        W_HAT[1][m][l] =  Z_BAR[1][l]*Z[0][m][l] + Z_BAR[0][l]*Z[1][m][l];
+                        W_HAT[2][m][l] =  Z_BAR[2][l]*Z[0][m][l] + Z_BAR[0][l]*Z[2][m][l];
+#ifdef EOS_NON_IDEAL
+                        W_HAT[3][m][l] = (Z_BAR[3][l]*Z[0][m][l] + Z_BAR[0][l]*Z[3][m][l] - ALPHA[l]*W_HAT[0][m][l] + KAPPA[l]*(U[l]*W_HAT[1][m][l] + V[l]*W_HAT[2][m][l]))/(1.0 + KAPPA[l]);
+#else
+                        W_HAT[3][m][l] = (Z_BAR[3][l]*Z[0][m][l] + GAMMA_1*Z_BAR[1][l]*Z[1][m][l] + GAMMA_1*Z_BAR[2][l]*Z[2][m][l] + Z_BAR[0][l]*Z[3][m][l])/GAMMA;
+#endif
+                }
+        }
+
+        // Element residual PHI (flux integral, see TRIANGLE::build_inflow)
+
+        double PHI[4][L];
+
+        for(i=0;i<4;++i){LANE_LOOP{PHI[i][l] = 0.0;}}
+
+        for(m=0;m<3;++m){
+                LANE_LOOP{
+#ifdef EOS_NON_IDEAL
+                        double P2  = PRESSURE[m][l];
+#else
+                        double P2  = (GAMMA_1/GAMMA)*(Z_BAR[0][l]*Z[3][m][l] + Z_BAR[3][l]*Z[0][m][l] - Z_BAR[1][l]*Z[1][m][l] - Z_BAR[2][l]*Z[2][m][l]);
+#endif
+                        double FX0 = Z_BAR[0][l]*Z[1][m][l] + Z_BAR[1][l]*Z[0][m][l];
+                        double FX1 = 2.0*Z_BAR[1][l]*Z[1][m][l] + P2;
+                        double FX2 = Z_BAR[1][l]*Z[2][m][l] + Z_BAR[2][l]*Z[1][m][l];
+                        double FX3 = Z_BAR[1][l]*Z[3][m][l] + Z_BAR[3][l]*Z[1][m][l];
+                        double FY0 = Z_BAR[0][l]*Z[2][m][l] + Z_BAR[2][l]*Z[0][m][l];
+                        double FY2 = 2.0*Z_BAR[2][l]*Z[2][m][l] + P2;
+                        double FY3 = Z_BAR[2][l]*Z[3][m][l] + Z_BAR[3][l]*Z[2][m][l];
+                        PHI[0][l] += HALF_MAG[m][l]*(N_X[m][l]*FX0 + N_Y[m][l]*FY0);
+                        PHI[1][l] += HALF_MAG[m][l]*(N_X[m][l]*FX1 + N_Y[m][l]*FX2);
+                        PHI[2][l] += HALF_MAG[m][l]*(N_X[m][l]*FX2 + N_Y[m][l]*FY2);
+                        PHI[3][l] += HALF_MAG[m][l]*(N_X[m][l]*FX3 + N_Y[m][l]*FY3);
+                }
+        }
+
+        // Roe average sound speed
+
+#ifndef EOS_NON_IDEAL
+        LANE_LOOP{C[l] = EOS::sound_speed_sq_enthalpy(Z_BAR[0][l]*Z_BAR[0][l], H_AVG[l], U[l]*U[l] + V[l]*V[l]);}
+#endif
+
+        for(int l=0;l<L;++l){C[l] = sqrt(C[l]);}
+
+        LANE_LOOP{
+                U_C[l]     = U[l]/C[l];
+                V_C[l]     = V[l]/C[l];
+                H_C[l]     = H_AVG[l]/C[l];
+#ifdef EOS_NON_IDEAL
+                ALPHA_C[l] = ALPHA[l]/C[l];
+#else
+                ALPHA_C[l] = GAMMA_1*(U[l]*U[l] + V[l]*V[l])/2.0/C[l];
+#endif
+        }
+
+        // K+ matrix for each vertex (K- and K are not formed, see TRIANGLE::build_inflow)
+
+        double INFLOW[4][4][3][L];
+
+        for(m=0;m<3;++m){
+                LANE_LOOP{
+                        double W = U[l]*N_X[m][l] + V[l]*N_Y[m][l];
+                        double VALUE1 = 0.0 > W + C[l] ? 0.0 : W + C[l];
+                        double VALUE2 = 0.0 > W - C[l] ? 0.0 : W - C[l];
+                        double VALUE3 = 0.0 > W ? 0.0 : W;
+                        double VALUE12  = (VALUE1 - VALUE2)/2.0;
+                        double VALUE123 = (VALUE1 + VALUE2 - 2.0*VALUE3)/2.0;
+                        double CL = C[l], UC = U_C[l], VC = V_C[l], HC = H_C[l], AC = ALPHA_C[l], K1 = KAPPA[l], K2 = KAPPA_2[l];
+                        double NX = N_X[m][l], NY = N_Y[m][l];
+
+                        INFLOW[0][0][m][l] = HALF_MAG[m][l]*(AC*VALUE123/CL - W*VALUE12/CL + VALUE3);
+                        INFLOW[0][1][m][l] = HALF_MAG[m][l]*(-1.0*K1*UC*VALUE123/CL + NX*VALUE12/CL);
+                        INFLOW[0][2][m][l] = HALF_MAG[m][l]*(-1.0*K1*VC*VALUE123/CL + NY*VALUE12/CL);
+                        INFLOW[0][3][m][l] = HALF_MAG[m][l]*(K1*VALUE123/(CL*CL));
+
+                        INFLOW[1][0][m][l] = HALF_MAG[m][l]*((AC*UC - W*NX)*VALUE123 + (AC*NX - UC*W)*VALUE12);
+                        INFLOW[1][1][m][l] = HALF_MAG[m][l]*((NX*NX - K1*UC*UC)*VALUE123 - (K2*UC*NX*VALUE12) + VALUE3);
+                        INFLOW[1][2][m][l] = HALF_MAG[m][l]*((NX*NY - K1*UC*VC)*VALUE123 + (UC*NY - K1*VC*NX)*VALUE12);
+                        INFLOW[1][3][m][l] = HALF_MAG[m][l]*(K1*UC*VALUE123/CL + K1*NX*VALUE12/CL);
+
+                        INFLOW[2][0][m][l] = HALF_MAG[m][l]*((AC*VC - W*NY)*VALUE123 + (AC*NY - VC*W)*VALUE12);
+                        INFLOW[2][1][m][l] = HALF_MAG[m][l]*((NX*NY - K1*UC*VC)*VALUE123 + (VC*NX - K1*UC*NY)*VALUE12);
+                        INFLOW[2][2][m][l] = HALF_MAG[m][l]*((NY*NY - K1*VC*VC)*VALUE123 - (K2*VC*NY*VALUE12) + VALUE3);
+                        INFLOW[2][3][m][l] = HALF_MAG[m][l]*(K1*VC*VALUE123/CL + K1*NY*VALUE12/CL);
+
+                        INFLOW[3][0][m][l] = HALF_MAG[m][l]*((AC*HC - W*W)*VALUE123 + W*(AC - HC)*VALUE12);
+#ifdef EOS_NON_IDEAL
+                        INFLOW[3][1][m][l] = HALF_MAG[m][l]*((W*NX - K1*HC*UC)*VALUE123 + (HC*NX - K1*UC*W)*VALUE12);
+                        INFLOW[3][2][m][l] = HALF_MAG[m][l]*((W*NY - K1*HC*VC)*VALUE123 + (HC*NY - K1*VC*W)*VALUE12);
+#else
+                        INFLOW[3][1][m][l] = HALF_MAG[m][l]*((W*NX - U[l] - AC*UC)*VALUE123 + (HC*NX - K1*UC*W)*VALUE12);
+                        INFLOW[3][2][m][l] = HALF_MAG[m][l]*((W*NY - V[l] - AC*VC)*VALUE123 + (HC*NY - K1*VC*W)*VALUE12);
+#endif
+                        INFLOW[3][3][m][l] = HALF_MAG[m][l]*(K1*HC*VALUE123/CL + K1*W*VALUE12/CL + VALUE3);
+                }
+        }
+
+        // Inverse of the K- sum (= -sum of K+)
+
+        double INFLOW_MINUS_SUM[4][4][L], INV[4][4][L], DET[L];
+
+        for(i=0;i<4;++i){
+                for(j=0;j<4;++j){
+                        LANE_LOOP{INFLOW_MINUS_SUM[i][j][l] = -1.0*(INFLOW[i][j][0][l] + INFLOW[i][j][1][l] + INFLOW[i][j][2][l]);}
+                }
+        }
+
+        inverse_4x4_lanes<L>(INFLOW_MINUS_SUM, INV, DET);
+
+        // Distribution (LDA and/or N)
+
+#if defined(LDA_SCHEME) or defined(BLENDED)
+        double BETA[4][4][3][L], FLUC_LDA[4][3][L];
+
+        for(i=0;i<4;++i){
+                for(j=0;j<4;++j){
+                        for(m=0;m<3;++m){
+                                LANE_LOOP{BETA[i][j][m][l] = -1.0*(INFLOW[i][0][m][l]*INV[0][j][l] + INFLOW[i][1][m][l]*INV[1][j][l] + INFLOW[i][2][m][l]*INV[2][j][l] + INFLOW[i][3][m][l]*INV[3][j][l]);}
+                        }
+                }
+        }
+
+        for(i=0;i<4;++i){
+                for(m=0;m<3;++m){
+                        LANE_LOOP{FLUC_LDA[i][m][l] = BETA[i][0][m][l]*PHI[0][l] + BETA[i][1][m][l]*PHI[1][l] + BETA[i][2][m][l]*PHI[2][l] + BETA[i][3][m][l]*PHI[3][l];}
+                }
+        }
+#endif
+
+#if defined(N_SCHEME) or defined(BLENDED)
+        double KZ_SUM[4][L], BRACKET[4][3][L], FLUC_N[4][3][L];
+
+        for(i=0;i<4;++i){
+                LANE_LOOP{
+                        KZ_SUM[i][l] = PHI[i][l];
+                        for(m=0;m<3;++m){
+                                KZ_SUM[i][l] -= INFLOW[i][0][m][l]*W_HAT[0][m][l] + INFLOW[i][1][m][l]*W_HAT[1][m][l] + INFLOW[i][2][m][l]*W_HAT[2][m][l] + INFLOW[i][3][m][l]*W_HAT[3][m][l];
+                        }
+                }
+        }
+
+        for(i=0;i<4;++i){
+                for(m=0;m<3;++m){
+                        LANE_LOOP{BRACKET[i][m][l] = W_HAT[i][m][l] - (INV[i][0][l]*KZ_SUM[0][l] + INV[i][1][l]*KZ_SUM[1][l] + INV[i][2][l]*KZ_SUM[2][l] + INV[i][3][l]*KZ_SUM[3][l]);}
+                }
+        }
+
+        for(i=0;i<4;++i){
+                for(m=0;m<3;++m){
+                        LANE_LOOP{FLUC_N[i][m][l] = INFLOW[i][0][m][l]*BRACKET[0][m][l] + INFLOW[i][1][m][l]*BRACKET[1][m][l] + INFLOW[i][2][m][l]*BRACKET[2][m][l] + INFLOW[i][3][m][l]*BRACKET[3][m][l];}
+                }
+        }
+#endif
+
+        // Scatter results back to the triangles
+
+        for(int l=0;l<L;++l){
+                TRIANGLE &E = *TRI[l];
+                if(DET[l] == 0.0 or not std::isfinite(DET[l])){
+                        E.calculate_first_half(T,DT);
+                        continue;
+                }
+                for(m=0;m<3;++m){E.DUAL[m] = DUAL[m][l];}
+                for(i=0;i<4;++i){
+                        E.PHI[i] = PHI[i][l];
+                        for(m=0;m<3;++m){
+#if defined(LDA_SCHEME) or defined(BLENDED)
+                                E.FLUC_LDA[i][m] = FLUC_LDA[i][m][l];
+                                for(j=0;j<4;++j){E.BETA[i][j][m] = BETA[i][j][m][l];}
+#endif
+#if defined(N_SCHEME) or defined(BLENDED)
+                                E.FLUC_N[i][m] = FLUC_N[i][m][l];
+#endif
+                        }
+                }
+#ifdef BLENDED
+                for(i=0;i<4;i++){
+                        double THETA = abs(E.PHI[i])/(abs(E.FLUC_N[i][0]) + abs(E.FLUC_N[i][1]) + abs(E.FLUC_N[i][2]));
+                        for(m=0;m<3;++m){E.FLUC_B[i][m] = THETA*E.FLUC_N[i][m] + (1.0 - THETA)*E.FLUC_LDA[i][m];}
+                }
+#endif
+                for(i=0;i<4;i++){
+#if defined(LDA_SCHEME)
+                        E.DU0_HALF[i] = -1.0*DT*E.FLUC_LDA[i][0]/E.DUAL[0];
+                        E.DU1_HALF[i] = -1.0*DT*E.FLUC_LDA[i][1]/E.DUAL[1];
+                        E.DU2_HALF[i] = -1.0*DT*E.FLUC_LDA[i][2]/E.DUAL[2];
+#elif defined(N_SCHEME)
+                        E.DU0_HALF[i] = -1.0*DT*E.FLUC_N[i][0]/E.DUAL[0];
+                        E.DU1_HALF[i] = -1.0*DT*E.FLUC_N[i][1]/E.DUAL[1];
+                        E.DU2_HALF[i] = -1.0*DT*E.FLUC_N[i][2]/E.DUAL[2];
+#else
+                        E.DU0_HALF[i] = -1.0*DT*E.FLUC_B[i][0]/E.DUAL[0];
+                        E.DU1_HALF[i] = -1.0*DT*E.FLUC_B[i][1]/E.DUAL[1];
+                        E.DU2_HALF[i] = -1.0*DT*E.FLUC_B[i][2]/E.DUAL[2];
+#endif
+                }
+        }
+}
+
+// Calculate first half for a list of triangles in batches of BATCH_LANES, the remainder with the scalar kernel
+void calculate_first_half_list(std::vector<TRIANGLE*> &LIST, double T, double DT){
+        int N_LIST = LIST.size();
+        int N_FULL = N_LIST - N_LIST % BATCH_LANES;
+#ifdef PARA_RES
+        #pragma omp parallel for
+#endif
+        for(int j=0;j<N_FULL;j+=BATCH_LANES){
+                calculate_first_half_batch<BATCH_LANES>(&LIST[j], T, DT);
+        }
+        for(int j=N_FULL;j<N_LIST;++j){
+                LIST[j]->calculate_first_half(T,DT);
+        }
+}
@@ -0,0 +1,221 @@
+/*
+Characteristic N/LDA distribution (2D: D = 2, 3D: D = 3)
+        Every K matrix of an element is built from the same Roe averaged state, so in the symmetrising variables
+                Q = (dp/(rho c), du_1..du_D, ((H - v^2) drho + v.d(rho v) - dE)/c^2)
+        K_m = WEIGHT_m*((v.n_m) I + c M(n_m)). The entropy wave (last variable) decouples and is distributed with scalar
+        operations, the acoustic and shear waves form a symmetric (D+1)x(D+1) block whose K+ sum is inverted in closed
+        form. No LAPACK call and no exit: a singular block (stagnant flow, all inflow eigenvalues zero) is regularised.
+        dp = ALPHA drho - KAPPA v.d(rho v) + KAPPA dE is the pressure linearisation of the EOS (eos_linearise). The
+        entropy variable is (drho - dp/c^2)/KAPPA, scaled so that the map stays regular for a barotropic EOS (KAPPA = 0).
+
+        Inputs are the Roe vector average Z_BAR, LIN = (C, ALPHA, KAPPA) of the Roe state, the weights and normals of the
+        K matrices (K_m = WEIGHT_m*A.n_m), the linearised vertex states W_HAT and the element residual PHI. Outputs may be
+        NULL when the scheme does not need them. Returns 1 if sum K+ was singular (block regularised or no entropy inflow),
+        0 otherwise; such elements are also counted in N_SINGULAR (inverse.cpp).
+*/
+
+// conserved variable increment DU -> characteristic increment Q at the Roe state
+template<int D>
+inline void char_from_cons(double RHO, const double VEL[D], double Q2, double H, const double LIN[3], const double DU[D+2], double Q[D+2]){
+        double C = LIN[0], DRHO = DU[0], VEL_DM = 0.0;
+        for(int k=0;k<D;++k){
+                Q[1+k]  = (DU[1+k] - VEL[k]*DRHO)/RHO;
+                VEL_DM += VEL[k]*DU[1+k];
+        }
+        double DP = LIN[1]*DRHO + LIN[2]*(DU[D+1] - VEL_DM);
+        Q[0]     = DP/(RHO*C);
+        Q[D+1]   = ((H - Q2)*DRHO + VEL_DM - DU[D+1])/(C*C);
+}
+
+// characteristic increment Q -> conserved variable increment DU at the Roe state
+template<int D>
+inline void cons_from_char(double RHO, const double VEL[D], double Q2, double H, const double LIN[3], const double Q[D+2], double DU[D+2]){
+        double C = LIN[0], DP = RHO*C*Q[0], DRHO = LIN[2]*Q[D+1] + DP/(C*C);
+        DU[0]   = DRHO;
+        DU[D+1] = DP*(H - Q2)/(C*C) - LIN[1]*Q[D+1];
+        for(int k=0;k<D;++k){
+                DU[1+k]  = VEL[k]*DRHO + RHO*Q[1+k];
+                DU[D+1] += VEL[k]*DU[1+k];
+        }
+}
+
+// inverse of a symmetric positive semi-definite N x N matrix (Gauss-Jordan), regularised if (near) singular
+template<int N>
+inline int inverse_spd(const double A[N][N], double INV[N][N]){
+        double M[N][2*N], TRACE = 0.0, SHIFT = 0.0;
+        int REGULARISED = 0;
+
+        for(int i=0;i<N;++i){TRACE += A[i][i];}
+        if(not (TRACE > 0.0)){
+                for(int i=0;i<N;++i){for(int j=0;j<N;++j){INV[i][j] = 0.0;}}
+                return 1;
+        }
+
+        for(int ATTEMPT=0;ATTEMPT<2;++ATTEMPT){
+                bool SINGULAR = false;
+                for(int i=0;i<N;++i){
+                        for(int j=0;j<N;++j){
+                                M[i][j]   = A[i][j] + (i==j ? SHIFT : 0.0);
+                                M[i][N+j] = (i==j ? 1.0 : 0.0);
+                        }
+                }
+                for(int k=0;k<N and not SINGULAR;++k){
+                        if(M[k][k] <= 1.0e-12*TRACE){SINGULAR = true; break;}
+                        double PIVOT = 1.0/M[k][k];
+                        for(int j=0;j<2*N;++j){M[k][j] *= PIVOT;}
+                        for(int i=0;i<N;++i){
+                                if(i == k){continue;}
+                                double F = M[i][k];
+                                for(int j=0;j<2*N;++j){M[i][j] -= F*M[k][j];}
+                        }
+                }
+                if(not SINGULAR){break;}
+                SHIFT       = 1.0e-8*TRACE;
+                REGULARISED = 1;
+        }
+
+        for(int i=0;i<N;++i){for(int j=0;j<N;++j){INV[i][j] = M[i][N+j];}}
+        return REGULARISED;
+}
+
+template<int D>
+int characteristic_distribution(const double Z_BAR[D+2], const double LIN[3], const double WEIGHT[D+1], const double NORMAL[D+1][D],
+                                const double W_HAT[D+2][D+1], const double PHI[D+2],
+                                double FLUC_N[D+2][D+1], double FLUC_LDA[D+2][D+1], double BETA[D+2][D+2][D+1]){
+        const int NV = D+1, NQ = D+2, NB = D+1;         // vertices, variables, size of the acoustic/shear block
+        int i,j,k,m;
+        double RHO = Z_BAR[0]*Z_BAR[0], H = Z_BAR[D+1]/Z_BAR[0], C = LIN[0], VEL[D], Q2 = 0.0;
+        for(k=0;k<D;++k){
+                VEL[k] = Z_BAR[1+k]/Z_BAR[0];
+                Q2    += VEL[k]*VEL[k];
+        }
+
+        // K+ of every vertex: acoustic/shear block KP and entropy wave KE
+
+        double KP[NV][NB][NB], KE[NV], SUM_KP[NB][NB], SUM_KE = 0.0;
+
+        for(i=0;i<NB;++i){for(j=0;j<NB;++j){SUM_KP[i][j] = 0.0;}}
+
+        for(m=0;m<NV;++m){
+                double W = 0.0;
+                for(k=0;k<D;++k){W += VEL[k]*NORMAL[m][k];}
+                double LP = max_val(0.0,W + C), LM = max_val(0.0,W - C), L0 = max_val(0.0,W);
+                double S = 0.5*WEIGHT[m]*(LP + LM), A = 0.5*WEIGHT[m]*(LP - LM), E = WEIGHT[m]*L0;
+
+                KP[m][0][0] = S;
+                for(j=0;j<D;++j){
+                        KP[m][0][1+j] = KP[m][1+j][0] = A*NORMAL[m][j];
+                        for(k=0;k<D;++k){
+                                KP[m][1+j][1+k] = (S - E)*NORMAL[m][j]*NORMAL[m][k] + (j==k ? E : 0.0);
+                        }
+                }
+                KE[m] = E;
+
+                for(i=0;i<NB;++i){for(j=0;j<NB;++j){SUM_KP[i][j] += KP[m][i][j];}}
+                SUM_KE += KE[m];
+        }
+
+        // no entropy inflow (stagnant element): the entropy wave is not distributed
+        double INV[NB][NB], INV_KE = SUM_KE > 0.0 ? 1.0/SUM_KE : 0.0;
+        int REGULARISED = inverse_spd<NB>(SUM_KP, INV) | (SUM_KE > 0.0 ? 0 : 1);
+
+        // vertex states and residual in characteristic variables
+
+        double QV[NV][NQ], QPHI[NQ], DU[NQ], QF[NQ];
+
+        for(m=0;m<NV;++m){
+                for(i=0;i<NQ;++i){DU[i] = W_HAT[i][m];}
+                char_from_cons<D>(RHO, VEL, Q2, H, LIN, DU, QV[m]);
+        }
+        char_from_cons<D>(RHO, VEL, Q2, H, LIN, PHI, QPHI);
+
+        // N scheme: FLUC_m = K+_m (Q_m - Q_IN), Q_IN = (sum K+)^-1 (sum K+_m Q_m - PHI)
+
+        if(FLUC_N != NULL){
+                double R[NB], Q_IN[NB], R_E = -QPHI[NB], Q_IN_E;
+                for(i=0;i<NB;++i){R[i] = -QPHI[i];}
+                for(m=0;m<NV;++m){
+                        for(i=0;i<NB;++i){for(j=0;j<NB;++j){R[i] += KP[m][i][j]*QV[m][j];}}
+                        R_E += KE[m]*QV[m][NB];
+                }
+                for(i=0;i<NB;++i){
+                        Q_IN[i] = 0.0;
+                        for(j=0;j<NB;++j){Q_IN[i] += INV[i][j]*R[j];}
+                }
+                Q_IN_E = INV_KE*R_E;
+
+                for(m=0;m<NV;++m){
+                        for(i=0;i<NB;++i){
+                                QF[i] = 0.0;
+                                for(j=0;j<NB;++j){QF[i] += KP[m][i][j]*(QV[m][j] - Q_IN[j]);}
+                        }
+                        QF[NB] = KE[m]*(QV[m][NB] - Q_IN_E);
+                        cons_from_char<D>(RHO, VEL, Q2, H, LIN, QF, DU);
+                        for(i=0;i<NQ;++i){FLUC_N[i][m] = DU[i];}
+                }
+        }
+
+        // LDA scheme: BETA_m = K+_m (sum K+)^-1, FLUC_m = BETA_m PHI
+
+        if(FLUC_LDA != NULL or BETA != NULL){
+                double G[NQ];
+                for(int COL=-1;COL<NQ;++COL){
+                        // COL = -1: residual, COL >= 0: unit vector for column COL of BETA
+                        if(COL < 0){
+                                if(FLUC_LDA == NULL){continue;}
+                                for(i=0;i<NQ;++i){QF[i] = QPHI[i];}
+                        }else{
+                                if(BETA == NULL){break;}
+                                for(i=0;i<NQ;++i){DU[i] = (i==COL ? 1.0 : 0.0);}
+                                char_from_cons<D>(RHO, VEL, Q2, H, LIN, DU, QF);
+                        }
+                        for(i=0;i<NB;++i){
+                                G[i] = 0.0;
+                                for(j=0;j<NB;++j){G[i] += INV[i][j]*QF[j];}
+                        }
+                        G[NB] = INV_KE*QF[NB];
+
+                        for(m=0;m<NV;++m){
+                                double B[NQ];
+                                for(i=0;i<NB;++i){
+                                        B[i] = 0.0;
+                                        for(j=0;j<NB;++j){B[i] += KP[m][i][j]*G[j];}
+                                }
+                                B[NB] = KE[m]*G[NB];
+                                cons_from_char<D>(RHO, VEL, Q2, H, LIN, B, DU);
+                                if(COL < 0){for(i=0;i<NQ;++i){FLUC_LDA[i][m] = DU[i];}}
+                                else{for(i=0;i<NQ;++i){BETA[i][COL][m] = DU[i];}}
+                        }
+                }
+        }
+
+        if(REGULARISED){
+#pragma omp atomic
+                N_SINGULAR++;
+        }
+
+        return REGULARISED;
+}
+
+// element residual from the Roe vectors: PHI = sum_m WEIGHT_m n_m.F(Z_BAR,Z_m), F(A,B) the symmetric bilinear flux. With
+// EOS_NON_IDEAL the pressure is not quadratic in Z and its term uses the vertex pressures P_S (linear on the boundary).
+template<int D>
+void bilinear_flux_residual(const double Z_BAR[D+2], const double Z[D+2][D+1], const double P_S[D+1], const double WEIGHT[D+1], const double NORMAL[D+1][D], double PHI[D+2]){
+        for(int i=0;i<D+2;++i){PHI[i] = 0.0;}
+        for(int m=0;m<D+1;++m){
+                double UN_BAR = 0.0, UN_M = 0.0, P2 = Z_BAR[0]*Z[D+1][m] + Z_BAR[D+1]*Z[0][m];
+                for(int k=0;k<D;++k){
+                        UN_BAR += Z_BAR[1+k]*NORMAL[m][k];
+                        UN_M   += Z[1+k][m]*NORMAL[m][k];
+                        P2     -= Z_BAR[1+k]*Z[1+k][m];
+                }
+#ifdef EOS_NON_IDEAL
+                P2 = P_S[m];
+#else
+                P2 = (GAMMA_1/GAMMA)*P2;
+#endif
+                PHI[0] += WEIGHT[m]*(Z_BAR[0]*UN_M + UN_BAR*Z[0][m]);
+                for(int k=0;k<D;++k){PHI[1+k] += WEIGHT[m]*(Z_BAR[1+k]*UN_M + UN_BAR*Z[1+k][m] + P2*NORMAL[m][k]);}
+                PHI[D+1] += WEIGHT[m]*(Z_BAR[D+1]*UN_M + UN_BAR*Z[D+1][m]);
+        }
+}
@@ -0,0 +1,31 @@
+/*
+Blocked conversion of the vertex states from conserved to primitive variables (batch_con_to_prim, common/physics.h)
+        PHYSICS_BLOCK vertices at a time are gathered into lane-major arrays, converted with one vectorised EOS call
+        and written back. Same results as VERTEX::con_to_prim / con_to_prim_half, including the E_LIM pressure floor.
+*/
+
+template<int N_DIM>
+void con_to_prim_block(std::vector<VERTEX> &MY_POINTS, int N_POINTS, bool HALF){
+#ifdef PARA_UP
+        #pragma omp parallel for
+#endif
+        for(int B=0; B<N_POINTS; B+=PHYSICS_BLOCK){
+                int i, k, N_BLOCK = (N_POINTS - B < PHYSICS_BLOCK) ? N_POINTS - B : PHYSICS_BLOCK;
+                double U[N_DIM+2][PHYSICS_BLOCK], VEL[N_DIM][PHYSICS_BLOCK], VEL_I[N_DIM];
+                double RHO[PHYSICS_BLOCK], SPECIFIC_ENERGY[PHYSICS_BLOCK], PRESSURE[PHYSICS_BLOCK];
+
+                for(i=0;i<N_BLOCK;++i){
+                        const double *U_V = HALF ? MY_POINTS[B+i].get_u_half() : MY_POINTS[B+i].get_u_variables();
+                        for(k=0;k<N_DIM+2;++k){U[k][i] = U_V[k];}
+                }
+
+                batch_con_to_prim<N_DIM>(N_BLOCK, U, RHO, VEL, SPECIFIC_ENERGY, PRESSURE, E_LIM);
+
+                for(i=0;i<N_BLOCK;++i){
+                        for(k=0;k<N_DIM;++k){VEL_I[k] = VEL[k][i];}
+                        if(HALF){MY_POINTS[B+i].set_prim_half(RHO[i], VEL_I, SPECIFIC_ENERGY[i], PRESSURE[i]);}
+                        else{MY_POINTS[B+i].set_prim(RHO[i], VEL_I, SPECIFIC_ENERGY[i], PRESSURE[i]);}
+                }
+        }
+        return ;
+}
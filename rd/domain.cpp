@@ -0,0 +1,639 @@
+/*
+MPI domain decomposition (MPI_RD)
+        No rank holds the whole mesh. Each rank starts from a share of it, a block of vertices by global ID and a slice
+        of the triangles: a binary mesh is mapped in these parts (binary_read_mesh), text and generated meshes are read
+        in full and cut (domain_decompose). The triangles are ordered along a Morton (Z order) space filling curve
+        through the position of their first vertex by a parallel sample sort, and cut into N_RANKS consecutive pieces.
+        A vertex is owned by the lowest rank whose triangles touch it (the rank of its first triangle along the curve),
+        the other such ranks hold a ghost copy. The rank of the vertex's block acts as its directory: it collects the
+        ranks touching the vertex, returns the owner and remembers it, so the vertex state can be fetched from there
+        after a repartition. Local vertices are stored owned first, then ghosts, each in global ID order, and the vertex
+        ID is the local index (as DU_PRIVATE expects). Local triangles are stored interior first (all vertices owned),
+        then the boundary triangles that touch a ghost. The duals are summed over the local triangles and completed
+        through the halo.
+
+        halo_forward copies owner data to the ghosts (U, U_HALF, DT_REQ, DUAL), halo_reverse adds the ghost
+        contributions to the owners and zeroes the ghosts (DU, DU_HALF, LEN_VEL_SUM, DUAL). Neighbours are always
+        combined in rank order and the send/receive lists are sorted by global ID, so the result does not depend on
+        message arrival. Snapshots gather the owned vertices back to rank 0 in global order (the only place all
+        vertices meet, for the output files), so the files and totals match a serial run to rounding.
+
+        halo_overlap runs a residual pass with the forward exchange in flight: interior triangles are evaluated in blocks of
+        OVERLAP_BLOCK (testing the messages in between so they progress), the boundary triangles after the wait. The
+        fraction of the exchange time hidden this way is accumulated for domain_report_overlap.
+
+        Triangles travel between ranks as records with global vertex IDs, shift codes and their stored residuals, the
+        receiver points them at its own vertices. Every exchange is an MPI_Alltoallv of whole records (one derived
+        datatype each), so the memory and traffic of a rank follow its share of the mesh. domain_rebalance re-cuts the
+        curve into pieces of equal element evaluations (MAX_TBIN/TBIN per triangle under DRIFT) from a prefix sum of
+        the costs over the ranks, and the ranks fetch the state of their new vertices from the old owners.
+*/
+
+#if defined(SELF_GRAVITY) || defined(DRIFT_SHELL) || defined(JUMP)
+#error "MPI_RD: SELF_GRAVITY, DRIFT_SHELL and JUMP need the full mesh on every rank"
+#endif
+#ifdef MESH_REPORT
+#error "MPI_RD: MESH_REPORT needs the full mesh on one rank, report on the mesh file with triangulation/binary/analyse_mesh"
+#endif
+
+#if !defined(BATCH_RESIDUAL) && !defined(DU_PRIVATE)
+#define HALO_OVERLAP                                    // residual passes can be split into interior and boundary triangles
+#endif
+#define OVERLAP_BLOCK 1024
+
+int MY_RANK = 0, N_RANKS = 1;
+
+struct RD_DOMAIN{
+        int N_GLOBAL_POINTS, N_GLOBAL_TRIANG;
+        int N_VERT;                                     // vertices per triangle
+        int N_OWNED;                                    // local vertices 0 .. N_OWNED-1 are owned, the rest are ghosts
+        int N_INTERIOR;                                 // local triangles 0 .. N_INTERIOR-1 have no ghost vertex
+        std::vector<int> GLOBAL_ID;                     // global vertex ID of each local vertex
+        std::vector<int> LOCAL_TRI;                     // global ID of each local triangle
+        std::vector<unsigned long long> LOCAL_KEY;      // curve key of each local triangle
+        std::vector<int> NEIGHBOURS;                    // ranks sharing vertices with this one (ascending)
+        std::vector< std::vector<int> > SEND_IDX;       // per neighbour: owned vertices ghosted there
+        std::vector< std::vector<int> > RECV_IDX;       // per neighbour: ghosts owned there
+        std::vector< std::vector<double> > SEND_BUF, RECV_BUF;
+        std::vector<MPI_Request> REQUESTS;
+        double T_COMM, T_HIDDEN;                        // forward exchange time in halo_overlap, and the part hidden
+        double IMBALANCE;                               // busiest rank / mean element evaluations at the last check
+
+        // vertex directory: rank R keeps the global vertices BLOCK[R] <= i < BLOCK[R+1]
+        std::vector<int> BLOCK;
+        std::vector<int> HOLDER;                        // rank holding the state of each vertex of this block
+} DOMAIN_DECOMP;
+
+void domain_init(int *ARGC, char ***ARGV){
+        MPI_Init(ARGC, ARGV);
+        MPI_Comm_rank(MPI_COMM_WORLD, &MY_RANK);
+        MPI_Comm_size(MPI_COMM_WORLD, &N_RANKS);
+        if(MY_RANK != 0){
+                if(freopen("/dev/null", "w", stdout) == NULL){}         // progress output from rank 0 only
+        }
+}
+
+// interleave the bits of the cell coordinates (2^BITS cells per side) into a Morton key
+unsigned long long morton_key(const double *X, const double *SIDE, int D){
+        const int BITS = 63/D;
+        unsigned long long KEY = 0, CELL[3];
+        for(int k=0;k<D;++k){
+                double S = X[k]/SIDE[k];
+                S = S - floor(S);
+                CELL[k] = (unsigned long long)(S*double(1ULL << BITS));
+        }
+        for(int b=BITS-1;b>=0;--b){
+                for(int k=0;k<D;++k){KEY = (KEY << 1) | ((CELL[k] >> b) & 1ULL);}
+        }
+        return KEY;
+}
+
+unsigned long long vertex_key(VERTEX &V){
+#ifdef THREE_D
+        double X[3] = {V.get_x(), V.get_y(), V.get_z()};
+        double SIDE[3] = {double(SIDE_LENGTH_X), double(SIDE_LENGTH_Y), double(SIDE_LENGTH_Z)};
+        return morton_key(X, SIDE, 3);
+#else
+        double X[2] = {V.get_x(), V.get_y()};
+        double SIDE[2] = {double(SIDE_LENGTH_X), double(SIDE_LENGTH_Y)};
+        return morton_key(X, SIDE, 2);
+#endif
+}
+
+int triangle_vertex_ids(TRIANGLE &TRI, VERTEX *BASE, int IDS[4]){
+        IDS[0] = TRI.get_vertex_0() - BASE;
+        IDS[1] = TRI.get_vertex_1() - BASE;
+        IDS[2] = TRI.get_vertex_2() - BASE;
+#ifdef THREE_D
+        IDS[3] = TRI.get_vertex_3() - BASE;
+        return 4;
+#else
+        return 3;
+#endif
+}
+
+// a triangle on its way to another rank, its vertices by global ID so the receiver can point them at its own copies.
+// The stored residuals (TRIANGLE::stored_size() values per triangle) travel alongside.
+struct TRIANGLE_RECORD{
+        unsigned long long KEY;                         // curve key of the first vertex
+        int ID, TBIN, BOUNDARY;
+        int VERTS[4], SHIFT[4];
+};
+
+// curve order: by key, ties by global triangle ID
+bool curve_before(const TRIANGLE_RECORD &A, const TRIANGLE_RECORD &B){
+        return A.KEY < B.KEY or (A.KEY == B.KEY and A.ID < B.ID);
+}
+
+// record of TRI, global triangle J, whose vertices are stored from BASE and have global IDS GLOBAL[i] (i if NULL)
+TRIANGLE_RECORD triangle_record(TRIANGLE &TRI, int J, VERTEX *BASE, const int *GLOBAL){
+        TRIANGLE_RECORD REC = {};
+        int N_VERT = triangle_vertex_ids(TRI, BASE, REC.VERTS);
+        for(int m=0;m<N_VERT;++m){
+                if(GLOBAL != NULL){REC.VERTS[m] = GLOBAL[REC.VERTS[m]];}
+                REC.SHIFT[m] = TRI.get_shift(m);
+        }
+        REC.ID       = J;
+        REC.TBIN     = TRI.get_tbin();
+        REC.BOUNDARY = TRI.get_boundary();
+        return REC;
+}
+
+// send the records in SEND, COUNT[R] of them to rank R in rank order, LENGTH values of T per record. A record goes
+// as one derived datatype, so the counts are records rather than bytes. Returns the records received, RECV_COUNT[R]
+// from rank R in rank order.
+template<class T>
+std::vector<T> domain_alltoall(const std::vector<T> &SEND, const std::vector<int> &COUNT, std::vector<int> &RECV_COUNT, int LENGTH = 1){
+        MPI_Datatype RECORD;
+        std::vector<int> SEND_OFFSET(N_RANKS, 0), RECV_OFFSET(N_RANKS, 0);
+        MPI_Type_contiguous(LENGTH*sizeof(T), MPI_BYTE, &RECORD);
+        MPI_Type_commit(&RECORD);
+
+        RECV_COUNT.resize(N_RANKS);
+        MPI_Alltoall(COUNT.data(), 1, MPI_INT, RECV_COUNT.data(), 1, MPI_INT, MPI_COMM_WORLD);
+        for(int R=1;R<N_RANKS;++R){
+                SEND_OFFSET[R] = SEND_OFFSET[R-1] + COUNT[R-1];
+                RECV_OFFSET[R] = RECV_OFFSET[R-1] + RECV_COUNT[R-1];
+        }
+        std::vector<T> RECV(LENGTH*size_t(RECV_OFFSET[N_RANKS-1] + RECV_COUNT[N_RANKS-1]));
+        MPI_Alltoallv(SEND.data(), COUNT.data(), SEND_OFFSET.data(), RECORD,
+                      RECV.data(), RECV_COUNT.data(), RECV_OFFSET.data(), RECORD, MPI_COMM_WORLD);
+        MPI_Type_free(&RECORD);
+        return RECV;
+}
+
+// post the exchange of FIELD: owners -> ghosts (forward) or ghosts -> owners (reverse)
+void halo_begin(std::vector<VERTEX> &RAND_POINTS, int FIELD, bool REVERSE){
+        RD_DOMAIN &DOM = DOMAIN_DECOMP;
+        int N = VERTEX::halo_size(FIELD);
+        DOM.REQUESTS.assign(2*DOM.NEIGHBOURS.size(), MPI_REQUEST_NULL);
+        for(int n=0;n<int(DOM.NEIGHBOURS.size());++n){
+                std::vector<int> &OUT = REVERSE ? DOM.RECV_IDX[n] : DOM.SEND_IDX[n];
+                std::vector<int> &IN  = REVERSE ? DOM.SEND_IDX[n] : DOM.RECV_IDX[n];
+                DOM.SEND_BUF[n].resize(N*OUT.size());
+                DOM.RECV_BUF[n].resize(N*IN.size());
+                MPI_Irecv(DOM.RECV_BUF[n].data(), N*IN.size(), MPI_DOUBLE, DOM.NEIGHBOURS[n], FIELD, MPI_COMM_WORLD, &DOM.REQUESTS[2*n]);
+                for(int k=0;k<int(OUT.size());++k){RAND_POINTS[OUT[k]].get_halo(FIELD, &DOM.SEND_BUF[n][N*k]);}
+                MPI_Isend(DOM.SEND_BUF[n].data(), N*OUT.size(), MPI_DOUBLE, DOM.NEIGHBOURS[n], FIELD, MPI_COMM_WORLD, &DOM.REQUESTS[2*n+1]);
+        }
+}
+
+// complete the exchange posted by halo_begin
+void halo_end(std::vector<VERTEX> &RAND_POINTS, int FIELD, bool REVERSE){
+        RD_DOMAIN &DOM = DOMAIN_DECOMP;
+        int N = VERTEX::halo_size(FIELD);
+        std::vector<double> ZERO(N, 0.0);
+        MPI_Waitall(DOM.REQUESTS.size(), DOM.REQUESTS.data(), MPI_STATUSES_IGNORE);
+        for(int n=0;n<int(DOM.NEIGHBOURS.size());++n){
+                if(REVERSE){
+                        for(int k=0;k<int(DOM.RECV_IDX[n].size());++k){RAND_POINTS[DOM.RECV_IDX[n][k]].set_halo(FIELD, ZERO.data());}
+                        for(int k=0;k<int(DOM.SEND_IDX[n].size());++k){RAND_POINTS[DOM.SEND_IDX[n][k]].add_halo(FIELD, &DOM.RECV_BUF[n][N*k]);}
+                }else{
+                        for(int k=0;k<int(DOM.RECV_IDX[n].size());++k){RAND_POINTS[DOM.RECV_IDX[n][k]].set_halo(FIELD, &DOM.RECV_BUF[n][N*k]);}
+                }
+        }
+}
+
+void halo_forward(std::vector<VERTEX> &RAND_POINTS, int FIELD){
+        halo_begin(RAND_POINTS, FIELD, false);
+        halo_end(RAND_POINTS, FIELD, false);
+}
+
+void halo_reverse(std::vector<VERTEX> &RAND_POINTS, int FIELD){
+        halo_begin(RAND_POINTS, FIELD, true);
+        halo_end(RAND_POINTS, FIELD, true);
+}
+
+// residual pass RESIDUAL(J_START, J_END) over the N_TRIANG local triangles, with the forward exchange of FIELD (none if
+// FIELD < 0) hidden behind the interior triangles
+template<class F>
+void halo_overlap(std::vector<VERTEX> &RAND_POINTS, int FIELD, int N_TRIANG, F RESIDUAL){
+        RD_DOMAIN &DOM = DOMAIN_DECOMP;
+        if(FIELD < 0){
+                RESIDUAL(0, N_TRIANG);
+                return ;
+        }
+#ifndef HALO_OVERLAP
+        halo_forward(RAND_POINTS, FIELD);
+        RESIDUAL(0, N_TRIANG);
+        return ;
+#endif
+        int DONE = 0;
+        double T_POST = MPI_Wtime(), T_DONE = 0.0, T_INTERIOR;
+        halo_begin(RAND_POINTS, FIELD, false);
+        for(int J=0;J<DOM.N_INTERIOR;J+=OVERLAP_BLOCK){
+                RESIDUAL(J, std::min(J + OVERLAP_BLOCK, DOM.N_INTERIOR));
+                if(not DONE){
+                        MPI_Testall(DOM.REQUESTS.size(), DOM.REQUESTS.data(), &DONE, MPI_STATUSES_IGNORE);
+                        if(DONE){T_DONE = MPI_Wtime();}
+                }
+        }
+        T_INTERIOR = MPI_Wtime();
+        halo_end(RAND_POINTS, FIELD, false);
+        if(not DONE){T_DONE = MPI_Wtime();}
+        DOM.T_COMM   += T_DONE - T_POST;
+        DOM.T_HIDDEN += std::min(T_DONE, T_INTERIOR) - T_POST;
+        RESIDUAL(DOM.N_INTERIOR, N_TRIANG);
+}
+
+// print the hidden fraction of the exchange time in halo_overlap (all ranks) since the last report
+void domain_report_overlap(){
+        RD_DOMAIN &DOM = DOMAIN_DECOMP;
+        double LOCAL[2] = {DOM.T_COMM, DOM.T_HIDDEN}, SUM[2];
+        MPI_Reduce(LOCAL, SUM, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        if(SUM[0] > 0.0){printf("OVERLAP =\t%f\tof %f s halo exchange hidden behind interior triangles\n", SUM[1]/SUM[0], SUM[0]);}
+        DOM.T_COMM = DOM.T_HIDDEN = 0.0;
+}
+
+// directory rank of global vertex ID
+int domain_block_rank(int ID){
+        std::vector<int> &BLOCK = DOMAIN_DECOMP.BLOCK;
+        return std::upper_bound(BLOCK.begin(), BLOCK.end(), ID) - BLOCK.begin() - 1;
+}
+
+// local index of global vertex ID, which must be held here (owned and ghosts are each sorted by global ID)
+int domain_local_id(int ID){
+        RD_DOMAIN &DOM = DOMAIN_DECOMP;
+        std::vector<int>::iterator OWNED_END = DOM.GLOBAL_ID.begin() + DOM.N_OWNED;
+        std::vector<int>::iterator AT = std::lower_bound(DOM.GLOBAL_ID.begin(), OWNED_END, ID);
+        if(AT != OWNED_END and *AT == ID){return AT - DOM.GLOBAL_ID.begin();}
+        return std::lower_bound(OWNED_END, DOM.GLOBAL_ID.end(), ID) - DOM.GLOBAL_ID.begin();
+}
+
+// HALO_STATE of the global vertices IDS, each from the rank FROM[k] holding it, where STATE_OF(global ID) is the
+// holder's copy. Returns halo_size(HALO_STATE) values per vertex, in the order of IDS.
+template<class F>
+std::vector<double> domain_fetch(const std::vector<int> &IDS, const std::vector<int> &FROM, F STATE_OF){
+        int k, N = VERTEX::halo_size(HALO_STATE), N_IDS = IDS.size();
+        std::vector<int> ORDER(N_IDS), ASK(N_IDS), COUNT(N_RANKS, 0), RECV_COUNT, BACK_COUNT;
+        for(k=0;k<N_IDS;++k){ORDER[k] = k;}
+        std::stable_sort(ORDER.begin(), ORDER.end(), [&](int A, int B){return FROM[A] < FROM[B];});
+        for(k=0;k<N_IDS;++k){
+                ASK[k] = IDS[ORDER[k]];
+                COUNT[FROM[ORDER[k]]] += 1;
+        }
+        std::vector<int> ASKED = domain_alltoall(ASK, COUNT, RECV_COUNT);
+
+        std::vector<double> REPLY(N*ASKED.size());
+        for(k=0;k<int(ASKED.size());++k){STATE_OF(ASKED[k]).get_halo(HALO_STATE, &REPLY[N*size_t(k)]);}
+        std::vector<double> BACK = domain_alltoall(REPLY, RECV_COUNT, BACK_COUNT, N);
+
+        std::vector<double> STATE(N*size_t(N_IDS));
+        for(k=0;k<N_IDS;++k){std::copy(&BACK[N*size_t(k)], &BACK[N*size_t(k)] + N, &STATE[N*size_t(ORDER[k])]);}
+        return STATE;
+}
+
+// sort the triangles of all ranks along the curve (sample sort): every rank contributes N_RANKS regularly spaced
+// samples of its sorted triangles, every N_RANKS-th of all the samples starts a piece of the curve, and each triangle
+// goes to the rank of its piece. Afterwards the ranks hold consecutive pieces of the curve, each in curve order.
+void domain_sort(std::vector<TRIANGLE_RECORD> &TRI){
+        int k, R, N_TRI = TRI.size();
+        std::vector<int> COUNT(N_RANKS, 0), RECV_COUNT;
+        std::vector<TRIANGLE_RECORD> SAMPLE;
+
+        std::sort(TRI.begin(), TRI.end(), curve_before);
+        for(R=0;R<N_RANKS and N_TRI > 0;++R){
+                for(k=0;k<N_RANKS;++k){SAMPLE.push_back(TRI[(long(N_TRI)*k)/N_RANKS]);}
+                COUNT[R] = N_RANKS;
+        }
+        std::vector<TRIANGLE_RECORD> ALL = domain_alltoall(SAMPLE, COUNT, RECV_COUNT);   // every rank gets all samples
+        std::sort(ALL.begin(), ALL.end(), curve_before);
+
+        COUNT.assign(N_RANKS, 0);
+        R = 0;
+        for(k=0;k<N_TRI;++k){
+                while(R < N_RANKS - 1 and not curve_before(TRI[k], ALL[(ALL.size()*(R + 1))/N_RANKS])){R++;}
+                COUNT[R] += 1;
+        }
+        TRI = domain_alltoall(TRI, COUNT, RECV_COUNT);
+        std::sort(TRI.begin(), TRI.end(), curve_before);
+}
+
+// new rank of each of this rank's triangles, given in curve order with costs COST: the curve is cut into N_RANKS
+// pieces of equal total cost. The ranks hold consecutive pieces of the curve, so the cost ahead of this rank's piece is
+// a prefix sum over the lower ranks (of whole numbers, so exact and the same on every rank).
+std::vector<int> domain_cut(const std::vector<double> &COST){
+        int k, N_TRI = COST.size();
+        double LOCAL = 0.0, TOTAL, SUM = 0.0;
+        std::vector<int> RANK(N_TRI);
+        for(k=0;k<N_TRI;++k){LOCAL += COST[k];}
+        MPI_Allreduce(&LOCAL, &TOTAL, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        MPI_Exscan(&LOCAL, &SUM, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        if(MY_RANK == 0){SUM = 0.0;}                                    // undefined there
+        for(k=0;k<N_TRI;++k){
+                RANK[k] = std::min(N_RANKS - 1, int(N_RANKS*(SUM + 0.5*COST[k])/TOTAL));
+                SUM    += COST[k];
+        }
+        return RANK;
+}
+
+// layout of this rank for its triangles TRI (in curve order, with the stored residuals STORED): the owners of their
+// vertices, the local vertices (owned, then ghosts, by global ID), the local triangles (interior, then boundary, each
+// in curve order; TRI and STORED are reordered to match) and the exchange lists. The directory ranks return the owner
+// of each vertex and the rank that held its state until now; those holders are returned per local vertex.
+std::vector<int> domain_layout(std::vector<TRIANGLE_RECORD> &TRI, std::vector<double> &STORED){
+        RD_DOMAIN &DOM = DOMAIN_DECOMP;
+        int i, k, m, n, R, N_TRI = TRI.size(), N_STORED = TRIANGLE::stored_size(), FIRST = DOM.BLOCK[MY_RANK];
+        std::vector<int> TOUCHED, COUNT(N_RANKS, 0), RECV_COUNT, BACK_COUNT;
+
+        // vertices of the local triangles to their directory ranks, in global ID order
+
+        for(k=0;k<N_TRI;++k){
+                for(m=0;m<DOM.N_VERT;++m){TOUCHED.push_back(TRI[k].VERTS[m]);}
+        }
+        std::sort(TOUCHED.begin(), TOUCHED.end());
+        TOUCHED.erase(std::unique(TOUCHED.begin(), TOUCHED.end()), TOUCHED.end());
+        for(i=0;i<int(TOUCHED.size());++i){COUNT[domain_block_rank(TOUCHED[i])] += 1;}
+        std::vector<int> ASKED = domain_alltoall(TOUCHED, COUNT, RECV_COUNT);
+
+        // owner: the lowest rank asking (requests arrive in rank order); reply with the owner and the holder until now
+
+        std::vector<int> OWNER(DOM.HOLDER.size(), -1), REPLY(2*ASKED.size());
+        for(R=0, i=0;R<N_RANKS;++R){
+                for(n=0;n<RECV_COUNT[R];++n, ++i){
+                        if(OWNER[ASKED[i] - FIRST] < 0){OWNER[ASKED[i] - FIRST] = R;}
+                }
+        }
+        for(i=0;i<int(ASKED.size());++i){
+                REPLY[2*i]     = OWNER[ASKED[i] - FIRST];
+                REPLY[2*i + 1] = DOM.HOLDER[ASKED[i] - FIRST];
+        }
+        for(i=0;i<int(OWNER.size());++i){if(OWNER[i] >= 0){DOM.HOLDER[i] = OWNER[i];}}
+        std::vector<int> ANSWER = domain_alltoall(REPLY, RECV_COUNT, BACK_COUNT, 2);    // in TOUCHED order
+
+        // local vertices and where their state is
+
+        std::vector<int> HOLDER, LOCAL_OWNER;
+        DOM.GLOBAL_ID.clear();
+        for(int PASS=0;PASS<2;++PASS){
+                for(i=0;i<int(TOUCHED.size());++i){
+                        if((ANSWER[2*i] == MY_RANK) != (PASS == 0)){continue;}
+                        DOM.GLOBAL_ID.push_back(TOUCHED[i]);
+                        LOCAL_OWNER.push_back(ANSWER[2*i]);
+                        HOLDER.push_back(ANSWER[2*i + 1]);
+                }
+                if(PASS == 0){DOM.N_OWNED = DOM.GLOBAL_ID.size();}
+        }
+
+        // local triangles
+
+        std::vector<int> ORDER;
+        for(int PASS=0;PASS<2;++PASS){
+                for(k=0;k<N_TRI;++k){
+                        bool INTERIOR = true;
+                        for(m=0;m<DOM.N_VERT;++m){if(domain_local_id(TRI[k].VERTS[m]) >= DOM.N_OWNED){INTERIOR = false;}}
+                        if(INTERIOR == (PASS == 0)){ORDER.push_back(k);}
+                }
+                if(PASS == 0){DOM.N_INTERIOR = ORDER.size();}
+        }
+        std::vector<TRIANGLE_RECORD> LOCAL_TRI(N_TRI);
+        std::vector<double> LOCAL_STORED(STORED.size());
+        DOM.LOCAL_TRI.resize(N_TRI);
+        DOM.LOCAL_KEY.resize(N_TRI);
+        for(k=0;k<N_TRI;++k){
+                LOCAL_TRI[k] = TRI[ORDER[k]];
+                std::copy(&STORED[N_STORED*size_t(ORDER[k])], &STORED[N_STORED*size_t(ORDER[k])] + N_STORED, &LOCAL_STORED[N_STORED*size_t(k)]);
+                DOM.LOCAL_TRI[k] = LOCAL_TRI[k].ID;
+                DOM.LOCAL_KEY[k] = LOCAL_TRI[k].KEY;
+        }
+        TRI.swap(LOCAL_TRI);
+        STORED.swap(LOCAL_STORED);
+
+        // exchange lists, both sides in global ID order: the ghosts are announced to their owners
+
+        std::vector< std::vector<int> > SEND(N_RANKS), RECV(N_RANKS);
+        std::vector<int> GHOSTS;
+        COUNT.assign(N_RANKS, 0);
+        for(i=DOM.N_OWNED;i<int(DOM.GLOBAL_ID.size());++i){RECV[LOCAL_OWNER[i]].push_back(i);}
+        for(R=0;R<N_RANKS;++R){
+                for(k=0;k<int(RECV[R].size());++k){GHOSTS.push_back(DOM.GLOBAL_ID[RECV[R][k]]);}
+                COUNT[R] = RECV[R].size();
+        }
+        std::vector<int> GHOSTED = domain_alltoall(GHOSTS, COUNT, RECV_COUNT);
+        for(R=0, i=0;R<N_RANKS;++R){
+                for(n=0;n<RECV_COUNT[R];++n, ++i){SEND[R].push_back(domain_local_id(GHOSTED[i]));}
+        }
+
+        DOM.NEIGHBOURS.clear();
+        DOM.SEND_IDX.clear();
+        DOM.RECV_IDX.clear();
+        for(R=0;R<N_RANKS;++R){
+                if(SEND[R].empty() and RECV[R].empty()){continue;}
+                DOM.NEIGHBOURS.push_back(R);
+                DOM.SEND_IDX.push_back(SEND[R]);
+                DOM.RECV_IDX.push_back(RECV[R]);
+        }
+        DOM.SEND_BUF.resize(DOM.NEIGHBOURS.size());
+        DOM.RECV_BUF.resize(DOM.NEIGHBOURS.size());
+        return HOLDER;
+}
+
+// replace RAND_POINTS and RAND_MESH by the local vertices and triangles of the current layout. Vertices are set from
+// their HALO_STATE in STATE, triangles built from their records TRI and stored residuals STORED (in local order), with
+// the vertex pointers and the geometry set up here.
+void domain_build(std::vector<VERTEX> &RAND_POINTS, std::vector<TRIANGLE> &RAND_MESH, const std::vector<TRIANGLE_RECORD> &TRI,
+                  const std::vector<double> &STORED, const std::vector<double> &STATE){
+        RD_DOMAIN &DOM = DOMAIN_DECOMP;
+        int m, N = VERTEX::halo_size(HALO_STATE), N_STORED = TRIANGLE::stored_size();
+        std::vector<VERTEX> LOCAL_POINTS(DOM.GLOBAL_ID.size());
+        std::vector<TRIANGLE> LOCAL_MESH(TRI.size());
+        for(int i=0;i<int(DOM.GLOBAL_ID.size());++i){
+                LOCAL_POINTS[i].set_halo(HALO_STATE, &STATE[N*size_t(i)]);
+                LOCAL_POINTS[i].set_id(i);
+        }
+        for(int k=0;k<int(TRI.size());++k){
+                const TRIANGLE_RECORD &REC = TRI[k];
+                TRIANGLE &ELEM = LOCAL_MESH[k];
+                VERTEX *V[4] = {};
+                for(m=0;m<DOM.N_VERT;++m){V[m] = &LOCAL_POINTS[domain_local_id(REC.VERTS[m])];}
+                ELEM.set_vertex_0(V[0]);
+                ELEM.set_vertex_1(V[1]);
+                ELEM.set_vertex_2(V[2]);
+#ifdef THREE_D
+                ELEM.set_vertex_3(V[3]);
+#endif
+                for(m=0;m<DOM.N_VERT;++m){ELEM.set_shift(m, REC.SHIFT[m]);}
+                ELEM.set_id(REC.ID);
+                ELEM.set_tbin(REC.TBIN);
+                ELEM.set_boundary(REC.BOUNDARY);
+                ELEM.set_stored(&STORED[N_STORED*size_t(k)]);
+                ELEM.setup_normals(false);                              // orders the corners of a new mesh counter-clockwise
+        }
+        RAND_POINTS.swap(LOCAL_POINTS);                                 // triangle pointers follow the swapped storage
+        RAND_MESH.swap(LOCAL_MESH);
+}
+
+// set up the decomposition from this rank's share of a mesh: the global vertices FIRST <= i < FIRST + BLOCK.size() of
+// N_POINTS (blocks consecutive in rank order) and the triangles TRI of N_TRIANG (any share, vertices by global ID).
+// RAND_POINTS and RAND_MESH become this rank's part, with the geometry and the duals of the whole mesh.
+void domain_distribute(int N_POINTS, int N_TRIANG, int FIRST, std::vector<VERTEX> &BLOCK, std::vector<TRIANGLE_RECORD> &TRI,
+                       std::vector<VERTEX> &RAND_POINTS, std::vector<TRIANGLE> &RAND_MESH){
+        RD_DOMAIN &DOM = DOMAIN_DECOMP;
+        int i, j, k, N = VERTEX::halo_size(HALO_STATE);
+        std::vector<int> COUNT(N_RANKS, 0), RECV_COUNT;
+
+        DOM.N_GLOBAL_POINTS = N_POINTS;
+        DOM.N_GLOBAL_TRIANG = N_TRIANG;
+#ifdef THREE_D
+        DOM.N_VERT = 4;
+#else
+        DOM.N_VERT = 3;
+#endif
+        DOM.T_COMM = DOM.T_HIDDEN = 0.0;
+        DOM.BLOCK.resize(N_RANKS + 1);
+        MPI_Allgather(&FIRST, 1, MPI_INT, DOM.BLOCK.data(), 1, MPI_INT, MPI_COMM_WORLD);
+        DOM.BLOCK[N_RANKS] = N_POINTS;
+        DOM.HOLDER.assign(BLOCK.size(), MY_RANK);                       // the vertex state is in BLOCK until the first layout
+        auto IN_BLOCK = [&](int ID) -> VERTEX& {return BLOCK[ID - FIRST];};
+
+        // curve keys from the first vertex of each triangle
+
+        std::vector<int> IDS(TRI.size()), FROM(TRI.size());
+        for(k=0;k<int(TRI.size());++k){
+                IDS[k]  = TRI[k].VERTS[0];
+                FROM[k] = domain_block_rank(IDS[k]);
+        }
+        std::vector<double> STATE = domain_fetch(IDS, FROM, IN_BLOCK);
+        for(k=0;k<int(TRI.size());++k){
+                VERTEX V;
+                V.set_halo(HALO_STATE, &STATE[N*size_t(k)]);
+                TRI[k].KEY = vertex_key(V);
+        }
+
+        // along the curve, in pieces of equal triangle counts
+
+        domain_sort(TRI);
+        std::vector<int> RANK = domain_cut(std::vector<double>(TRI.size(), 1.0));
+        for(k=0;k<int(TRI.size());++k){COUNT[RANK[k]] += 1;}
+        TRI = domain_alltoall(TRI, COUNT, RECV_COUNT);
+        std::vector<double> STORED(TRIANGLE::stored_size()*TRI.size(), 0.0);
+
+        std::vector<int> HOLDER = domain_layout(TRI, STORED);
+        STATE = domain_fetch(DOM.GLOBAL_ID, HOLDER, IN_BLOCK);
+        domain_build(RAND_POINTS, RAND_MESH, TRI, STORED, STATE);
+
+        // duals: sums over the local triangles, completed at the owners and copied to the ghosts
+
+        for(i=0;i<int(RAND_POINTS.size());++i){RAND_POINTS[i].set_dual(0.0);}
+        for(j=0;j<int(RAND_MESH.size());++j){RAND_MESH[j].add_dual();}
+        halo_reverse(RAND_POINTS, HALO_DUAL);
+        halo_forward(RAND_POINTS, HALO_DUAL);
+}
+
+// keep this rank's part of a mesh every rank has read in full (text and generated meshes): an equal share of its
+// vertices and triangles goes through domain_distribute, as for a binary mesh mapped in parts
+void domain_decompose(std::vector<VERTEX> &RAND_POINTS, std::vector<TRIANGLE> &RAND_MESH){
+        int N_POINTS = RAND_POINTS.size(), N_TRIANG = RAND_MESH.size();
+        int I0 = (long(N_POINTS)*MY_RANK)/N_RANKS, I1 = (long(N_POINTS)*(MY_RANK + 1))/N_RANKS;
+        int J0 = (long(N_TRIANG)*MY_RANK)/N_RANKS, J1 = (long(N_TRIANG)*(MY_RANK + 1))/N_RANKS;
+
+        std::vector<VERTEX> BLOCK(RAND_POINTS.begin() + I0, RAND_POINTS.begin() + I1);
+        std::vector<TRIANGLE_RECORD> TRI(J1 - J0);
+        for(int j=J0;j<J1;++j){TRI[j - J0] = triangle_record(RAND_MESH[j], j, &RAND_POINTS[0], NULL);}
+        domain_distribute(N_POINTS, N_TRIANG, I0, BLOCK, TRI, RAND_POINTS, RAND_MESH);
+}
+
+// repartition by the element evaluations per MAX_TBIN steps (MAX_TBIN/TBIN) when the busiest rank exceeds the mean by
+// more than BALANCE_THRESHOLD, migrating vertex and triangle state. Returns true if the local mesh changed.
+bool domain_rebalance(std::vector<VERTEX> &RAND_POINTS, std::vector<TRIANGLE> &RAND_MESH){
+        RD_DOMAIN &DOM = DOMAIN_DECOMP;
+        int j, k, N_TRIANG = RAND_MESH.size(), N_STORED = TRIANGLE::stored_size();
+        double LOCAL_COST = 0.0, MAX_COST, SUM_COST;
+
+        std::vector<double> COST(N_TRIANG);
+        for(j=0;j<N_TRIANG;++j){
+                COST[j]     = double(MAX_TBIN/RAND_MESH[j].get_tbin());
+                LOCAL_COST += COST[j];
+        }
+        MPI_Allreduce(&LOCAL_COST, &MAX_COST, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        MPI_Allreduce(&LOCAL_COST, &SUM_COST, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        DOM.IMBALANCE = MAX_COST*N_RANKS/SUM_COST;
+        if(DOM.IMBALANCE <= BALANCE_THRESHOLD){return false;}
+
+        // new ranks of the local triangles, taken in curve order
+
+        std::vector<int> CURVE(N_TRIANG), COUNT(N_RANKS, 0), RECV_COUNT;
+        std::vector<double> CURVE_COST(N_TRIANG);
+        for(j=0;j<N_TRIANG;++j){CURVE[j] = j;}
+        std::sort(CURVE.begin(), CURVE.end(), [&](int A, int B){
+                return DOM.LOCAL_KEY[A] < DOM.LOCAL_KEY[B] or (DOM.LOCAL_KEY[A] == DOM.LOCAL_KEY[B] and DOM.LOCAL_TRI[A] < DOM.LOCAL_TRI[B]);
+        });
+        for(k=0;k<N_TRIANG;++k){CURVE_COST[k] = COST[CURVE[k]];}
+        std::vector<int> RANK = domain_cut(CURVE_COST);
+
+        // every triangle as a record to its new rank (this one included), with its stored residuals
+
+        std::vector<TRIANGLE_RECORD> TRI(N_TRIANG);
+        std::vector<double> STORED(N_STORED*size_t(N_TRIANG));
+        for(k=0;k<N_TRIANG;++k){
+                j = CURVE[k];
+                TRI[k]     = triangle_record(RAND_MESH[j], DOM.LOCAL_TRI[j], &RAND_POINTS[0], DOM.GLOBAL_ID.data());
+                TRI[k].KEY = DOM.LOCAL_KEY[j];
+                RAND_MESH[j].get_stored(&STORED[N_STORED*size_t(k)]);
+                COUNT[RANK[k]] += 1;
+        }
+        TRI    = domain_alltoall(TRI, COUNT, RECV_COUNT);
+        STORED = domain_alltoall(STORED, COUNT, RECV_COUNT, N_STORED);
+
+        // new layout, the vertex state from the old owners
+
+        std::vector<int> OLD_OWNED(DOM.GLOBAL_ID.begin(), DOM.GLOBAL_ID.begin() + DOM.N_OWNED);
+        std::vector<int> HOLDER = domain_layout(TRI, STORED);
+        std::vector<double> STATE = domain_fetch(DOM.GLOBAL_ID, HOLDER, [&](int ID) -> VERTEX& {
+                return RAND_POINTS[std::lower_bound(OLD_OWNED.begin(), OLD_OWNED.end(), ID) - OLD_OWNED.begin()];
+        });
+        domain_build(RAND_POINTS, RAND_MESH, TRI, STORED, STATE);
+        return true;
+}
+
+// owned vertices of all ranks in global order on rank 0 (empty elsewhere); returns true on rank 0
+bool gather_points(std::vector<VERTEX> &RAND_POINTS, std::vector<VERTEX> &GLOBAL_POINTS){
+        RD_DOMAIN &DOM = DOMAIN_DECOMP;
+        int N = VERTEX::halo_size(HALO_STATE), R, i;
+        std::vector<double> SEND(N*DOM.N_OWNED), RECV;
+        std::vector<int> IDS(DOM.GLOBAL_ID.begin(), DOM.GLOBAL_ID.begin() + DOM.N_OWNED), ALL_IDS, COUNTS(N_RANKS), OFFSETS(N_RANKS);
+
+        for(i=0;i<DOM.N_OWNED;++i){RAND_POINTS[i].get_halo(HALO_STATE, &SEND[N*i]);}
+
+        MPI_Gather(&DOM.N_OWNED, 1, MPI_INT, COUNTS.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if(MY_RANK == 0){
+                for(R=0;R<N_RANKS;++R){OFFSETS[R] = R == 0 ? 0 : OFFSETS[R-1] + COUNTS[R-1];}
+                ALL_IDS.resize(DOM.N_GLOBAL_POINTS);
+        }
+        MPI_Gatherv(IDS.data(), DOM.N_OWNED, MPI_INT, ALL_IDS.data(), COUNTS.data(), OFFSETS.data(), MPI_INT, 0, MPI_COMM_WORLD);
+        if(MY_RANK == 0){
+                for(R=0;R<N_RANKS;++R){COUNTS[R] *= N; OFFSETS[R] *= N;}
+                RECV.resize(N*DOM.N_GLOBAL_POINTS);
+        }
+        MPI_Gatherv(SEND.data(), N*DOM.N_OWNED, MPI_DOUBLE, RECV.data(), COUNTS.data(), OFFSETS.data(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+        GLOBAL_POINTS.clear();
+        if(MY_RANK != 0){return false;}
+        GLOBAL_POINTS.resize(DOM.N_GLOBAL_POINTS);
+        for(i=0;i<DOM.N_GLOBAL_POINTS;++i){
+                GLOBAL_POINTS[ALL_IDS[i]].set_halo(HALO_STATE, &RECV[N*i]);
+                GLOBAL_POINTS[ALL_IDS[i]].set_id(ALL_IDS[i]);
+        }
+        return true;
+}
+
+// minimum over all ranks
+double domain_min(double VALUE){
+        double MIN;
+        MPI_Allreduce(&VALUE, &MIN, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+        return MIN;
+}
+
+// sum over all ranks
+int domain_sum(int VALUE){
+        int SUM;
+        MPI_Allreduce(&VALUE, &SUM, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+        return SUM;
+}
+
+// sum over all ranks
+double domain_sum(double VALUE){
+        double SUM;
+        MPI_Allreduce(&VALUE, &SUM, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        return SUM;
+}
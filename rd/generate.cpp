@@ -0,0 +1,181 @@
+/*
+In-process mesh generation (GENERATE_IC)
+        Places N_GENERATE points per side in the periodic box with the distributions of triangulation/cgal (GENERATOR),
+        triangulates them with triangulation/cgal/lib and sets up the vertices and triangles directly, skipping the
+        Delaunay2D.txt/Delaunay3D.txt round trip. Points are placed and elements set up in parallel loops; the random
+        generators hash the point index, so the mesh does not depend on the number of threads.
+
+        GEN_DENSITY places the points with a density following GEN_WEIGHT of the initial conditions from setup_vertex
+        (equal weight per point), so resolution goes where the initial conditions need it rather than uniformly.
+
+        periodic_triangulation and setup_triangles also retriangulate the moving mesh (moving_mesh.cpp).
+*/
+
+#include <stdint.h>
+#include "triangulation/cgal/lib/periodic_delaunay.h"
+
+enum{GEN_RANDOM, GEN_UNIFORM, GEN_OFFSET, GEN_PERTURBED, GEN_DENSITY};
+
+#ifdef THREE_D
+#define GEN_DIM 3
+#else
+#define GEN_DIM 2
+#endif
+
+// uniform deviate in [0,1) from the point index and stream K < 4 (splitmix64)
+double gen_random(uint64_t I, int K){
+        uint64_t Z = 4*I + K + 0x9e3779b97f4a7c15ull;
+        Z = (Z ^ (Z >> 30))*0xbf58476d1ce4e5b9ull;
+        Z = (Z ^ (Z >> 27))*0x94d049bb133111ebull;
+        Z = Z ^ (Z >> 31);
+        return (Z >> 11)*(1.0/9007199254740992.0);
+}
+
+// wrap a coordinate into the periodic box [0,L)
+double gen_wrap(double X, double L){
+        X = fmod(X, L);
+        if(X < 0.0){X += L;}
+        return X < L ? X : 0.0;                                         // -tiny + L rounds to L
+}
+
+// N_POINTS points distributed as GEN_WEIGHT, by inverse transform sampling of the weight tabulated on N_GRID cells per
+// side: point p takes the cell holding cumulative weight (p + u)/N_POINTS of the total and a random position within it
+std::vector<double> density_points(long N_POINTS, int N_GRID, const double L[]){
+        long N_CELLS = 1;
+        for(int k=0;k<GEN_DIM;++k){N_CELLS *= N_GRID;}
+        std::vector<double> W(N_CELLS), CUM(N_CELLS + 1, 0.0), X(GEN_DIM*N_POINTS);
+
+        // weight at the cell centres, floored at GEN_FLOOR times the mean so quiescent regions keep some points
+#pragma omp parallel for
+        for(long c=0;c<N_CELLS;++c){
+                double C[3];
+                long REST = c;
+                for(int k=GEN_DIM-1;k>=0;--k){C[k] = (REST % N_GRID + 0.5)*L[k]/N_GRID; REST /= N_GRID;}
+#ifdef THREE_D
+                VERTEX V = setup_vertex(C[0], C[1], C[2]);
+#else
+                VERTEX V = setup_vertex(C[0], C[1]);
+#endif
+                W[c] = GEN_WEIGHT(V);
+        }
+        double FLOOR = GEN_FLOOR*pairwise_sum(W.data(), N_CELLS)/N_CELLS;
+        for(long c=0;c<N_CELLS;++c){CUM[c+1] = CUM[c] + std::max(W[c], FLOOR);}
+
+#pragma omp parallel for
+        for(long p=0;p<N_POINTS;++p){
+                double TARGET = CUM[N_CELLS]*(p + gen_random(p, 3))/N_POINTS;
+                long c = std::upper_bound(CUM.begin() + 1, CUM.end(), TARGET) - (CUM.begin() + 1);
+                if(c >= N_CELLS){c = N_CELLS - 1;}
+                for(int k=GEN_DIM-1;k>=0;--k){
+                        X[GEN_DIM*p + k] = (c % N_GRID + gen_random(p, k))*L[k]/N_GRID;
+                        c /= N_GRID;
+                }
+        }
+
+        return X;
+}
+
+// N_SIDE^GEN_DIM points, GEN_DIM coordinates each
+std::vector<double> generate_points(int GENERATOR_TYPE, int N_SIDE){
+#ifdef THREE_D
+        double L[3] = {SIDE_LENGTH_X, SIDE_LENGTH_Y, SIDE_LENGTH_Z};
+#else
+        double L[2] = {SIDE_LENGTH_X, SIDE_LENGTH_Y};
+#endif
+        long N_POINTS = 1;
+        for(int k=0;k<GEN_DIM;++k){N_POINTS *= N_SIDE;}
+        if(GENERATOR_TYPE == GEN_DENSITY){return density_points(N_POINTS, GEN_GRID*N_SIDE, L);}
+        std::vector<double> X(GEN_DIM*N_POINTS);
+
+#pragma omp parallel for
+        for(long i=0;i<N_POINTS;++i){
+                int CELL[3], k;
+                long REST = i;
+                for(k=GEN_DIM-1;k>=0;--k){CELL[k] = REST % N_SIDE; REST /= N_SIDE;}
+
+                for(k=0;k<GEN_DIM;++k){
+                        double H = L[k]/N_SIDE, POS = 0.0;
+                        switch(GENERATOR_TYPE){
+                                case GEN_RANDOM:
+                                        POS = L[k]*gen_random(i, k);
+                                        break;
+                                case GEN_UNIFORM:
+                                        POS = H*CELL[k];
+                                        break;
+                                case GEN_OFFSET:                // alternate rows shifted half a cell along x
+                                case GEN_PERTURBED:             // and moved by up to half a cell along x
+                                        POS = H*CELL[k];
+                                        if(k == 0 and CELL[1] % 2 != 0){POS += 0.5*H;}
+                                        if(k == 0 and GENERATOR_TYPE == GEN_PERTURBED){POS += H*(gen_random(i, k) - 0.5);}
+                                        break;
+                        }
+                        X[GEN_DIM*i + k] = gen_wrap(POS, L[k]);
+                }
+        }
+
+        return X;
+}
+
+// periodic Delaunay triangulation of X with triangulation/cgal/lib, -1 if there is none
+long periodic_triangulation(const std::vector<double> &X, std::vector<int> &VERTS, std::vector<int> &SHIFT){
+#ifdef THREE_D
+        double LOW[3] = {0.0, 0.0, 0.0}, HIGH[3] = {SIDE_LENGTH_X, SIDE_LENGTH_Y, SIDE_LENGTH_Z};
+        long N_TRIANG = periodic_delaunay_3d(LOW, HIGH, X, VERTS, SHIFT);
+#else
+        double LOW[2] = {0.0, 0.0}, HIGH[2] = {SIDE_LENGTH_X, SIDE_LENGTH_Y};
+        long N_TRIANG = periodic_delaunay_2d(LOW, HIGH, X, VERTS, SHIFT);
+#endif
+        if(N_TRIANG < 0){
+                std::cout << "BWARNING: Points not forming a 1-sheeted periodic triangulation." << std::endl;
+        }
+        return N_TRIANG;
+}
+
+// triangles of the triangulation of POINTS (duals zero), set up as the CGAL_IC readers do, duals summed in triangle order
+void setup_triangles(long N_TRIANG, const std::vector<int> &VERTS, const std::vector<int> &SHIFT, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        MESH.resize(N_TRIANG);
+#pragma omp parallel for
+        for(long j=0;j<N_TRIANG;++j){
+                const int *V = &VERTS[(GEN_DIM+1)*j];
+                int BOUNDARY = 0;
+
+                MESH[j].set_vertex_0(&POINTS[V[0]]);
+                MESH[j].set_vertex_1(&POINTS[V[1]]);
+                MESH[j].set_vertex_2(&POINTS[V[2]]);
+#ifdef THREE_D
+                MESH[j].set_vertex_3(&POINTS[V[3]]);
+#endif
+                MESH[j].set_id(j);
+
+                // periodic images straight from the triangulation offsets, boundary triangle if any corner is shifted
+                for(int m=0;m<=GEN_DIM;++m){
+                        MESH[j].set_shift(m, SHIFT[(GEN_DIM+1)*j + m]);
+                        if(SHIFT[(GEN_DIM+1)*j + m] != 0){BOUNDARY = 1;}
+                }
+                MESH[j].set_boundary(BOUNDARY);
+        }
+
+        setup_geometry(MESH);
+}
+
+// triangulate X and set up the vertices and triangles
+void generate_mesh(std::vector<double> X, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        std::vector<int> VERTS, SHIFT;
+        long N_TRIANG = periodic_triangulation(X, VERTS, SHIFT);
+        if(N_TRIANG < 0){exit(1);}
+        int N_POINTS = X.size()/GEN_DIM;
+
+        POINTS.resize(N_POINTS);
+#pragma omp parallel for
+        for(int i=0;i<N_POINTS;++i){
+#ifdef THREE_D
+                POINTS[i] = setup_vertex(X[3*i], X[3*i+1], X[3*i+2]);
+#else
+                POINTS[i] = setup_vertex(X[2*i], X[2*i+1]);
+#endif
+                POINTS[i].reset_len_vel_sum();
+                POINTS[i].set_id(i);
+        }
+
+        setup_triangles(N_TRIANG, VERTS, SHIFT, POINTS, MESH);
+}
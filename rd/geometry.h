@@ -0,0 +1,73 @@
+/*
+Element geometry from cross products, shared by the 2D and 3D TRIANGLE classes
+        triangle_geometry    => area, edge lengths MAG and unit inward normals of a counter-clockwise triangle (edge m
+                                opposite vertex m, normal pointing towards it)
+        tetrahedron_geometry => volume, twice the face areas MAG and unit inward normals of a tetrahedron (face m opposite
+                                vertex m, normal pointing towards it)
+        setup_geometry       => all elements at mesh load: normals across threads, then the duals summed in element order
+                                so they do not depend on the thread count
+
+        No transcendental calls and no branches in the kernels: the orientation of a 3D face normal is the sign of its dot
+        product with an edge to the opposite vertex.
+*/
+
+#include <math.h>
+#include <vector>
+
+inline double triangle_geometry(const double X[3], const double Y[3], double NORMAL[3][2], double MAG[3]){
+        double PERP[3][2];
+
+        for(int m=0;m<3;++m){
+                int J = (m + 1) % 3, K = (m + 2) % 3;
+                PERP[m][0] = Y[J] - Y[K];
+                PERP[m][1] = X[K] - X[J];
+        }
+
+        for(int m=0;m<3;++m){
+                MAG[m] = sqrt(PERP[m][0]*PERP[m][0] + PERP[m][1]*PERP[m][1]);
+                NORMAL[m][0] = PERP[m][0]/MAG[m];
+                NORMAL[m][1] = PERP[m][1]/MAG[m];
+        }
+
+        return 0.5*fabs(PERP[0][0]*PERP[1][1] - PERP[0][1]*PERP[1][0]);
+}
+
+inline double tetrahedron_geometry(const double X[4], const double Y[4], const double Z[4], double NORMAL[4][3], double MAG[4]){
+        double E[4][3], PERP[4][3], DOT[4];
+
+        for(int m=0;m<4;++m){                                           // edges from vertex 0, E[0] from vertex 1 to 0
+                int O = m == 0 ? 1 : 0;
+                E[m][0] = X[m] - X[O];
+                E[m][1] = Y[m] - Y[O];
+                E[m][2] = Z[m] - Z[O];
+        }
+        double E21[3] = {X[2] - X[1], Y[2] - Y[1], Z[2] - Z[1]};
+        double E31[3] = {X[3] - X[1], Y[3] - Y[1], Z[3] - Z[1]};
+
+        const double *A[4] = {E21, E[2], E[1], E[2]};                   // face m spanned by A[m] x B[m]
+        const double *B[4] = {E31, E[3], E[3], E[1]};
+        for(int m=0;m<4;++m){
+                PERP[m][0] = A[m][1]*B[m][2] - A[m][2]*B[m][1];
+                PERP[m][1] = A[m][2]*B[m][0] - A[m][0]*B[m][2];
+                PERP[m][2] = A[m][0]*B[m][1] - A[m][1]*B[m][0];
+                DOT[m] = PERP[m][0]*E[m][0] + PERP[m][1]*E[m][1] + PERP[m][2]*E[m][2];
+        }
+
+        for(int m=0;m<4;++m){
+                MAG[m] = sqrt(PERP[m][0]*PERP[m][0] + PERP[m][1]*PERP[m][1] + PERP[m][2]*PERP[m][2]);
+                double S = copysign(1.0, DOT[m])/MAG[m];                // inwards
+                NORMAL[m][0] = S*PERP[m][0];
+                NORMAL[m][1] = S*PERP[m][1];
+                NORMAL[m][2] = S*PERP[m][2];
+        }
+
+        return fabs(DOT[1])/6.0;                                        // E10.(E20 x E30) is six times the signed volume
+}
+
+template<class ELEMENT>
+void setup_geometry(std::vector<ELEMENT> &MESH){
+        long N_ELEM = MESH.size();
+#pragma omp parallel for schedule(static)
+        for(long j=0;j<N_ELEM;++j){MESH[j].setup_normals(false);}
+        for(long j=0;j<N_ELEM;++j){MESH[j].add_dual();}
+}
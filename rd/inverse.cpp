@@ -1,20 +1,69 @@
-lapack_int mat_inv(double *A, unsigned n, double X, double Y, int ID, int POINT){
+int N_SINGULAR = 0;                                     // singular matrices regularised in the current step
+const double PIVOT_RATIO_MIN = 1.0e-12;                 // smallest min|U_ii|/max|U_ii| still inverted directly
+
+// regularised pseudo-inverse V diag(s/(s^2 + EPS^2)) U^T of the n x n matrix A = U diag(s) V^T, in place. Filtering the
+// singular values rather than inverting A^T A + EPS^2 I keeps it accurate when A is (nearly) singular. Zero for A = 0.
+void mat_pinv(double *A, unsigned n){
+        double NORM = 0.0, EPS2;
+        double S[n], U[n*n], VT[n*n], SUPERB[n];
+        unsigned i,j,k;
+
+        for(i=0;i<n*n;++i){NORM += A[i]*A[i];}
+        if(not (NORM > 0.0) or not std::isfinite(NORM)){
+                for(i=0;i<n*n;++i){A[i] = 0.0;}
+                return ;
+        }
+        EPS2 = 1.0e-16*NORM;
+
+        LAPACKE_dgesvd(LAPACK_COL_MAJOR,'A','A',n,n,A,n,S,U,n,VT,n,SUPERB);
+
+        for(k=0;k<n;++k){S[k] = S[k]/(S[k]*S[k] + EPS2);}
+        for(i=0;i<n;++i){
+                for(j=0;j<n;++j){
+                        A[j*n+i] = 0.0;
+                        for(k=0;k<n;++k){A[j*n+i] += VT[i*n+k]*S[k]*U[k*n+j];}
+                }
+        }
+}
+
+lapack_int mat_inv(double *A, unsigned n, [[maybe_unused]] double X, [[maybe_unused]] double Y, [[maybe_unused]] int ID, [[maybe_unused]] int POINT){
         int ipiv[n+1];
+        double A_COPY[n*n];
         lapack_int ret;
 
+        for(unsigned i=0;i<n*n;++i){A_COPY[i] = A[i];}
+
         ret =  LAPACKE_dgetrf(LAPACK_COL_MAJOR,n,n,A,n,ipiv);
 
 #ifdef DEBUG
         std::cout << "ret =\t" << ret << "\t(0 = done, <0 = illegal arguement, >0 = singular)" << std::endl;
 #endif
 
+        // numerically singular too when the pivots span more than 1/PIVOT_RATIO_MIN, report the smallest one as dgetrf would
+        if(ret == 0){
+                double U_MIN = fabs(A[0]), U_MAX = fabs(A[0]);
+                unsigned I_MIN = 0;
+                for(unsigned i=1;i<n;++i){
+                        double U_II = fabs(A[i*n+i]);
+                        if(U_II < U_MIN){U_MIN = U_II; I_MIN = i;}
+                        if(U_II > U_MAX){U_MAX = U_II;}
+                }
+                if(not (U_MIN >= PIVOT_RATIO_MIN*U_MAX)){ret = I_MIN + 1;}
+        }
+
         if(ret !=0){
+                // singular or ill-conditioned (typically no inflow in stagnant flow): carry on with the regularised pseudo-inverse
+#ifdef DEBUG
                 std::cout << "B WARNING: MATRIX CANNOT BE INVERTED\t" << ret << "\t(0 = done, <0 = illegal arguement, >0 = singular) at " << X << "\t" << Y << "\tPoint =\t" << POINT << "\t" << ID << std::endl;
                 for(int i=0;i<n*n;++i){
-                        std::cout << A[i] << "\t";
+                        std::cout << A_COPY[i] << "\t";
                         if((i+1)%n == 0){std::cout << std::endl;}
                 }
-                exit(0);
+#endif
+                for(unsigned i=0;i<n*n;++i){A[i] = A_COPY[i];}
+                mat_pinv(A, n);
+#pragma omp atomic
+                N_SINGULAR++;
                 return ret;
         }
         ret = LAPACKE_dgetri(LAPACK_COL_MAJOR,n,A,n,ipiv);
@@ -13,18 +13,17 @@ void open_active(std::ofstream &SNAPFILE, int i){
         return;
 }
 
-void write_snap(std::vector<VERTEX> POINTS, double T, double DT, int N_POINTS, int SNAP_ID, std::ofstream &LOGFILE){
+void write_snap(std::vector<VERTEX> &POINTS, double T, double DT, int N_POINTS, int SNAP_ID, std::ofstream &LOGFILE){
         std::ofstream SNAPFILE;
         open_snap(SNAPFILE,SNAP_ID);
-        double TOTAL_DENSITY = 0.0;
-        double TOTAL_ENERGY = 0.0;
         SNAPFILE << N_POINTS << "\t" << T << std::endl;
         for(int i=0;i<N_POINTS;++i){
                 // write         X                           Y                                 rho                                   v_x                                    v_y                                 p                                      e                                         |S|
                 SNAPFILE << POINTS[i].get_x() << "\t" << POINTS[i].get_y() << "\t" << POINTS[i].get_mass_density() << "\t" << POINTS[i].get_x_velocity() << "\t" << POINTS[i].get_y_velocity() << "\t" << POINTS[i].get_pressure() << "\t" << POINTS[i].get_specific_energy() << "\t" << POINTS[i].get_dual() << std::endl;
-                TOTAL_DENSITY += POINTS[i].get_mass_density()*POINTS[i].get_dual();
-                TOTAL_ENERGY += POINTS[i].get_specific_energy()*POINTS[i].get_dual() * POINTS[i].get_mass_density();
         }
+        // conserved totals independent of the thread count (reduce.cpp)
+        double TOTAL_DENSITY = deterministic_sum(N_POINTS, [&](int i){return POINTS[i].get_mass_density()*POINTS[i].get_dual();});
+        double TOTAL_ENERGY  = deterministic_sum(N_POINTS, [&](int i){return POINTS[i].get_specific_energy()*POINTS[i].get_dual()*POINTS[i].get_mass_density();});
         std::cout << "*************************************************************************************************" << std::endl;            // right out time and total density to terminal
         std::cout << "time\t" << T << " \t-> total mass =\t" << TOTAL_DENSITY << " \t-> total energy =\t" << TOTAL_ENERGY << "\ttime step = \t" << DT << std::endl;
         LOGFILE << T << "\t" << TOTAL_DENSITY << "\t" << TOTAL_ENERGY << "\t" << DT << "\t" << MAX_TBIN << "\t" << N_POINTS << std::endl;
@@ -36,8 +35,19 @@ void write_active(std::vector<TRIANGLE> MESH, int N_TRIANG, int SNAP_ID, int TBI
         std::ofstream SNAPFILE;
         SNAPFILE << std::setprecision(12);
         double X0,X1,X2,Y0,Y1,Y2;
+#ifdef MPI_RD
+        // ranks append their triangles in turn after the header from rank 0 (domain.cpp)
+        for(int R=0;R<MY_RANK;++R){MPI_Barrier(MPI_COMM_WORLD);}
+        if(MY_RANK == 0){
+                open_active(SNAPFILE,SNAP_ID);
+                SNAPFILE << DOMAIN_DECOMP.N_GLOBAL_TRIANG << "\t" << std::endl;
+        }else{
+                SNAPFILE.open("output/active_"+std::to_string(SNAP_ID)+".txt", std::ios::app);
+        }
+#else
         open_active(SNAPFILE,SNAP_ID);
         SNAPFILE << N_TRIANG << "\t" << std::endl;
+#endif
         for(int j=0;j<N_TRIANG;++j){
                 if(MESH[j].get_boundary() == 0){
                         X0 = MESH[j].get_vertex_0()->get_x();
@@ -50,6 +60,10 @@ void write_active(std::vector<TRIANGLE> MESH, int N_TRIANG, int SNAP_ID, int TBI
                         SNAPFILE << X0 << "\t" << Y0 << "\t"  << X1 << "\t" << Y1 << "\t"  << X2 << "\t" << Y2 << "\t" << MESH[j].get_tbin() << "\t" << MESH[j].get_un00() << "\t" << MESH[j].get_un01() << "\t" << MESH[j].get_un02() << std::endl;
                 }
         }
+#ifdef MPI_RD
+        SNAPFILE.close();
+        for(int R=MY_RANK;R<N_RANKS;++R){MPI_Barrier(MPI_COMM_WORLD);}
+#endif
 }
 
 void read_parameter_file(int ARGC, char *ARGV[]){
@@ -108,7 +122,7 @@ TRIANGLE qhull_read_triangles_line(std::ifstream &TRIANGLES_FILE, std::vector<VE
         NEW_TRIANGLE.set_vertex_1(&POINTS[VERT1]);
         NEW_TRIANGLE.set_vertex_2(&POINTS[VERT2]);
 
-        NEW_TRIANGLE.setup_normals();
+        NEW_TRIANGLE.find_shift();
 
         return NEW_TRIANGLE;
 }
@@ -178,31 +192,232 @@ TRIANGLE cgal_read_triangles_line(std::ifstream &CGAL_FILE, std::vector<VERTEX>
 
         // std::cout << POINTS[VERT0].get_x() << "\t" << POINTS[VERT1].get_x() << "\t" << POINTS[VERT2].get_x() << std::endl;
 
-        double X0,X1,X2,Y0,Y1,Y2;
+        // periodic images of the vertices, which also flag a boundary triangle
+        NEW_TRIANGLE.find_shift();
 
-        // check if boundary triangle
+        return NEW_TRIANGLE;
+}
 
-        X0 = POINTS[VERT0].get_x();
-        X1 = POINTS[VERT1].get_x();
-        X2 = POINTS[VERT2].get_x();
+#endif
 
-        Y0 = POINTS[VERT0].get_y();
-        Y1 = POINTS[VERT1].get_y();
-        Y2 = POINTS[VERT2].get_y();
+// if using a binary mesh (mesh_binary.h), map it and build the vertices and triangles directly
+#ifdef BINARY_IC
+#ifdef MPI_RD
+// each rank maps its share of the file, a block of vertices and a slice of the triangles, and domain_distribute lays the
+// mesh out across the ranks from these, so no rank reads or holds the whole mesh
+void binary_read_mesh(std::string MESH_FILE_NAME, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        MESH_PART PART;
+        if(not mesh_map_part(MESH_FILE_NAME.c_str(), 2, MY_RANK, N_RANKS, PART)){exit(1);}
+        const MESH_HEADER &H = PART.HEADER;
+        int N_POINTS = H.N_POINTS, N_TRIANG = H.N_TRIANG, I0 = PART.I0, J0 = PART.J0;
 
-        if(abs(X0 - X1) > 0.5*SIDE_LENGTH_X or abs(X0 - X2) > 0.5*SIDE_LENGTH_X or abs(X1 - X2) > 0.5*SIDE_LENGTH_X or
-           abs(Y0 - Y1) > 0.5*SIDE_LENGTH_Y or abs(Y0 - Y2) > 0.5*SIDE_LENGTH_Y or abs(Y1 - Y2) > 0.5*SIDE_LENGTH_Y){
-                NEW_TRIANGLE.set_boundary(1);
-        }else{
-                NEW_TRIANGLE.set_boundary(0);
-        } 
-        
-        NEW_TRIANGLE.setup_normals();
+        // check boundaries match
+        if(H.LOW[0] < 0.0 or H.LOW[1] < 0.0 or int(H.HIGH[0]) != SIDE_LENGTH_X or int(H.HIGH[1]) != SIDE_LENGTH_Y){
+                std::cout << "BWARNING: Exiting on mismatching boundaries. Have (X): " << H.LOW[0]  << "\t" << H.HIGH[0] << "\tNeed (X): " << 0.0 << "\t" << SIDE_LENGTH_X << std::endl;
+                exit(1);
+        }
 
-        return NEW_TRIANGLE;
+        std::vector<VERTEX> BLOCK(PART.I1 - PART.I0);
+        for(int i=0;i<int(BLOCK.size());++i){
+                BLOCK[i] = setup_vertex(PART.X[2*i], PART.X[2*i+1]);
+                BLOCK[i].reset_len_vel_sum();
+                BLOCK[i].set_id(I0 + i);
+        }
+
+        std::vector<TRIANGLE_RECORD> TRI(PART.J1 - PART.J0);
+        for(int j=0;j<int(TRI.size());++j){
+                const uint32_t *V = &PART.VERTS[3*j];
+                const uint8_t *S = &PART.SHIFT[3*j];
+                for(int m=0;m<3;++m){
+                        if(V[m] >= uint32_t(N_POINTS)){
+                                std::cout << "BWARNING: Exiting on vertex index " << V[m] << " out of range in triangle " << J0 + j << std::endl;
+                                exit(1);
+                        }
+                        TRI[j].VERTS[m] = V[m];
+                        TRI[j].SHIFT[m] = S[m];
+                }
+                TRI[j].ID       = J0 + j;
+                TRI[j].TBIN     = 1;
+                TRI[j].BOUNDARY = S[0] or S[1] or S[2];
+        }
+        mesh_unmap_part(PART);
+
+        domain_distribute(N_POINTS, N_TRIANG, I0, BLOCK, TRI, POINTS, MESH);
+}
+#else
+void binary_read_mesh(std::string MESH_FILE_NAME, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        MESH_MAP MAP;
+        if(not mesh_map(MESH_FILE_NAME.c_str(), 2, MAP)){exit(1);}
+        const MESH_HEADER &H = *MAP.HEADER;
+        int N_POINTS = H.N_POINTS, N_TRIANG = H.N_TRIANG;
+
+        // check boundaries match
+        if(H.LOW[0] < 0.0 or H.LOW[1] < 0.0 or int(H.HIGH[0]) != SIDE_LENGTH_X or int(H.HIGH[1]) != SIDE_LENGTH_Y){
+                std::cout << "BWARNING: Exiting on mismatching boundaries. Have (X): " << H.LOW[0]  << "\t" << H.HIGH[0] << "\tNeed (X): " << 0.0 << "\t" << SIDE_LENGTH_X << std::endl;
+                exit(1);
+        }
+
+        POINTS.resize(N_POINTS);
+        for(int i=0;i<N_POINTS;++i){
+                POINTS[i] = setup_vertex(MAP.X[2*i], MAP.X[2*i+1]);
+                POINTS[i].reset_len_vel_sum();
+                POINTS[i].set_id(i);
+        }
+
+        MESH.resize(N_TRIANG);
+        for(int j=0;j<N_TRIANG;++j){
+                const uint32_t *V = &MAP.VERTS[3*j];
+                for(int m=0;m<3;++m){
+                        if(V[m] >= uint32_t(N_POINTS)){
+                                std::cout << "BWARNING: Exiting on vertex index " << V[m] << " out of range in triangle " << j << std::endl;
+                                exit(1);
+                        }
+                }
+                MESH[j].set_vertex_0(&POINTS[V[0]]);
+                MESH[j].set_vertex_1(&POINTS[V[1]]);
+                MESH[j].set_vertex_2(&POINTS[V[2]]);
+                MESH[j].set_id(j);
+                for(int m=0;m<3;++m){MESH[j].set_shift(m, MAP.SHIFT[3*j+m]);}
+                MESH[j].set_boundary(MAP.SHIFT[3*j] or MAP.SHIFT[3*j+1] or MAP.SHIFT[3*j+2]);
+        }
+        setup_geometry(MESH);
+
+        mesh_unmap(MAP);
+}
+#endif
+#endif
+
+// if reading the text triangulation across threads (parse_text.cpp), build the vertices and triangles in parallel loops
+#ifdef PARALLEL_PARSE
+// N_POINTS vertex lines from line FIRST, qhull coordinates are centred on the origin and scaled to the box
+void parallel_read_vertices(const TEXT_MAP &MAP, size_t FIRST, bool QHULL, std::vector<VERTEX> &POINTS){
+        int N_POINTS = POINTS.size(), BAD = N_POINTS;
+
+#pragma omp parallel for reduction(min:BAD)
+        for(int i=0;i<N_POINTS;++i){
+                double X[2];
+                if(not text_line(MAP, FIRST + i, X, 2)){BAD = std::min(BAD, i); continue;}
+                if(QHULL){
+                        X[0] = SIDE_LENGTH_X*(X[0] + 0.5);
+                        X[1] = SIDE_LENGTH_Y*(X[1] + 0.5);
+                }
+                POINTS[i] = setup_vertex(X[0], X[1]);
+                POINTS[i].reset_len_vel_sum();
+                POINTS[i].set_id(i);
+        }
+
+        if(BAD < N_POINTS){
+                std::cout << "BWARNING: Exiting on malformed vertex " << BAD << std::endl;
+                exit(1);
+        }
 }
 
+// N_TRIANG triangle lines from line FIRST, after SKIP leading tokens, geometry set up as the serial readers do
+void parallel_read_triangles(const TEXT_MAP &MAP, size_t FIRST, int SKIP, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        int N_POINTS = POINTS.size(), N_TRIANG = MESH.size(), BAD = N_TRIANG;
+
+#pragma omp parallel for reduction(min:BAD)
+        for(int j=0;j<N_TRIANG;++j){
+                int V[3], m;
+                bool OK = text_line(MAP, FIRST + j, V, 3, SKIP);
+                for(m=0;m<3 and OK;++m){OK = V[m] >= 0 and V[m] < N_POINTS;}
+                if(not OK){BAD = std::min(BAD, j); continue;}
+
+                MESH[j].set_vertex_0(&POINTS[V[0]]);
+                MESH[j].set_vertex_1(&POINTS[V[1]]);
+                MESH[j].set_vertex_2(&POINTS[V[2]]);
+                MESH[j].set_id(j);
+                MESH[j].find_shift();
+        }
+
+        if(BAD < N_TRIANG){
+                std::cout << "BWARNING: Exiting on malformed triangle " << BAD << std::endl;
+                exit(1);
+        }
+
+        setup_geometry(MESH);
+}
+
+#ifdef CGAL_IC
+void parallel_read_cgal(std::string CGAL_FILE_NAME, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        TEXT_MAP MAP;
+        double BOX[4];
+        int SHEETS[2], N_POINTS, N_TRIANG;
+
+        if(not text_map(CGAL_FILE_NAME.c_str(), MAP)){exit(1);}
+        if(not text_line(MAP, 0, BOX, 4) or not text_line(MAP, 1, SHEETS, 2) or not text_line(MAP, 2, &N_POINTS, 1) or not text_line(MAP, 3 + N_POINTS, &N_TRIANG, 1)){
+                std::cout << "BWARNING: Exiting on malformed CGAL header." << std::endl;
+                exit(1);
+        }
+
+        // check boundaries match
+        float XLOW = BOX[0], YLOW = BOX[1], XHIGH = BOX[2], YHIGH = BOX[3];
+        if(XLOW < 0.0 or YLOW < 0.0 or int(XHIGH) != SIDE_LENGTH_X or int(YHIGH) != SIDE_LENGTH_Y){
+                std::cout << "BWARNING: Exiting on mismatching boundaries. Have (X): " << XLOW  << "\t" << XHIGH << "\tNeed (X): " << 0.0 << "\t" << SIDE_LENGTH_X << std::endl;
+                exit(1);
+        }
+
+        // check data in 1-sheet format
+        if(SHEETS[0] != 1 or SHEETS[1] != 1){
+                std::cout << "BWARNING: Exiting on CGAL file not in 1-sheet format." << std::endl;
+                exit(1);
+        }
+
+        POINTS.resize(N_POINTS);
+        parallel_read_vertices(MAP, 3, false, POINTS);
+
+        MESH.resize(N_TRIANG);
+        parallel_read_triangles(MAP, 4 + N_POINTS, 0, POINTS, MESH);
+
+        text_unmap(MAP);
+}
 #endif
 
+#ifdef QHULL_IC
+void parallel_read_qhull(std::string POSITIONS_FILE_NAME, std::string TRIANGLES_FILE_NAME, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        TEXT_MAP POSITIONS, TRIANGLES;
+        int N_POINTS, N_TRIANG;
+
+        if(not text_map(POSITIONS_FILE_NAME.c_str(), POSITIONS) or not text_map(TRIANGLES_FILE_NAME.c_str(), TRIANGLES)){exit(1);}
+        if(not text_line(POSITIONS, 1, &N_POINTS, 1) or not text_line(TRIANGLES, 0, &N_TRIANG, 1)){
+                std::cout << "BWARNING: Exiting on malformed QHULL header." << std::endl;
+                exit(1);
+        }
+
+        const char *INFO = POSITIONS.DATA + POSITIONS.LINE[0];
+        std::cout << "Details of point creation =\t" << std::string(INFO, std::find(INFO, POSITIONS.DATA + POSITIONS.LINE[1], '\n')) << std::endl;
+
+        POINTS.resize(N_POINTS);
+        parallel_read_vertices(POSITIONS, 2, true, POINTS);
 
+        MESH.resize(N_TRIANG);
+        parallel_read_triangles(TRIANGLES, 1, 1, POINTS, MESH);
 
+        text_unmap(POSITIONS);
+        text_unmap(TRIANGLES);
+}
+#endif
+#endif
+
+#ifdef MESH_REPORT
+// pre-flight quality report of the loaded mesh and initial state (mesh_quality.h), exits on a rejected mesh
+void mesh_report(std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        VERTEX *BASE = POINTS.data();
+        QUALITY_REPORT Q = mesh_quality(2, POINTS.size(), MESH.size(), [&](long j, int m, double P[3]){
+                VERTEX *V = m == 0 ? MESH[j].get_vertex_0() : m == 1 ? MESH[j].get_vertex_1() : MESH[j].get_vertex_2();
+                int SHIFT = MESH[j].get_shift(m);
+                P[0] = V->get_x() + ((SHIFT & 1) ? SIDE_LENGTH_X : 0.0);
+                P[1] = V->get_y() + ((SHIFT & 2) ? SIDE_LENGTH_Y : 0.0);
+                return long(V - BASE);
+        }, [&](long i){
+                VERTEX &V = POINTS[i];
+                double V2 = V.get_x_velocity()*V.get_x_velocity() + V.get_y_velocity()*V.get_y_velocity();
+                return sqrt(V2) + sqrt(EOS::sound_speed_sq_enthalpy(V.get_u0(), (V.get_u3() + V.get_pressure())/V.get_u0(), V2));
+        }, CFL, MAX_TBIN);
+        mesh_quality_print(Q);
+        if(Q.N_DEGENERATE > 0 or Q.ANGLE_MIN < MESH_MIN_ANGLE){
+                std::cout << "BWARNING: Exiting on " << Q.N_DEGENERATE << " degenerate triangles, minimum angle " << Q.ANGLE_MIN << " (MESH_MIN_ANGLE " << MESH_MIN_ANGLE << ")" << std::endl;
+                exit(2);
+        }
+}
+#endif
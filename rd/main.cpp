@@ -4,22 +4,68 @@
 #include <string>
 #include <cmath>
 #include <vector>
+#include <algorithm>
 #include <cstdlib>
 #include <stdio.h>
 #include <omp.h> 
 
 #include "constants.h"
+#ifdef MPI_RD
+#include <mpi.h>
+#endif
+#include "../common/physics.h"
+#ifdef COOLING
+#include "../common/cooling.h"
+#endif
 
 #include "cblas.h"
 #include "lapacke.h"
 #include "inverse.cpp"
 #include "base.cpp"
+#include "reduce.cpp"
+#include "geometry.h"
+#ifdef CHARACTERISTIC
+#include "characteristic.cpp"
+#endif
 
 #ifdef TWO_D
 #include "vertex2D.h"
+#include "convert.cpp"
 #include "triangle2D.h"
+#if defined(BATCH_RESIDUAL) && (defined(DEBUG) || defined(CLOSED) || defined(CHARACTERISTIC))
+#undef BATCH_RESIDUAL                                   // per element DEBUG output, CLOSED skips and CHARACTERISTIC only in the scalar kernel
+#define BATCH_RESIDUAL_FALLBACK                         // reported at startup
+#endif
+#ifdef BATCH_RESIDUAL
+#include "batch2D.cpp"
+#endif
+#ifdef MPI_RD
+#include "domain.cpp"
+#endif
 #include "setup2D.cpp"
+#ifdef BINARY_IC
+#include "mesh_binary.h"
+#endif
+#ifdef MESH_REPORT
+#include "mesh_quality.h"
+#endif
+#ifdef PARALLEL_PARSE
+#include "parse_text.cpp"
+#endif
 #include "io2D.cpp"
+#if defined(GENERATE_IC) or defined(MOVING_MESH)
+#include "generate.cpp"
+#endif
+#ifdef DU_PRIVATE
+#include "scatter.cpp"
+#endif
+#ifdef MOVING_MESH
+#include "moving_mesh.cpp"
+#endif
+#ifdef AMR
+#include "amr.cpp"
+#endif
+#include "source_bins.cpp"
 #include "source2D.cpp"
 #include "timestep.cpp"
 #endif
@@ -30,14 +76,21 @@ int main(int ARGC, char *ARGV[]){
         */
         int i, j, l = 0, m;                                        // ******* decalare varaibles and vectors ******
         int SNAP_ID = 0;
-        double DT, T = 0.0;                                        //
+        double DT = 0.0, T = 0.0;                                  //
         double NEXT_TIME = 0.0;                                    // NEXT_TIME    = time of next snapshot
-        double NEXT_DT = T_TOT, POSSIBLE_DT = T_TOT;               // NEXT_DT.     = timestep for upcoming time iteration
+        double NEXT_DT = T_TOT;                                    // NEXT_DT.     = timestep for upcoming time iteration
         double MIN_DT;
-        VERTEX                               NEW_VERTEX;           // NEW_VERTEX   = dummy variable for setting up vertices
-        TRIANGLE                             NEW_TRIANGLE;         // NEW_TRIABLE  = dummy variable for setting up triangles
         std::vector<VERTEX>                  RAND_POINTS;          // X_POINTS     = vector of x vertices
         std::vector<TRIANGLE>                RAND_MESH;            // X_MESH       = vector of x triangles
+#ifdef BATCH_RESIDUAL
+        std::vector<TRIANGLE*>               ACTIVE_MESH;          // ACTIVE_MESH  = triangles passed to the batched residual kernel
+#endif
+
+#ifdef MPI_RD
+        std::vector<VERTEX>                  GLOBAL_POINTS;        // GLOBAL_POINTS = all owned vertices, gathered on rank 0 for snapshots
+        bool                                 GHOSTS_CURRENT = true;// GHOSTS_CURRENT = ghost U already matches the owners
+        domain_init(&ARGC, &ARGV);
+#endif
 
         // Initialise seed for random number generator (rand)
         std::srand(68315);
@@ -62,23 +115,68 @@ int main(int ARGC, char *ARGV[]){
         printf("Using B Scheme\n");
 #endif
 
+#ifdef CHARACTERISTIC
+        printf("Using characteristic distribution\n");
+#endif
+
+#if defined(BATCH_RESIDUAL)
+        printf("Using batched residual kernel\n");
+#elif defined(BATCH_RESIDUAL_FALLBACK)
+        printf("Using scalar residual kernel, BATCH_RESIDUAL is not available with DEBUG, CLOSED or CHARACTERISTIC\n");
+#endif
+
 #ifdef FIRST_ORDER
         printf("Using 1st order\n");
 #else
         printf("Using 2nd order\n");
 #endif
 
+#if defined(EOS_ISOTHERMAL)
+        printf("Using isothermal EOS\n");
+#elif defined(EOS_POLYTROPIC)
+        printf("Using polytropic EOS\n");
+#elif defined(EOS_TABLE)
+        printf("Using tabulated EOS\n");
+        if(not eos_table::load(EOS_TABLE_FILE)){exit(1);}
+#endif
+
+#ifdef COOLING
+        printf("Using radiative cooling\n");
+        if(not cooling_table::load(COOLING_TABLE_FILE)){exit(1);}
+#endif
+
         printf("Building vertices and mesh\n");
 
         std::ofstream LOGFILE;
         LOGFILE << std::setprecision(12);
+#ifdef MPI_RD
+        if(MY_RANK == 0){LOGFILE.open(LOG_DIR);}
+#else
         LOGFILE.open(LOG_DIR);
+#endif
 
 #ifdef READ_IC
 #ifdef QHULL_IC
+#ifdef PARALLEL_PARSE
+        int N_POINTS, N_TRIANG;
+
+        /****** Setup vertices and mesh ******/
+
+        printf("Reading QHULL triangulation across threads ...");
+
+        parallel_read_qhull("triangulation/points.txt", "triangulation/ordered_triangles.txt", RAND_POINTS, RAND_MESH);
+        N_POINTS = RAND_POINTS.size();
+        N_TRIANG = RAND_MESH.size();
+        for(j=0; j<N_TRIANG; ++j){RAND_MESH[j].set_tbin(1);}
+
+        printf("Number of vertices = %d\n", N_POINTS);
+        printf("Number of triangles = %d\n", N_TRIANG);
+#else
         int N_POINTS, N_TRIANG;
         std::string   POSITIONS_FILE_NAME, TRIANGLES_FILE_NAME;
         std::ifstream POSITIONS_FILE, TRIANGLES_FILE;
+        VERTEX        NEW_VERTEX;                                  // dummy variables for reading vertices and triangles
+        TRIANGLE      NEW_TRIANGLE;
 
         /****** Setup vertices ******/
 
@@ -113,14 +211,33 @@ int main(int ARGC, char *ARGV[]){
                 NEW_TRIANGLE.set_tbin(1);
                 RAND_MESH.push_back(NEW_TRIANGLE);
         }
+        setup_geometry(RAND_MESH);                                 // normals, areas and duals of all triangles
 
         POSITIONS_FILE.close();
         TRIANGLES_FILE.close();
 #endif
+#endif
 #ifdef CGAL_IC
+#ifdef PARALLEL_PARSE
+        int N_POINTS, N_TRIANG;
+
+        /****** Setup vertices and mesh ******/
+
+        printf("Reading CGAL triangulation across threads ...");
+
+        parallel_read_cgal("Delaunay2D.txt", RAND_POINTS, RAND_MESH);
+        N_POINTS = RAND_POINTS.size();
+        N_TRIANG = RAND_MESH.size();
+        for(j=0; j<N_TRIANG; ++j){RAND_MESH[j].set_tbin(1);}
+
+        printf("Number of vertices = %d\n", N_POINTS);
+        printf("Number of triangles = %d\n", N_TRIANG);
+#else
         int N_POINTS, N_TRIANG;
         std::string   CGAL_FILE_NAME;
         std::ifstream CGAL_FILE;
+        VERTEX        NEW_VERTEX;                                  // dummy variables for reading vertices and triangles
+        TRIANGLE      NEW_TRIANGLE;
 
         /****** Setup vertices ******/
 
@@ -152,18 +269,73 @@ int main(int ARGC, char *ARGV[]){
                 NEW_TRIANGLE.set_tbin(1);
                 RAND_MESH.push_back(NEW_TRIANGLE);
         }
+        setup_geometry(RAND_MESH);                                 // normals, areas and duals of all triangles
+
+#endif
+#endif
+#ifdef GENERATE_IC
+        int N_POINTS, N_TRIANG;
+
+        /****** Setup vertices and mesh ******/
+
+        printf("Generating and triangulating points ...");
+
+        generate_mesh(generate_points(GENERATOR, N_GENERATE), RAND_POINTS, RAND_MESH);
+        N_POINTS = RAND_POINTS.size();
+        N_TRIANG = RAND_MESH.size();
+        for(j=0; j<N_TRIANG; ++j){RAND_MESH[j].set_tbin(1);}
+
+        printf("Number of vertices = %d\n", N_POINTS);
+        printf("Number of triangles = %d\n", N_TRIANG);
+#endif
+#ifdef BINARY_IC
+        int N_POINTS, N_TRIANG;
 
+        /****** Setup vertices and mesh ******/
+
+        printf("Mapping binary mesh ...");
+
+        binary_read_mesh("Delaunay2D.bin", RAND_POINTS, RAND_MESH);
+        N_POINTS = RAND_POINTS.size();
+        N_TRIANG = RAND_MESH.size();
+        for(j=0; j<N_TRIANG; ++j){RAND_MESH[j].set_tbin(1);}
+
+#ifdef MPI_RD
+        printf("Number of vertices = %d\n", DOMAIN_DECOMP.N_GLOBAL_POINTS);        // this rank holds its part only
+        printf("Number of triangles = %d\n", DOMAIN_DECOMP.N_GLOBAL_TRIANG);
+#else
+        printf("Number of vertices = %d\n", N_POINTS);
+        printf("Number of triangles = %d\n", N_TRIANG);
+#endif
+#endif
+#endif
+
+#ifdef MPI_RD
+        /****** Keep this rank's part of the mesh ******/
+#ifndef BINARY_IC
+        domain_decompose(RAND_POINTS, RAND_MESH);                           // a binary mesh is read in parts (io2D.cpp)
 #endif
+        N_POINTS = RAND_POINTS.size();
+        N_TRIANG = RAND_MESH.size();
+        printf("Domain decomposition: %d ranks, rank 0 has %d triangles, %d owned and %d ghost vertices\n", N_RANKS, N_TRIANG, DOMAIN_DECOMP.N_OWNED, N_POINTS - DOMAIN_DECOMP.N_OWNED);
 #endif
 
 #ifdef SEDOV
         /****** Inject pressure for Sedov test  ******/
         double ETOT = 0.0,ETOT_AIM = 300000.0,PRESSURE_AIM;
-        for(i=0; i<N_POINTS; ++i){
+#ifdef MPI_RD
+        int N_AREA = DOMAIN_DECOMP.N_OWNED;                                 // each vertex once, then summed over the ranks
+#else
+        int N_AREA = N_POINTS;
+#endif
+        for(i=0; i<N_AREA; ++i){
                 if((RAND_POINTS[i].get_x()-5.0)*(RAND_POINTS[i].get_x()-5.0) + (RAND_POINTS[i].get_y()-5.0)*(RAND_POINTS[i].get_y()-5.0) < R_BLAST*R_BLAST){
                         AREA_CHECK = AREA_CHECK + RAND_POINTS[i].get_dual();
                 }
         }
+#ifdef MPI_RD
+        AREA_CHECK = domain_sum(AREA_CHECK);
+#endif
         for(i=0; i<N_POINTS; ++i){
                 if((RAND_POINTS[i].get_x()-5.0)*(RAND_POINTS[i].get_x()-5.0) + (RAND_POINTS[i].get_y()-5.0)*(RAND_POINTS[i].get_y()-5.0) < R_BLAST*R_BLAST){
                         PRESSURE_AIM = (ETOT_AIM * GAMMA_1 / RAND_POINTS[i].get_dual()) * (RAND_POINTS[i].get_dual() / (AREA_CHECK));
@@ -176,25 +348,57 @@ int main(int ARGC, char *ARGV[]){
         }
 #endif
 
+#ifdef MESH_REPORT
+        mesh_report(RAND_POINTS, RAND_MESH);
+#endif
+
         /****** Set initial timestep  ******/
 
         printf("Finding initial timestep ...");
 
+#ifdef MOVING_MESH
+        mesh_velocity(RAND_POINTS, RAND_MESH);                             // signal speeds relative to the moving vertices
+#endif
         for(j=0;j<N_TRIANG;++j){                                           // loop over all triangles in MESH
                 RAND_MESH[j].calculate_len_vel_contribution();             // calculate flux through TRIANGLE
         }
 
-        for(i=0; i<N_POINTS; ++i){
-                NEXT_DT = RAND_POINTS[i].calc_next_dt();      // check dt is min required by CFL
-                if(POSSIBLE_DT < NEXT_DT){NEXT_DT=POSSIBLE_DT;}
+#ifdef MPI_RD
+        halo_reverse(RAND_POINTS, HALO_LEN_VEL);                            // complete sums at the owned vertices (domain.cpp)
+        int N_DT = DOMAIN_DECOMP.N_OWNED;
+#else
+        int N_DT = N_POINTS;
+#endif
+        NEXT_DT = deterministic_min(N_DT, T_TOT, [&](int i){                // same order for any thread count (reduce.cpp)
+                double POSSIBLE_DT = RAND_POINTS[i].calc_next_dt();        // check dt is min required by CFL
                 RAND_POINTS[i].reset_len_vel_sum();
-        }
+                return POSSIBLE_DT;
+        });
+#ifdef MPI_RD
+        NEXT_DT = domain_min(NEXT_DT);
+        halo_forward(RAND_POINTS, HALO_DT_REQ);
+#endif
 
         printf("Checking mesh size ...");
         printf("Mesh Size = %d\n",int(RAND_MESH.size()));
+#ifdef BATCH_RESIDUAL
+        ACTIVE_MESH.resize(N_TRIANG);
+        printf("Batched residuals (%d lanes)\n", BATCH_LANES);
+#endif
+#ifdef DU_PRIVATE
+        du_private_setup(RAND_MESH, RAND_POINTS);
+        printf("Thread private DU buffers (%d)\n", DU_PRIVATE_BUF.N_CHUNKS);
+#endif
+#ifdef MOVING_MESH
+        mesh_neighbours(RAND_MESH);                                       // edge neighbours for the flips (moving_mesh.cpp)
+#endif
+#ifdef AMR
+        amr_setup(RAND_POINTS, RAND_MESH);
+#endif
         printf("Evolving fluid ...");
 
         int TBIN, TBIN_CURRENT = 0;
+        int SBIN_CURRENT = 0;                                                     // source bin counter (independent of TBIN_CURRENT)
         NEXT_DT = 0.0;                                                            // set first timestep to zero
 
         /****** Loop over time until total time T_TOT is reached *****************************************************************************************************/
@@ -212,8 +416,15 @@ int main(int ARGC, char *ARGV[]){
 
         /****** Write snapshot *****************************************************************************************************/
                 if(T >= NEXT_TIME){                                       // write out densities at given interval
+#ifdef MPI_RD
+                        if(gather_points(RAND_POINTS, GLOBAL_POINTS)){write_snap(GLOBAL_POINTS,T,DT,GLOBAL_POINTS.size(),SNAP_ID,LOGFILE);}
+#else
                         write_snap(RAND_POINTS,T,DT,N_POINTS,SNAP_ID,LOGFILE);
+#endif
                         write_active(RAND_MESH, N_TRIANG, SNAP_ID, TBIN_CURRENT);
+#ifdef MPI_RD
+                        domain_report_overlap();
+#endif
                         NEXT_TIME = NEXT_TIME + T_TOT/float(N_SNAP);
                         if(NEXT_TIME > T_TOT){NEXT_TIME = T_TOT;}
                         SNAP_ID ++;
@@ -221,6 +432,47 @@ int main(int ARGC, char *ARGV[]){
 
         /****** 1st order update ***************************************************************************************************/
 
+#ifdef SOURCE_KDK
+                /****** First half source kick applied to the state before the RD stages ******/
+                sources(RAND_POINTS, 0.5*DT, N_POINTS, SBIN_CURRENT);
+#ifdef PARA_UP
+                #pragma omp parallel for
+#endif
+                for(i=0;i<N_POINTS;++i){
+                        RAND_POINTS[i].kick_u_variables();
+                        RAND_POINTS[i].reset_du();
+                        RAND_POINTS[i].check_values();
+                }
+                con_to_prim_block<2>(RAND_POINTS, N_POINTS, false);            // convert these to their corresponding primitives
+#ifdef MPI_RD
+                GHOSTS_CURRENT = false;
+#endif
+#endif
+
+#ifdef MOVING_MESH
+                /****** Mesh velocity, vertices to the mid step positions and the geometry there ******/
+                mesh_drift_half(DT, RAND_POINTS, RAND_MESH);
+#endif
+
+#if defined(MPI_RD) && defined(HALO_OVERLAP)
+                /****** Update residual, ghost states received while the interior triangles are evaluated ******/
+                halo_overlap(RAND_POINTS, GHOSTS_CURRENT ? -1 : HALO_U, N_TRIANG, [&](int J_START, int J_END){
+#ifdef DRIFT
+                        drift_update_half(TBIN_CURRENT, J_END, T, DT, RAND_MESH, J_START);
+#else
+#ifdef PARA_RES
+                        #pragma omp parallel for
+#endif
+                        for(int j=J_START;j<J_END;++j){
+                                RAND_MESH[j].calculate_first_half(T,DT);
+                                RAND_MESH[j].pass_update_half();
+                        }
+#endif
+                });
+#else
+#ifdef MPI_RD
+                if(not GHOSTS_CURRENT){halo_forward(RAND_POINTS, HALO_U);}
+#endif
 #ifdef DRIFT
                 /****** Update residual for active bins (Drift method) ******/
                 drift_update_half(TBIN_CURRENT, N_TRIANG, T, DT, RAND_MESH);
@@ -232,6 +484,15 @@ int main(int ARGC, char *ARGV[]){
 
 
 #if !defined(DRIFT) && !defined(JUMP)
+#ifdef BATCH_RESIDUAL
+                /****** Update residual for all bins in batches (No adaptive method) ******/
+                for(j=0;j<N_TRIANG;++j){ACTIVE_MESH[j] = &RAND_MESH[j];}
+                calculate_first_half_list(ACTIVE_MESH, T, DT);
+                for(j=0;j<N_TRIANG;++j){RAND_MESH[j].pass_update_half();}
+#elif defined(DU_PRIVATE)
+                /****** Update residual for all bins, scatter through thread private buffers ******/
+                du_private_update(1, true, TBIN_CURRENT, T, DT, RAND_MESH);
+#else
 #ifdef PARA_RES
                 #pragma omp parallel for
 #endif
@@ -241,6 +502,12 @@ int main(int ARGC, char *ARGV[]){
                         RAND_MESH[j].pass_update_half();
                 }
 #endif
+#endif
+#endif
+
+#ifdef MPI_RD
+                halo_reverse(RAND_POINTS, HALO_DU_HALF);                       // add ghost residuals to the owners
+#endif
 
 #ifdef PARA_UP
                 #pragma omp parallel for
@@ -249,17 +516,38 @@ int main(int ARGC, char *ARGV[]){
                         RAND_POINTS[i].update_u_half();                        // update the half time state
                         RAND_POINTS[i].reset_du_half();                        // reset du value to zero for next timestep
                         RAND_POINTS[i].check_values_half();
-                        RAND_POINTS[i].con_to_prim_half();
                 }
+                con_to_prim_block<2>(RAND_POINTS, N_POINTS, true);             // convert these to their corresponding primitives
 
         /****** 2nd order update ***************************************************************************************************/
 
+#if defined(MPI_RD) && defined(HALO_OVERLAP)
+                halo_overlap(RAND_POINTS, HALO_U_HALF, N_TRIANG, [&](int J_START, int J_END){
+#ifdef DRIFT
+                        drift_update(TBIN_CURRENT, J_END, T, DT, RAND_MESH, J_START);
+#else
+#ifdef PARA_RES
+                        #pragma omp parallel for
+#endif
+                        for(int j=J_START;j<J_END;++j){
+                                RAND_MESH[j].calculate_second_half(T,DT);
+                                RAND_MESH[j].pass_update();
+                        }
+#endif
+                });
+#else
+#ifdef MPI_RD
+                halo_forward(RAND_POINTS, HALO_U_HALF);                        // owners' half time state to the ghosts
+#endif
 #ifdef DRIFT
                 /****** Update residual for active bins (Drift method) ******/
                 drift_update(TBIN_CURRENT, N_TRIANG, T, DT, RAND_MESH);
 #endif
 
 #if !defined(DRIFT) && !defined(JUMP)
+#ifdef DU_PRIVATE
+                du_private_update(2, true, TBIN_CURRENT, T, DT, RAND_MESH);
+#else
 #ifdef PARA_RES
                 #pragma omp parallel for
 #endif
@@ -269,8 +557,18 @@ int main(int ARGC, char *ARGV[]){
                         RAND_MESH[j].pass_update();
                 }
 #endif
+#endif
+#endif
+
+#ifdef MPI_RD
+                halo_reverse(RAND_POINTS, HALO_DU);
+#endif
 
-                sources(RAND_POINTS, DT, N_POINTS);
+#ifdef SOURCE_KDK
+                sources(RAND_POINTS, 0.5*DT, N_POINTS, SBIN_CURRENT);           // second half source kick
+#else
+                sources(RAND_POINTS, DT, N_POINTS, SBIN_CURRENT);
+#endif
 
 #ifdef PARA_UP
                 #pragma omp parallel for
@@ -279,24 +577,106 @@ int main(int ARGC, char *ARGV[]){
                         RAND_POINTS[i].update_u_variables();                   // update the fluid state at vertex
                         RAND_POINTS[i].reset_du();                             // reset du value to zero for next timestep
                         RAND_POINTS[i].check_values();
-                        RAND_POINTS[i].con_to_prim();                          // convert these to their corresponding conserved
                 }
+                con_to_prim_block<2>(RAND_POINTS, N_POINTS, false);            // convert these to their corresponding primitives
+#ifdef MPI_RD
+                GHOSTS_CURRENT = false;                                        // sent with the next first half residuals
+#endif
+
+#ifdef MOVING_MESH
+                /****** Vertices to the end of step positions, low quality triangles repaired by edge flips ******/
+                double Q_MIN;
+                int N_FLIP = mesh_drift_end(DT, Q_MIN, RAND_POINTS, RAND_MESH);
+                if(MESH_STATE.N_CAVITY > 0){
+                        printf("CAVITY =\t%d\tinverted triangles repaired locally at step %d, %ld local and %ld global repairs so far\n", MESH_STATE.N_CAVITY, l, MESH_STATE.N_CAVITY_TOTAL, MESH_STATE.N_REMESH_TOTAL);
+                }
+                if(N_FLIP > 0){
+                        printf("FLIPS =\t%d\tedges flipped at step %d, minimum quality %f\n", N_FLIP, l, Q_MIN);
+                }
+                if(N_FLIP == -2){                                              // checkpoint the end of step state and stop
+                        printf("REMESH =\t%f\tminimum quality, retriangulation failed at step %d\n", Q_MIN, l);
+                        write_snap(RAND_POINTS,T+DT,DT,N_POINTS,SNAP_ID,LOGFILE);
+                        exit(1);
+                }
+                if(N_FLIP == -1){
+                        printf("REMESH =\t%f\tminimum quality, retriangulated at step %d, %ld local and %ld global repairs so far\n", Q_MIN, l, MESH_STATE.N_CAVITY_TOTAL, MESH_STATE.N_REMESH_TOTAL);
+                        N_TRIANG = RAND_MESH.size();
+#ifdef DU_PRIVATE
+                        du_private_setup(RAND_MESH, RAND_POINTS);
+#endif
+                }
+#endif
 
                 if(TBIN_CURRENT == 0){
+#ifdef MPI_RD
+                        halo_forward(RAND_POINTS, HALO_U);                     // timestep contributions need the ghosts now
+                        GHOSTS_CURRENT = true;
+#endif
+#ifdef AMR
+                        if(amr_update(RAND_POINTS, RAND_MESH)){                // vertices inserted and removed, binned below
+                                printf("AMR =\t%d\t%d\tvertices inserted, removed at step %d\n", AMR_STATE.N_REFINED, AMR_STATE.N_DEREFINED, l);
+                                N_POINTS = RAND_POINTS.size();
+                                N_TRIANG = RAND_MESH.size();
+#ifdef DU_PRIVATE
+                                du_private_setup(RAND_MESH, RAND_POINTS);
+#endif
+                        }
+#endif
+#ifdef MOVING_MESH
+                        mesh_velocity(RAND_POINTS, RAND_MESH);                 // of the mesh the next steps start from
+#endif
+                        reset_tbins(T, DT, N_TRIANG, N_POINTS, NEXT_DT, RAND_MESH, RAND_POINTS);
+#ifdef MPI_RD
+                        if(domain_rebalance(RAND_POINTS, RAND_MESH)){          // new time bins: even out the element evaluations
+                                printf("BALANCE =\t%f\timbalance, repartitioned at step %d\n", DOMAIN_DECOMP.IMBALANCE, l);
+                                N_POINTS = RAND_POINTS.size();
+                                N_TRIANG = RAND_MESH.size();
+#ifdef BATCH_RESIDUAL
+                                ACTIVE_MESH.resize(N_TRIANG);
+#endif
+#ifdef DU_PRIVATE
+                                du_private_setup(RAND_MESH, RAND_POINTS);
+#endif
+                        }
+#endif
+                }
+
+#ifdef MOVING_MESH
+                if(TBIN_CURRENT != 0){                                           // the geometry changes every step, so does the timestep
+                        mesh_velocity(RAND_POINTS, RAND_MESH);
                         reset_tbins(T, DT, N_TRIANG, N_POINTS, NEXT_DT, RAND_MESH, RAND_POINTS);
                 }
+#endif
+
+                if(SBIN_CURRENT == 0){
+                        reset_sbins(NEXT_DT, N_POINTS, RAND_POINTS);
+                }
 
 // #if defined(FIXED_BOUNDARY) && (defined(NOH) || defined(DF))
 //                 for(j=0;j<N_TRIANG;++j){                                         // loop over all triangles in MESH
 //                         RAND_MESH[j].check_boundary();                           // calculate flux through TRIANGLE
 //                 }
 // #endif
+#ifdef MPI_RD
+                N_SINGULAR = domain_sum(N_SINGULAR);
+#endif
+                if(N_SINGULAR > 0){                                              // elements whose inflow matrix was regularised
+                        printf("SINGULAR =\t%d\tinflow matrices regularised at step %d\n", N_SINGULAR, l);
+                        N_SINGULAR = 0;
+                }
+
                 TBIN_CURRENT = (TBIN_CURRENT + 1) % MAX_TBIN;                     // increment time step bin
+                SBIN_CURRENT = (SBIN_CURRENT + 1) % MAX_SBIN;                     // increment source bin
                 T += DT;                                                         // increment time
                 l += 1;                                                          // increment step number
         }
 
+#ifdef MPI_RD
+        if(gather_points(RAND_POINTS, GLOBAL_POINTS)){write_snap(GLOBAL_POINTS,T,DT,GLOBAL_POINTS.size(),SNAP_ID,LOGFILE);}
+        MPI_Finalize();
+#else
         write_snap(RAND_POINTS,T,DT,N_POINTS,SNAP_ID,LOGFILE);
+#endif
 
         return 0;
 }
@@ -4,23 +4,56 @@
 #include <string>
 #include <cmath>
 #include <vector>
+#include <algorithm>
 #include <cstdlib>
 #include <stdio.h>
 #include <omp.h> 
 
 
 #include "constants3D.h"
+#ifdef MPI_RD
+#include <mpi.h>
+#endif
+#include "../common/physics.h"
+#ifdef COOLING
+#include "../common/cooling.h"
+#endif
 
 #include "cblas.h"
 #include "lapacke.h"
 #include "inverse.cpp"
 #include "base.cpp"
+#include "reduce.cpp"
+#include "geometry.h"
+#if defined(CHARACTERISTIC) or defined(EOS_NON_IDEAL)
+#include "characteristic.cpp"                           // bilinear_flux_residual for a non-ideal EOS
+#endif
 
 #ifdef THREE_D
 #include "vertex3D.h"
+#include "convert.cpp"
 #include "triangle3D.h"
+#ifdef MPI_RD
+#include "domain.cpp"
+#endif
 #include "setup3D.cpp"
+#ifdef BINARY_IC
+#include "mesh_binary.h"
+#endif
+#ifdef MESH_REPORT
+#include "mesh_quality.h"
+#endif
+#ifdef PARALLEL_PARSE
+#include "parse_text.cpp"
+#endif
 #include "io3D.cpp"
+#ifdef GENERATE_IC
+#include "generate.cpp"
+#endif
+#ifdef DU_PRIVATE
+#include "scatter.cpp"
+#endif
+#include "source_bins.cpp"
 #include "source3D.cpp"
 #include "timestep.cpp"
 #endif
@@ -31,17 +64,20 @@ int main(){
         */
 
         int i, j, k, l = 0, m;                                     // ******* decalare varaibles and vectors ******
-        double DT, T = 0.0;                                        // DT = timestep,t = time
+        double DT = 0.0, T = 0.0;                                  // DT = timestep,t = time
         double NEXT_TIME = 0.0;                                    // NEXT_TIME    = time of next snapshot
-        double NEXT_DT = T_TOT, POSSIBLE_DT = T_TOT;               // NEXT_DT.     = timestep for upcoming time iteration
+        double NEXT_DT = T_TOT;                                    // NEXT_DT.     = timestep for upcoming time iteration
         double MIN_DT;
-        VERTEX                               NEW_VERTEX;           // NEW_VERTEX   = dummy variable for setting up vertices
-        TRIANGLE                             NEW_TRIANGLE;         // NEW_TRIABLE  = dummy variable for setting up triangles
         std::vector<VERTEX>                  RAND_POINTS;          // X_POINTS     = vector of x vertices
         std::vector<TRIANGLE>                RAND_MESH;            // X_MESH       = vector of x triangles
         double SNAP_ID = 0;
 
 
+#ifdef MPI_RD
+        std::vector<VERTEX>                  GLOBAL_POINTS;        // GLOBAL_POINTS = all owned vertices, gathered on rank 0 for snapshots
+        domain_init(NULL, NULL);
+#endif
+
         // Initialise seed for random number generator (rand)
         std::srand(68315);
 
@@ -66,24 +102,63 @@ int main(){
         printf("Using B Scheme\n");
 #endif
 
+#ifdef CHARACTERISTIC
+        printf("Using characteristic distribution\n");
+#endif
+
 #ifdef FIRST_ORDER
         printf("Using 1st order\n");
 #else
         printf("Using 2nd order\n");
 #endif
 
+#if defined(EOS_ISOTHERMAL)
+        printf("Using isothermal EOS\n");
+#elif defined(EOS_POLYTROPIC)
+        printf("Using polytropic EOS\n");
+#elif defined(EOS_TABLE)
+        printf("Using tabulated EOS\n");
+        if(not eos_table::load(EOS_TABLE_FILE)){exit(1);}
+#endif
+
+#ifdef COOLING
+        printf("Using radiative cooling\n");
+        if(not cooling_table::load(COOLING_TABLE_FILE)){exit(1);}
+#endif
+
         printf("Building vertices and mesh\n");
         std::ofstream LOGFILE;
         LOGFILE << std::setprecision(12);
+#ifdef MPI_RD
+        if(MY_RANK == 0){LOGFILE.open(LOG_DIR);}
+#else
         LOGFILE.open(LOG_DIR);
+#endif
 
         /****** Setup Vertices ******/
 
 #ifdef READ_IC
 #ifdef CGAL_IC
+#ifdef PARALLEL_PARSE
+        int N_POINTS, N_TRIANG;
+
+        /****** Setup vertices and mesh ******/
+
+        printf("Reading CGAL triangulation across threads ...");
+
+        parallel_read_cgal("Delaunay3D.txt", RAND_POINTS, RAND_MESH);
+        N_POINTS = RAND_POINTS.size();
+        N_TRIANG = RAND_MESH.size();
+        for(j=0; j<N_TRIANG; ++j){RAND_MESH[j].set_tbin(1);}
+
+        printf("Number of vertices = %d\n", N_POINTS);
+        printf("Number of triangles = %d\n", N_TRIANG);
+#else
         int N_POINTS, N_TRIANG;
         std::string   CGAL_FILE_NAME;
         std::ifstream CGAL_FILE;
+        VERTEX        NEW_VERTEX;                                  // dummy variables for reading vertices and triangles
+        TRIANGLE      NEW_TRIANGLE;
 
         /****** Setup vertices ******/
 
@@ -116,17 +191,72 @@ int main(){
                 NEW_TRIANGLE = cgal_read_triangles_line(CGAL_FILE,RAND_POINTS,j);
                 RAND_MESH.push_back(NEW_TRIANGLE);
         }
+        setup_geometry(RAND_MESH);                                 // normals, areas and duals of all triangles
+
+#endif
+#endif
+#ifdef GENERATE_IC
+        int N_POINTS, N_TRIANG;
+
+        /****** Setup vertices and mesh ******/
+
+        printf("Generating and triangulating points ...");
+
+        generate_mesh(generate_points(GENERATOR, N_GENERATE), RAND_POINTS, RAND_MESH);
+        N_POINTS = RAND_POINTS.size();
+        N_TRIANG = RAND_MESH.size();
+        for(j=0; j<N_TRIANG; ++j){RAND_MESH[j].set_tbin(1);}
+
+        printf("Number of vertices = %d\n", N_POINTS);
+        printf("Number of triangles = %d\n", N_TRIANG);
+#endif
+#ifdef BINARY_IC
+        int N_POINTS, N_TRIANG;
 
+        /****** Setup vertices and mesh ******/
+
+        printf("Mapping binary mesh ...");
+
+        binary_read_mesh("Delaunay3D.bin", RAND_POINTS, RAND_MESH);
+        N_POINTS = RAND_POINTS.size();
+        N_TRIANG = RAND_MESH.size();
+        for(j=0; j<N_TRIANG; ++j){RAND_MESH[j].set_tbin(1);}
+
+#ifdef MPI_RD
+        printf("Number of vertices = %d\n", DOMAIN_DECOMP.N_GLOBAL_POINTS);        // this rank holds its part only
+        printf("Number of triangles = %d\n", DOMAIN_DECOMP.N_GLOBAL_TRIANG);
+#else
+        printf("Number of vertices = %d\n", N_POINTS);
+        printf("Number of triangles = %d\n", N_TRIANG);
+#endif
 #endif
 #endif
 
+#ifdef MPI_RD
+        /****** Keep this rank's part of the mesh ******/
+#ifndef BINARY_IC
+        domain_decompose(RAND_POINTS, RAND_MESH);                           // a binary mesh is read in parts (io3D.cpp)
+#endif
+        N_POINTS = RAND_POINTS.size();
+        N_TRIANG = RAND_MESH.size();
+        printf("Domain decomposition: %d ranks, rank 0 has %d triangles, %d owned and %d ghost vertices\n", N_RANKS, N_TRIANG, DOMAIN_DECOMP.N_OWNED, N_POINTS - DOMAIN_DECOMP.N_OWNED);
+#endif
+
 #ifdef SEDOV2D
         double ETOT = 0.0,ETOT_AIM = 300000.0,PRESSURE_AIM;
-        for(i=0; i<N_POINTS; ++i){
+#ifdef MPI_RD
+        int N_AREA = DOMAIN_DECOMP.N_OWNED;                                 // each vertex once, then summed over the ranks
+#else
+        int N_AREA = N_POINTS;
+#endif
+        for(i=0; i<N_AREA; ++i){
                 if((RAND_POINTS[i].get_x()-5.0)*(RAND_POINTS[i].get_x()-5.0) + (RAND_POINTS[i].get_y()-5.0)*(RAND_POINTS[i].get_y()-5.0) < R_BLAST*R_BLAST){
                         AREA_CHECK = AREA_CHECK + RAND_POINTS[i].get_dual();
                 }
         }
+#ifdef MPI_RD
+        AREA_CHECK = domain_sum(AREA_CHECK);
+#endif
         for(i=0; i<N_POINTS; ++i){
                 if((RAND_POINTS[i].get_x()-5.0)*(RAND_POINTS[i].get_x()-5.0) + (RAND_POINTS[i].get_y()-5.0)*(RAND_POINTS[i].get_y()-5.0) < R_BLAST*R_BLAST){
                         PRESSURE_AIM = (ETOT_AIM * GAMMA_1 / RAND_POINTS[i].get_dual()) * (RAND_POINTS[i].get_dual() / (AREA_CHECK));
@@ -140,11 +270,19 @@ int main(){
 #endif
 #ifdef SEDOV3D
         double ETOT = 0.0,ETOT_AIM = 300000.0,PRESSURE_AIM;
-        for(i=0; i<N_POINTS; ++i){
+#ifdef MPI_RD
+        int N_AREA = DOMAIN_DECOMP.N_OWNED;                                 // each vertex once, then summed over the ranks
+#else
+        int N_AREA = N_POINTS;
+#endif
+        for(i=0; i<N_AREA; ++i){
                 if((RAND_POINTS[i].get_x()-5.0)*(RAND_POINTS[i].get_x()-5.0) + (RAND_POINTS[i].get_y()-5.0)*(RAND_POINTS[i].get_y()-5.0) + (RAND_POINTS[i].get_z()-5.0)*(RAND_POINTS[i].get_z()-5.0) < R_BLAST*R_BLAST){
                         AREA_CHECK = AREA_CHECK + RAND_POINTS[i].get_dual();
                 }
         }
+#ifdef MPI_RD
+        AREA_CHECK = domain_sum(AREA_CHECK);
+#endif
         for(i=0; i<N_POINTS; ++i){
                 if((RAND_POINTS[i].get_x()-5.0)*(RAND_POINTS[i].get_x()-5.0) + (RAND_POINTS[i].get_y()-5.0)*(RAND_POINTS[i].get_y()-5.0) + (RAND_POINTS[i].get_z()-5.0)*(RAND_POINTS[i].get_z()-5.0) < R_BLAST*R_BLAST){
                         PRESSURE_AIM = (ETOT_AIM * GAMMA_1 / RAND_POINTS[i].get_dual()) * (RAND_POINTS[i].get_dual() / (AREA_CHECK));
@@ -157,6 +295,10 @@ int main(){
         }
 #endif
 
+#ifdef MESH_REPORT
+        mesh_report(RAND_POINTS, RAND_MESH);
+#endif
+
         /****** Set initial timestep  ********************************************************************************************************************************/
 
         printf("Finding initial timestep ...");
@@ -165,19 +307,34 @@ int main(){
                 RAND_MESH[j].calculate_len_vel_contribution();             // calculate flux through TRIANGLE
         }
 
-        for(i=0; i<N_POINTS; ++i){
-                NEXT_DT = RAND_POINTS[i].calc_next_dt();      // check dt is min required by CFL
-                if(POSSIBLE_DT < NEXT_DT){NEXT_DT=POSSIBLE_DT;}
+#ifdef MPI_RD
+        halo_reverse(RAND_POINTS, HALO_LEN_VEL);                            // complete sums at the owned vertices (domain.cpp)
+        int N_DT = DOMAIN_DECOMP.N_OWNED;
+#else
+        int N_DT = N_POINTS;
+#endif
+        NEXT_DT = deterministic_min(N_DT, T_TOT, [&](int i){                // same order for any thread count (reduce.cpp)
+                double POSSIBLE_DT = RAND_POINTS[i].calc_next_dt();        // check dt is min required by CFL
                 RAND_POINTS[i].reset_len_vel_sum();
-        }
+                return POSSIBLE_DT;
+        });
+#ifdef MPI_RD
+        NEXT_DT = domain_min(NEXT_DT);
+        halo_forward(RAND_POINTS, HALO_DT_REQ);
+#endif
 
         printf("Checking mesh size ...");
         printf("Mesh Size = %d\n",int(RAND_MESH.size()));
+#ifdef DU_PRIVATE
+        du_private_setup(RAND_MESH, RAND_POINTS);
+        printf("Thread private DU buffers (%d)\n", DU_PRIVATE_BUF.N_CHUNKS);
+#endif
         printf("Evolving fluid ...");
 
         /****** Loop over time until total time T_TOT is reached *****************************************************************************************************/
 
         int TBIN, TBIN_CURRENT = 0;
+        int SBIN_CURRENT = 0;                                                     // source bin counter (independent of TBIN_CURRENT)
         NEXT_DT = 0.0;
 
         while(T<T_TOT){
@@ -191,14 +348,38 @@ int main(){
                 printf("STEP =\t%d\tTIME =\t%f\tTIMESTEP =\t%f\t%f/100\r", l, T, DT, 100.0*T/T_TOT);
 
                 if(T >= NEXT_TIME){                                       // write out densities at given interval
+#ifdef MPI_RD
+                        if(gather_points(RAND_POINTS, GLOBAL_POINTS)){write_snap(GLOBAL_POINTS,T,DT,GLOBAL_POINTS.size(),SNAP_ID,LOGFILE);}
+#else
                         write_snap(RAND_POINTS,T,DT,N_POINTS,SNAP_ID,LOGFILE);
+#endif
                         NEXT_TIME = NEXT_TIME + T_TOT/float(N_SNAP);
                         if(NEXT_TIME > T_TOT){NEXT_TIME = T_TOT;}
+#ifdef MPI_RD
+                        domain_report_overlap();
+#endif
                         SNAP_ID ++;
                 }
 
         /****** 1st order update ***************************************************************************************************/
 
+#ifdef SOURCE_KDK
+                /****** First half source kick applied to the state before the RD stages ******/
+                sources(RAND_POINTS, 0.5*DT, N_POINTS, SBIN_CURRENT);
+#ifdef PARA_UP
+                #pragma omp parallel for
+#endif
+                for(i=0;i<N_POINTS;++i){
+                        RAND_POINTS[i].kick_u_variables();
+                        RAND_POINTS[i].reset_du();
+                        RAND_POINTS[i].check_values();
+                }
+                con_to_prim_block<3>(RAND_POINTS, N_POINTS, false);            // convert these to their corresponding primitives
+#ifdef MPI_RD
+                halo_forward(RAND_POINTS, HALO_U);
+#endif
+#endif
+
 #ifdef DRIFT
                 /****** Update residual for active bins (Drift method) ******/
                 drift_update_half(TBIN_CURRENT, N_TRIANG, T, DT, RAND_MESH);
@@ -206,6 +387,9 @@ int main(){
 
 
 #if !defined(DRIFT) && !defined(JUMP)
+#ifdef DU_PRIVATE
+                du_private_update(1, true, TBIN_CURRENT, T, DT, RAND_MESH);
+#else
 #ifdef PARA_RES
                 #pragma omp parallel for
 #endif
@@ -215,6 +399,11 @@ int main(){
                         RAND_MESH[j].pass_update_half();
                 }
 #endif
+#endif
+
+#ifdef MPI_RD
+                halo_reverse(RAND_POINTS, HALO_DU_HALF);                       // add ghost residuals to the owners
+#endif
 
 #ifdef PARA_UP
                 #pragma omp parallel for
@@ -223,17 +412,39 @@ int main(){
                         RAND_POINTS[i].update_u_half();                        // update the half time state
                         RAND_POINTS[i].reset_du_half();                        // reset du value to zero for next timestep
                         RAND_POINTS[i].check_values_half();
-                        RAND_POINTS[i].con_to_prim_half();
                 }
+                con_to_prim_block<3>(RAND_POINTS, N_POINTS, true);             // convert these to their corresponding primitives
 
         /****** 2nd order update ***************************************************************************************************/
 
+#if defined(MPI_RD) && defined(HALO_OVERLAP)
+                /****** Update residual, ghost states received while the interior triangles are evaluated ******/
+                halo_overlap(RAND_POINTS, HALO_U_HALF, N_TRIANG, [&](int J_START, int J_END){
+#ifdef DRIFT
+                        drift_update(TBIN_CURRENT, J_END, T, DT, RAND_MESH, J_START);
+#else
+#ifdef PARA_RES
+                        #pragma omp parallel for
+#endif
+                        for(int j=J_START;j<J_END;++j){
+                                RAND_MESH[j].calculate_second_half(T,DT);
+                                RAND_MESH[j].pass_update();
+                        }
+#endif
+                });
+#else
+#ifdef MPI_RD
+                halo_forward(RAND_POINTS, HALO_U_HALF);                        // owners' half time state to the ghosts
+#endif
 #ifdef DRIFT
                 /****** Update residual for active bins (Drift method) ******/
                 drift_update(TBIN_CURRENT, N_TRIANG, T, DT, RAND_MESH);
 #endif
 
 #if !defined(DRIFT) && !defined(JUMP)
+#ifdef DU_PRIVATE
+                du_private_update(2, true, TBIN_CURRENT, T, DT, RAND_MESH);
+#else
 #ifdef PARA_RES
                 #pragma omp parallel for
 #endif
@@ -243,8 +454,18 @@ int main(){
                         RAND_MESH[j].pass_update();
                 }
 #endif
+#endif
+#endif
+
+#ifdef MPI_RD
+                halo_reverse(RAND_POINTS, HALO_DU);
+#endif
 
-                sources(RAND_POINTS, DT, N_POINTS);
+#ifdef SOURCE_KDK
+                sources(RAND_POINTS, 0.5*DT, N_POINTS, SBIN_CURRENT);           // second half source kick
+#else
+                sources(RAND_POINTS, DT, N_POINTS, SBIN_CURRENT);
+#endif
 
 #ifdef PARA_UP
                 #pragma omp parallel for
@@ -253,28 +474,58 @@ int main(){
                         RAND_POINTS[i].update_u_variables();                   // update the fluid state at vertex
                         RAND_POINTS[i].reset_du();                             // reset du value to zero for next timestep
                         RAND_POINTS[i].check_values();
-                        RAND_POINTS[i].con_to_prim();                          // convert these to their corresponding conserved
                 }
+                con_to_prim_block<3>(RAND_POINTS, N_POINTS, false);            // convert these to their corresponding primitives
+#ifdef MPI_RD
+                halo_forward(RAND_POINTS, HALO_U);
+#endif
 
                 for(j=0;j<N_TRIANG;++j){                                       // loop over all triangles in MESH
                         RAND_MESH[j].calculate_len_vel_contribution();         // calculate flux through TRIANGLE
                 }
 
-                for(i=0; i<N_POINTS; ++i){
-                        NEXT_DT = T_TOT - (T + DT);
-                        POSSIBLE_DT = RAND_POINTS[i].calc_next_dt();      // check dt is min required by CFL
-                        if(POSSIBLE_DT < NEXT_DT){NEXT_DT=POSSIBLE_DT;}
+#ifdef MPI_RD
+                halo_reverse(RAND_POINTS, HALO_LEN_VEL);
+                NEXT_DT = deterministic_min(DOMAIN_DECOMP.N_OWNED, T_TOT - (T + DT), [&](int i){
+                        double POSSIBLE_DT = RAND_POINTS[i].calc_next_dt();    // check dt is min required by CFL
                         RAND_POINTS[i].reset_len_vel_sum();
+                        return POSSIBLE_DT;
+                });
+                NEXT_DT = domain_min(NEXT_DT);
+#else
+                NEXT_DT = deterministic_min(N_POINTS, T_TOT - (T + DT), [&](int i){
+                        double POSSIBLE_DT = RAND_POINTS[i].calc_next_dt();    // check dt is min required by CFL
+                        RAND_POINTS[i].reset_len_vel_sum();
+                        return POSSIBLE_DT;
+                });
+#endif
+
+                if(SBIN_CURRENT == 0){
+                        reset_sbins(NEXT_DT, N_POINTS, RAND_POINTS);
+                }
+
+#ifdef MPI_RD
+                N_SINGULAR = domain_sum(N_SINGULAR);
+#endif
+                if(N_SINGULAR > 0){                                              // elements whose inflow matrix was regularised
+                        printf("SINGULAR =\t%d\tinflow matrices regularised at step %d\n", N_SINGULAR, l);
+                        N_SINGULAR = 0;
                 }
 
                 TBIN_CURRENT = (TBIN_CURRENT + 1) % MAX_TBIN;                    // increment time step bin
+                SBIN_CURRENT = (SBIN_CURRENT + 1) % MAX_SBIN;                    // increment source bin
                 T += DT;                                                         // increment time
                 l += 1;                                                          // increment step number
         }
 
         /*************************************************************************************************************************************************************/
 
+#ifdef MPI_RD
+        if(gather_points(RAND_POINTS, GLOBAL_POINTS)){write_snap(GLOBAL_POINTS,T,DT,GLOBAL_POINTS.size(),SNAP_ID,LOGFILE);}
+        MPI_Finalize();
+#else
         write_snap(RAND_POINTS,T,DT,N_POINTS,SNAP_ID,LOGFILE);
+#endif
 
         return 0;
 }
@@ -0,0 +1,152 @@
+/*
+Binary mesh format (BINARY_IC)
+        Written once from a CGAL text triangulation by triangulation/binary/convert_mesh and mapped straight into memory
+        at startup, so loading needs no per-token parsing. Native byte order, sections aligned to 8 bytes:
+                MESH_HEADER     magic, version, dimension D, N_POINTS, N_TRIANG, periodic box LOW/HIGH
+                double          D coordinates per vertex
+                uint32_t        D+1 vertex indices per triangle, padded to 8 bytes
+                uint8_t         D+1 periodic shift codes per triangle (bit k: the vertex image lies one box side up along
+                                axis k, nonzero for triangles wrapping the box), padded to 8 bytes
+
+        Under MPI_RD each rank maps only its share of the vertex and triangle sections by byte range (mesh_map_part).
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MESH_MAGIC   0x4d44524cu                        // "LRDM"
+#define MESH_VERSION 2u                                 // 2: per corner shift codes instead of a boundary flag
+
+struct MESH_HEADER{
+        uint32_t MAGIC, VERSION, DIM, PAD;
+        uint64_t N_POINTS, N_TRIANG;
+        double LOW[3], HIGH[3];
+};
+
+inline size_t mesh_verts_offset(const MESH_HEADER &H){return sizeof(MESH_HEADER) + sizeof(double)*H.DIM*H.N_POINTS;}
+inline size_t mesh_shift_offset(const MESH_HEADER &H){return mesh_verts_offset(H) + 8*((sizeof(uint32_t)*(H.DIM + 1)*H.N_TRIANG + 7)/8);}
+inline size_t mesh_file_size(const MESH_HEADER &H){return mesh_shift_offset(H) + 8*(((H.DIM + 1)*H.N_TRIANG + 7)/8);}
+
+// read only view of a mapped mesh file
+struct MESH_MAP{
+        size_t SIZE;
+        void *DATA;
+        const MESH_HEADER *HEADER;
+        const double *X;                                // X[D*i + k]
+        const uint32_t *VERTS;                          // VERTS[(D+1)*j + m]
+        const uint8_t *SHIFT;                           // SHIFT[(D+1)*j + m]
+};
+
+// map NAME and check it holds a DIM dimensional mesh, prints the reason and returns false otherwise
+inline bool mesh_map(const char *NAME, uint32_t DIM, MESH_MAP &MAP){
+        struct stat INFO;
+        int FD = open(NAME, O_RDONLY);
+        MAP.DATA = MAP_FAILED;
+        if(FD < 0 or fstat(FD, &INFO) != 0 or size_t(INFO.st_size) < sizeof(MESH_HEADER)){
+                printf("BWARNING: cannot read binary mesh %s\n", NAME);
+                if(FD >= 0){close(FD);}
+                return false;
+        }
+        MAP.SIZE = INFO.st_size;
+        MAP.DATA = mmap(NULL, MAP.SIZE, PROT_READ, MAP_PRIVATE, FD, 0);
+        close(FD);                                                      // the mapping stays valid
+        if(MAP.DATA == MAP_FAILED){
+                printf("BWARNING: cannot map binary mesh %s\n", NAME);
+                return false;
+        }
+        MAP.HEADER = (const MESH_HEADER*)MAP.DATA;
+        if(MAP.HEADER->MAGIC != MESH_MAGIC or MAP.HEADER->VERSION != MESH_VERSION or MAP.HEADER->DIM != DIM or mesh_file_size(*MAP.HEADER) != MAP.SIZE){
+                printf("BWARNING: %s is not a version %u binary mesh in %u dimensions (or is truncated)\n", NAME, MESH_VERSION, DIM);
+                munmap(MAP.DATA, MAP.SIZE);
+                MAP.DATA = MAP_FAILED;
+                return false;
+        }
+        madvise(MAP.DATA, MAP.SIZE, MADV_SEQUENTIAL);
+        MAP.X        = (const double*)((const char*)MAP.DATA + sizeof(MESH_HEADER));
+        MAP.VERTS    = (const uint32_t*)((const char*)MAP.DATA + mesh_verts_offset(*MAP.HEADER));
+        MAP.SHIFT    = (const uint8_t*)((const char*)MAP.DATA + mesh_shift_offset(*MAP.HEADER));
+        return true;
+}
+
+inline void mesh_unmap(MESH_MAP &MAP){
+        if(MAP.DATA != MAP_FAILED){munmap(MAP.DATA, MAP.SIZE);}
+        MAP.DATA = MAP_FAILED;
+}
+
+// read only view of one rank's part of a mesh file (MPI_RD): vertices I0 <= i < I1 and triangles J0 <= j < J1, an
+// equal share of each section, mapped by byte range
+struct MESH_PART{
+        MESH_HEADER HEADER;
+        size_t I0, I1, J0, J1;
+        void *DATA[3];                                  // mappings of the three ranges, MAP_FAILED if empty
+        size_t SIZE[3];
+        const double *X;                                // X[D*(i - I0) + k]
+        const uint32_t *VERTS;                          // VERTS[(D+1)*(j - J0) + m]
+        const uint8_t *SHIFT;                           // SHIFT[(D+1)*(j - J0) + m]
+};
+
+// map LENGTH bytes of FD from OFFSET (from the page boundary below it), AT is the first byte and NULL if LENGTH is 0
+inline bool mesh_map_range(int FD, size_t OFFSET, size_t LENGTH, void *&DATA, size_t &SIZE, const char *&AT){
+        size_t START = OFFSET - OFFSET % size_t(sysconf(_SC_PAGESIZE));
+        DATA = MAP_FAILED;
+        SIZE = 0;
+        AT   = NULL;
+        if(LENGTH == 0){return true;}
+        SIZE = OFFSET + LENGTH - START;
+        DATA = mmap(NULL, SIZE, PROT_READ, MAP_PRIVATE, FD, START);
+        if(DATA == MAP_FAILED){return false;}
+        madvise(DATA, SIZE, MADV_SEQUENTIAL);
+        AT = (const char*)DATA + (OFFSET - START);
+        return true;
+}
+
+inline void mesh_unmap_part(MESH_PART &PART){
+        for(int S=0;S<3;++S){
+                if(PART.DATA[S] != MAP_FAILED){munmap(PART.DATA[S], PART.SIZE[S]);}
+                PART.DATA[S] = MAP_FAILED;
+        }
+}
+
+// map part PART of N_PARTS of NAME and check it holds a DIM dimensional mesh, prints the reason and returns false
+// otherwise. Only the header is read in full.
+inline bool mesh_map_part(const char *NAME, uint32_t DIM, int PART, int N_PARTS, MESH_PART &P){
+        struct stat INFO;
+        const char *AT[3];
+        int FD = open(NAME, O_RDONLY);
+        for(int S=0;S<3;++S){P.DATA[S] = MAP_FAILED;}
+        if(FD < 0 or fstat(FD, &INFO) != 0 or pread(FD, &P.HEADER, sizeof(MESH_HEADER), 0) != ssize_t(sizeof(MESH_HEADER))){
+                printf("BWARNING: cannot read binary mesh %s\n", NAME);
+                if(FD >= 0){close(FD);}
+                return false;
+        }
+        const MESH_HEADER &H = P.HEADER;
+        if(H.MAGIC != MESH_MAGIC or H.VERSION != MESH_VERSION or H.DIM != DIM or mesh_file_size(H) != size_t(INFO.st_size)){
+                printf("BWARNING: %s is not a version %u binary mesh in %u dimensions (or is truncated)\n", NAME, MESH_VERSION, DIM);
+                close(FD);
+                return false;
+        }
+
+        size_t D = DIM;
+        P.I0 = (H.N_POINTS*PART)/N_PARTS;
+        P.I1 = (H.N_POINTS*(PART + 1))/N_PARTS;
+        P.J0 = (H.N_TRIANG*PART)/N_PARTS;
+        P.J1 = (H.N_TRIANG*(PART + 1))/N_PARTS;
+        size_t OFFSET[3] = {sizeof(MESH_HEADER) + sizeof(double)*D*P.I0, mesh_verts_offset(H) + sizeof(uint32_t)*(D + 1)*P.J0, mesh_shift_offset(H) + (D + 1)*P.J0};
+        size_t LENGTH[3] = {sizeof(double)*D*(P.I1 - P.I0), sizeof(uint32_t)*(D + 1)*(P.J1 - P.J0), (D + 1)*(P.J1 - P.J0)};
+        bool OK = true;
+        for(int S=0;S<3;++S){OK = mesh_map_range(FD, OFFSET[S], LENGTH[S], P.DATA[S], P.SIZE[S], AT[S]) and OK;}
+        close(FD);                                                      // the mappings stay valid
+        if(not OK){
+                printf("BWARNING: cannot map binary mesh %s\n", NAME);
+                mesh_unmap_part(P);
+                return false;
+        }
+        P.X     = (const double*)AT[0];
+        P.VERTS = (const uint32_t*)AT[1];
+        P.SHIFT = (const uint8_t*)AT[2];
+        return true;
+}
@@ -0,0 +1,262 @@
+/*
+Mesh quality analysis (MESH_REPORT, triangulation/binary/analyse_mesh)
+        One parallel pass over the elements of a 2D or 3D periodic mesh, given through two callables so the solver and
+        the standalone tool share it:
+                CORNER(j, m, P)         index of corner m of element j, P its position with the periodic image applied
+                SPEED(i)                signal speed |v| + c at vertex i
+        It reports the angles (dihedral angles in 3D), the aspect ratios (longest edge over inradius, 1 for a regular
+        element), the duals (1/(D+1) of each element), the number of elements at each vertex and the CFL timestep of
+        each vertex as calc_next_dt takes it (D*CFL*DUAL over the sum of element size times largest corner speed, the
+        size being the longest edge in 2D and the largest face in 3D). The elements are binned by the smallest
+        timestep of their vertices as reset_tbins does, so the report shows how the time bins will be populated.
+
+        Counts, minima and maxima do not depend on the number of threads. The duals and timestep sums are scattered
+        with atomics and may differ in the last bits between runs.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+
+#define MQ_ANGLE_BINS 18                                // 10 degree bins
+#define MQ_ASPECT_BINS 7                                // edges in MQ_ASPECT_EDGES
+#define MQ_DUAL_BINS 9                                  // log2 of the dual over the mean, -4 .. 4, ends open
+#define MQ_TBINS 16                                     // time bins 1, 2, 4 .. 2^15
+
+const double MQ_ASPECT_EDGES[MQ_ASPECT_BINS-1] = {1.25, 1.5, 2.0, 3.0, 5.0, 10.0};
+
+struct QUALITY_REPORT{
+        int DIM, MAX_TBIN;
+        long N_POINTS, N_ELEM, N_DEGENERATE;            // degenerate: measure below 1e-12 of the element size^D
+        double ANGLE_MIN, ANGLE_MAX;                    // degrees
+        double ASPECT_MEAN, ASPECT_MAX;                 // over the non degenerate elements
+        double DUAL_MIN, DUAL_MAX, DUAL_MEAN;
+        double DT_MIN, DT_MAX;
+        double COST;                                    // element evaluations per step with the time bins, 1 without
+        long ANGLE_HIST[MQ_ANGLE_BINS], ASPECT_HIST[MQ_ASPECT_BINS], DUAL_HIST[MQ_DUAL_BINS], TBIN_HIST[MQ_TBINS];
+        std::vector<long> VALENCE_HIST;                 // vertices by number of elements at them
+};
+
+inline void mq_sub(const double A[3], const double B[3], double C[3]){for(int k=0;k<3;++k){C[k] = A[k] - B[k];}}
+inline double mq_dot(const double A[3], const double B[3]){return A[0]*B[0] + A[1]*B[1] + A[2]*B[2];}
+inline void mq_cross(const double A[3], const double B[3], double C[3]){
+        C[0] = A[1]*B[2] - A[2]*B[1];
+        C[1] = A[2]*B[0] - A[0]*B[2];
+        C[2] = A[0]*B[1] - A[1]*B[0];
+}
+
+// angles, aspect ratio, area/volume and CFL size of the element with corners P (z = 0 in 2D), returns the number of
+// angles
+inline int mq_element(int D, double P[4][3], double ANGLE[6], double &ASPECT, double &MEASURE, double &SIZE){
+        double E[3], F[3], C[3], LMAX = 0.0;
+        for(int a=0;a<=D;++a){
+                for(int b=a+1;b<=D;++b){
+                        mq_sub(P[b], P[a], E);
+                        LMAX = fmax(LMAX, sqrt(mq_dot(E, E)));
+                }
+        }
+
+        if(D == 2){
+                double PERIM = 0.0;
+                for(int m=0;m<3;++m){
+                        mq_sub(P[(m + 1) % 3], P[m], E);
+                        mq_sub(P[(m + 2) % 3], P[m], F);
+                        mq_cross(E, F, C);
+                        ANGLE[m] = atan2(fabs(C[2]), mq_dot(E, F))*180.0/M_PI;
+                        PERIM += sqrt(mq_dot(E, E));
+                }
+                MEASURE = 0.5*fabs(C[2]);
+                SIZE    = LMAX;
+                ASPECT  = LMAX*PERIM/(4.0*sqrt(3.0)*MEASURE);
+                return 3;
+        }
+
+        // outward area vectors of the faces opposite each corner
+        double N[4][3], AREA[4], S = 0.0;
+        SIZE = 0.0;
+        for(int m=0;m<4;++m){
+                const double *A = P[(m + 1) % 4], *B = P[(m + 2) % 4], *Q = P[(m + 3) % 4];
+                mq_sub(B, A, E);
+                mq_sub(Q, A, F);
+                mq_cross(E, F, N[m]);
+                mq_sub(P[m], A, E);
+                double SIGN = mq_dot(N[m], E) > 0.0 ? -0.5 : 0.5;
+                for(int k=0;k<3;++k){N[m][k] *= SIGN;}
+                AREA[m] = sqrt(mq_dot(N[m], N[m]));
+                SIZE    = fmax(SIZE, AREA[m]);
+                S      += AREA[m];
+        }
+        mq_sub(P[1], P[0], E);
+        mq_sub(P[2], P[0], F);
+        mq_cross(E, F, C);
+        mq_sub(P[3], P[0], E);
+        MEASURE = fabs(mq_dot(E, C))/6.0;
+        ASPECT  = LMAX*S/(6.0*sqrt(6.0)*MEASURE);
+
+        // the dihedral angle on edge (a, b) is between the faces opposite the other two corners
+        int n = 0;
+        for(int a=0;a<4;++a){
+                for(int b=a+1;b<4;++b){
+                        int c = 0;
+                        while(c == a or c == b){c++;}
+                        int d = 6 - a - b - c;
+                        double COS = mq_dot(N[c], N[d])/(AREA[c]*AREA[d]);
+                        ANGLE[n++] = 180.0 - acos(fmax(-1.0, fmin(1.0, COS)))*180.0/M_PI;
+                }
+        }
+        return 6;
+}
+
+inline int mq_dual_bin(double RATIO){
+        int B = int(floor(log2(RATIO))) + MQ_DUAL_BINS/2;
+        return B < 0 ? 0 : (B >= MQ_DUAL_BINS ? MQ_DUAL_BINS - 1 : B);
+}
+
+// quality of the N_ELEM elements of a D dimensional mesh on N_POINTS vertices, timesteps for CFL and time bins up to
+// MAX_TBIN
+template<class CORNER, class SPEED>
+QUALITY_REPORT mesh_quality(int D, long N_POINTS, long N_ELEM, CORNER corner, SPEED speed, double CFL, int MAX_TBIN){
+        QUALITY_REPORT Q = QUALITY_REPORT();
+        Q.DIM = D;
+        Q.MAX_TBIN = MAX_TBIN;
+        Q.N_POINTS = N_POINTS;
+        Q.N_ELEM = N_ELEM;
+        Q.ANGLE_MIN = Q.DUAL_MIN = Q.DT_MIN = HUGE_VAL;
+
+        std::vector<double> DUAL(N_POINTS, 0.0), LEN_VEL(N_POINTS, 0.0), DT(N_POINTS);
+        std::vector<int> VALENCE(N_POINTS, 0);
+        double ASPECT_SUM = 0.0, MEASURE_SUM = 0.0;
+
+        // elements: angles and aspect ratios, duals and timestep sums scattered to the vertices
+#pragma omp parallel
+        {
+                QUALITY_REPORT T = QUALITY_REPORT();
+                double T_ASPECT = 0.0, T_MEASURE = 0.0;
+                T.ANGLE_MIN = HUGE_VAL;
+#pragma omp for schedule(static)
+                for(long j=0;j<N_ELEM;++j){
+                        double P[4][3] = {}, ANGLE[6], ASPECT, MEASURE, SIZE, VMAX = 0.0;
+                        long V[4];
+                        for(int m=0;m<=D;++m){
+                                V[m] = corner(j, m, P[m]);
+                                VMAX = fmax(VMAX, speed(V[m]));
+                        }
+                        int N_ANGLE = mq_element(D, P, ANGLE, ASPECT, MEASURE, SIZE);
+                        for(int n=0;n<N_ANGLE;++n){
+                                T.ANGLE_MIN = fmin(T.ANGLE_MIN, ANGLE[n]);
+                                T.ANGLE_MAX = fmax(T.ANGLE_MAX, ANGLE[n]);
+                                T.ANGLE_HIST[int(fmin(ANGLE[n]/10.0, MQ_ANGLE_BINS - 1))]++;
+                        }
+                        if(not (MEASURE > 1e-12*pow(SIZE, D == 2 ? 2.0 : 1.5))){
+                                T.N_DEGENERATE++;
+                                T.ASPECT_HIST[MQ_ASPECT_BINS-1]++;
+                        }else{
+                                int B = 0;
+                                while(B < MQ_ASPECT_BINS - 1 and ASPECT >= MQ_ASPECT_EDGES[B]){B++;}
+                                T.ASPECT_HIST[B]++;
+                                T.ASPECT_MAX = fmax(T.ASPECT_MAX, ASPECT);
+                                T_ASPECT += ASPECT;
+                        }
+                        T_MEASURE += MEASURE;
+                        for(int m=0;m<=D;++m){
+#pragma omp atomic
+                                DUAL[V[m]] += MEASURE/(D + 1);
+#pragma omp atomic
+                                LEN_VEL[V[m]] += SIZE*VMAX;
+#pragma omp atomic
+                                VALENCE[V[m]]++;
+                        }
+                }
+#pragma omp critical
+                {
+                        Q.N_DEGENERATE += T.N_DEGENERATE;
+                        Q.ANGLE_MIN = fmin(Q.ANGLE_MIN, T.ANGLE_MIN);
+                        Q.ANGLE_MAX = fmax(Q.ANGLE_MAX, T.ANGLE_MAX);
+                        Q.ASPECT_MAX = fmax(Q.ASPECT_MAX, T.ASPECT_MAX);
+                        for(int B=0;B<MQ_ANGLE_BINS;++B){Q.ANGLE_HIST[B] += T.ANGLE_HIST[B];}
+                        for(int B=0;B<MQ_ASPECT_BINS;++B){Q.ASPECT_HIST[B] += T.ASPECT_HIST[B];}
+                        ASPECT_SUM += T_ASPECT;
+                        MEASURE_SUM += T_MEASURE;
+                }
+        }
+        Q.ASPECT_MEAN = ASPECT_SUM/fmax(1.0, double(N_ELEM - Q.N_DEGENERATE));
+        Q.DUAL_MEAN = MEASURE_SUM/fmax(1.0, double(N_POINTS));
+
+        // vertices: duals, valences and timesteps
+        int V_MAX = 0;
+        double DUAL_MIN = HUGE_VAL, DUAL_MAX = 0.0, DT_MIN = HUGE_VAL, DT_MAX = 0.0;
+#pragma omp parallel for reduction(max:V_MAX,DUAL_MAX,DT_MAX) reduction(min:DUAL_MIN,DT_MIN)
+        for(long i=0;i<N_POINTS;++i){
+                DT[i] = LEN_VEL[i] > 0.0 ? CFL*D*DUAL[i]/LEN_VEL[i] : HUGE_VAL;
+                V_MAX = VALENCE[i] > V_MAX ? VALENCE[i] : V_MAX;
+                DUAL_MIN = fmin(DUAL_MIN, DUAL[i]);
+                DUAL_MAX = fmax(DUAL_MAX, DUAL[i]);
+                DT_MIN = fmin(DT_MIN, DT[i]);
+                if(DT[i] < HUGE_VAL){DT_MAX = fmax(DT_MAX, DT[i]);}
+        }
+        Q.DUAL_MIN = DUAL_MIN;
+        Q.DUAL_MAX = DUAL_MAX;
+        Q.DT_MIN = DT_MIN;
+        Q.DT_MAX = DT_MAX;
+        Q.VALENCE_HIST.assign(V_MAX + 1, 0);
+        for(long i=0;i<N_POINTS;++i){
+                Q.VALENCE_HIST[VALENCE[i]]++;
+                if(DUAL[i] > 0.0){Q.DUAL_HIST[mq_dual_bin(DUAL[i]/Q.DUAL_MEAN)]++;}
+        }
+
+        // elements binned by the smallest timestep of their vertices, relative to the global minimum
+        long TBIN_HIST[MQ_TBINS] = {};
+        double COST = 0.0;
+#pragma omp parallel
+        {
+                long T_HIST[MQ_TBINS] = {};
+                double P[3], T_COST = 0.0;
+#pragma omp for schedule(static)
+                for(long j=0;j<N_ELEM;++j){
+                        double DT_J = HUGE_VAL;
+                        for(int m=0;m<=D;++m){DT_J = fmin(DT_J, DT[corner(j, m, P)]);}
+                        int B = 0;
+                        while(B < MQ_TBINS - 1 and (2 << B) <= MAX_TBIN and DT_J >= (2 << B)*DT_MIN){B++;}
+                        T_HIST[B]++;
+                        T_COST += 1.0/(1 << B);
+                }
+#pragma omp critical
+                {
+                        for(int B=0;B<MQ_TBINS;++B){TBIN_HIST[B] += T_HIST[B];}
+                        COST += T_COST;
+                }
+        }
+        for(int B=0;B<MQ_TBINS;++B){Q.TBIN_HIST[B] = TBIN_HIST[B];}
+        Q.COST = COST/fmax(1.0, double(N_ELEM));
+
+        return Q;
+}
+
+inline void mesh_quality_print(const QUALITY_REPORT &Q){
+        int B;
+        printf("Mesh quality: %ld vertices, %ld %s, %ld degenerate\n", Q.N_POINTS, Q.N_ELEM, Q.DIM == 2 ? "triangles" : "tetrahedra", Q.N_DEGENERATE);
+        printf("ANGLE =\t%f\t%f\tminimum, maximum %s(degrees)\n", Q.ANGLE_MIN, Q.ANGLE_MAX, Q.DIM == 2 ? "" : "dihedral ");
+        printf("\tfrom\t");
+        for(B=0;B<MQ_ANGLE_BINS;++B){printf("%d\t", 10*B);}
+        printf("\n\tcount\t");
+        for(B=0;B<MQ_ANGLE_BINS;++B){printf("%ld\t", Q.ANGLE_HIST[B]);}
+        printf("\nASPECT =\t%f\t%f\tmean, maximum (longest edge over inradius, 1 regular)\n", Q.ASPECT_MEAN, Q.ASPECT_MAX);
+        printf("\tfrom\t1\t");
+        for(B=0;B<MQ_ASPECT_BINS-1;++B){printf("%g\t", MQ_ASPECT_EDGES[B]);}
+        printf("\n\tcount\t");
+        for(B=0;B<MQ_ASPECT_BINS;++B){printf("%ld\t", Q.ASPECT_HIST[B]);}
+        printf("\nDUAL =\t%g\t%g\t%g\tminimum, mean, maximum\n", Q.DUAL_MIN, Q.DUAL_MEAN, Q.DUAL_MAX);
+        printf("\tlog2/mean\t");
+        for(B=0;B<MQ_DUAL_BINS;++B){printf("%s%d\t", B == 0 ? "<=" : (B == MQ_DUAL_BINS - 1 ? ">=" : ""), B - MQ_DUAL_BINS/2);}
+        printf("\n\tcount\t");
+        for(B=0;B<MQ_DUAL_BINS;++B){printf("%ld\t", Q.DUAL_HIST[B]);}
+        printf("\nVALENCE =\t%s at each vertex\n\telements\t", Q.DIM == 2 ? "triangles" : "tetrahedra");
+        for(B=0;B<int(Q.VALENCE_HIST.size());++B){if(Q.VALENCE_HIST[B] > 0){printf("%d\t", B);}}
+        printf("\n\tcount\t");
+        for(B=0;B<int(Q.VALENCE_HIST.size());++B){if(Q.VALENCE_HIST[B] > 0){printf("%ld\t", Q.VALENCE_HIST[B]);}}
+        printf("\nDT =\t%g\t%g\tminimum, maximum CFL timestep of the vertices\n\ttime bin\t", Q.DT_MIN, Q.DT_MAX);
+        for(B=0;B<MQ_TBINS and (1 << B) <= Q.MAX_TBIN;++B){printf("%d\t", 1 << B);}
+        printf("\n\tcount\t");
+        for(B=0;B<MQ_TBINS and (1 << B) <= Q.MAX_TBIN;++B){printf("%ld\t", Q.TBIN_HIST[B]);}
+        printf("\nCOST =\t%f\telement evaluations per step with time bins, relative to none\n", Q.COST);
+}
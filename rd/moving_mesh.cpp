@@ -0,0 +1,650 @@
+/*
+Moving mesh (MOVING_MESH)
+        The vertices move with the fluid velocity, regularised towards the centroids of their dual cells
+        (VERTEX::set_mesh_velocity). Each step the normals, MAG, AREA and duals are recomputed at the mid step positions,
+        the residuals there use the flux relative to the moving elements (TRIANGLE::ale_residual), and the end of step
+        duals follow from the edge fluxes of the mesh velocity. A uniform state therefore stays uniform, and DUAL*U summed
+        over the vertices is conserved between retriangulations.
+
+        The connectivity is repaired locally: the edges of triangles whose quality falls below MESH_QUALITY are flipped
+        towards the Delaunay triangulation (Lawson flips, propagating to the neighbouring edges), updating the edge
+        neighbours, shift codes, time bins, duals and DU_PRIVATE slots of the two triangles involved only. A triangle
+        that inverts within a step is first repaired with the rings of triangles around it, retriangulated in place
+        (cavity_repair). Each flip and cavity settles the dual it moved on its own vertices as an AMR change does
+        (ledger_settle), so DUAL*U summed over the vertices is conserved through them. If a cavity fails, or the flips do
+        not settle, the vertices are retriangulated with triangulation/cgal/lib (generate.cpp). The vertex states are
+        then kept as point values of the linear interpolant, so the totals of DUAL*U change by the dual changes times the
+        local variation of U.
+
+        2D only, every triangle evaluated every step (time bins set to 1, timestep.cpp) and the timestep found again from
+        the new mesh velocities every step (main.cpp).
+*/
+
+#if defined(MPI_RD) or defined(BATCH_RESIDUAL) or defined(CHARACTERISTIC) or defined(JUMP)
+#error "MOVING_MESH: MPI_RD, BATCH_RESIDUAL, CHARACTERISTIC and JUMP assume a static mesh"
+#endif
+
+#include <array>
+
+#define CAVITY_RINGS 3                                  // rings of vertex stars grown around an inverted triangle
+#define CAVITY_MAX 96                                   // larger cavities are left to the global retriangulation
+
+std::vector<int> MESH_NEIGH;                            // triangle across the edge opposite each corner, 3 per triangle
+
+struct MESH_COUNTS{
+        int N_CAVITY;                                   // inverted triangles repaired by a local retriangulation in the last step
+        long N_CAVITY_TOTAL, N_REMESH_TOTAL;            // local and global retriangulations so far
+} MESH_STATE;
+
+VERTEX* corner_vertex(TRIANGLE &T, int m){
+        return m == 0 ? T.get_vertex_0() : (m == 1 ? T.get_vertex_1() : T.get_vertex_2());
+}
+
+int corner_of(TRIANGLE &T, VERTEX *V){
+        for(int m=0;m<3;++m){
+                if(corner_vertex(T, m) == V){return m;}
+        }
+        return -1;
+}
+
+// position of corner m with its periodic image
+void corner_position(TRIANGLE &T, int m, double P[2]){
+        VERTEX *V = corner_vertex(T, m);
+        P[0] = (T.get_shift(m) & 1) ? V->get_x() + SIDE_LENGTH_X : V->get_x();
+        P[1] = (T.get_shift(m) & 2) ? V->get_y() + SIDE_LENGTH_Y : V->get_y();
+}
+
+// edge neighbours, matching the edges by the vertex IDs at their ends and the image offset between them
+void mesh_neighbours(std::vector<TRIANGLE> &MESH){
+        int N_TRIANG = MESH.size();
+        std::vector< std::array<long,3> > EDGE(3*N_TRIANG);      // lower ID, higher ID and offset, 3*j + m
+
+#pragma omp parallel for
+        for(int j=0;j<N_TRIANG;++j){
+                for(int m=0;m<3;++m){
+                        int A = (m + 1) % 3, B = (m + 2) % 3;
+                        long I_A = corner_vertex(MESH[j], A)->get_id(), I_B = corner_vertex(MESH[j], B)->get_id();
+                        int O_X = (MESH[j].get_shift(B) & 1) - (MESH[j].get_shift(A) & 1);
+                        int O_Y = (MESH[j].get_shift(B) >> 1) - (MESH[j].get_shift(A) >> 1);
+                        if(I_A > I_B){std::swap(I_A, I_B); O_X = -O_X; O_Y = -O_Y;}
+                        EDGE[3*j+m] = {I_A, 9*I_B + 3*(O_X + 1) + O_Y + 1, 3*j + m};
+                }
+        }
+        std::sort(EDGE.begin(), EDGE.end());
+
+        MESH_NEIGH.assign(3*N_TRIANG, -1);
+        for(int e=0;e+1<3*N_TRIANG;++e){
+                if(EDGE[e][0] == EDGE[e+1][0] and EDGE[e][1] == EDGE[e+1][1]){
+                        MESH_NEIGH[EDGE[e][2]]   = EDGE[e+1][2]/3;
+                        MESH_NEIGH[EDGE[e+1][2]] = EDGE[e][2]/3;
+                        e++;
+                }
+        }
+}
+
+// corner of triangle K opposite the edge it shares with corner M of triangle J, -1 if there is none
+int neighbour_corner(std::vector<TRIANGLE> &MESH, int J, int M, int K){
+        VERTEX *A = corner_vertex(MESH[J], (M + 1) % 3), *B = corner_vertex(MESH[J], (M + 2) % 3);
+        for(int n=0;n<3;++n){
+                if(MESH_NEIGH[3*K+n] == J and corner_vertex(MESH[K], (n + 1) % 3) == B and corner_vertex(MESH[K], (n + 2) % 3) == A){return n;}
+        }
+        return -1;
+}
+
+// triangles around V, starting from J and crossing the edge after V in each, false if the walk does not close within
+// MAX_STAR triangles
+bool vertex_star(std::vector<TRIANGLE> &MESH, int J, VERTEX *V, std::vector<int> &STAR, int MAX_STAR){
+        int T = J;
+        STAR.clear();
+        do{
+                int m = corner_of(MESH[T], V);
+                if(m < 0 or int(STAR.size()) >= MAX_STAR){return false;}
+                STAR.push_back(T);
+                T = MESH_NEIGH[3*T + (m + 1) % 3];
+                if(T < 0){return false;}
+        }while(T != J);
+        return true;
+}
+
+// point the edge of triangle K shared with J_OLD, where it runs from P to Q, at J_NEW
+void repoint_neighbour(std::vector<TRIANGLE> &MESH, int K, int J_OLD, int J_NEW, VERTEX *P, VERTEX *Q){
+        for(int n=0;n<3;++n){
+                if(MESH_NEIGH[3*K+n] == J_OLD and corner_vertex(MESH[K], (n + 1) % 3) == Q and corner_vertex(MESH[K], (n + 2) % 3) == P){
+                        MESH_NEIGH[3*K+n] = J_NEW;
+                        return;
+                }
+        }
+}
+
+// shift codes of a triangle with corners V at the unwrapped positions P, false if it spans more than one image
+bool image_codes(VERTEX *V[3], double P[3][2], int CODE[3]){
+        double L[2] = {SIDE_LENGTH_X, SIDE_LENGTH_Y};
+        long N[3];
+        CODE[0] = CODE[1] = CODE[2] = 0;
+        for(int k=0;k<2;++k){
+                for(int m=0;m<3;++m){N[m] = lround((P[m][k] - (k == 0 ? V[m]->get_x() : V[m]->get_y()))/L[k]);}
+                long LOW = std::min(N[0], std::min(N[1], N[2]));
+                for(int m=0;m<3;++m){
+                        if(N[m] - LOW > 1){return false;}
+                        CODE[m] |= (N[m] - LOW) << k;
+                }
+        }
+        return true;
+}
+
+double orient(double A[2], double B[2], double C[2]){
+        return (B[0] - A[0])*(C[1] - A[1]) - (B[1] - A[1])*(C[0] - A[0]);
+}
+
+// positive if D lies inside the circumcircle of the counter clockwise A, B, C, relative to the fourth power of the
+// distances so nearly cocircular quadrilaterals (regular grids) are left alone rather than flipped back and forth
+double incircle(double A[2], double B[2], double C[2], double D[2]){
+        double AX = A[0] - D[0], AY = A[1] - D[1], A2 = AX*AX + AY*AY;
+        double BX = B[0] - D[0], BY = B[1] - D[1], B2 = BX*BX + BY*BY;
+        double CX = C[0] - D[0], CY = C[1] - D[1], C2 = CX*CX + CY*CY;
+        double DET = A2*(BX*CY - CX*BY) + B2*(CX*AY - AX*CY) + C2*(AX*BY - BX*AY);
+        return DET/((A2 + B2 + C2)*(A2 + B2 + C2));
+}
+
+// vertices whose duals a local mesh change alters, with the duals before it (repairs here, amr.cpp)
+typedef std::vector< std::pair<VERTEX*,double> > DUAL_LEDGER;
+
+void ledger_add(DUAL_LEDGER *LEDGER, VERTEX *V){
+        if(LEDGER == NULL){return;}
+        for(size_t n=0;n<LEDGER->size();++n){
+                if((*LEDGER)[n].first == V){return;}
+        }
+        LEDGER->push_back(std::make_pair(V, V->get_dual()));
+}
+
+// vertices whose dual shrank keep their state, those whose dual grew share what the others gave up in proportion to
+// their gains
+void ledger_settle(DUAL_LEDGER &LEDGER){
+        double LOST[4] = {0.0, 0.0, 0.0, 0.0}, GAIN = 0.0;
+        for(size_t n=0;n<LEDGER.size();++n){
+                VERTEX *V = LEDGER[n].first;
+                double CHANGE = V->get_dual() - LEDGER[n].second;
+                if(CHANGE < 0.0){
+                        LOST[0] -= CHANGE*V->get_u0();
+                        LOST[1] -= CHANGE*V->get_u1();
+                        LOST[2] -= CHANGE*V->get_u2();
+                        LOST[3] -= CHANGE*V->get_u3();
+                }else{
+                        GAIN += CHANGE;
+                }
+        }
+        for(size_t n=0;n<LEDGER.size() and GAIN>0.0;++n){
+                VERTEX *V = LEDGER[n].first;
+                double D_OLD = LEDGER[n].second, D_NEW = V->get_dual(), W = (D_NEW - D_OLD)/GAIN;
+                if(D_NEW <= D_OLD){continue;}
+                V->set_u0((D_OLD*V->get_u0() + W*LOST[0])/D_NEW);
+                V->set_u1((D_OLD*V->get_u1() + W*LOST[1])/D_NEW);
+                V->set_u2((D_OLD*V->get_u2() + W*LOST[2])/D_NEW);
+                V->set_u3((D_OLD*V->get_u3() + W*LOST[3])/D_NEW);
+                V->con_to_prim();
+        }
+}
+
+// flip the edge opposite corner M of triangle J if the quadrilateral with its neighbour K is convex and not Delaunay
+// (or just convex with FORCE): J (C,A,B) and K (D,B,A) become J (C,A,D) and K (C,D,B). The four outer edges go on the
+// STACK, the four vertices in the LEDGER
+bool flip_edge(std::vector<TRIANGLE> &MESH, int J, int M, std::vector<int> &STACK, bool FORCE = false, DUAL_LEDGER *LEDGER = NULL){
+        int K = MESH_NEIGH[3*J+M];
+        if(K < 0 or K == J){return false;}
+        int N = neighbour_corner(MESH, J, M, K);
+        if(N < 0){return false;}
+
+        VERTEX *V_A = corner_vertex(MESH[J], (M + 1) % 3), *V_B = corner_vertex(MESH[J], (M + 2) % 3);
+        VERTEX *V_C = corner_vertex(MESH[J], M), *V_D = corner_vertex(MESH[K], N);
+        int N_BC = MESH_NEIGH[3*J + (M + 1) % 3], N_CA = MESH_NEIGH[3*J + (M + 2) % 3];
+        int N_AD = MESH_NEIGH[3*K + (N + 1) % 3], N_DB = MESH_NEIGH[3*K + (N + 2) % 3];
+        if(V_C == V_D){return false;}
+        for(int OUTER : {N_BC, N_CA, N_AD, N_DB}){
+                if(OUTER < 0 or OUTER == J or OUTER == K){return false;}            // only in meshes of a few triangles
+        }
+
+        // D in the frame of J, from the offset between the images of A in the two triangles
+        double P_A[2], P_B[2], P_C[2], P_D[2], P_K[2];
+        corner_position(MESH[J], (M + 1) % 3, P_A);
+        corner_position(MESH[J], (M + 2) % 3, P_B);
+        corner_position(MESH[J], M, P_C);
+        corner_position(MESH[K], N, P_D);
+        corner_position(MESH[K], (N + 2) % 3, P_K);
+        P_D[0] += P_A[0] - P_K[0];
+        P_D[1] += P_A[1] - P_K[1];
+
+        if(not FORCE and incircle(P_A, P_B, P_C, P_D) <= MESH_FLIP_TOL){return false;}
+        if(orient(P_C, P_A, P_D) <= 0.0 or orient(P_C, P_D, P_B) <= 0.0){return false;}
+
+        VERTEX *V_J[3] = {V_C, V_A, V_D}, *V_K[3] = {V_C, V_D, V_B};
+        double P_J[3][2] = {{P_C[0], P_C[1]}, {P_A[0], P_A[1]}, {P_D[0], P_D[1]}};
+        double Q_K[3][2] = {{P_C[0], P_C[1]}, {P_D[0], P_D[1]}, {P_B[0], P_B[1]}};
+        int CODE_J[3], CODE_K[3];
+        if(not image_codes(V_J, P_J, CODE_J) or not image_codes(V_K, Q_K, CODE_K)){return false;}
+
+        // duals move with the areas of the two triangles at the current positions
+        for(VERTEX *V : {V_A, V_B, V_C, V_D}){ledger_add(LEDGER, V);}
+        MESH[J].setup_normals(false);
+        MESH[K].setup_normals(false);
+        MESH[J].remove_dual();
+        MESH[K].remove_dual();
+
+        MESH[J].set_vertex_0(V_C); MESH[J].set_vertex_1(V_A); MESH[J].set_vertex_2(V_D);
+        MESH[K].set_vertex_0(V_C); MESH[K].set_vertex_1(V_D); MESH[K].set_vertex_2(V_B);
+        for(int m=0;m<3;++m){
+                MESH[J].set_shift(m, CODE_J[m]);
+                MESH[K].set_shift(m, CODE_K[m]);
+        }
+        MESH[J].set_boundary(CODE_J[0] or CODE_J[1] or CODE_J[2]);
+        MESH[K].set_boundary(CODE_K[0] or CODE_K[1] or CODE_K[2]);
+
+        MESH[J].setup_normals(false);
+        MESH[K].setup_normals(false);
+        MESH[J].add_dual();
+        MESH[K].add_dual();
+
+        int TBIN = min_val(MESH[J].get_tbin(), MESH[K].get_tbin());
+        MESH[J].set_tbin(TBIN);
+        MESH[K].set_tbin(TBIN);
+
+        MESH_NEIGH[3*J+0] = N_AD; MESH_NEIGH[3*J+1] = K;    MESH_NEIGH[3*J+2] = N_CA;
+        MESH_NEIGH[3*K+0] = N_DB; MESH_NEIGH[3*K+1] = N_BC; MESH_NEIGH[3*K+2] = J;
+        repoint_neighbour(MESH, N_AD, K, J, V_A, V_D);
+        repoint_neighbour(MESH, N_BC, J, K, V_B, V_C);
+
+#ifdef DU_PRIVATE
+        if(LEDGER == NULL){                                             // an AMR pass sets the buffers up again after it
+                du_private_touch(MESH, J);
+                du_private_touch(MESH, K);
+        }
+#endif
+
+        STACK.push_back(3*J+0);
+        STACK.push_back(3*J+2);
+        STACK.push_back(3*K+0);
+        STACK.push_back(3*K+1);
+        return true;
+}
+
+// Lawson flips from the edges of the triangles of quality Q below MESH_QUALITY, in triangle order, each settled on
+// the four vertices it involves. Returns the number of flips, -1 if they did not settle within one per triangle
+int mesh_repair(const std::vector<double> &Q, std::vector<TRIANGLE> &MESH){
+        int N_TRIANG = MESH.size(), N_FLIP = 0;
+        std::vector<int> STACK;
+        DUAL_LEDGER LEDGER;
+
+        for(int j=N_TRIANG-1;j>=0;--j){
+                if(Q[j] < MESH_QUALITY){
+                        for(int m=2;m>=0;--m){STACK.push_back(3*j+m);}
+                }
+        }
+
+        while(not STACK.empty()){
+                int E = STACK.back(), K = MESH_NEIGH[E];
+                STACK.pop_back();
+                LEDGER.clear();
+                for(int m=0;m<3 and K>=0;++m){
+                        ledger_add(&LEDGER, corner_vertex(MESH[E/3], m));
+                        ledger_add(&LEDGER, corner_vertex(MESH[K], m));
+                }
+                if(not flip_edge(MESH, E/3, E%3, STACK)){continue;}
+                ledger_settle(LEDGER);
+                if(++N_FLIP > N_TRIANG){return -1;}
+        }
+        return N_FLIP;
+}
+
+// Delaunay triangulation of the points P (Bowyer-Watson from an enclosing triangle), counter clockwise corner triples
+std::vector< std::array<int,3> > local_delaunay(const std::vector< std::array<double,2> > &P){
+        int N = P.size();
+        double LOW[2] = {P[0][0], P[0][1]}, HIGH[2] = {P[0][0], P[0][1]};
+        for(int i=1;i<N;++i){
+                for(int k=0;k<2;++k){
+                        LOW[k]  = std::min(LOW[k], P[i][k]);
+                        HIGH[k] = std::max(HIGH[k], P[i][k]);
+                }
+        }
+        double MID[2] = {0.5*(LOW[0] + HIGH[0]), 0.5*(LOW[1] + HIGH[1])};
+        double R = 100.0*std::max(HIGH[0] - LOW[0], HIGH[1] - LOW[1]);
+
+        std::vector< std::array<double,2> > Q(P);
+        Q.push_back({MID[0] - R, MID[1] - R});
+        Q.push_back({MID[0] + R, MID[1] - R});
+        Q.push_back({MID[0], MID[1] + R});
+
+        std::vector< std::array<int,3> > TRIS(1, std::array<int,3>{N, N + 1, N + 2}), KEEP;
+        std::vector< std::array<int,2> > HOLE;
+        for(int i=0;i<N;++i){
+                KEEP.clear();
+                HOLE.clear();
+                for(const std::array<int,3> &T : TRIS){
+                        if(incircle(&Q[T[0]][0], &Q[T[1]][0], &Q[T[2]][0], &Q[i][0]) > 0.0){
+                                for(int m=0;m<3;++m){HOLE.push_back({T[(m + 1) % 3], T[(m + 2) % 3]});}
+                        }else{
+                                KEEP.push_back(T);
+                        }
+                }
+                // edges of the hole boundary appear once, interior edges once in each direction
+                for(size_t e=0;e<HOLE.size();++e){
+                        bool INNER = false;
+                        for(size_t f=0;f<HOLE.size() and not INNER;++f){
+                                INNER = HOLE[f][0] == HOLE[e][1] and HOLE[f][1] == HOLE[e][0];
+                        }
+                        if(not INNER){KEEP.push_back({HOLE[e][0], HOLE[e][1], i});}
+                }
+                TRIS.swap(KEEP);
+        }
+
+        KEEP.clear();
+        for(const std::array<int,3> &T : TRIS){
+                if(T[0] < N and T[1] < N and T[2] < N){KEEP.push_back(T);}
+        }
+        return KEEP;
+}
+
+// retriangulate the cavity around the inverted triangle J: the stars of its corners, grown by the stars of the cavity
+// corners up to CAVITY_RINGS times, replaced by the Delaunay triangles of its vertices that fall inside its boundary.
+// Accepted only if they cover the cavity with positive triangles, keep its boundary edges and use every vertex, so the
+// triangles outside are untouched. The duals change by the new minus the old signed areas, Q holds the new qualities
+bool cavity_repair(int J, std::vector<double> &Q, std::vector<TRIANGLE> &MESH){
+        std::vector<int> CAV(1, J), STAR;
+
+        for(int RING=0;RING<CAVITY_RINGS;++RING){
+                // grow by the stars of the cavity corners
+                int N_OLD = CAV.size();
+                for(int t=0;t<N_OLD;++t){
+                        for(int m=0;m<3;++m){
+                                if(not vertex_star(MESH, CAV[t], corner_vertex(MESH[CAV[t]], m), STAR, CAVITY_MAX)){return false;}
+                                for(int K : STAR){
+                                        if(std::find(CAV.begin(), CAV.end(), K) == CAV.end()){CAV.push_back(K);}
+                                }
+                        }
+                }
+                if(int(CAV.size()) > CAVITY_MAX){return false;}
+                int N_CAV = CAV.size();
+
+                // corner positions in the frame of J, walking over the edge neighbours within the cavity
+                std::vector< std::array<double,2> > OFF(N_CAV), POS;
+                std::vector<char> PLACED(N_CAV, 0);
+                std::vector<VERTEX*> VERT;
+                std::vector< std::array<int,3> > OLD(N_CAV);
+                std::vector<int> WALK(1, 0);
+                OFF[0] = {0.0, 0.0};
+                PLACED[0] = 1;
+                for(size_t w=0;w<WALK.size();++w){
+                        int a = WALK[w], T = CAV[a];
+                        for(int m=0;m<3;++m){
+                                int K = MESH_NEIGH[3*T+m];
+                                int b = std::find(CAV.begin(), CAV.end(), K) - CAV.begin();
+                                if(b == N_CAV or PLACED[b]){continue;}
+                                int n = neighbour_corner(MESH, T, m, K);
+                                if(n < 0){return false;}
+                                double P_T[2], P_K[2];
+                                corner_position(MESH[T], (m + 1) % 3, P_T);
+                                corner_position(MESH[K], (n + 2) % 3, P_K);
+                                OFF[b] = {OFF[a][0] + P_T[0] - P_K[0], OFF[a][1] + P_T[1] - P_K[1]};
+                                PLACED[b] = 1;
+                                WALK.push_back(b);
+                        }
+                }
+                if(int(WALK.size()) != N_CAV){return false;}
+
+                double TOL = 1e-9*(SIDE_LENGTH_X + SIDE_LENGTH_Y);
+                for(int t=0;t<N_CAV;++t){
+                        for(int m=0;m<3;++m){
+                                double P[2];
+                                corner_position(MESH[CAV[t]], m, P);
+                                P[0] += OFF[t][0];
+                                P[1] += OFF[t][1];
+                                VERTEX *V = corner_vertex(MESH[CAV[t]], m);
+                                int v = std::find(VERT.begin(), VERT.end(), V) - VERT.begin();
+                                if(v == int(VERT.size())){
+                                        VERT.push_back(V);
+                                        POS.push_back({P[0], P[1]});
+                                }else if(fabs(P[0] - POS[v][0]) + fabs(P[1] - POS[v][1]) > TOL){
+                                        return false;                   // the cavity wraps round the box
+                                }
+                                OLD[t][m] = v;
+                        }
+                }
+
+                // boundary edges run counter clockwise, one from each boundary vertex, to the triangles OUTER outside
+                int N_VERT = VERT.size(), N_BOUND = 0;
+                std::vector<int> NEXT(N_VERT, -1), OUTER(N_VERT, -1), OWNER(N_VERT, -1);
+                for(int t=0;t<N_CAV;++t){
+                        for(int m=0;m<3;++m){
+                                int K = MESH_NEIGH[3*CAV[t]+m];
+                                if(std::find(CAV.begin(), CAV.end(), K) != CAV.end()){continue;}
+                                int a = OLD[t][(m + 1) % 3];
+                                if(K < 0 or NEXT[a] >= 0){return false;}
+                                NEXT[a] = OLD[t][(m + 2) % 3];
+                                OUTER[a] = K;
+                                OWNER[a] = CAV[t];
+                                N_BOUND++;
+                        }
+                }
+                int N_LOOP = 0, a = std::find_if(NEXT.begin(), NEXT.end(), [](int b){return b >= 0;}) - NEXT.begin();
+                if(a == N_VERT){return false;}
+                double AREA = 0.0;
+                for(int b=a;N_LOOP==0 or b!=a;b=NEXT[b]){
+                        if(NEXT[b] < 0 or N_LOOP++ > N_BOUND){return false;}
+                        AREA += 0.5*(POS[b][0]*POS[NEXT[b]][1] - POS[NEXT[b]][0]*POS[b][1]);
+                }
+                if(N_LOOP != N_BOUND or N_CAV != N_BOUND + 2*(N_VERT - N_BOUND) - 2 or AREA <= 0.0){continue;}
+
+                // Delaunay triangles with their centroid inside the boundary
+                std::vector< std::array<int,3> > NEW, ALL = local_delaunay(POS);
+                for(const std::array<int,3> &T : ALL){
+                        double C[2] = {(POS[T[0]][0] + POS[T[1]][0] + POS[T[2]][0])/3.0, (POS[T[0]][1] + POS[T[1]][1] + POS[T[2]][1])/3.0};
+                        int WIND = 0;
+                        for(int b=0;b<N_VERT;++b){
+                                if(NEXT[b] < 0){continue;}
+                                double *P0 = &POS[b][0], *P1 = &POS[NEXT[b]][0];
+                                if(P0[1] <= C[1] and P1[1] > C[1] and orient(P0, P1, C) > 0.0){WIND++;}
+                                if(P0[1] > C[1] and P1[1] <= C[1] and orient(P0, P1, C) < 0.0){WIND--;}
+                        }
+                        if(WIND != 0){NEW.push_back(T);}
+                }
+                if(int(NEW.size()) != N_CAV){continue;}
+
+                double NEW_AREA = 0.0;
+                std::vector<int> USED(N_VERT, 0), KEPT(N_VERT, 0);
+                std::vector< std::array<int,3> > CODE(N_CAV);
+                bool VALID = true;
+                for(int t=0;t<N_CAV and VALID;++t){
+                        VERTEX *V[3];
+                        double P[3][2];
+                        for(int m=0;m<3;++m){
+                                V[m] = VERT[NEW[t][m]];
+                                P[m][0] = POS[NEW[t][m]][0];
+                                P[m][1] = POS[NEW[t][m]][1];
+                                USED[NEW[t][m]] = 1;
+                                if(NEXT[NEW[t][(m + 1) % 3]] == NEW[t][(m + 2) % 3]){KEPT[NEW[t][(m + 1) % 3]] = 1;}
+                        }
+                        double A = 0.5*orient(P[0], P[1], P[2]);
+                        NEW_AREA += A;
+                        VALID = A > 0.0 and image_codes(V, P, &CODE[t][0]);
+                }
+                for(int b=0;b<N_VERT and VALID;++b){VALID = USED[b] and (NEXT[b] < 0 or KEPT[b]);}
+                if(not VALID or fabs(NEW_AREA - AREA) > 1e-10*AREA){continue;}
+
+                // old signed areas out of the duals, the new triangles into the cavity slots, settled on its vertices
+                DUAL_LEDGER LEDGER;
+                for(VERTEX *V : VERT){ledger_add(&LEDGER, V);}
+                for(int t=0;t<N_CAV;++t){
+                        double A = 0.5*orient(&POS[OLD[t][0]][0], &POS[OLD[t][1]][0], &POS[OLD[t][2]][0]);
+                        for(int m=0;m<3;++m){VERT[OLD[t][m]]->calculate_dual(-A/3.0);}
+                }
+
+                int TBIN = MESH[CAV[0]].get_tbin();
+                for(int t=1;t<N_CAV;++t){TBIN = min_val(TBIN, MESH[CAV[t]].get_tbin());}
+                std::vector<int> SLOT(CAV);
+                std::sort(SLOT.begin(), SLOT.end());
+                for(int t=0;t<N_CAV;++t){
+                        TRIANGLE &T = MESH[SLOT[t]];
+                        T.set_vertex_0(VERT[NEW[t][0]]);
+                        T.set_vertex_1(VERT[NEW[t][1]]);
+                        T.set_vertex_2(VERT[NEW[t][2]]);
+                        for(int m=0;m<3;++m){T.set_shift(m, CODE[t][m]);}
+                        T.set_boundary(CODE[t][0] or CODE[t][1] or CODE[t][2]);
+                        T.setup_normals(false);
+                        T.add_dual();
+                        T.set_tbin(TBIN);
+                        Q[SLOT[t]] = T.quality();
+#ifdef DU_PRIVATE
+                        du_private_touch(MESH, SLOT[t]);
+#endif
+                }
+                ledger_settle(LEDGER);
+
+                // edge neighbours within the cavity, and across its boundary to the untouched triangles
+                for(int t=0;t<N_CAV;++t){
+                        for(int m=0;m<3;++m){
+                                int a = NEW[t][(m + 1) % 3], b = NEW[t][(m + 2) % 3];
+                                if(NEXT[a] == b){
+                                        MESH_NEIGH[3*SLOT[t]+m] = OUTER[a];
+                                        repoint_neighbour(MESH, OUTER[a], OWNER[a], SLOT[t], VERT[a], VERT[b]);
+                                        continue;
+                                }
+                                for(int u=0;u<N_CAV;++u){
+                                        for(int n=0;n<3;++n){
+                                                if(NEW[u][(n + 1) % 3] == b and NEW[u][(n + 2) % 3] == a){MESH_NEIGH[3*SLOT[t]+m] = SLOT[u];}
+                                        }
+                                }
+                        }
+                }
+                return true;
+        }
+        return false;
+}
+
+// retriangulate the current positions, false with the mesh untouched if they have no periodic triangulation
+bool remesh(std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        int N_POINTS = POINTS.size();
+        std::vector<double> X(2*N_POINTS);
+
+#pragma omp parallel for
+        for(int i=0;i<N_POINTS;++i){
+                X[2*i]   = POINTS[i].get_x();
+                X[2*i+1] = POINTS[i].get_y();
+        }
+
+        std::vector<int> VERTS, SHIFT;
+        long N_TRIANG = periodic_triangulation(X, VERTS, SHIFT);
+        if(N_TRIANG < 0){return false;}
+
+#pragma omp parallel for
+        for(int i=0;i<N_POINTS;++i){POINTS[i].set_dual(0.0);}
+        setup_triangles(N_TRIANG, VERTS, SHIFT, POINTS, MESH);
+
+        for(int j=0;j<int(MESH.size());++j){MESH[j].set_tbin(1);}
+        mesh_neighbours(MESH);
+        return true;
+}
+
+// mesh velocities from the current positions and state. Also set before each timestep is found (main.cpp), so the CFL
+// limit sees the drift towards the dual centroids the next step will make, not that of the last one
+void mesh_velocity(std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        int N_POINTS = POINTS.size(), N_TRIANG = MESH.size();
+
+        // dual centroids are summed in triangle order, as the duals at mesh load
+#pragma omp parallel for
+        for(int i=0;i<N_POINTS;++i){POINTS[i].reset_centroid_offset();}
+        for(int j=0;j<N_TRIANG;++j){MESH[j].add_centroid_offset();}
+
+#pragma omp parallel for
+        for(int i=0;i<N_POINTS;++i){POINTS[i].set_mesh_velocity();}
+}
+
+// mesh velocity from the state at the start of the step, vertices to their mid step positions and the geometry there
+void mesh_drift_half(double DT, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        int N_POINTS = POINTS.size(), N_TRIANG = MESH.size();
+
+        mesh_velocity(POINTS, MESH);
+
+#pragma omp parallel for
+        for(int i=0;i<N_POINTS;++i){
+                POINTS[i].begin_dual_step();
+                POINTS[i].drift(0.5*DT);                                    // unwrapped, the shift codes still hold
+        }
+
+#pragma omp parallel for
+        for(int j=0;j<N_TRIANG;++j){MESH[j].update_geometry();}
+        for(int j=0;j<N_TRIANG;++j){
+                MESH[j].add_dual();
+                MESH[j].add_dual_rate();
+        }
+
+#pragma omp parallel for
+        for(int i=0;i<N_POINTS;++i){POINTS[i].set_dual_new(DT);}
+}
+
+// shift codes of T after its corners wrapped into the box. WRAP holds per vertex the axes wrapped down (bits 1, 2, the
+// image now needs +L) and up (bits 4, 8, -L). Per axis the wrapped corners toggle their bit, the three bits are
+// complemented if a corner needs an image the bits cannot hold (a -L image, or a +2L image), and a bit set on all three
+// corners is cleared, as find_shift would leave it
+void wrap_shift(TRIANGLE &T, const std::vector<int> &WRAP, VERTEX *FIRST){
+        int S[3], W[3], BOUNDARY = 0;
+        for(int m=0;m<3;++m){
+                S[m] = T.get_shift(m);
+                W[m] = WRAP[corner_vertex(T, m) - FIRST];
+        }
+        for(int B=1;B<=2;B<<=1){
+                int FLIP = 0, ALL = B;
+                for(int m=0;m<3;++m){
+                        if(((W[m] & (B << 2)) and !(S[m] & B)) or ((W[m] & B) and (S[m] & B))){FLIP = B;}
+                        S[m] ^= (W[m] | (W[m] >> 2)) & B;
+                }
+                for(int m=0;m<3;++m){
+                        S[m] ^= FLIP;
+                        ALL &= S[m];
+                }
+                for(int m=0;m<3;++m){S[m] &= ~ALL;}
+        }
+        for(int m=0;m<3;++m){
+                T.set_shift(m, S[m]);
+                if(S[m] != 0){BOUNDARY = 1;}
+        }
+        T.set_boundary(BOUNDARY);
+}
+
+// vertices to their end of step positions, wrapped into the box with new shift codes, and low quality triangles
+// repaired. Inverted triangles are retriangulated locally (cavity_repair, counted in MESH_STATE.N_CAVITY), the rest by
+// edge flips. Q_MIN returns the worst triangle quality before the repair. Returns the number of edge flips, -1 if a
+// cavity or the flips failed and the mesh was retriangulated globally, -2 if that failed too
+int mesh_drift_end(double DT, double &Q_MIN, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        int N_POINTS = POINTS.size(), N_TRIANG = MESH.size();
+        std::vector<double> Q(N_TRIANG);
+        std::vector<int> WRAP(N_POINTS);
+
+#pragma omp parallel for
+        for(int i=0;i<N_POINTS;++i){
+                POINTS[i].drift(0.5*DT);
+                double X = POINTS[i].get_x(), Y = POINTS[i].get_y();
+                double X_WRAP = gen_wrap(X, SIDE_LENGTH_X), Y_WRAP = gen_wrap(Y, SIDE_LENGTH_Y);
+                WRAP[i] = (X_WRAP < X ? 1 : 0) | (Y_WRAP < Y ? 2 : 0) | (X_WRAP > X ? 4 : 0) | (Y_WRAP > Y ? 8 : 0);
+                POINTS[i].set_x(X_WRAP);
+                POINTS[i].set_y(Y_WRAP);
+                POINTS[i].end_dual_step();
+        }
+
+        Q_MIN = deterministic_min(N_TRIANG, 1.0, [&](int j){
+                wrap_shift(MESH[j], WRAP, &POINTS[0]);
+                Q[j] = MESH[j].quality();
+                return Q[j];
+        });
+
+        MESH_STATE.N_CAVITY = 0;
+        if(Q_MIN >= MESH_QUALITY){return 0;}
+        bool LOCAL = true;                                              // flips need every triangle the right way round
+        for(int j=0;j<N_TRIANG and LOCAL;++j){
+                if(Q[j] > 0.0){continue;}
+                LOCAL = cavity_repair(j, Q, MESH);
+                if(LOCAL){MESH_STATE.N_CAVITY++;}
+        }
+        MESH_STATE.N_CAVITY_TOTAL += MESH_STATE.N_CAVITY;
+        int N_FLIP = LOCAL ? mesh_repair(Q, MESH) : -1;
+        if(N_FLIP >= 0){return N_FLIP;}
+        MESH_STATE.N_REMESH_TOTAL++;
+        return remesh(POINTS, MESH) ? -1 : -2;
+}
@@ -0,0 +1,105 @@
+/*
+Parallel text mesh reader (PARALLEL_PARSE)
+        Maps a CGAL or qhull text triangulation and indexes its lines across threads, each thread taking a chunk of the
+        file that starts and ends on a line boundary. Lines are then parsed independently with std::from_chars, which
+        is locale independent and rounds like >>, so the readers in io2D.cpp/io3D.cpp can fill the vertices and
+        triangles in parallel loops.
+*/
+
+#include <charconv>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// read only view of a mapped text file
+struct TEXT_MAP{
+        size_t SIZE;
+        const char *DATA;
+        std::vector<size_t> LINE;                       // offset of the first character of each non blank line
+};
+
+inline bool text_blank(char C){return C == ' ' or C == '\t' or C == '\r' or C == '\n';}
+
+// map NAME and index its non blank lines, prints the reason and returns false otherwise
+bool text_map(const char *NAME, TEXT_MAP &MAP){
+        struct stat INFO;
+        int FD = open(NAME, O_RDONLY);
+        MAP.DATA = NULL;
+        MAP.LINE.clear();
+        if(FD < 0 or fstat(FD, &INFO) != 0 or INFO.st_size == 0){
+                printf("BWARNING: cannot read text mesh %s\n", NAME);
+                if(FD >= 0){close(FD);}
+                return false;
+        }
+        MAP.SIZE = INFO.st_size;
+        void *DATA = mmap(NULL, MAP.SIZE, PROT_READ, MAP_PRIVATE, FD, 0);
+        close(FD);
+        if(DATA == MAP_FAILED){
+                printf("BWARNING: cannot map text mesh %s\n", NAME);
+                return false;
+        }
+        madvise(DATA, MAP.SIZE, MADV_SEQUENTIAL);
+        MAP.DATA = (const char*)DATA;
+
+        // chunk boundaries moved forward to the next line start, then count, offset and record line starts per chunk
+        int N_CHUNKS = omp_get_max_threads();
+        std::vector<size_t> START(N_CHUNKS + 1), COUNT(N_CHUNKS + 1, 0);
+        for(int c=0;c<N_CHUNKS;++c){
+                size_t S = MAP.SIZE*c/N_CHUNKS;
+                while(S > 0 and S < MAP.SIZE and MAP.DATA[S-1] != '\n'){S++;}
+                START[c] = S;
+        }
+        START[N_CHUNKS] = MAP.SIZE;
+
+        auto scan = [&](int c, size_t *OUT){
+                size_t N = 0;
+                for(size_t S=START[c]; S<START[c+1];){
+                        size_t E = S;
+                        bool BLANK = true;
+                        while(E < MAP.SIZE and MAP.DATA[E] != '\n'){BLANK = BLANK and text_blank(MAP.DATA[E]); E++;}
+                        if(not BLANK){
+                                if(OUT != NULL){OUT[N] = S;}
+                                N++;
+                        }
+                        S = E + 1;
+                }
+                return N;
+        };
+
+#pragma omp parallel for schedule(static,1)
+        for(int c=0;c<N_CHUNKS;++c){COUNT[c+1] = scan(c, NULL);}
+        for(int c=0;c<N_CHUNKS;++c){COUNT[c+1] += COUNT[c];}
+        MAP.LINE.resize(COUNT[N_CHUNKS]);
+#pragma omp parallel for schedule(static,1)
+        for(int c=0;c<N_CHUNKS;++c){scan(c, MAP.LINE.data() + COUNT[c]);}
+
+        return true;
+}
+
+void text_unmap(TEXT_MAP &MAP){
+        if(MAP.DATA != NULL){munmap((void*)MAP.DATA, MAP.SIZE);}
+        MAP.DATA = NULL;
+        MAP.LINE.clear();
+        MAP.LINE.shrink_to_fit();
+}
+
+// parse N numbers from line L (skipping the first SKIP tokens), false if the line is short or not numeric
+template<class T>
+bool text_line(const TEXT_MAP &MAP, size_t L, T *VALUES, int N, int SKIP = 0){
+        if(L >= MAP.LINE.size()){return false;}
+        const char *P = MAP.DATA + MAP.LINE[L], *END = MAP.DATA + MAP.SIZE;
+        for(int n=-SKIP;n<N;++n){
+                while(P < END and *P != '\n' and text_blank(*P)){P++;}
+                if(P == END or *P == '\n'){return false;}
+                if(n < 0){
+                        while(P < END and not text_blank(*P)){P++;}
+                        continue;
+                }
+                if(*P == '+'){P++;}                     // accepted by >> but not by from_chars
+                auto RESULT = std::from_chars(P, END, VALUES[n]);
+                if(RESULT.ec != std::errc()){return false;}
+                P = RESULT.ptr;
+        }
+        return true;
+}
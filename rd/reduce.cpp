@@ -0,0 +1,60 @@
+/*
+Deterministic reductions
+        Global sums are taken over fixed blocks of REDUCE_BLOCK consecutive values (compensated summation within a
+        block), and the block sums are combined in a fixed pairwise tree. The result depends only on the values and their
+        order, not on the number of threads, so conservation diagnostics are reproducible with and without PARA_UP.
+        Minima are exact in any order and use the same blocking only to run in parallel.
+*/
+
+#define REDUCE_BLOCK 512
+
+// pairwise sum of X[0] .. X[N-1] (fixed tree)
+double pairwise_sum(const double *X, int N){
+        if(N <= 8){
+                double SUM = 0.0;
+                for(int i=0;i<N;++i){SUM += X[i];}
+                return SUM;
+        }
+        int HALF = N/2;
+        return pairwise_sum(X, HALF) + pairwise_sum(X + HALF, N - HALF);
+}
+
+// sum of VALUE(i) for 0 <= i < N
+template<class F>
+double deterministic_sum(int N, F VALUE){
+        int N_BLOCKS = (N + REDUCE_BLOCK - 1)/REDUCE_BLOCK;
+        std::vector<double> BLOCK_SUM(N_BLOCKS);
+#ifdef PARA_UP
+        #pragma omp parallel for schedule(static)
+#endif
+        for(int B=0;B<N_BLOCKS;++B){
+                double SUM = 0.0, COMP = 0.0, Y, NEW_SUM;
+                int I_END = std::min(N, (B+1)*REDUCE_BLOCK);
+                for(int i=B*REDUCE_BLOCK;i<I_END;++i){
+                        Y       = VALUE(i) - COMP;
+                        NEW_SUM = SUM + Y;
+                        COMP    = (NEW_SUM - SUM) - Y;
+                        SUM     = NEW_SUM;
+                }
+                BLOCK_SUM[B] = SUM;
+        }
+        return pairwise_sum(BLOCK_SUM.data(), N_BLOCKS);
+}
+
+// minimum of VALUE(i) for 0 <= i < N, and of INITIAL
+template<class F>
+double deterministic_min(int N, double INITIAL, F VALUE){
+        int N_BLOCKS = (N + REDUCE_BLOCK - 1)/REDUCE_BLOCK;
+        std::vector<double> BLOCK_MIN(N_BLOCKS);
+#ifdef PARA_UP
+        #pragma omp parallel for schedule(static)
+#endif
+        for(int B=0;B<N_BLOCKS;++B){
+                double MIN = HUGE_VAL;
+                int I_END = std::min(N, (B+1)*REDUCE_BLOCK);
+                for(int i=B*REDUCE_BLOCK;i<I_END;++i){MIN = min_val(MIN, VALUE(i));}
+                BLOCK_MIN[B] = MIN;
+        }
+        for(int B=0;B<N_BLOCKS;++B){INITIAL = min_val(INITIAL, BLOCK_MIN[B]);}
+        return INITIAL;
+}
@@ -6,3 +6,5 @@
 
 # clang++ -I /home/morton/local/include  -L /home/morton/local/lib -lopenblas -o lairds main.cpp
 
+# MPI_RD: mpicxx -fopenmp -O3 main.cpp -o lairds -llapack -lblas && mpirun -np 4 ./lairds
+# GENERATE_IC or MOVING_MESH: (cd triangulation/cgal/lib && bash compile_lib.sh) && g++ -fopenmp -O3 main.cpp -o lairds -Ltriangulation/cgal/lib -lperiodic_delaunay -lgmp -lmpfr -llapack -lblas
@@ -14,3 +14,6 @@ clang++ -Xpreprocessor -fopenmp -lomp -O3 -I /usr/local/opt/openblas/include /us
 
 # cd ../../../exact_sod
 # python sod_plot_rd.py &
+
+# MPI_RD: mpicxx -fopenmp -O3 main3D.cpp -o lairds3D -llapack -lblas && mpirun -np 4 ./lairds3D
+# GENERATE_IC: (cd triangulation/cgal/lib && bash compile_lib.sh) && g++ -fopenmp -O3 main3D.cpp -o lairds3D -Ltriangulation/cgal/lib -lperiodic_delaunay -lgmp -lmpfr -llapack -lblas
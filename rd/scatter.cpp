@@ -0,0 +1,182 @@
+/*
+Thread private DU accumulation (DU_PRIVATE)
+        Alternative to atomics (DU_ATOMIC) for scattering the element residuals to the vertices under PARA_RES. Each
+        thread owns a fixed contiguous chunk of the triangle list and accumulates into a private buffer with one slot per
+        vertex its triangles touch (its partition plus halo), found for every triangle corner at setup. The buffers are
+        then summed per vertex in a second parallel pass, always in chunk order, so the result does not depend on the
+        scheduling.
+
+        The slots of all chunks together are at most one per triangle corner, so the memory does not grow with the thread
+        count and does not depend on how the vertices are numbered (a vertex ID range per chunk would cover nearly all
+        vertices on a mesh whose triangles are not ordered in space). du_private_setup builds the slots for a given mesh
+        and must be called again if it changes; du_private_touch updates them for a local change (edge flips and cavity
+        repairs, moving_mesh.cpp).
+*/
+
+#ifdef THREE_D
+#define DU_VARS 5
+#define DU_CORNERS 4
+#else
+#define DU_VARS 4
+#define DU_CORNERS 3
+#endif
+
+struct DU_PRIVATE_BUFFERS{
+        int N_CHUNKS, N_POINTS;
+        VERTEX *POINTS;
+        std::vector<int> J_START;                       // chunk C owns triangles J_START[C] <= j < J_START[C+1]
+        std::vector<int> SLOT;                          // buffer slot of each triangle corner, DU_CORNERS per triangle
+        std::vector< std::vector<int> > SLOT_ID;        // vertex ID of each slot of chunk C, sorted up to N_SORTED[C]
+        std::vector<int> N_SORTED;                      // slots from du_private_touch are appended after these
+        std::vector< std::vector<double> > DU;          // DU_VARS values per slot
+        std::vector<int> VERT_START;                    // slots holding vertex i: VERT_START[i] <= e < VERT_START[i+1],
+        std::vector<int> VERT_CHUNK, VERT_SLOT;         // in chunk order
+        bool STALE;                                     // slots appended since the vertex lists were built
+} DU_PRIVATE_BUF;
+
+inline VERTEX* du_corner(TRIANGLE &ELEM, int m){
+        switch(m){
+                case 0: return ELEM.get_vertex_0();
+                case 1: return ELEM.get_vertex_1();
+#ifdef THREE_D
+                case 2: return ELEM.get_vertex_2();
+                default: return ELEM.get_vertex_3();
+#else
+                default: return ELEM.get_vertex_2();
+#endif
+        }
+}
+
+// slot of vertex ID in chunk C, -1 if the chunk has none
+int du_private_find(int C, int ID){
+        DU_PRIVATE_BUFFERS &BUF = DU_PRIVATE_BUF;
+        std::vector<int> &IDS = BUF.SLOT_ID[C];
+        std::vector<int>::iterator AT = std::lower_bound(IDS.begin(), IDS.begin() + BUF.N_SORTED[C], ID);
+        if(AT != IDS.begin() + BUF.N_SORTED[C] and *AT == ID){return AT - IDS.begin();}
+        for(int s=BUF.N_SORTED[C];s<int(IDS.size());++s){if(IDS[s] == ID){return s;}}
+        return -1;
+}
+
+// per vertex lists of the slots holding it, filled chunk by chunk so each list is in chunk order
+void du_private_index(){
+        DU_PRIVATE_BUFFERS &BUF = DU_PRIVATE_BUF;
+        int C, s, i;
+
+        BUF.VERT_START.assign(BUF.N_POINTS + 1, 0);
+        for(C=0;C<BUF.N_CHUNKS;++C){
+                for(s=0;s<int(BUF.SLOT_ID[C].size());++s){BUF.VERT_START[BUF.SLOT_ID[C][s] + 1] += 1;}
+        }
+        for(i=0;i<BUF.N_POINTS;++i){BUF.VERT_START[i+1] += BUF.VERT_START[i];}
+
+        std::vector<int> NEXT(BUF.VERT_START.begin(), BUF.VERT_START.end() - 1);
+        BUF.VERT_CHUNK.resize(BUF.VERT_START[BUF.N_POINTS]);
+        BUF.VERT_SLOT.resize(BUF.VERT_START[BUF.N_POINTS]);
+        for(C=0;C<BUF.N_CHUNKS;++C){
+                for(s=0;s<int(BUF.SLOT_ID[C].size());++s){
+                        int e = NEXT[BUF.SLOT_ID[C][s]]++;
+                        BUF.VERT_CHUNK[e] = C;
+                        BUF.VERT_SLOT[e] = s;
+                }
+        }
+        BUF.STALE = false;
+}
+
+void du_private_setup(std::vector<TRIANGLE> &RAND_MESH, std::vector<VERTEX> &RAND_POINTS){
+        int C, N_TRIANG = RAND_MESH.size(), N_POINTS = RAND_POINTS.size();
+        DU_PRIVATE_BUFFERS &BUF = DU_PRIVATE_BUF;
+
+        BUF.N_CHUNKS = omp_get_max_threads();
+        BUF.N_POINTS = N_POINTS;
+        BUF.POINTS   = &RAND_POINTS[0];
+        BUF.J_START.resize(BUF.N_CHUNKS + 1);
+        BUF.SLOT.resize(DU_CORNERS*long(N_TRIANG));
+        BUF.SLOT_ID.resize(BUF.N_CHUNKS);
+        BUF.N_SORTED.resize(BUF.N_CHUNKS);
+        BUF.DU.resize(BUF.N_CHUNKS);
+
+        for(C=0;C<=BUF.N_CHUNKS;++C){BUF.J_START[C] = int((long(N_TRIANG)*C)/BUF.N_CHUNKS);}
+
+        // slots are found, and the buffers allocated and first touched, by the threads that use them
+#pragma omp parallel for schedule(static,1)
+        for(C=0;C<BUF.N_CHUNKS;++C){
+                std::vector<int> &IDS = BUF.SLOT_ID[C];
+                int j, m;
+
+                IDS.clear();
+                for(j=BUF.J_START[C];j<BUF.J_START[C+1];++j){
+                        for(m=0;m<DU_CORNERS;++m){IDS.push_back(du_corner(RAND_MESH[j], m)->get_id());}
+                }
+                std::sort(IDS.begin(), IDS.end());
+                IDS.erase(std::unique(IDS.begin(), IDS.end()), IDS.end());
+                BUF.N_SORTED[C] = IDS.size();
+
+                for(j=BUF.J_START[C];j<BUF.J_START[C+1];++j){
+                        for(m=0;m<DU_CORNERS;++m){
+                                int ID = du_corner(RAND_MESH[j], m)->get_id();
+                                BUF.SLOT[DU_CORNERS*long(j) + m] = std::lower_bound(IDS.begin(), IDS.end(), ID) - IDS.begin();
+                        }
+                }
+                BUF.DU[C].assign(DU_VARS*IDS.size(), 0.0);
+        }
+
+        du_private_index();
+}
+
+// slots of the corners of triangle j after its vertices changed (moving_mesh.cpp). A vertex new to the chunk gets a
+// slot appended, the per vertex lists are built again before the next residual pass.
+void du_private_touch(std::vector<TRIANGLE> &RAND_MESH, int j){
+        DU_PRIVATE_BUFFERS &BUF = DU_PRIVATE_BUF;
+        int C = std::upper_bound(BUF.J_START.begin(), BUF.J_START.end(), j) - BUF.J_START.begin() - 1;
+
+        for(int m=0;m<DU_CORNERS;++m){
+                int ID = du_corner(RAND_MESH[j], m)->get_id();
+                int s = du_private_find(C, ID);
+                if(s < 0){
+                        s = BUF.SLOT_ID[C].size();
+                        BUF.SLOT_ID[C].push_back(ID);
+                        BUF.DU[C].resize(DU_VARS*(s + 1), 0.0);                 // empty between residual passes
+                        BUF.STALE = true;
+                }
+                BUF.SLOT[DU_CORNERS*long(j) + m] = s;
+        }
+}
+
+// residual pass over the mesh (STAGE 1 = first half, 2 = second half). Triangles not due in TBIN_CURRENT only scatter
+// their stored DU, unless ALL is set.
+void du_private_update(int STAGE, bool ALL, int TBIN_CURRENT, double T, double DT, std::vector<TRIANGLE> &RAND_MESH){
+        DU_PRIVATE_BUFFERS &BUF = DU_PRIVATE_BUF;
+
+        if(BUF.STALE){du_private_index();}
+
+#pragma omp parallel
+        {
+                int C, i, k, e, j;
+
+                for(C=omp_get_thread_num();C<BUF.N_CHUNKS;C+=omp_get_num_threads()){
+                        double *DU = BUF.DU[C].data();
+                        for(j=BUF.J_START[C];j<BUF.J_START[C+1];++j){
+                                if(ALL or TBIN_CURRENT % RAND_MESH[j].get_tbin() == 0){
+                                        if(STAGE == 1){RAND_MESH[j].calculate_first_half(T,DT);}
+                                        else{RAND_MESH[j].calculate_second_half(T,DT);}
+                                }
+                                if(STAGE == 1){RAND_MESH[j].pass_update_half(DU, &BUF.SLOT[DU_CORNERS*long(j)]);}
+                                else{RAND_MESH[j].pass_update(DU, &BUF.SLOT[DU_CORNERS*long(j)]);}
+                        }
+                }
+
+#pragma omp barrier
+
+#pragma omp for schedule(static)
+                for(i=0;i<BUF.N_POINTS;++i){
+                        if(BUF.VERT_START[i] == BUF.VERT_START[i+1]){continue;}
+                        double SUM[DU_VARS];
+                        for(k=0;k<DU_VARS;++k){SUM[k] = 0.0;}
+                        for(e=BUF.VERT_START[i];e<BUF.VERT_START[i+1];++e){
+                                double *DU = &BUF.DU[BUF.VERT_CHUNK[e]][DU_VARS*BUF.VERT_SLOT[e]];
+                                for(k=0;k<DU_VARS;++k){SUM[k] += DU[k]; DU[k] = 0.0;}
+                        }
+                        if(STAGE == 1){BUF.POINTS[i].update_du_half(SUM);}
+                        else{BUF.POINTS[i].update_du(SUM);}
+                }
+        }
+}
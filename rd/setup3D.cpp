@@ -89,8 +89,11 @@ VERTEX setup_vertex(double X, double Y, double Z){
         if(R < R_BLAST){
                 // P = 1000000.0;
                 // P = 1000.0;
-                std::cout << POINT_CHECK << "\tSetting blast pressure point at\t" << X << "\t" << Y << "\t" << P << std::endl;
-                POINT_CHECK ++;
+#pragma omp critical
+                {
+                        std::cout << POINT_CHECK << "\tSetting blast pressure point at\t" << X << "\t" << Y << "\t" << P << std::endl;
+                        POINT_CHECK ++;
+                }
         }
 
         NEW_VERTEX.set_mass_density(RHO);                       // units kg/m^3
@@ -112,8 +115,11 @@ VERTEX setup_vertex(double X, double Y, double Z){
         if(R < R_BLAST){
                 // P = 1000000.0;
                 // P = 1000.0;
-                std::cout << POINT_CHECK << "\tSetting blast pressure point at\t" << X << "\t" << Y << "\t" << Z << "\t" << P << std::endl;
-                POINT_CHECK ++;
+#pragma omp critical
+                {
+                        std::cout << POINT_CHECK << "\tSetting blast pressure point at\t" << X << "\t" << Y << "\t" << Z << "\t" << P << std::endl;
+                        POINT_CHECK ++;
+                }
         }
 
         NEW_VERTEX.set_mass_density(RHO);                       // units kg/m^3
@@ -31,40 +31,83 @@ void plummer_gravity(std::vector<VERTEX> &MY_POINTS, double DT, int N_POINTS){
 #endif
 
 #ifdef SELF_GRAVITY
-void direct_gravity(std::vector<VERTEX> MY_POINTS, double DT, int N_POINTS){
-        double X0, X1, Y0, Y1, Z0, Z1, X_DIFF, Y_DIFF, Z_DIFF, AX, AY, AZ, MASS, MASS_DENSITY, DU[5];
+void direct_gravity(std::vector<VERTEX> &MY_POINTS, std::vector<int> &ACTIVE, int N_POINTS){
+        // acceleration of each active vertex summed over all other vertices, applied once over its source step
+        double X0, Y0, Z0, X_DIFF, Y_DIFF, Z_DIFF, R, AX, AY, AZ, MASS_DENSITY, DU[5];
         DU[0] = DU[4] = 0.0;
-        for(int i=0; i<N_POINTS; ++i){
+        for(int a=0; a<int(ACTIVE.size()); ++a){
+                int i = ACTIVE[a];
+                double DT = MY_POINTS[i].get_dt_src();
                 X0 = MY_POINTS[i].get_x();
                 Y0 = MY_POINTS[i].get_y();
                 Z0 = MY_POINTS[i].get_z();
-                MASS = MY_POINTS[i].get_mass();
+                MASS_DENSITY = MY_POINTS[i].get_mass_density();
+                AX = AY = AZ = 0.0;
                 for(int j=0; j<N_POINTS; ++j){
                         if(j!=i){
-                                X1 = MY_POINTS[j].get_x();
-                                Y1 = MY_POINTS[j].get_y();
-                                Z1 = MY_POINTS[j].get_z();
-                                X_DIFF = X1 - X0;
-                                Y_DIFF = Y1 - Y0;
-                                Z_DIFF = Z1 - Z0;
-                                AX = AX - GRAV * MASS * X_DIFF/pow((sqrt(X_DIFF*X_DIFF + Y_DIFF*Y_DIFF + Z_DIFF*Z_DIFF)),3);
-                                AY = AY - GRAV * MASS * Y_DIFF/pow((sqrt(X_DIFF*X_DIFF + Y_DIFF*Y_DIFF + Z_DIFF*Z_DIFF)),3);
-                                AZ = AZ - GRAV * MASS * Z_DIFF/pow((sqrt(X_DIFF*X_DIFF + Y_DIFF*Y_DIFF + Z_DIFF*Z_DIFF)),3);
-                                DU[1] = -1.0*AX*DT*MASS_DENSITY;
-                                DU[2] = -1.0*AY*DT*MASS_DENSITY;
-                                DU[3] = -1.0*AZ*DT*MASS_DENSITY;
-                                MY_POINTS[i].update_du(DU);
+                                X_DIFF = MY_POINTS[j].get_x() - X0;
+                                Y_DIFF = MY_POINTS[j].get_y() - Y0;
+                                Z_DIFF = MY_POINTS[j].get_z() - Z0;
+                                R = sqrt(X_DIFF*X_DIFF + Y_DIFF*Y_DIFF + Z_DIFF*Z_DIFF);
+                                AX += GRAV * MY_POINTS[j].get_mass() * X_DIFF/(R*R*R);
+                                AY += GRAV * MY_POINTS[j].get_mass() * Y_DIFF/(R*R*R);
+                                AZ += GRAV * MY_POINTS[j].get_mass() * Z_DIFF/(R*R*R);
                         }
                 }
+                DU[1] = -1.0*AX*DT*MASS_DENSITY;                        // 3D update subtracts DU
+                DU[2] = -1.0*AY*DT*MASS_DENSITY;
+                DU[3] = -1.0*AZ*DT*MASS_DENSITY;
+                MY_POINTS[i].update_du(DU);
+        }
+}
+#endif
+
+#ifdef COOLING
+void radiative_cooling(std::vector<VERTEX> &MY_POINTS, std::vector<int> &ACTIVE){
+        // Exact (Townsend) integration of the cooling at fixed density over the time since each vertex was last cooled,
+        // in blocks of COOL_BLOCK active vertices
+        int N_ACTIVE = ACTIVE.size();
+#ifdef PARA_UP
+        #pragma omp parallel for
+#endif
+        for(int B=0; B<N_ACTIVE; B+=COOL_BLOCK){
+                int i, N_BLOCK = (N_ACTIVE - B < COOL_BLOCK) ? N_ACTIVE - B : COOL_BLOCK;
+                double RHO[COOL_BLOCK], E_INT[COOL_BLOCK], E_NEW[COOL_BLOCK], DT[COOL_BLOCK], DU[5];
+
+                for(i=0;i<N_BLOCK;++i){
+                        RHO[i]   = MY_POINTS[ACTIVE[B+i]].get_mass_density();
+                        E_INT[i] = MY_POINTS[ACTIVE[B+i]].get_internal_energy();
+                        DT[i]    = MY_POINTS[ACTIVE[B+i]].get_dt_src();
+                }
+
+                cooling_table::batch_cool(N_BLOCK, RHO, E_INT, DT, E_NEW);
+
+                DU[0] = DU[1] = DU[2] = DU[3] = 0.0;
+                for(i=0;i<N_BLOCK;++i){
+                        DU[4] = -1.0*RHO[i]*(E_NEW[i] - E_INT[i]);      // 3D update subtracts DU
+                        MY_POINTS[ACTIVE[B+i]].update_du(DU);
+                }
         }
+        return ;
 }
 #endif
 
-void sources(std::vector<VERTEX> &MY_POINTS, double DT, int N_POINTS){
+void sources(std::vector<VERTEX> &MY_POINTS, double DT, int N_POINTS, [[maybe_unused]] int SBIN_CURRENT){
+        // cheap sources every step with the step (kick) length
 #ifdef ANALYTIC_GRAVITY
         plummer_gravity(MY_POINTS, DT, N_POINTS);
 #endif
+
+        // expensive sources only at vertices due in their source bin (see source_bins.cpp)
+#if defined(SELF_GRAVITY) || defined(COOLING)
+        std::vector<int> ACTIVE;
+        active_sources(SBIN_CURRENT, DT, N_POINTS, MY_POINTS, ACTIVE);
 #ifdef SELF_GRAVITY
-        direct_gravity(MY_POINTS, DT, N_POINTS);
+        direct_gravity(MY_POINTS, ACTIVE, N_POINTS);
+#endif
+#ifdef COOLING
+        radiative_cooling(MY_POINTS, ACTIVE);
 #endif
-}
\ No newline at end of file
+        for(int a=0; a<int(ACTIVE.size()); ++a){MY_POINTS[ACTIVE[a]].reset_dt_src();}
+#endif
+}
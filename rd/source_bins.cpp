@@ -0,0 +1,43 @@
+/*
+Source term scheduler
+        Vertices are binned for the source terms independently of the triangle time bins. Cheap sources are applied
+        every step with the step length, expensive sources (SELF_GRAVITY, COOLING) only to vertices whose source bin is
+        due, over the time elapsed since their last evaluation (DT_SRC). Bins are powers of 2 up to MAX_SBIN and are
+        reset when SBIN_CURRENT == 0, where every vertex is due.
+*/
+
+// timescale on which the expensive sources change the state at a vertex
+double source_timescale([[maybe_unused]] VERTEX &MY_VERTEX){
+        double T_SRC = HUGE_VAL;
+#ifdef COOLING
+        T_SRC = min_val(T_SRC, cooling_table::cooling_time(MY_VERTEX.get_mass_density(), MY_VERTEX.get_internal_energy()));
+#endif
+#ifdef SELF_GRAVITY
+        T_SRC = min_val(T_SRC, 1.0/sqrt(GRAV*MY_VERTEX.get_mass_density()));
+#endif
+        return T_SRC;
+}
+
+// bin vertices by the number of steps of length DT they can go without evaluating the expensive sources
+void reset_sbins(double DT, int N_POINTS, std::vector<VERTEX> &RAND_POINTS){
+        int SBIN;
+        double T_SRC;
+#ifdef PARA_UP
+        #pragma omp parallel for private(SBIN, T_SRC)
+#endif
+        for(int i=0;i<N_POINTS;++i){
+                T_SRC = SOURCE_ACC * source_timescale(RAND_POINTS[i]);
+                SBIN  = 1;
+                while(2*SBIN <= MAX_SBIN and 2*SBIN*DT <= T_SRC){SBIN = 2*SBIN;}
+                RAND_POINTS[i].set_sbin(SBIN);
+        }
+}
+
+// add the kick length DT to every vertex and list the vertices whose source bin is due
+void active_sources(int SBIN_CURRENT, double DT, int N_POINTS, std::vector<VERTEX> &RAND_POINTS, std::vector<int> &ACTIVE){
+        ACTIVE.clear();
+        for(int i=0;i<N_POINTS;++i){
+                RAND_POINTS[i].add_dt_src(DT);
+                if(SBIN_CURRENT % RAND_POINTS[i].get_sbin() == 0){ACTIVE.push_back(i);}
+        }
+}
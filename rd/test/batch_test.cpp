@@ -0,0 +1,152 @@
+// Checks of the batched first half residual kernel (batch2D.cpp, BATCH_RESIDUAL) against the scalar
+// TRIANGLE::calculate_first_half on a jittered periodic mesh with a smooth random state: the half step states of every
+// vertex agree to round-off, also for the remainder triangles that do not fill a batch. Blended scheme by default, add
+// -DN_SCHEME or -DLDA_SCHEME for the others. Exits 1 on any failure.
+//
+// g++ -O2 -fopenmp batch_test.cpp -o batch_test -llapacke -llapack -lblas && ./batch_test
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <omp.h>
+
+// configuration in place of constants.h
+#define TWO_D
+#define PERIODIC_BOUNDARY
+#define BATCH_RESIDUAL
+#define BATCH_LANES 4
+#if !defined(LDA_SCHEME) && !defined(N_SCHEME)
+#define BLENDED
+#endif
+double GAMMA = 5.0/3.0;
+double GAMMA_1 = GAMMA - 1.0;
+double GAMMA_2 = GAMMA - 2.0;
+double SIDE_LENGTH_X = 10.0;
+double SIDE_LENGTH_Y = 10.0;
+double CFL = 0.5;
+int MAX_TBIN = 1;
+double M_LIM = 0.0001;
+double E_LIM = 0.0001;
+std::string LOG_DIR = "batch_test_log.txt";
+
+#include "../../common/physics.h"
+#include "cblas.h"
+#include "lapacke.h"
+#include "../inverse.cpp"
+#include "../base.cpp"
+#include "../geometry.h"
+#include "../characteristic.cpp"
+#include "../vertex2D.h"
+#include "../triangle2D.h"
+#include "../batch2D.cpp"
+
+const int N_SIDE = 13;                                  // 2*13*13 triangles, not a multiple of BATCH_LANES
+
+bool PASS = true;
+
+void check(bool OK, std::string WHAT){
+        printf("%s: %s\n", OK ? "pass" : "FAIL", WHAT.c_str());
+        PASS = PASS and OK;
+}
+
+double jitter(int I, int K){return 0.3*sin(12.9898*I + 78.233*K);}
+
+// jittered N_SIDE x N_SIDE periodic grid, two counter-clockwise triangles per cell
+void build_mesh(std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        double H = SIDE_LENGTH_X/N_SIDE;
+        POINTS.resize(N_SIDE*N_SIDE);
+        for(int i=0;i<N_SIDE;++i){
+                for(int j=0;j<N_SIDE;++j){
+                        int I = i*N_SIDE + j;
+                        double X = (i + 0.5 + jitter(I, 0))*H, Y = (j + 0.5 + jitter(I, 1))*H;
+                        VERTEX &V = POINTS[I];
+                        V.set_x(X);
+                        V.set_y(Y);
+                        V.set_dual(0.0);
+                        V.set_mass_density(1.0 + 0.5*sin(0.7*X + 0.3*Y) + 0.2*jitter(I, 2));
+                        V.set_x_velocity(0.8*cos(0.5*Y) + 0.3*jitter(I, 3));
+                        V.set_y_velocity(-0.6*sin(0.4*X) + 0.3*jitter(I, 4));
+                        V.set_pressure(1.0 + 0.4*cos(0.6*X - 0.2*Y) + 0.2*jitter(I, 5));
+                        V.setup_specific_energy();
+                        V.prim_to_con();
+                        V.set_id(I);
+                }
+        }
+
+        MESH.resize(2*N_SIDE*N_SIDE);
+        for(int i=0;i<N_SIDE;++i){
+                for(int j=0;j<N_SIDE;++j){
+                        int I1 = (i+1)%N_SIDE, J1 = (j+1)%N_SIDE;
+                        int CORNER[4] = {i*N_SIDE + j, I1*N_SIDE + j, I1*N_SIDE + J1, i*N_SIDE + J1};
+                        int SHIFT[4]  = {0, I1 == 0 ? 1 : 0, (I1 == 0 ? 1 : 0) | (J1 == 0 ? 2 : 0), J1 == 0 ? 2 : 0};
+                        int TRI[2][3] = {{0, 1, 2}, {0, 2, 3}};
+                        for(int t=0;t<2;++t){
+                                TRIANGLE &E = MESH[2*(i*N_SIDE + j) + t];
+                                E.set_vertex_0(&POINTS[CORNER[TRI[t][0]]]);
+                                E.set_vertex_1(&POINTS[CORNER[TRI[t][1]]]);
+                                E.set_vertex_2(&POINTS[CORNER[TRI[t][2]]]);
+                                int BOUNDARY = 0;
+                                for(int m=0;m<3;++m){
+                                        E.set_shift(m, SHIFT[TRI[t][m]]);
+                                        if(SHIFT[TRI[t][m]] != 0){BOUNDARY = 1;}
+                                }
+                                E.set_boundary(BOUNDARY);
+                                E.set_id(2*(i*N_SIDE + j) + t);
+                                E.set_tbin(1);
+                        }
+                }
+        }
+        setup_geometry(MESH);
+}
+
+// half step states of all vertices after the first half residual from BATCHED or scalar kernels
+std::vector<double> half_states(bool BATCHED, double DT){
+        std::vector<VERTEX> POINTS;
+        std::vector<TRIANGLE> MESH;
+        build_mesh(POINTS, MESH);
+        int N_TRIANG = MESH.size();
+
+        for(auto &V : POINTS){V.reset_du_half();}
+        if(BATCHED){
+                std::vector<TRIANGLE*> LIST(N_TRIANG);
+                for(int j=0;j<N_TRIANG;++j){LIST[j] = &MESH[j];}
+                calculate_first_half_list(LIST, 0.0, DT);
+        }else{
+                for(int j=0;j<N_TRIANG;++j){MESH[j].calculate_first_half(0.0, DT);}
+        }
+        for(int j=0;j<N_TRIANG;++j){MESH[j].pass_update_half();}
+
+        std::vector<double> STATE;
+        for(auto &V : POINTS){
+                V.update_u_half();
+                STATE.push_back(V.get_u0_half());
+                STATE.push_back(V.get_u1_half());
+                STATE.push_back(V.get_u2_half());
+                STATE.push_back(V.get_u3_half());
+        }
+        return STATE;
+}
+
+int main(){
+        double DT = 0.02;
+        std::vector<double> SCALAR = half_states(false, DT), BATCHED = half_states(true, DT);
+
+        double ERR = 0.0, CHANGE = 0.0;
+        std::vector<VERTEX> POINTS;
+        std::vector<TRIANGLE> MESH;
+        build_mesh(POINTS, MESH);
+        for(size_t i=0;i<SCALAR.size();++i){ERR = fmax(ERR, fabs(BATCHED[i] - SCALAR[i])/fmax(1.0, fabs(SCALAR[i])));}
+        for(size_t i=0;i<POINTS.size();++i){CHANGE = fmax(CHANGE, fabs(SCALAR[4*i] - POINTS[i].get_u0()));}
+        printf("%d triangles in batches of %d: largest relative difference %g, largest density change %g\n", int(MESH.size()), BATCH_LANES, ERR, CHANGE);
+
+        check(CHANGE > 1e-4, "the residual changes the state");
+        check(ERR < 1e-12, "batched and scalar half step states agree");
+        check(N_SINGULAR == 0, "no singular elements");
+
+        printf("%s\n", PASS ? "PASS" : "FAIL");
+        return PASS ? 0 : 1;
+}
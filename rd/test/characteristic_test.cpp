@@ -0,0 +1,160 @@
+// Checks of the characteristic N/LDA distribution (characteristic.cpp) for an ideal gas against a LAPACK reference in
+// conserved variables: K+_m = R diag(max(lambda,0)) R^-1 from dgeev of the flux Jacobian, BETA_m = K+_m (sum K+)^-1 and
+// FLUC_N_m = K+_m (U_m - U_IN) with the inverse from mat_inv (dgetrf/dgetri). A subsonic and a supersonic state are
+// checked on a triangle (2D) and a tetrahedron (3D). Exits 1 on any failure.
+//
+// g++ -O2 characteristic_test.cpp -o characteristic_test -llapacke -llapack -lblas && ./characteristic_test
+
+#include <iostream>
+#include <cmath>
+#include <string>
+
+#include "cblas.h"
+#include "lapacke.h"
+
+#define GAMMA 1.4
+#define GAMMA_1 (GAMMA - 1.0)
+
+double max_val(double A, double B){return A > B ? A : B;}
+
+#include "../inverse.cpp"
+#include "../characteristic.cpp"
+
+bool PASS = true;
+
+void check(bool OK, std::string WHAT){
+        printf("%s: %s\n", OK ? "pass" : "FAIL", WHAT.c_str());
+        PASS = PASS and OK;
+}
+
+// K+ = WEIGHT*(A.n)+ of the ideal gas flux Jacobian at density RHO, velocity VEL, enthalpy H, from its eigenvectors
+template<int D>
+void k_plus(double RHO, const double VEL[D], double H, double WEIGHT, const double NORMAL[D], double KP[D+2][D+2]){
+        const int NQ = D+2;
+        double K[NQ][NQ], K_COL[NQ*NQ], WR[NQ], WI[NQ], VR[NQ*NQ], R[NQ][NQ], R_INV[NQ][NQ], Q2 = 0.0, W = 0.0;
+        for(int k=0;k<D;++k){Q2 += VEL[k]*VEL[k]; W += VEL[k]*NORMAL[k];}
+
+        K[0][0] = 0.0;
+        K[0][NQ-1] = 0.0;
+        K[NQ-1][0] = W*(0.5*GAMMA_1*Q2 - H);
+        K[NQ-1][NQ-1] = GAMMA*W;
+        for(int i=0;i<D;++i){
+                K[0][1+i] = NORMAL[i];
+                K[1+i][0] = 0.5*GAMMA_1*Q2*NORMAL[i] - VEL[i]*W;
+                K[1+i][NQ-1] = GAMMA_1*NORMAL[i];
+                K[NQ-1][1+i] = H*NORMAL[i] - GAMMA_1*W*VEL[i];
+                for(int j=0;j<D;++j){K[1+i][1+j] = VEL[i]*NORMAL[j] - GAMMA_1*NORMAL[i]*VEL[j] + (i==j ? W : 0.0);}
+        }
+
+        for(int i=0;i<NQ;++i){for(int j=0;j<NQ;++j){K_COL[i + j*NQ] = WEIGHT*K[i][j];}}
+        LAPACKE_dgeev(LAPACK_COL_MAJOR, 'N', 'V', NQ, K_COL, NQ, WR, WI, NULL, 1, VR, NQ);
+        for(int i=0;i<NQ;++i){for(int j=0;j<NQ;++j){R[i][j] = R_INV[i][j] = VR[i + j*NQ];}}
+        mat_inv(&R_INV[0][0], NQ, 0.0, 0.0, 0, 0);
+
+        for(int i=0;i<NQ;++i){
+                for(int j=0;j<NQ;++j){
+                        KP[i][j] = 0.0;
+                        for(int k=0;k<NQ;++k){KP[i][j] += R[i][k]*max_val(0.0, WR[k])*R_INV[k][j];}
+                }
+        }
+}
+
+// compare FLUC_N, FLUC_LDA and BETA from characteristic_distribution with the conserved variable reference
+template<int D>
+void compare(std::string NAME, double RHO, const double VEL[D], double P, const double X[D+1][D]){
+        const int NV = D+1, NQ = D+2;
+        double H, Q2 = 0.0, Z_BAR[NQ], LIN[3], WEIGHT[NV], NORMAL[NV][D], W_HAT[NQ][NV], PHI[NQ];
+        for(int k=0;k<D;++k){Q2 += VEL[k]*VEL[k];}
+        H = GAMMA*P/(GAMMA_1*RHO) + 0.5*Q2;
+
+        Z_BAR[0] = sqrt(RHO);
+        for(int k=0;k<D;++k){Z_BAR[1+k] = sqrt(RHO)*VEL[k];}
+        Z_BAR[NQ-1] = sqrt(RHO)*H;
+        LIN[0] = sqrt(GAMMA*P/RHO);
+        LIN[1] = 0.5*GAMMA_1*Q2;
+        LIN[2] = GAMMA_1;
+
+        // inward unit normal of the face opposite each vertex, WEIGHT = face measure / D
+        for(int m=0;m<NV;++m){
+                double N[D], MAG = 0.0, DOT = 0.0;
+                if constexpr(D == 2){
+                        int A = (m+1)%3, B = (m+2)%3;
+                        N[0] = X[B][1] - X[A][1];
+                        N[1] = X[A][0] - X[B][0];
+                }else{
+                        int F[3], f = 0;
+                        for(int a=0;a<NV;++a){if(a != m){F[f++] = a;}}
+                        double U[3], V[3];
+                        for(int k=0;k<3;++k){U[k] = X[F[1]][k] - X[F[0]][k]; V[k] = X[F[2]][k] - X[F[0]][k];}
+                        N[0] = U[1]*V[2] - U[2]*V[1];
+                        N[1] = U[2]*V[0] - U[0]*V[2];
+                        N[2] = U[0]*V[1] - U[1]*V[0];
+                }
+                for(int k=0;k<D;++k){MAG += N[k]*N[k]; DOT += N[k]*(X[m][k] - X[(m+1)%NV][k]);}
+                MAG = sqrt(MAG);
+                for(int k=0;k<D;++k){NORMAL[m][k] = (DOT > 0.0 ? 1.0 : -1.0)*N[k]/MAG;}
+                WEIGHT[m] = (D == 2 ? MAG : 0.5*MAG)/D;
+        }
+
+        for(int i=0;i<NQ;++i){
+                PHI[i] = 0.3*sin(1.0 + i);
+                for(int m=0;m<NV;++m){W_HAT[i][m] = cos(1.0 + i + 2.0*m);}
+        }
+
+        double FLUC_N[NQ][NV], FLUC_LDA[NQ][NV], BETA[NQ][NQ][NV];
+        characteristic_distribution<D>(Z_BAR, LIN, WEIGHT, NORMAL, W_HAT, PHI, FLUC_N, FLUC_LDA, BETA);
+
+        // reference in conserved variables
+        double KP[NV][NQ][NQ], SUM_KP[NQ][NQ] = {}, R[NQ] = {}, U_IN[NQ], ERR_N = 0.0, ERR_LDA = 0.0, ERR_BETA = 0.0, SCALE = 0.0;
+        for(int m=0;m<NV;++m){
+                k_plus<D>(RHO, VEL, H, WEIGHT[m], NORMAL[m], KP[m]);
+                for(int i=0;i<NQ;++i){
+                        for(int j=0;j<NQ;++j){
+                                SUM_KP[i][j] += KP[m][i][j];
+                                R[i] += KP[m][i][j]*W_HAT[j][m];
+                        }
+                }
+        }
+        for(int i=0;i<NQ;++i){R[i] -= PHI[i];}
+        check(mat_inv(&SUM_KP[0][0], NQ, 0.0, 0.0, 0, 0) == 0, NAME + ": sum K+ is regular");
+        for(int i=0;i<NQ;++i){
+                U_IN[i] = 0.0;
+                for(int j=0;j<NQ;++j){U_IN[i] += SUM_KP[i][j]*R[j];}
+        }
+
+        for(int m=0;m<NV;++m){
+                for(int i=0;i<NQ;++i){
+                        double N_REF = 0.0, LDA_REF = 0.0;
+                        for(int j=0;j<NQ;++j){
+                                double BETA_REF = 0.0;
+                                for(int k=0;k<NQ;++k){BETA_REF += KP[m][i][k]*SUM_KP[k][j];}
+                                N_REF   += KP[m][i][j]*(W_HAT[j][m] - U_IN[j]);
+                                LDA_REF += BETA_REF*PHI[j];
+                                ERR_BETA = fmax(ERR_BETA, fabs(BETA[i][j][m] - BETA_REF));
+                                SCALE    = fmax(SCALE, fabs(BETA_REF));
+                        }
+                        ERR_N   = fmax(ERR_N, fabs(FLUC_N[i][m] - N_REF));
+                        ERR_LDA = fmax(ERR_LDA, fabs(FLUC_LDA[i][m] - LDA_REF));
+                        SCALE   = fmax(SCALE, fmax(fabs(N_REF), fabs(LDA_REF)));
+                }
+        }
+        printf("%s: max error N %g, LDA %g, BETA %g (scale %g)\n", NAME.c_str(), ERR_N, ERR_LDA, ERR_BETA, SCALE);
+        check(ERR_N < 1e-10*SCALE, NAME + ": N fluctuations match LAPACK");
+        check(ERR_LDA < 1e-10*SCALE, NAME + ": LDA fluctuations match LAPACK");
+        check(ERR_BETA < 1e-10*SCALE, NAME + ": LDA distribution matrices match LAPACK");
+}
+
+int main(){
+        double X2[3][2] = {{0.0, 0.0}, {1.0, 0.1}, {0.3, 0.9}};
+        double X3[4][3] = {{0.0, 0.0, 0.0}, {1.0, 0.1, 0.0}, {0.2, 0.9, 0.1}, {0.3, 0.2, 0.8}};
+        double V2_SUB[2] = {0.3, -0.2}, V2_SUP[2] = {2.0, 1.1};
+        double V3_SUB[3] = {0.3, -0.2, 0.1}, V3_SUP[3] = {2.0, 1.1, -0.7};
+
+        compare<2>("2D subsonic", 1.3, V2_SUB, 0.8, X2);
+        compare<2>("2D supersonic", 0.7, V2_SUP, 0.5, X2);
+        compare<3>("3D subsonic", 1.3, V3_SUB, 0.8, X3);
+        compare<3>("3D supersonic", 0.7, V3_SUP, 0.5, X3);
+
+        printf("%s\n", PASS ? "PASS" : "FAIL");
+        return PASS ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+// Checks of the cooling table and the exact cooling integrator (common/cooling.h): a file without a trailing newline
+// loads and a truncated one does not, a flat LAMBDA cools linearly and LAMBDA = T exponentially (the log branch),
+// across table segments and down to the first node, and zero, negative and NaN energies are left alone. Exits 1 on
+// any failure.
+//
+// g++ -O2 cooling_test.cpp -o cooling_test && ./cooling_test
+
+#include <math.h>
+#include <stdio.h>
+#include <fstream>
+#include <iomanip>
+#include <string>
+
+#define PHYSICS_SIMD
+double COOL_T_UNIT    = 1.0;
+double COOL_RATE_UNIT = 1.0;
+
+#include "../../common/cooling.h"
+
+bool PASS = true;
+
+void check(bool OK, std::string WHAT){
+        printf("%s: %s\n", OK ? "pass" : "FAIL", WHAT.c_str());
+        PASS = PASS and OK;
+}
+
+bool close(double A, double B, double TOL){
+        return fabs(A - B) <= TOL*fabs(B);
+}
+
+// 5 nodes over T in [1, 1e4] written without the final newline, LAMBDA = T^SLOPE, TRUNCATE drops the last node
+void write_table(std::string NAME, double SLOPE, bool TRUNCATE){
+        std::ofstream FILE(NAME);
+        FILE << std::setprecision(17) << 5 << "\n" << 0 << " " << 4;
+        for(int k=0; k<(TRUNCATE ? 4 : 5); ++k){FILE << "\n" << pow(10.0, SLOPE*k);}
+}
+
+double cool(double RHO, double E_INT, double DT){
+        double E_NEW;
+        cooling_table::batch_cool(1, &RHO, &E_INT, &DT, &E_NEW);
+        return E_NEW;
+}
+
+int main(){
+        write_table("cooling_test.txt", 0.0, true);
+        check(!cooling_table::load("cooling_test.txt"), "truncated table is rejected");
+        write_table("cooling_test.txt", 0.0, false);
+        check(cooling_table::load("cooling_test.txt"), "table without a trailing newline loads");
+
+        // du/dt = -rho
+        check(close(cool(2.0, 100.0, 10.0), 80.0, 1e-12), "flat LAMBDA cools linearly");
+        check(close(cool(2.0, 5000.0, 1000.0), 3000.0, 1e-12), "flat LAMBDA cools linearly across segments");
+        check(close(cool(2.0, 20000.0, 4000.0), 12000.0, 1e-12), "flat LAMBDA cools linearly above the table");
+        check(cool(2.0, 100.0, 1e6) == 1.0, "cooling stops at the first node");
+        check(close(cooling_table::cooling_time(2.0, 100.0), 50.0, 1e-12), "cooling time");
+
+        check(cool(2.0, 0.5, 10.0) == 0.5, "energy below the table is not cooled");
+        check(cool(2.0, 0.0, 10.0) == 0.0, "zero energy is not cooled");
+        check(cool(2.0, -1.0, 10.0) == -1.0, "negative energy is not cooled");
+        check(std::isnan(cool(2.0, NAN, 10.0)), "NaN energy is passed through");
+        check(cooling_table::cooling_time(2.0, -1.0) == HUGE_VAL and cooling_table::cooling_time(2.0, NAN) == HUGE_VAL, "no cooling time below the table");
+
+        // du/dt = -rho u
+        write_table("cooling_test.txt", 1.0, false);
+        check(cooling_table::load("cooling_test.txt"), "power law table loads");
+        check(close(cool(1.0, 100.0, 0.5), 100.0*exp(-0.5), 1e-10), "LAMBDA = T cools exponentially");
+        check(close(cool(1.0, 5000.0, 3.0), 5000.0*exp(-3.0), 1e-10), "LAMBDA = T cools exponentially across segments");
+
+        remove("cooling_test.txt");
+        printf("%s\n", PASS ? "PASS" : "FAIL");
+        return PASS ? 0 : 1;
+}
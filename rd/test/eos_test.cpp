@@ -0,0 +1,78 @@
+// Checks of the tabulated EOS (common/eos.h, EOS_TABLE): a file without a trailing newline loads and a truncated one
+// does not, an ideal gas table (GAMMA = 5/3) reproduces the ideal gas and its Roe linearisation, and lookups at zero,
+// negative and NaN states are clamped to the first node of a table whose c^2/e differs at every node. Exits 1 on any
+// failure.
+//
+// g++ -O2 eos_test.cpp -o eos_test && ./eos_test
+
+#include <math.h>
+#include <stdio.h>
+#include <fstream>
+#include <iomanip>
+#include <string>
+
+#define EOS_TABLE
+double GAMMA = 5.0/3.0;
+
+#include "../../common/eos.h"
+
+const int N = 8;
+bool PASS = true;
+
+void check(bool OK, std::string WHAT){
+        printf("%s: %s\n", OK ? "pass" : "FAIL", WHAT.c_str());
+        PASS = PASS and OK;
+}
+
+// table over rho, e_int in [1e-8, 1e8] written without the final newline, c^2/e = GAMMA (GAMMA-1) or (node index + 1)
+// with LABEL, TRUNCATE drops the last node
+void write_table(std::string NAME, bool LABEL, bool TRUNCATE){
+        std::ofstream FILE(NAME);
+        FILE << std::setprecision(17) << N << " " << N << "\n" << -8 << " " << 8 << " " << -8 << " " << 8;
+        for(int i=0; i<N; ++i){
+                for(int j=0; j<N; ++j){
+                        if(TRUNCATE and i == N-1 and j == N-1){continue;}
+                        double RHO = pow(10.0, -8.0 + 16.0*i/(N-1)), E_INT = pow(10.0, -8.0 + 16.0*j/(N-1));
+                        double C_RATIO = LABEL ? i*N + j + 1.0 : GAMMA*(GAMMA-1.0);
+                        FILE << "\n" << (GAMMA-1.0)*RHO*E_INT << " " << C_RATIO*E_INT;
+                }
+        }
+}
+
+bool close(double A, double B, double TOL){
+        return fabs(A - B) <= TOL*fabs(B);
+}
+
+int main(){
+        write_table("eos_test_cut.txt", false, true);
+        check(!eos_table::load("eos_test_cut.txt"), "truncated table is rejected");
+        check(!eos_table::load("eos_test_missing.txt"), "missing table is rejected");
+        write_table("eos_test.txt", false, false);
+        check(eos_table::load("eos_test.txt"), "table without a trailing newline loads");
+
+        double P = eos_table::pressure(2.5, 3.5);
+        check(close(P, (GAMMA-1.0)*2.5*3.5, 1e-12), "interior pressure is the ideal gas pressure");
+        check(close(eos_table::sound_speed_sq(2.5, 3.5, P), GAMMA*P/2.5, 1e-12), "interior sound speed is the ideal gas sound speed");
+
+        double ALPHA, KAPPA, C_SQ;
+        double RHO = 2.0, E_INT = 3.0, VEL_SQ_SUM = 0.5, H = GAMMA*E_INT + 0.5*VEL_SQ_SUM;
+        eos_linearise(RHO, E_INT, H, VEL_SQ_SUM, ALPHA, KAPPA, C_SQ);
+        check(close(KAPPA, GAMMA-1.0, 1e-6) and close(ALPHA, 0.5*(GAMMA-1.0)*VEL_SQ_SUM, 1e-6), "linearisation matches the ideal gas");
+        check(close(C_SQ, GAMMA*(GAMMA-1.0)*E_INT, 1e-6), "linearised sound speed matches the ideal gas");
+
+        // states the solvers can produce after the floors or a bad half step, all looked up at node 0 (c^2/e = 1)
+        write_table("eos_test.txt", true, false);
+        check(eos_table::load("eos_test.txt"), "labelled table loads");
+        check(eos_table::sound_speed_sq(0.0, 1e-8, 0.0) == 1e-8, "lookup at rho = 0 uses the first node");
+        check(eos_table::sound_speed_sq(-1.0, 1e-8, 0.0) == 1e-8, "lookup at rho = -1 uses the first node");
+        check(eos_table::sound_speed_sq(NAN, 1e-8, 0.0) == 1e-8, "lookup at rho = NaN uses the first node");
+        check(eos_table::sound_speed_sq(1e-8, -1.0, 0.0) == -1.0, "lookup at e = -1 uses the first node");
+        check(eos_table::sound_speed_sq(1e-8, 0.0, 0.0) == 0.0, "lookup at e = 0 stays in the table");
+        check(std::isnan(eos_table::sound_speed_sq(NAN, NAN, 0.0)), "lookup at rho = e = NaN stays in the table");
+        check(close(eos_table::sound_speed_sq(1e9, 1e9, 0.0), N*N*1e9, 1e-5), "lookup above the table uses the last node");
+
+        remove("eos_test_cut.txt");
+        remove("eos_test.txt");
+        printf("%s\n", PASS ? "PASS" : "FAIL");
+        return PASS ? 0 : 1;
+}
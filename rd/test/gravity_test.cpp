@@ -0,0 +1,66 @@
+// Two-body check of the direct gravity source in 3D (source3D.cpp, SELF_GRAVITY): two equal masses at rest must gain
+// momentum towards each other once the source DU is applied the way vertex3D.h applies it (U - DU). Exits 1 otherwise.
+//
+// g++ -O2 gravity_test.cpp -o gravity_test && ./gravity_test
+
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#define SELF_GRAVITY
+#define GRAV 1.0
+#define MAX_SBIN 1
+#define SOURCE_ACC 1.0
+
+double min_val(double A, double B){return A < B ? A : B;}
+
+class VERTEX{
+public:
+        double X[3], DUAL, U[5], DU[5], DT_SRC;
+        int SBIN;
+        double get_x(){return X[0];}
+        double get_y(){return X[1];}
+        double get_z(){return X[2];}
+        double get_mass_density(){return U[0];}
+        double get_mass(){return DUAL*U[0];}
+        double get_dt_src(){return DT_SRC;}
+        void add_dt_src(double DT){DT_SRC += DT;}
+        void reset_dt_src(){DT_SRC = 0.0;}
+        int get_sbin(){return SBIN;}
+        void set_sbin(int NEW_SBIN){SBIN = NEW_SBIN;}
+        void update_du(double NEW_DU[5]){for(int k=0;k<5;++k){DU[k] += NEW_DU[k];}}
+        void update_u_variables(){for(int k=0;k<5;++k){U[k] -= DU[k];}}         // as vertex3D.h
+};
+
+#include "../source_bins.cpp"
+#include "../source3D.cpp"
+
+int main(){
+        std::vector<VERTEX> POINTS(2);
+        for(int i=0;i<2;++i){
+                VERTEX &V = POINTS[i];
+                V.X[0] = 4.0 + 2.0*i;                           // along x, 2 apart
+                V.X[1] = V.X[2] = 5.0;
+                V.DUAL = 1.0;
+                V.U[0] = 1.0;
+                V.U[1] = V.U[2] = V.U[3] = 0.0;
+                V.U[4] = 1.0;
+                for(int k=0;k<5;++k){V.DU[k] = 0.0;}
+                V.DT_SRC = 0.0;
+                V.SBIN = 1;
+        }
+
+        sources(POINTS, 0.1, 2, 0);
+        for(int i=0;i<2;++i){POINTS[i].update_u_variables();}
+
+        // GRAV m rho DT / r^2 = 0.025 along x, towards the other body, and nothing else
+        bool PASS = true;
+        for(int i=0;i<2;++i){
+                double EXPECT = i == 0 ? 0.025 : -0.025;
+                printf("body %d: momentum %g %g %g (expected %g 0 0)\n", i, POINTS[i].U[1], POINTS[i].U[2], POINTS[i].U[3], EXPECT);
+                PASS = PASS and fabs(POINTS[i].U[1] - EXPECT) < 1e-12 and POINTS[i].U[2] == 0.0 and POINTS[i].U[3] == 0.0;
+                PASS = PASS and POINTS[i].U[0] == 1.0 and POINTS[i].U[4] == 1.0;
+        }
+        printf("%s\n", PASS ? "PASS" : "FAIL: the bodies do not attract");
+        return PASS ? 0 : 1;
+}
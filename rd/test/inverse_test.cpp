@@ -1,41 +1,82 @@
+// Checks of mat_inv (inverse.cpp): a well conditioned 5x5 matrix is inverted directly, while an exactly singular one
+// and one whose pivots span more than 1/PIVOT_RATIO_MIN fall back to the regularised pseudo-inverse, which stays finite
+// and satisfies A P A = A. Exits 1 on any failure.
+//
+// g++ -O2 inverse_test.cpp -o inverse_test -llapacke -llapack -lblas && ./inverse_test
+
 #include <iostream>
+#include <cmath>
+#include <string>
 
 #include "cblas.h"
 #include "lapacke.h"
-#include "inverse.cpp"
+#include "../inverse.cpp"
+
+const int N = 5;
+bool PASS = true;
+
+void check(bool OK, std::string WHAT){
+        printf("%s: %s\n", OK ? "pass" : "FAIL", WHAT.c_str());
+        PASS = PASS and OK;
+}
+
+// largest |(A B)_ij - C_ij|
+double max_diff(double A[N][N], double B[N][N], double C[N][N]){
+        double DIFF = 0.0;
+        for(int i=0;i<N;++i){
+                for(int j=0;j<N;++j){
+                        double AB = 0.0;
+                        for(int k=0;k<N;++k){AB += A[i][k]*B[k][j];}
+                        DIFF = fmax(DIFF, fabs(AB - C[i][j]));
+                }
+        }
+        return DIFF;
+}
+
+bool all_finite(double A[N][N]){
+        for(int i=0;i<N;++i){for(int j=0;j<N;++j){if(not std::isfinite(A[i][j])){return false;}}}
+        return true;
+}
+
+// A P A = A for the inverse P of A returned by mat_inv
+double pinv_residual(double A[N][N], double P[N][N]){
+        double PA[N][N];
+        for(int i=0;i<N;++i){
+                for(int j=0;j<N;++j){
+                        PA[i][j] = 0.0;
+                        for(int k=0;k<N;++k){PA[i][j] += P[i][k]*A[k][j];}
+                }
+        }
+        return max_diff(A, PA, A);
+}
 
 int main(){
-  double INFLOW_MINUS_SUM[5][5];
-
-  INFLOW_MINUS_SUM[0][0] = 1;
-  INFLOW_MINUS_SUM[0][1] = 2;
-  INFLOW_MINUS_SUM[0][2] = 0;
-  INFLOW_MINUS_SUM[0][3] = 6;
-  INFLOW_MINUS_SUM[0][4] = 3;
-  
-  INFLOW_MINUS_SUM[1][0] = 5;
-  INFLOW_MINUS_SUM[1][1] = 0;
-  INFLOW_MINUS_SUM[1][2] = 2;
-  INFLOW_MINUS_SUM[1][3] = 6;
-  INFLOW_MINUS_SUM[1][4] = 9;
-
-  INFLOW_MINUS_SUM[2][0] = 8;
-  INFLOW_MINUS_SUM[2][1] = 3;
-  INFLOW_MINUS_SUM[2][2] = 5;
-  INFLOW_MINUS_SUM[2][3] = 0;
-  INFLOW_MINUS_SUM[2][4] = 1;
-
-  INFLOW_MINUS_SUM[3][0] = 0;
-  INFLOW_MINUS_SUM[3][1] = 8;
-  INFLOW_MINUS_SUM[3][2] = 2;
-  INFLOW_MINUS_SUM[3][3] = 4;
-  INFLOW_MINUS_SUM[3][4] = 3;
-
-  INFLOW_MINUS_SUM[4][0] = 9;
-  INFLOW_MINUS_SUM[4][1] = 2;
-  INFLOW_MINUS_SUM[4][2] = 1;
-  INFLOW_MINUS_SUM[4][3] = 0;
-  INFLOW_MINUS_SUM[4][4] = 7;
-
-  mat_inv(&INFLOW_MINUS_SUM[0][0],5,0,0,0);
+        double A[N][N] = {{1, 2, 0, 6, 3},
+                          {5, 0, 2, 6, 9},
+                          {8, 3, 5, 0, 1},
+                          {0, 8, 2, 4, 3},
+                          {9, 2, 1, 0, 7}};
+        double I[N][N] = {}, P[N][N];
+        for(int i=0;i<N;++i){I[i][i] = 1.0;}
+
+        for(int i=0;i<N;++i){for(int j=0;j<N;++j){P[i][j] = A[i][j];}}
+        check(mat_inv(&P[0][0], N, 0.0, 0.0, 0, 0) == 0 and N_SINGULAR == 0, "regular matrix is inverted directly");
+        check(max_diff(A, P, I) < 1e-12, "A A^-1 = I");
+
+        // last row the sum of the first two
+        for(int j=0;j<N;++j){A[4][j] = A[0][j] + A[1][j];}
+        for(int i=0;i<N;++i){for(int j=0;j<N;++j){P[i][j] = A[i][j];}}
+        check(mat_inv(&P[0][0], N, 0.0, 0.0, 0, 0) > 0 and N_SINGULAR == 1, "singular matrix falls back to the pseudo-inverse");
+        check(all_finite(P), "pseudo-inverse of the singular matrix is finite");
+        check(pinv_residual(A, P) < 1e-10, "A P A = A for the singular matrix");
+
+        // the same row perturbed at 1e-14, invertible in exact arithmetic but with a pivot ratio far below 1e-12
+        A[4][2] += 1e-14;
+        for(int i=0;i<N;++i){for(int j=0;j<N;++j){P[i][j] = A[i][j];}}
+        check(mat_inv(&P[0][0], N, 0.0, 0.0, 0, 0) > 0 and N_SINGULAR == 2, "ill-conditioned matrix falls back to the pseudo-inverse");
+        check(all_finite(P) and fabs(P[2][4]) < 1e6, "pseudo-inverse of the ill-conditioned matrix stays bounded");
+        check(pinv_residual(A, P) < 1e-10, "A P A = A for the ill-conditioned matrix");
+
+        printf("%s\n", PASS ? "PASS" : "FAIL");
+        return PASS ? 0 : 1;
 }
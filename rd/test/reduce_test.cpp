@@ -0,0 +1,60 @@
+// Checks of the deterministic reductions (reduce.cpp, PARA_UP): deterministic_sum over values spanning many orders of
+// magnitude and both signs gives bitwise the same result with 1 to 8 threads, close to a long double reference, and
+// deterministic_min agrees with a serial minimum. Exits 1 on any failure.
+//
+// g++ -O2 -fopenmp reduce_test.cpp -o reduce_test && ./reduce_test
+
+#include <math.h>
+#include <stdio.h>
+#include <omp.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define PARA_UP
+
+double min_val(double A, double B){return A < B ? A : B;}
+
+#include "../reduce.cpp"
+
+bool PASS = true;
+
+void check(bool OK, std::string WHAT){
+        printf("%s: %s\n", OK ? "pass" : "FAIL", WHAT.c_str());
+        PASS = PASS and OK;
+}
+
+int main(){
+        // not a multiple of REDUCE_BLOCK, so the last block is partial
+        const int N = 100*REDUCE_BLOCK + 77;
+        std::vector<double> X(N);
+        unsigned long SEED = 12345;
+        for(int i=0;i<N;++i){
+                SEED = 6364136223846793005UL*SEED + 1442695040888963407UL;
+                double R = double(SEED >> 11)/double(1UL << 53);
+                X[i] = (i%2 ? -1.0 : 1.0)*pow(10.0, 16.0*R - 8.0) + 1e-3*R;
+        }
+
+        long double REFERENCE = 0.0;
+        double MIN = HUGE_VAL;
+        for(int i=0;i<N;++i){REFERENCE += X[i]; MIN = min_val(MIN, X[i]);}
+
+        omp_set_num_threads(1);
+        double SUM_1 = deterministic_sum(N, [&](int i){return X[i];});
+        bool SAME = true, SAME_MIN = true;
+        for(int THREADS=2;THREADS<=8;++THREADS){
+                omp_set_num_threads(THREADS);
+                double SUM = deterministic_sum(N, [&](int i){return X[i];});
+                printf("%d threads: sum = %.17g\n", THREADS, SUM);
+                SAME = SAME and SUM == SUM_1;
+                SAME_MIN = SAME_MIN and deterministic_min(N, HUGE_VAL, [&](int i){return X[i];}) == MIN;
+        }
+        check(SAME, "sum is bitwise independent of the thread count");
+        check(fabs(SUM_1 - double(REFERENCE)) <= 1e-12*fabs(double(REFERENCE)), "sum matches the long double reference");
+        check(SAME_MIN, "minimum matches the serial minimum");
+        check(deterministic_min(N, -1e30, [&](int i){return X[i];}) == -1e30, "minimum includes INITIAL");
+        check(deterministic_sum(0, [&](int i){return X[i];}) == 0.0, "empty sum is zero");
+
+        printf("%s\n", PASS ? "PASS" : "FAIL");
+        return PASS ? 0 : 1;
+}
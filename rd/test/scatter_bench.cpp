@@ -0,0 +1,156 @@
+// Residual scatter benchmark: thread private slots (scatter.cpp, DU_PRIVATE) against atomics (DU_ATOMIC) and a greedy
+// colouring of the triangles, on a periodic N x N mesh of 2 N^2 triangles with the vertices numbered row by row or
+// at random. Prints the time per pass and the extra memory of each method for 1 to 128 threads.
+//
+// g++ -O2 -fopenmp scatter_bench.cpp -o scatter_bench
+// ./scatter_bench [N = 512] [passes = 20] [flops per triangle = 200]
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+int WORK = 200;
+
+class VERTEX{
+public:
+        int ID;
+        double DU[4], DU_HALF[4];
+        int get_id(){return ID;}
+        void update_du(double NEW_DU[4]){for(int i=0;i<4;++i){DU[i] += NEW_DU[i];}}
+        void update_du_half(double NEW_DU[4]){for(int i=0;i<4;++i){DU_HALF[i] += NEW_DU[i];}}
+        void update_du_atomic(double NEW_DU[4]){
+                for(int i=0;i<4;++i){
+                        #pragma omp atomic update
+                        DU_HALF[i] += NEW_DU[i];
+                }
+        }
+};
+
+class TRIANGLE{
+public:
+        VERTEX *V[3];
+        double DU[3][4];
+        VERTEX* get_vertex_0(){return V[0];}
+        VERTEX* get_vertex_1(){return V[1];}
+        VERTEX* get_vertex_2(){return V[2];}
+        int get_tbin(){return 1;}
+        void calculate_first_half(double T, double DT){                // stands in for the residual, WORK flops
+                double X = T + DT*V[0]->ID;
+                for(int k=0;k<WORK/2;++k){X = X*0.999999 + 1e-9;}
+                for(int m=0;m<3;++m){for(int i=0;i<4;++i){DU[m][i] = X*(m + 1) + i;}}
+        }
+        void calculate_second_half(double T, double DT){calculate_first_half(T, DT);}
+        void pass_update_half(){for(int m=0;m<3;++m){V[m]->update_du_half(DU[m]);}}
+        void pass_update_half(double *BUF, const int *SLOT){
+                for(int m=0;m<3;++m){for(int i=0;i<4;++i){BUF[4*SLOT[m] + i] += DU[m][i];}}
+        }
+        void pass_update(double *BUF, const int *SLOT){pass_update_half(BUF, SLOT);}
+};
+
+#include "../scatter.cpp"
+
+void make_mesh(int N, bool SHUFFLE, std::vector<VERTEX> &POINTS, std::vector<TRIANGLE> &MESH){
+        std::vector<int> ID(N*N);
+        for(int i=0;i<N*N;++i){ID[i] = i;}
+        if(SHUFFLE){std::shuffle(ID.begin(), ID.end(), std::mt19937(1));}
+
+        POINTS.assign(N*N, VERTEX());
+        for(int i=0;i<N*N;++i){POINTS[i].ID = i;}
+        MESH.resize(2*N*N);
+        for(int y=0;y<N;++y){
+                for(int x=0;x<N;++x){                                   // cells in row order, periodic
+                        VERTEX *A = &POINTS[ID[y*N + x]], *B = &POINTS[ID[y*N + (x+1)%N]];
+                        VERTEX *C = &POINTS[ID[((y+1)%N)*N + x]], *D = &POINTS[ID[((y+1)%N)*N + (x+1)%N]];
+                        TRIANGLE &T0 = MESH[2*(y*N + x)], &T1 = MESH[2*(y*N + x) + 1];
+                        T0.V[0] = A; T0.V[1] = B; T0.V[2] = D;
+                        T1.V[0] = A; T1.V[1] = D; T1.V[2] = C;
+                }
+        }
+}
+
+// greedy colouring, no two triangles of a colour share a vertex
+int colour_mesh(std::vector<TRIANGLE> &MESH, int N_POINTS, std::vector< std::vector<int> > &COLOUR){
+        std::vector< std::vector<int> > USED(N_POINTS);
+        COLOUR.clear();
+        for(int j=0;j<int(MESH.size());++j){
+                int c = 0;
+                while(true){
+                        bool FREE = true;
+                        for(int m=0;m<3 and FREE;++m){
+                                std::vector<int> &U = USED[MESH[j].V[m]->ID];
+                                FREE = std::find(U.begin(), U.end(), c) == U.end();
+                        }
+                        if(FREE){break;}
+                        c++;
+                }
+                if(c == int(COLOUR.size())){COLOUR.push_back(std::vector<int>());}
+                COLOUR[c].push_back(j);
+                for(int m=0;m<3;++m){USED[MESH[j].V[m]->ID].push_back(c);}
+        }
+        return COLOUR.size();
+}
+
+int main(int ARGC, char *ARGV[]){
+        int N = ARGC > 1 ? atoi(ARGV[1]) : 512;
+        int PASSES = ARGC > 2 ? atoi(ARGV[2]) : 20;
+        WORK = ARGC > 3 ? atoi(ARGV[3]) : 200;
+        const int THREADS[] = {1, 8, 16, 32, 64, 128};
+
+        printf("%d vertices, %d triangles, %d passes, %d flops per triangle, %d cores\n", N*N, 2*N*N, PASSES, WORK, omp_get_num_procs());
+        printf("numbering threads   private_s  private_MB  range_MB   atomic_s  colour_s (colours)\n");
+
+        for(int SHUFFLE=0;SHUFFLE<2;++SHUFFLE){
+                std::vector<VERTEX> POINTS;
+                std::vector<TRIANGLE> MESH;
+                std::vector< std::vector<int> > COLOUR;
+                make_mesh(N, SHUFFLE, POINTS, MESH);
+                int N_COLOURS = colour_mesh(MESH, POINTS.size(), COLOUR);
+                int N_TRIANG = MESH.size();
+
+                for(int t : THREADS){
+                        omp_set_num_threads(t);
+                        du_private_setup(MESH, POINTS);
+
+                        double SLOTS = 0.0, RANGE = 0.0;                // slots here, against a LO..HI vertex range per chunk
+                        for(int C=0;C<DU_PRIVATE_BUF.N_CHUNKS;++C){
+                                SLOTS += DU_PRIVATE_BUF.SLOT_ID[C].size();
+                                RANGE += DU_PRIVATE_BUF.SLOT_ID[C].back() - DU_PRIVATE_BUF.SLOT_ID[C].front() + 1;
+                        }
+                        double PRIVATE_MB = (DU_VARS*8.0*SLOTS + 4.0*(DU_CORNERS*N_TRIANG + 3.0*SLOTS + POINTS.size()))/1e6;
+                        double RANGE_MB = DU_VARS*8.0*RANGE/1e6;
+
+                        double T0 = omp_get_wtime();
+                        for(int p=0;p<PASSES;++p){du_private_update(1, true, 0, p, 1e-3, MESH);}
+                        double T_PRIVATE = (omp_get_wtime() - T0)/PASSES;
+
+                        T0 = omp_get_wtime();
+                        for(int p=0;p<PASSES;++p){
+                                #pragma omp parallel for schedule(static)
+                                for(int j=0;j<N_TRIANG;++j){
+                                        MESH[j].calculate_first_half(p, 1e-3);
+                                        for(int m=0;m<3;++m){MESH[j].V[m]->update_du_atomic(MESH[j].DU[m]);}
+                                }
+                        }
+                        double T_ATOMIC = (omp_get_wtime() - T0)/PASSES;
+
+                        T0 = omp_get_wtime();
+                        for(int p=0;p<PASSES;++p){
+                                for(int c=0;c<N_COLOURS;++c){
+                                        std::vector<int> &J = COLOUR[c];
+                                        #pragma omp parallel for schedule(static)
+                                        for(int k=0;k<int(J.size());++k){
+                                                MESH[J[k]].calculate_first_half(p, 1e-3);
+                                                MESH[J[k]].pass_update_half();
+                                        }
+                                }
+                        }
+                        double T_COLOUR = (omp_get_wtime() - T0)/PASSES;
+
+                        printf("%-9s %7d %11.5f %11.2f %9.2f %10.5f %9.5f (%d)\n", SHUFFLE ? "random" : "rows", t, T_PRIVATE, PRIVATE_MB, RANGE_MB, T_ATOMIC, T_COLOUR, N_COLOURS);
+                }
+        }
+        return 0;
+}
@@ -1,6 +1,19 @@
-void drift_update_half(int TBIN_CURRENT, int N_TRIANG, double T, double DT, std::vector<TRIANGLE> &RAND_MESH){
+// triangles J_START .. N_TRIANG-1 (the batched and thread private paths always take the whole mesh)
+void drift_update_half(int TBIN_CURRENT, int N_TRIANG, double T, double DT, std::vector<TRIANGLE> &RAND_MESH, int J_START = 0){
         int TBIN;
-        for(int j=0;j<N_TRIANG;++j){                                                                         // loop over all triangles in MESH
+#ifdef BATCH_RESIDUAL
+        std::vector<TRIANGLE*> ACTIVE;                                                                       // active triangles, residuals in batches
+        for(int j=0;j<N_TRIANG;++j){
+                if(TBIN_CURRENT % RAND_MESH[j].get_tbin() == 0){ACTIVE.push_back(&RAND_MESH[j]);}
+        }
+        calculate_first_half_list(ACTIVE, T, DT);
+        for(int j=0;j<N_TRIANG;++j){RAND_MESH[j].pass_update_half();}
+        return ;
+#elif defined(DU_PRIVATE)
+        du_private_update(1, false, TBIN_CURRENT, T, DT, RAND_MESH);
+        return ;
+#endif
+        for(int j=J_START;j<N_TRIANG;++j){                                                                   // loop over all triangles in MESH
                 TBIN = RAND_MESH[j].get_tbin();
                 if(TBIN_CURRENT % TBIN == 0){
                         RAND_MESH[j].calculate_first_half(T,DT);
@@ -68,9 +81,13 @@ void jump_update_half(int TBIN_CURRENT, int N_TRIANG, double T, double DT, std::
 }
 #endif
 
-void drift_update(int TBIN_CURRENT, int N_TRIANG, double T, double DT, std::vector<TRIANGLE> &RAND_MESH){
+void drift_update(int TBIN_CURRENT, int N_TRIANG, double T, double DT, std::vector<TRIANGLE> &RAND_MESH, int J_START = 0){
         int TBIN;
-        for(int j=0;j<N_TRIANG;++j){                                                                         // loop over all triangles in MESH
+#ifdef DU_PRIVATE
+        du_private_update(2, false, TBIN_CURRENT, T, DT, RAND_MESH);
+        return ;
+#endif
+        for(int j=J_START;j<N_TRIANG;++j){                                                                   // loop over all triangles in MESH
                 TBIN = RAND_MESH[j].get_tbin();
                 if(TBIN_CURRENT % TBIN == 0){
                         RAND_MESH[j].calculate_second_half(T,DT);
@@ -80,17 +97,26 @@ void drift_update(int TBIN_CURRENT, int N_TRIANG, double T, double DT, std::vect
 }
 
 void reset_tbins(int T, int DT, int N_TRIANG, int N_POINTS, double &NEXT_DT, std::vector<TRIANGLE> &RAND_MESH, std::vector<VERTEX> &RAND_POINTS){
-        double POSSIBLE_DT, MIN_DT;
+        double MIN_DT;
         for(int j=0;j<N_TRIANG;++j){                                       // loop over all triangles in MESH
                 RAND_MESH[j].calculate_len_vel_contribution();             // calculate contribution from each edge TRIANGLE
         }
-        NEXT_DT = T_TOT - (T + DT);                                        // set next timestep to max possible value (time remaining to end)å
-        for(int i=0;i<N_POINTS;++i){                                       // loop over all vertices
-                POSSIBLE_DT = RAND_POINTS[i].calc_next_dt();               // calculate next timestep based on new state
-                if(POSSIBLE_DT < NEXT_DT){NEXT_DT = POSSIBLE_DT;}
+#ifdef MPI_RD
+        halo_reverse(RAND_POINTS, HALO_LEN_VEL);                            // complete sums at the owned vertices (domain.cpp)
+        for(int i=DOMAIN_DECOMP.N_OWNED;i<N_POINTS;++i){RAND_POINTS[i].set_tbin_local(MAX_TBIN);}
+        N_POINTS = DOMAIN_DECOMP.N_OWNED;
+#endif
+        // next timestep: minimum required by the vertices, at most the time remaining to the end (reduce.cpp)
+        NEXT_DT = deterministic_min(N_POINTS, T_TOT - (T + DT), [&](int i){
+                double POSSIBLE_DT = RAND_POINTS[i].calc_next_dt();        // calculate next timestep based on new state
                 RAND_POINTS[i].reset_len_vel_sum();
                 RAND_POINTS[i].set_tbin_local(MAX_TBIN);
-        }
+                return POSSIBLE_DT;
+        });
+#ifdef MPI_RD
+        NEXT_DT = domain_min(NEXT_DT);
+        halo_forward(RAND_POINTS, HALO_DT_REQ);                             // ghosts need DT_REQ to bin the triangles
+#endif
         for(int j=0;j<N_TRIANG;++j){                                        // bin triangles by minimum timestep of vertices
                 MIN_DT = RAND_MESH[j].get_vertex_0()->get_dt_req();
                 if(RAND_MESH[j].get_vertex_1()->get_dt_req() < MIN_DT){MIN_DT = RAND_MESH[j].get_vertex_1()->get_dt_req();}
@@ -98,7 +124,11 @@ void reset_tbins(int T, int DT, int N_TRIANG, int N_POINTS, double &NEXT_DT, std
 #ifdef THREE_D
                 if(RAND_MESH[j].get_vertex_3()->get_dt_req() < MIN_DT){MIN_DT = RAND_MESH[j].get_vertex_3()->get_dt_req();}
 #endif
+#ifdef MOVING_MESH
+                RAND_MESH[j].set_tbin(1);                                   // the geometry changes every step (moving_mesh.cpp)
+#else
                 RAND_MESH[j].set_tbin( min_val( MAX_TBIN,pow(2.0,int(log2(MIN_DT/NEXT_DT))) ) );
+#endif
 #ifdef DRIFT_SHELL
                 RAND_MESH[j].send_tbin_limit();
 #endif
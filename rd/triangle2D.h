@@ -4,6 +4,7 @@
         *VERTEX_1 => pointers to VERTEX 1 of triangle
         *VERTEX_2 => pointers to VERTEX 2 of triangle
         BOUNDARY  => 0 or 1, denoted whether triangle crosses boundary
+        SHIFT     => periodic image of each vertex, bit k adds the box side along axis k (set once at mesh load)
         AREA => area of triangle
         X,Y  => vertex coordinates for 0,1,2
         DUAL => area of dual cells corresponding to each vertex
@@ -20,6 +21,10 @@
         PHI => element residual
         BETA => distribution coefficient defined by chosen scheme
         MAG => length of normal to each edge
+        HALF_MAG, AREA_THIRD => MAG/2 and AREA/3, set once with the normals
+        W_MESH, W_BAR => vertex velocities and their mean (MOVING_MESH)
+        W_FLUX => HALF_MAG NORMAL.W_BAR for each corner, AREA_RATE = dAREA/dt the sum of HALF_MAG NORMAL.W_MESH (MOVING_MESH)
+        GCL_SOURCE => AREA_RATE/3 times the first half state of each corner, returned to it with its dual change (MOVING_MESH)
 */
 
 class TRIANGLE{
@@ -29,6 +34,7 @@ private:
         VERTEX *VERTEX_0,*VERTEX_1,*VERTEX_2;
 
         int BOUNDARY;
+        int SHIFT[3];
         int TBIN;
 
         double AREA;
@@ -52,11 +58,18 @@ private:
         double DU0_HALF[4],DU1_HALF[4],DU2_HALF[4];
 
         double MAG[3];
+        double HALF_MAG[3], AREA_THIRD;
+#ifdef MOVING_MESH
+        double W_MESH[3][2], W_BAR[2], W_FLUX[3], AREA_RATE;
+        double GCL_SOURCE[4][3];
+#endif
 
         int PRINT;
 
 public:
 
+        template<int L> friend void calculate_first_half_batch(TRIANGLE **TRI, double T, double DT);
+
         void set_id(int NEW_ID){ID = NEW_ID;}
 
         void set_vertex_0(VERTEX* NEW_VERTEX){VERTEX_0 = NEW_VERTEX;}
@@ -64,6 +77,7 @@ public:
         void set_vertex_2(VERTEX* NEW_VERTEX){VERTEX_2 = NEW_VERTEX;}
 
         void set_boundary(int NEW_BOUNDARY){BOUNDARY = NEW_BOUNDARY;}
+        void set_shift(int m, int NEW_SHIFT){SHIFT[m] = NEW_SHIFT;}
         void set_tbin(    int NEW_TBIN){TBIN = NEW_TBIN;}
 
         int get_id(){return ID;}
@@ -73,6 +87,7 @@ public:
         VERTEX* get_vertex_2(){return VERTEX_2;}
 
         int get_boundary(){return BOUNDARY;}
+        int get_shift(int m){return SHIFT[m];}
         int get_tbin(){ return TBIN;}
 
         double get_un00(){
@@ -111,6 +126,31 @@ public:
                 Y[2] = VERTEX_2->get_y();
         }
 
+        // shift codes from the vertex positions (a vertex more than half the box below another takes the image above),
+        // and the boundary flag from the codes. Only at mesh load, when the triangulation gives no offsets
+        void find_shift(){
+                setup_positions();
+                BOUNDARY = 0;
+                for(int i=0; i<3; ++i){
+                        SHIFT[i] = 0;
+#ifdef PERIODIC_BOUNDARY
+                        for(int j=0; j<3; ++j){
+                                if(X[j] - X[i] > 0.5*SIDE_LENGTH_X){SHIFT[i] |= 1;}
+                                if(Y[j] - Y[i] > 0.5*SIDE_LENGTH_Y){SHIFT[i] |= 2;}
+                        }
+#endif
+                        if(SHIFT[i] != 0){BOUNDARY = 1;}
+                }
+        }
+
+        // vertex positions with the periodic images applied, by lookup of the shift codes
+        void setup_positions_mod(){
+                for(int m=0; m<3; ++m){
+                        X_MOD[m] = (SHIFT[m] & 1) ? X[m] + SIDE_LENGTH_X : X[m];
+                        Y_MOD[m] = (SHIFT[m] & 2) ? Y[m] + SIDE_LENGTH_Y : Y[m];
+                }
+        }
+
         // import initial fluid state and pressure for all vertices
         void setup_initial_state(){
                 U_N[0][0] = VERTEX_0->get_u0();
@@ -159,61 +199,33 @@ public:
 
         //**********************************************************************************************************************
 
-        // Calculate first half timestep change, passing change to vertice
-        void calculate_first_half(double T, double DT){
-                int i,j,m,p;
-                double INFLOW[4][4][3][3];
-                double C_SOUND[3];
-
-                // Import conditions and positions of vertices
+        // Build the parameter vector W_HAT and the element residual PHI_S from the state U_S, P_S, and if WITH_K the K+
+        // matrix of every vertex (INFLOW). K- and K are never formed: sum_m K_m = 0, so sum_m K-_m = -sum_m K+_m and
+        // sum_m K-_m W_HAT_m = PHI - sum_m K+_m W_HAT_m. PHI is the flux integral over the element boundary, which for Z
+        // linear on the element (F quadratic in Z) is sum_m MAG_m NORMAL_m.F(Z_BAR,Z_m), F(A,B) the symmetric bilinear flux.
+        // Z_BAR_S and LIN_S, if given, return the Roe average and its sound speed and pressure linearisation (C, ALPHA, KAPPA)
+        // for characteristic.cpp. With EOS_NON_IDEAL the pressure is linearised with the EOS derivatives (eos_linearise) and
+        // enters the flux integral through its vertex values.
+        void build_inflow(double U_S[4][3], double P_S[3], double W_HAT[4][3], double PHI_S[4], double INFLOW[4][4][3], bool WITH_K, double *Z_BAR_S=NULL, double *LIN_S=NULL){
+                int i,m;
 
-                setup_positions();
-                setup_initial_state();
-
-#ifdef CLOSED
-                for(m=0;m<3;++m){
-                        if(X[m] > 0.99*SIDE_LENGTH_X or X[m] < 0.01*SIDE_LENGTH_X or Y[m] > 0.99*SIDE_LENGTH_Y or Y[m] < 0.01*SIDE_LENGTH_Y){
-                                return ;
-                        }
-                }
-#endif
-
-#ifdef DEBUG
-                std::cout << "-- FIRST  -------------------------------------------------------" << std::endl;
-                std::cout << "Time     =\t" << T << std::endl;
-                std::cout << "0 =\t" << X[0] << "\t" << Y[0] << std::endl;
-                std::cout << "1 =\t" << X[1] << "\t" << Y[1] << std::endl;
-                std::cout << "2 =\t" << X[2] << "\t" << Y[2] << std::endl;
-                std::cout << "State    =" << "\trho" << "\tx_mom" << "\ty_mom" << "\tenergy" << std::endl;
-                for(i=0;i<3;i++){std::cout << i << " =\t" << U_N[0][i] << "\t" << U_N[1][i] << "\t" << U_N[2][i] << "\t" << U_N[3][i] << std::endl;}
-                std::cout << "Pressure =\t" << PRESSURE[0] << "\t" << PRESSURE[1] << "\t" << PRESSURE[2] << std::endl;
-#endif
-
-//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-                // Calculate inflow parameters
-
-                double H[3];
                 double RHO,C,U,U_C,V,V_C,H_AVG,H_C,ALPHA,ALPHA_C,W;
                 double Z[4][3];
-                double VALUE1,VALUE2,VALUE3,VALUE4,VALUE12,VALUE123;
-                double PRESSURE_AVG;
-                double LAMBDA[4][3],LAMBDA_PLUS[4][3],LAMBDA_MINUS[4][3];
+                double VALUE1,VALUE2,VALUE3,VALUE12,VALUE123;
                 double N_X[3],N_Y[3];
 
-                double Z_BAR[4],W_HAT[4][3];
+                double Z_BAR[4];
 
                 // Construct Roe vector Z
 
                 for(m=0;m<3;++m){
-                        Z[0][m] = sqrt(U_N[0][m]);
-                        Z[1][m] = U_N[1][m]/Z[0][m];
-                        Z[2][m] = U_N[2][m]/Z[0][m];
-                        Z[3][m] = (U_N[3][m] + PRESSURE[m])/Z[0][m];
+                        Z[0][m] = sqrt(U_S[0][m]);
+                        Z[1][m] = U_S[1][m]/Z[0][m];
+                        Z[2][m] = U_S[2][m]/Z[0][m];
+                        Z[3][m] = (U_S[3][m] + P_S[m])/Z[0][m];
 
                         N_X[m]  = NORMAL[m][0];
                         N_Y[m]  = NORMAL[m][1];
-
-                        H[m] = (U_N[3][m] + PRESSURE[m])/U_N[0][m];
 #ifdef DEBUG
                         std::cout << "Z =\t" << Z[0][m] << "\t" << Z[1][m] << "\t" << Z[2][m] << "\t" << Z[3][m] << std::endl;
 #endif
@@ -226,14 +238,32 @@ public:
                 std::cout << std::endl;
 #endif
 
+                // Construct average state for element
+
+                RHO   = Z_BAR[0]*Z_BAR[0];
+                U     = Z_BAR[1]/Z_BAR[0];
+                V     = Z_BAR[2]/Z_BAR[0];
+                H_AVG = Z_BAR[3]/Z_BAR[0];
+
+#ifdef EOS_NON_IDEAL
+                double E_BAR = 0.0, KAPPA, KAPPA_2, C_SQ;
+                for(m=0;m<3;++m){E_BAR += Z[0][m]*(U_S[3][m] - 0.5*(U_S[1][m]*U_S[1][m] + U_S[2][m]*U_S[2][m])/U_S[0][m])/U_S[0][m];}
+                E_BAR /= 3.0*Z_BAR[0];
+                eos_linearise(RHO, E_BAR, H_AVG, U*U + V*V, ALPHA, KAPPA, C_SQ);
+                KAPPA_2 = KAPPA - 1.0;
+#else
+                double KAPPA = GAMMA_1, KAPPA_2 = GAMMA_2;
+#endif
 
                 for(m=0; m<3; ++m){
                         W_HAT[0][m] =  2.0*Z_BAR[0]*Z[0][m];
                         W_HAT[1][m] =  Z_BAR[1]*Z[0][m] + Z_BAR[0]*Z[1][m];
                         W_HAT[2][m] =  Z_BAR[2]*Z[0][m] + Z_BAR[0]*Z[2][m];
+#ifdef EOS_NON_IDEAL
+                        W_HAT[3][m] = (Z_BAR[3]*Z[0][m] + Z_BAR[0]*Z[3][m] - ALPHA*W_HAT[0][m] + KAPPA*(U*W_HAT[1][m] + V*W_HAT[2][m]))/(1.0 + KAPPA);
+#else
                         W_HAT[3][m] = (Z_BAR[3]*Z[0][m] + GAMMA_1*Z_BAR[1]*Z[1][m] + GAMMA_1*Z_BAR[2]*Z[2][m] + Z_BAR[0]*Z[3][m])/GAMMA;
-
-                        //std::cout << Z_BAR[1] << "\t" << Z[0][m] << "\t" << Z_BAR[0] << "\t" << Z[2][m] << std::endl;
+#endif
 
 #ifdef DEBUG
                         for(i=0;i<4;++i){std::cout << "W_HAT " << i << "\t" << m << " =\t" << W_HAT[i][m] << std::endl;}
@@ -241,21 +271,56 @@ public:
 #endif
                 }
 
-                // Construct average state for element
+                // Element residual (flux integral)
+
+                for(i=0;i<4;++i){PHI_S[i] = 0.0;}
+
+                for(m=0;m<3;++m){
+#ifdef EOS_NON_IDEAL
+                        double P2 = P_S[m];
+#else
+                        double P2 = (GAMMA_1/GAMMA)*(Z_BAR[0]*Z[3][m] + Z_BAR[3]*Z[0][m] - Z_BAR[1]*Z[1][m] - Z_BAR[2]*Z[2][m]);
+#endif
+                        double FX[4],FY[4];
+
+                        FX[0] = Z_BAR[0]*Z[1][m] + Z_BAR[1]*Z[0][m];
+                        FX[1] = 2.0*Z_BAR[1]*Z[1][m] + P2;
+                        FX[2] = Z_BAR[1]*Z[2][m] + Z_BAR[2]*Z[1][m];
+                        FX[3] = Z_BAR[1]*Z[3][m] + Z_BAR[3]*Z[1][m];
+
+                        FY[0] = Z_BAR[0]*Z[2][m] + Z_BAR[2]*Z[0][m];
+                        FY[1] = FX[2];
+                        FY[2] = 2.0*Z_BAR[2]*Z[2][m] + P2;
+                        FY[3] = Z_BAR[2]*Z[3][m] + Z_BAR[3]*Z[2][m];
+
+                        for(i=0;i<4;++i){PHI_S[i] += HALF_MAG[m]*(N_X[m]*FX[i] + N_Y[m]*FY[i]);}
+                }
+
+#ifdef DEBUG
+                std::cout << "PHI =\t" << PHI_S[0] << "\t" << PHI_S[1] << "\t" << PHI_S[2] << "\t" << PHI_S[3] << std::endl;
+#endif
+
+                if(not WITH_K and LIN_S == NULL){return ;}
 
-                RHO   = pow((sqrt(U_N[0][0]) + sqrt(U_N[0][1]) + sqrt(U_N[0][2]))/3.0, 2);
-                U     = (sqrt(U_N[0][0])*U_N[1][0]/U_N[0][0] + sqrt(U_N[0][1])*U_N[1][1]/U_N[0][1] + sqrt(U_N[0][2])*U_N[1][2]/U_N[0][2])/(sqrt(U_N[0][0]) + sqrt(U_N[0][1]) + sqrt(U_N[0][2]));        // U now represents x velocity
-                V     = (sqrt(U_N[0][0])*U_N[2][0]/U_N[0][0] + sqrt(U_N[0][1])*U_N[2][1]/U_N[0][1] + sqrt(U_N[0][2])*U_N[2][2]/U_N[0][2])/(sqrt(U_N[0][0]) + sqrt(U_N[0][1]) + sqrt(U_N[0][2]));        // V represents y velocity
-                H_AVG = (sqrt(U_N[0][0])*H[0] + sqrt(U_N[0][1])*H[1] + sqrt(U_N[0][2])*H[2])/(sqrt(U_N[0][0]) + sqrt(U_N[0][1]) + sqrt(U_N[0][2]));
-               
-                // E     = (sqrt(U_N[0][0])*H[0]/U_N[0][0] + sqrt(U_N[0][1])*H[1]/U_N[0][1] + sqrt(U_N[0][2])*H[2]/U_N[0][2])/(sqrt(U_N[0][0]) + sqrt(U_N[0][1]) + sqrt(U_N[0][2]));
+#ifdef EOS_NON_IDEAL
+                C = sqrt(C_SQ);
+#else
+                C = sqrt(EOS::sound_speed_sq_enthalpy(RHO, H_AVG, U*U + V*V));
+#endif
 
-                PRESSURE_AVG = (PRESSURE[0] + PRESSURE[1] + PRESSURE[2])/3.0;
-                C = sqrt((GAMMA-1.0) * H_AVG - (GAMMA-1.0) * (U*U + V*V)/2.0);
-                // C_SOUND_AVG = sqrt(GAMMA*PRESSURE_AVG/RHO);
+#ifndef EOS_NON_IDEAL
+                ALPHA = GAMMA_1*(U*U + V*V)/2.0;
+#endif
+
+                if(LIN_S != NULL){
+                        for(i=0;i<4;++i){Z_BAR_S[i] = Z_BAR[i];}
+                        LIN_S[0] = C;
+                        LIN_S[1] = ALPHA;
+                        LIN_S[2] = KAPPA;
+                }
+                if(not WITH_K){return ;}
 
 #ifdef DEBUG
-                std::cout << "PRESSURE_AVG =\t" << PRESSURE_AVG << std::endl;
                 std::cout << "C_SOUND_AVG  =\t" << C << std::endl;
 #endif
 
@@ -265,7 +330,6 @@ public:
                 V_C = V/C;
                 H_C = H_AVG/C;
 
-                ALPHA   = GAMMA_1*(U*U + V*V)/2.0;
                 ALPHA_C = ALPHA/C;
 
 #ifdef DEBUG
@@ -276,80 +340,60 @@ public:
                 std::cout << std::endl;
 #endif
 
-                // Calculate K+,K- and K matrices for each vertex i,j,k
+                // Calculate K+ matrix for each vertex i,j,k (positive eigenvalues)
 
                 for(m=0;m<3;++m){
 
                         W = U*N_X[m] + V*N_Y[m];
-
-#ifdef DEBUG
-                        std::cout << "W =\t" << W << std::endl;
+#ifdef MOVING_MESH
+                        // eigenvalues of K - W_BAR.N I. With the mesh following the flow W_REL is near zero, so the
+                        // positive parts are smoothed (Harten) to keep sum K+ invertible
+                        double W_REL = W - (W_BAR[0]*N_X[m] + W_BAR[1]*N_Y[m]);
+
+                        VALUE1 = smooth_positive(W_REL + C, MESH_ENTROPY_FIX*C);
+                        VALUE2 = smooth_positive(W_REL - C, MESH_ENTROPY_FIX*C);
+                        VALUE3 = smooth_positive(W_REL, MESH_ENTROPY_FIX*C);
+#else
+                        VALUE1 = max_val(0.0,W + C);
+                        VALUE2 = max_val(0.0,W - C);
+                        VALUE3 = max_val(0.0,W);
 #endif
 
-                        LAMBDA[0][m] = W + C;
-                        LAMBDA[1][m] = W - C;
-                        LAMBDA[2][m] = W;
-                        LAMBDA[3][m] = W;
-
-                        for(i=0;i<4;++i){
-                                LAMBDA_PLUS[i][m]  = max_val(0.0,LAMBDA[i][m]);
-                                LAMBDA_MINUS[i][m] = min_val(0.0,LAMBDA[i][m]);
-                        } 
-
-                        for(p=0;p<3;++p){
-                                if(p==0){       // Identify and select positive eigenvalues
-                                        VALUE1 = LAMBDA_PLUS[0][m];
-                                        VALUE2 = LAMBDA_PLUS[1][m];
-                                        VALUE3 = LAMBDA_PLUS[2][m];
-                                        VALUE4 = LAMBDA_PLUS[3][m];
-#ifdef DEBUG
-                                        std::cout << "K+" << std::endl;
-#endif
-                                }else if(p==1){ // Identify and select negative eigenvalues
-                                        VALUE1 = LAMBDA_MINUS[0][m];
-                                        VALUE2 = LAMBDA_MINUS[1][m];
-                                        VALUE3 = LAMBDA_MINUS[2][m];
-                                        VALUE4 = LAMBDA_MINUS[3][m];
 #ifdef DEBUG
-                                        std::cout << "K-" << std::endl;
+                        std::cout << "W =\t" << W << "\tLambda + =\t" << VALUE1 << "\t" << VALUE2 << "\t" << VALUE3 << std::endl;
 #endif
-                                }else{          // Select all eigenvalues
-                                        VALUE1 = LAMBDA[0][m];
-                                        VALUE2 = LAMBDA[1][m];
-                                        VALUE3 = LAMBDA[2][m];
-                                        VALUE4 = LAMBDA[3][m];
-#ifdef DEBUG
-                                        std::cout << "K" << std::endl;
-#endif
-                                }
-
-                                VALUE12  = (VALUE1 - VALUE2)/2.0;
-                                VALUE123 = (VALUE1 + VALUE2 - 2.0*VALUE3)/2.0;
-
-                                INFLOW[0][0][m][p] = 0.5*MAG[m]*(ALPHA_C*VALUE123/C - W*VALUE12/C + VALUE3);
-                                INFLOW[0][1][m][p] = 0.5*MAG[m]*(-1.0*GAMMA_1*U_C*VALUE123/C + N_X[m]*VALUE12/C);
-                                INFLOW[0][2][m][p] = 0.5*MAG[m]*(-1.0*GAMMA_1*V_C*VALUE123/C + N_Y[m]*VALUE12/C);
-                                INFLOW[0][3][m][p] = 0.5*MAG[m]*(GAMMA_1*VALUE123/(C*C));
 
-                                INFLOW[1][0][m][p] = 0.5*MAG[m]*((ALPHA_C*U_C - W*N_X[m])*VALUE123 + (ALPHA_C*N_X[m] - U_C*W)*VALUE12);
-                                INFLOW[1][1][m][p] = 0.5*MAG[m]*((N_X[m]*N_X[m] - GAMMA_1*U_C*U_C)*VALUE123 - (GAMMA_2*U_C*N_X[m]*VALUE12) + VALUE3);
-                                INFLOW[1][2][m][p] = 0.5*MAG[m]*((N_X[m]*N_Y[m] - GAMMA_1*U_C*V_C)*VALUE123 + (U_C*N_Y[m] - GAMMA_1*V_C*N_X[m])*VALUE12);
-                                INFLOW[1][3][m][p] = 0.5*MAG[m]*(GAMMA_1*U_C*VALUE123/C + GAMMA_1*N_X[m]*VALUE12/C);
-
-                                INFLOW[2][0][m][p] = 0.5*MAG[m]*((ALPHA_C*V_C - W*N_Y[m])*VALUE123 + (ALPHA_C*N_Y[m] - V_C*W)*VALUE12);
-                                INFLOW[2][1][m][p] = 0.5*MAG[m]*((N_X[m]*N_Y[m] - GAMMA_1*U_C*V_C)*VALUE123 + (V_C*N_X[m] - GAMMA_1*U_C*N_Y[m])*VALUE12);
-                                INFLOW[2][2][m][p] = 0.5*MAG[m]*((N_Y[m]*N_Y[m] - GAMMA_1*V_C*V_C)*VALUE123 - (GAMMA_2*V_C*N_Y[m]*VALUE12) + VALUE3);
-                                INFLOW[2][3][m][p] = 0.5*MAG[m]*(GAMMA_1*V_C*VALUE123/C + GAMMA_1*N_Y[m]*VALUE12/C);
-
-                                INFLOW[3][0][m][p] = 0.5*MAG[m]*((ALPHA_C*H_C - W*W)*VALUE123 + W*(ALPHA_C - H_C)*VALUE12);
-                                INFLOW[3][1][m][p] = 0.5*MAG[m]*((W*N_X[m] - U - ALPHA_C*U_C)*VALUE123 + (H_C*N_X[m] - GAMMA_1*U_C*W)*VALUE12);
-                                INFLOW[3][2][m][p] = 0.5*MAG[m]*((W*N_Y[m] - V - ALPHA_C*V_C)*VALUE123 + (H_C*N_Y[m] - GAMMA_1*V_C*W)*VALUE12);
-                                INFLOW[3][3][m][p] = 0.5*MAG[m]*(GAMMA_1*H_C*VALUE123/C + GAMMA_1*W*VALUE12/C + VALUE3);
-                        }
+                        VALUE12  = (VALUE1 - VALUE2)/2.0;
+                        VALUE123 = (VALUE1 + VALUE2 - 2.0*VALUE3)/2.0;
+
+                        INFLOW[0][0][m] = HALF_MAG[m]*(ALPHA_C*VALUE123/C - W*VALUE12/C + VALUE3);
+                        INFLOW[0][1][m] = HALF_MAG[m]*(-1.0*KAPPA*U_C*VALUE123/C + N_X[m]*VALUE12/C);
+                        INFLOW[0][2][m] = HALF_MAG[m]*(-1.0*KAPPA*V_C*VALUE123/C + N_Y[m]*VALUE12/C);
+                        INFLOW[0][3][m] = HALF_MAG[m]*(KAPPA*VALUE123/(C*C));
+
+                        INFLOW[1][0][m] = HALF_MAG[m]*((ALPHA_C*U_C - W*N_X[m])*VALUE123 + (ALPHA_C*N_X[m] - U_C*W)*VALUE12);
+                        INFLOW[1][1][m] = HALF_MAG[m]*((N_X[m]*N_X[m] - KAPPA*U_C*U_C)*VALUE123 - (KAPPA_2*U_C*N_X[m]*VALUE12) + VALUE3);
+                        INFLOW[1][2][m] = HALF_MAG[m]*((N_X[m]*N_Y[m] - KAPPA*U_C*V_C)*VALUE123 + (U_C*N_Y[m] - KAPPA*V_C*N_X[m])*VALUE12);
+                        INFLOW[1][3][m] = HALF_MAG[m]*(KAPPA*U_C*VALUE123/C + KAPPA*N_X[m]*VALUE12/C);
+
+                        INFLOW[2][0][m] = HALF_MAG[m]*((ALPHA_C*V_C - W*N_Y[m])*VALUE123 + (ALPHA_C*N_Y[m] - V_C*W)*VALUE12);
+                        INFLOW[2][1][m] = HALF_MAG[m]*((N_X[m]*N_Y[m] - KAPPA*U_C*V_C)*VALUE123 + (V_C*N_X[m] - KAPPA*U_C*N_Y[m])*VALUE12);
+                        INFLOW[2][2][m] = HALF_MAG[m]*((N_Y[m]*N_Y[m] - KAPPA*V_C*V_C)*VALUE123 - (KAPPA_2*V_C*N_Y[m]*VALUE12) + VALUE3);
+                        INFLOW[2][3][m] = HALF_MAG[m]*(KAPPA*V_C*VALUE123/C + KAPPA*N_Y[m]*VALUE12/C);
+
+                        INFLOW[3][0][m] = HALF_MAG[m]*((ALPHA_C*H_C - W*W)*VALUE123 + W*(ALPHA_C - H_C)*VALUE12);
+#ifdef EOS_NON_IDEAL
+                        INFLOW[3][1][m] = HALF_MAG[m]*((W*N_X[m] - KAPPA*H_C*U_C)*VALUE123 + (H_C*N_X[m] - KAPPA*U_C*W)*VALUE12);
+                        INFLOW[3][2][m] = HALF_MAG[m]*((W*N_Y[m] - KAPPA*H_C*V_C)*VALUE123 + (H_C*N_Y[m] - KAPPA*V_C*W)*VALUE12);
+#else                                                           // KAPPA H = C^2 + ALPHA for the ideal gas
+                        INFLOW[3][1][m] = HALF_MAG[m]*((W*N_X[m] - U - ALPHA_C*U_C)*VALUE123 + (H_C*N_X[m] - KAPPA*U_C*W)*VALUE12);
+                        INFLOW[3][2][m] = HALF_MAG[m]*((W*N_Y[m] - V - ALPHA_C*V_C)*VALUE123 + (H_C*N_Y[m] - KAPPA*V_C*W)*VALUE12);
+#endif
+                        INFLOW[3][3][m] = HALF_MAG[m]*(KAPPA*H_C*VALUE123/C + KAPPA*W*VALUE12/C + VALUE3);
 #ifdef DEBUG
                         for(i=0; i<4; ++i){
-                                for (j=0; j<4; ++j){
-                                        std::cout << INFLOW[i][j][m][0] << "\t";
+                                for (int j=0; j<4; ++j){
+                                        std::cout << INFLOW[i][j][m] << "\t";
                                 }
                                 std::cout << std::endl;
                         }
@@ -357,47 +401,105 @@ public:
 #endif
                 }
 
+                return ;
+        }
 
-#ifdef DEBUG
-                std::cout << "Lambda + =\t" << LAMBDA_PLUS[0][0] << "\t" << LAMBDA_PLUS[0][1] << "\t" << LAMBDA_PLUS[0][2] << std::endl;
-                std::cout << "Lambda + =\t" << LAMBDA_PLUS[1][0] << "\t" << LAMBDA_PLUS[1][1] << "\t" << LAMBDA_PLUS[1][2] << std::endl;
-                std::cout << "Lambda + =\t" << LAMBDA_PLUS[2][0] << "\t" << LAMBDA_PLUS[2][1] << "\t" << LAMBDA_PLUS[2][2] << std::endl;
-                std::cout << "Lambda + =\t" << LAMBDA_PLUS[3][0] << "\t" << LAMBDA_PLUS[3][1] << "\t" << LAMBDA_PLUS[3][2] << std::endl;
-
-                std::cout << "Lambda - =\t" << LAMBDA_MINUS[0][0] << "\t" << LAMBDA_MINUS[0][1] << "\t" << LAMBDA_MINUS[0][2] << std::endl;
-                std::cout << "Lambda - =\t" << LAMBDA_MINUS[1][0] << "\t" << LAMBDA_MINUS[1][1] << "\t" << LAMBDA_MINUS[1][2] << std::endl;
-                std::cout << "Lambda - =\t" << LAMBDA_MINUS[2][0] << "\t" << LAMBDA_MINUS[2][1] << "\t" << LAMBDA_MINUS[2][2] << std::endl;
-                std::cout << "Lambda - =\t" << LAMBDA_MINUS[3][0] << "\t" << LAMBDA_MINUS[3][1] << "\t" << LAMBDA_MINUS[3][2] << std::endl;
-
-                std::cout << "Lambda   =\t" << LAMBDA[0][0] << "\t" << LAMBDA[0][1] << "\t" << LAMBDA[0][2] << std::endl;
-                std::cout << "Lambda   =\t" << LAMBDA[1][0] << "\t" << LAMBDA[1][1] << "\t" << LAMBDA[1][2] << std::endl;
-                std::cout << "Lambda   =\t" << LAMBDA[2][0] << "\t" << LAMBDA[2][1] << "\t" << LAMBDA[2][2] << std::endl;
-                std::cout << "Lambda   =\t" << LAMBDA[3][0] << "\t" << LAMBDA[3][1] << "\t" << LAMBDA[3][2] << std::endl;
+#ifdef MOVING_MESH
+        // positive part of an eigenvalue, |L| replaced by (L^2 + DELTA^2)/(2 DELTA) within DELTA of zero
+        static double smooth_positive(double L, double DELTA){
+                double ABS = std::abs(L) < DELTA ? (L*L + DELTA*DELTA)/(2.0*DELTA) : std::abs(L);
+                return 0.5*(L + ABS);
+        }
+
+        // Relative (ALE) residual: PHI_S less the flux of U_S through the moving edges, plus GCL_S = AREA_RATE/3 times
+        // the state of each corner. With U_S and the mesh velocity linear the flux is exactly AREA_RATE times the mean
+        // state plus W_BAR.grad U_S, continuous across shared edges, so PHI_S keeps only the W_BAR part: the linearisation
+        // the distribution uses (eigenvalues less W_BAR.N), however the corner velocities differ. GCL_S goes back to its
+        // own corner outside the distribution, so a uniform state gives PHI_S = 0 and grows with the dual only.
+        void ale_residual(double U_S[4][3], double PHI_S[4], double GCL_S[4][3]){
+                for(int i=0;i<4;++i){
+                        for(int m=0;m<3;++m){
+                                GCL_S[i][m] = AREA_RATE*U_S[i][m]/3.0;
+                                PHI_S[i] -= W_FLUX[m]*U_S[i][m];
+                        }
+                }
+        }
 #endif
 
-//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-                for(i=0;i<4;++i){
-                        PHI[i] = 0.0;
-#ifdef DEBUG
-                        std::cout << "Calculating Phi " << i << std::endl;
+        // true if the half state of all vertices equals the state the first half was calculated from
+        bool unchanged_state(){
+                for(int m=0;m<3;++m){
+                        if(PRESSURE_HALF[m] != PRESSURE[m]){return false;}
+                        for(int i=0;i<4;++i){if(U_HALF[i][m] != U_N[i][m]){return false;}}
+                }
+                return true;
+        }
+
+        // Calculate first half timestep change, passing change to vertice
+        void calculate_first_half(double T, double DT){
+                int i;
+#ifndef CHARACTERISTIC
+                int j,m;
+#elif defined(CLOSED)
+                int m;
 #endif
-                        for(m=0;m<3;++m){
-                                PHI[i] += INFLOW[i][0][m][2]*W_HAT[0][m] + INFLOW[i][1][m][2]*W_HAT[1][m] + INFLOW[i][2][m][2]*W_HAT[2][m] + INFLOW[i][3][m][2]*W_HAT[3][m];
+                double INFLOW[4][4][3];                 // K+ for each vertex
+
+                // Import conditions and positions of vertices
+
+                setup_positions();
+                setup_initial_state();
+
+#ifdef CLOSED
+                for(m=0;m<3;++m){
+                        if(X[m] > 0.99*SIDE_LENGTH_X or X[m] < 0.01*SIDE_LENGTH_X or Y[m] > 0.99*SIDE_LENGTH_Y or Y[m] < 0.01*SIDE_LENGTH_Y){
+                                return ;
                         }
                 }
+#endif
 
 #ifdef DEBUG
-                std::cout << "PHI =\t" << PHI[0] << "\t" << PHI[1] << "\t" << PHI[2] << "\t" << PHI[3] << std::endl;
+                std::cout << "-- FIRST  -------------------------------------------------------" << std::endl;
+                std::cout << "Time     =\t" << T << std::endl;
+                std::cout << "0 =\t" << X[0] << "\t" << Y[0] << std::endl;
+                std::cout << "1 =\t" << X[1] << "\t" << Y[1] << std::endl;
+                std::cout << "2 =\t" << X[2] << "\t" << Y[2] << std::endl;
+                std::cout << "State    =" << "\trho" << "\tx_mom" << "\ty_mom" << "\tenergy" << std::endl;
+                for(i=0;i<3;i++){std::cout << i << " =\t" << U_N[0][i] << "\t" << U_N[1][i] << "\t" << U_N[2][i] << "\t" << U_N[3][i] << std::endl;}
+                std::cout << "Pressure =\t" << PRESSURE[0] << "\t" << PRESSURE[1] << "\t" << PRESSURE[2] << std::endl;
+#endif
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+                // Calculate inflow parameters
+
+                double W_HAT[4][3];
+
+#ifdef CHARACTERISTIC
+                double Z_BAR[4], LIN[3];
+
+                build_inflow(U_N, PRESSURE, W_HAT, PHI, INFLOW, false, Z_BAR, LIN);
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+                // Distribution in the characteristic variables of the Roe state (characteristic.cpp)
+
+#if defined(LDA_SCHEME) or defined(BLENDED)
+                characteristic_distribution<2>(Z_BAR, LIN, HALF_MAG, NORMAL, W_HAT, PHI, NULL, FLUC_LDA, BETA);
+#endif
+#if defined(N_SCHEME) or defined(BLENDED)
+                characteristic_distribution<2>(Z_BAR, LIN, HALF_MAG, NORMAL, W_HAT, PHI, FLUC_N, NULL, NULL);
+#endif
+#else
+                build_inflow(U_N, PRESSURE, W_HAT, PHI, INFLOW, true);
+#ifdef MOVING_MESH
+                ale_residual(U_N, PHI, GCL_SOURCE);
 #endif
 
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
                 double INFLOW_MINUS_SUM[4][4];
 
                 for(i=0;i<4;++i){
                         for(j=0;j<4;++j){
-                                INFLOW_MINUS_SUM[i][j] = 0.0;
-                                for(m=0;m<3;++m){
-                                        INFLOW_MINUS_SUM[i][j] += INFLOW[i][j][m][1];
-                                }
+                                INFLOW_MINUS_SUM[i][j] = -1.0*(INFLOW[i][j][0] + INFLOW[i][j][1] + INFLOW[i][j][2]);
                         }
                 }
 
@@ -425,7 +527,7 @@ public:
                 for(i=0;i<4;++i){
                         for(j=0;j<4;++j){
                                 for(m=0;m<3;++m){
-                                        BETA[i][j][m] = -1.0*(INFLOW[i][0][m][0] * INFLOW_MINUS_SUM[0][j] + INFLOW[i][1][m][0] * INFLOW_MINUS_SUM[1][j] + INFLOW[i][2][m][0] * INFLOW_MINUS_SUM[2][j] + INFLOW[i][3][m][0] * INFLOW_MINUS_SUM[3][j]);
+                                        BETA[i][j][m] = -1.0*(INFLOW[i][0][m] * INFLOW_MINUS_SUM[0][j] + INFLOW[i][1][m] * INFLOW_MINUS_SUM[1][j] + INFLOW[i][2][m] * INFLOW_MINUS_SUM[2][j] + INFLOW[i][3][m] * INFLOW_MINUS_SUM[3][j]);
                                 }
                         }
 #ifdef DEBUG
@@ -447,9 +549,9 @@ public:
                 double KZ_SUM[4];
 
                 for(i=0;i<4;++i){
-                        KZ_SUM[i] = 0.0;
+                        KZ_SUM[i] = PHI[i];
                         for(m=0;m<3;++m){
-                                KZ_SUM[i] += INFLOW[i][0][m][1] * W_HAT[0][m] + INFLOW[i][1][m][1] * W_HAT[1][m] + INFLOW[i][2][m][1] * W_HAT[2][m] + INFLOW[i][3][m][1] * W_HAT[3][m];
+                                KZ_SUM[i] -= INFLOW[i][0][m] * W_HAT[0][m] + INFLOW[i][1][m] * W_HAT[1][m] + INFLOW[i][2][m] * W_HAT[2][m] + INFLOW[i][3][m] * W_HAT[3][m];
                         }
                 }
 
@@ -461,11 +563,12 @@ public:
 
                 for(i=0;i<4;++i){
                         for(m=0;m<3;++m){
-                                FLUC_N[i][m] = INFLOW[i][0][m][0]*BRACKET[0][m] + INFLOW[i][1][m][0]*BRACKET[1][m] + INFLOW[i][2][m][0]*BRACKET[2][m] + INFLOW[i][3][m][0]*BRACKET[3][m];
+                                FLUC_N[i][m] = INFLOW[i][0][m]*BRACKET[0][m] + INFLOW[i][1][m]*BRACKET[1][m] + INFLOW[i][2][m]*BRACKET[2][m] + INFLOW[i][3][m]*BRACKET[3][m];
                                 // std::cout << FLUC_N[i][m] << std::endl;
                         }
                 }
 #endif
+#endif
 
 #ifdef BLENDED
                 double THETA_E[4][4];
@@ -528,6 +631,14 @@ public:
                         DU2_HALF[i] = -1.0*DT*FLUC_B[i][2]/DUAL[2];
                 }
 
+#endif
+
+#ifdef MOVING_MESH
+                for(i=0;i<4;i++){
+                        DU0_HALF[i] += DT*GCL_SOURCE[i][0]/DUAL[0];
+                        DU1_HALF[i] += DT*GCL_SOURCE[i][1]/DUAL[1];
+                        DU2_HALF[i] += DT*GCL_SOURCE[i][2]/DUAL[2];
+                }
 #endif
                 return ;
         }
@@ -539,12 +650,24 @@ public:
                 return ;
         }
 
+        // scatter into a thread private DU buffer at the slots SLOT of its corners instead (DU_PRIVATE, scatter.cpp)
+        void pass_update_half(double *BUF, const int *SLOT){
+                for(int i=0;i<4;++i){
+                        BUF[4*SLOT[0] + i] += DU0_HALF[i];
+                        BUF[4*SLOT[1] + i] += DU1_HALF[i];
+                        BUF[4*SLOT[2] + i] += DU2_HALF[i];
+                }
+        }
+
         //**********************************************************************************************************************
 
 
         void calculate_second_half(double T, double DT){
-                int i,j,m,p;
-                double INFLOW[4][4][3][3];
+                int i,m;
+#if !defined(CHARACTERISTIC) or defined(LDA_SCHEME) or defined(BLENDED)
+                int j;
+#endif
+                double INFLOW[4][4][3];                 // K+ for each vertex
 
                 setup_half_state();
 
@@ -582,191 +705,26 @@ public:
 #endif
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-                // Calculate inflow parameters
-
-                double H[3];
-                double RHO,C,U,U_C,V,V_C,H_AVG,H_C,ALPHA,ALPHA_C,W;
-                double Z[4][3];
-                double VALUE1,VALUE2,VALUE3,VALUE4,VALUE12,VALUE123;
-                double PRESSURE_AVG,C_SOUND_AVG;
-                double LAMBDA[4][3],LAMBDA_PLUS[4][3],LAMBDA_MINUS[4][3];
-                double N_X[3],N_Y[3];
-
-                double Z_BAR[4],W_HAT[4][3];
-
-                // Construct Roe vector Z
-
-                for(m=0;m<3;++m){
-                        Z[0][m] = sqrt(U_HALF[0][m]);
-                        Z[1][m] = U_HALF[1][m]/Z[0][m];
-                        Z[2][m] = U_HALF[2][m]/Z[0][m];
-                        Z[3][m] = (U_HALF[3][m] + PRESSURE_HALF[m])/Z[0][m];
-
-                        N_X[m]  = NORMAL[m][0];
-                        N_Y[m]  = NORMAL[m][1];
-
-                        H[m] = (U_HALF[3][m] + PRESSURE_HALF[m])/U_HALF[0][m];
-#ifdef DEBUG
-                        std::cout << "Z =\t" << Z[0][m] << "\t" << Z[1][m] << "\t" << Z[2][m] << "\t" << Z[3][m] << std::endl;
-#endif
-                }
-
-                for(i=0; i<4; ++i){Z_BAR[i] = (Z[i][0] + Z[i][1] + Z[i][2])/3.0;}
-
-#ifdef DEBUG
-                for(i=0; i<4; ++i){std::cout << "Z_BAR " << i << " =\t" << Z_BAR[i] << std::endl;}
-                std::cout << std::endl;
+                // Calculate inflow parameters (stage one data is reused if no vertex state changed since the first half)
+
+                double W_HAT[4][3], PHI_HALF[4];
+                bool REUSE = unchanged_state();
+
+                // the LDA scheme reuses BETA of the first half and needs only the residual
+#if defined(CHARACTERISTIC) and (defined(N_SCHEME) or defined(BLENDED))
+                double Z_BAR[4], LIN[3];
+                if(not REUSE){build_inflow(U_HALF, PRESSURE_HALF, W_HAT, PHI_HALF, INFLOW, false, Z_BAR, LIN);}
+#elif defined(N_SCHEME) or defined(BLENDED)
+                if(not REUSE){build_inflow(U_HALF, PRESSURE_HALF, W_HAT, PHI_HALF, INFLOW, true);}
+#else
+                if(not REUSE){build_inflow(U_HALF, PRESSURE_HALF, W_HAT, PHI_HALF, INFLOW, false);}
 #endif
-
-
-                for(m=0; m<3; ++m){
-                        W_HAT[0][m] =  2.0*Z_BAR[0]*Z[0][m];
-                        W_HAT[1][m] =  Z_BAR[1]*Z[0][m] + Z_BAR[0]*Z[1][m];
-                        W_HAT[2][m] =  Z_BAR[2]*Z[0][m] + Z_BAR[0]*Z[2][m];
-                        W_HAT[3][m] = (Z_BAR[3]*Z[0][m] + GAMMA_1*Z_BAR[1]*Z[1][m] + GAMMA_1*Z_BAR[2]*Z[2][m] + Z_BAR[0]*Z[3][m])/GAMMA;
-
-                        //std::cout << Z_BAR[1] << "\t" << Z[0][m] << "\t" << Z_BAR[0] << "\t" << Z[2][m] << std::endl;
-
-#ifdef DEBUG
-                        for(i=0;i<4;++i){std::cout << "W_HAT " << i << "\t" << m << " =\t" << W_HAT[i][m] << std::endl;}
-                        std::cout << std::endl;
-#endif
-                }
-
-                // Construct average state for element
-
-                RHO   = pow((sqrt(U_HALF[0][0]) + sqrt(U_HALF[0][1]) + sqrt(U_HALF[0][2]))/3.0, 2);
-                U     = (sqrt(U_HALF[0][0])*U_HALF[1][0]/U_HALF[0][0] + sqrt(U_HALF[0][1])*U_HALF[1][1]/U_HALF[0][1] + sqrt(U_HALF[0][2])*U_HALF[1][2]/U_HALF[0][2])/(sqrt(U_HALF[0][0]) + sqrt(U_HALF[0][1]) + sqrt(U_HALF[0][2]));        // U now represents x velocity
-                V     = (sqrt(U_HALF[0][0])*U_HALF[2][0]/U_HALF[0][0] + sqrt(U_HALF[0][1])*U_HALF[2][1]/U_HALF[0][1] + sqrt(U_HALF[0][2])*U_HALF[2][2]/U_HALF[0][2])/(sqrt(U_HALF[0][0]) + sqrt(U_HALF[0][1]) + sqrt(U_HALF[0][2]));        // V represents y velocity
-                H_AVG = (sqrt(U_HALF[0][0])*H[0] + sqrt(U_HALF[0][1])*H[1] + sqrt(U_HALF[0][2])*H[2])/(sqrt(U_HALF[0][0]) + sqrt(U_HALF[0][1]) + sqrt(U_HALF[0][2]));
-               
-                // E     = (sqrt(U_N[0][0])*H[0]/U_N[0][0] + sqrt(U_N[0][1])*H[1]/U_N[0][1] + sqrt(U_N[0][2])*H[2]/U_N[0][2])/(sqrt(U_N[0][0]) + sqrt(U_N[0][1]) + sqrt(U_N[0][2]));
-
-                PRESSURE_AVG = (PRESSURE_HALF[0] + PRESSURE_HALF[1] + PRESSURE_HALF[2])/3.0;
-                C = sqrt((GAMMA-1.0) * H_AVG - (GAMMA-1.0) * (U*U + V*V)/2.0);
-
-#ifdef DEBUG
-                std::cout << "PRESSURE_AVG =\t" << PRESSURE_AVG << std::endl;
-                std::cout << "C_SOUND_AVG  =\t" << C_SOUND_AVG  << std::endl;
-#endif
-
-                // Reassign variables to local equivalents
-
-                U_C = U/C;
-                V_C = V/C;
-                H_C = H_AVG/C;
-
-                ALPHA   = GAMMA_1*(U*U + V*V)/2.0;
-                ALPHA_C = ALPHA/C;
-
-#ifdef DEBUG
-                std::cout << "U =\t" << U << "\tU_C =\t" << U_C << std::endl;
-                std::cout << "V =\t" << V << "\tV_C =\t" << V_C << std::endl;
-                std::cout << "H =\t" << H_AVG << "\tH_C =\t" << H_C << std::endl;
-                std::cout << "ALPHA =\t" << ALPHA << "\tALPHA_C =\t" << ALPHA_C << std::endl;
-                std::cout << std::endl;
-#endif
-
-                // Calculate K+,K- and K matrices for each vertex i,j,k
-
-                for(m=0;m<3;++m){
-
-                        W = U*N_X[m] + V*N_Y[m];
-
-#ifdef DEBUG
-                        std::cout << "W =\t" << W << std::endl;
-#endif
-
-                        LAMBDA[0][m] = W + C;
-                        LAMBDA[1][m] = W - C;
-                        LAMBDA[2][m] = W;
-                        LAMBDA[3][m] = W;
-
-                        for(i=0;i<4;++i){
-                                LAMBDA_PLUS[i][m]  = max_val(0.0,LAMBDA[i][m]);
-                                LAMBDA_MINUS[i][m] = min_val(0.0,LAMBDA[i][m]);
-                        } 
-
-                        for(p=0;p<3;++p){
-                                if(p==0){       // Identify and select positive eigenvalues
-                                        VALUE1 = LAMBDA_PLUS[0][m];
-                                        VALUE2 = LAMBDA_PLUS[1][m];
-                                        VALUE3 = LAMBDA_PLUS[2][m];
-                                        VALUE4 = LAMBDA_PLUS[3][m];
-#ifdef DEBUG
-                                        std::cout << "K+" << std::endl;
-#endif
-                                }else if(p==1){ // Identify and select negative eigenvalues
-                                        VALUE1 = LAMBDA_MINUS[0][m];
-                                        VALUE2 = LAMBDA_MINUS[1][m];
-                                        VALUE3 = LAMBDA_MINUS[2][m];
-                                        VALUE4 = LAMBDA_MINUS[3][m];
-#ifdef DEBUG
-                                        std::cout << "K-" << std::endl;
-#endif
-                                }else{          // Select all eigenvalues
-                                        VALUE1 = LAMBDA[0][m];
-                                        VALUE2 = LAMBDA[1][m];
-                                        VALUE3 = LAMBDA[2][m];
-                                        VALUE4 = LAMBDA[3][m];
-#ifdef DEBUG
-                                        std::cout << "K" << std::endl;
-#endif
-                                }
-
-
-                                VALUE12  = (VALUE1 - VALUE2)/2.0;
-                                VALUE123 = (VALUE1 + VALUE2 - 2.0*VALUE3)/2.0;
-
-                                INFLOW[0][0][m][p] = 0.5*MAG[m]*(ALPHA_C*VALUE123/C - W*VALUE12/C + VALUE3);
-                                INFLOW[0][1][m][p] = 0.5*MAG[m]*(-1.0*GAMMA_1*U_C*VALUE123/C + N_X[m]*VALUE12/C);
-                                INFLOW[0][2][m][p] = 0.5*MAG[m]*(-1.0*GAMMA_1*V_C*VALUE123/C + N_Y[m]*VALUE12/C);
-                                INFLOW[0][3][m][p] = 0.5*MAG[m]*(GAMMA_1*VALUE123/(C*C));
-
-                                INFLOW[1][0][m][p] = 0.5*MAG[m]*((ALPHA_C*U_C - W*N_X[m])*VALUE123 + (ALPHA_C*N_X[m] - U_C*W)*VALUE12);
-                                INFLOW[1][1][m][p] = 0.5*MAG[m]*((N_X[m]*N_X[m] - GAMMA_1*U_C*U_C)*VALUE123 - (GAMMA_2*U_C*N_X[m]*VALUE12) + VALUE3);
-                                INFLOW[1][2][m][p] = 0.5*MAG[m]*((N_X[m]*N_Y[m] - GAMMA_1*U_C*V_C)*VALUE123 + (U_C*N_Y[m] - GAMMA_1*V_C*N_X[m])*VALUE12);
-                                INFLOW[1][3][m][p] = 0.5*MAG[m]*(GAMMA_1*U_C*VALUE123/C + GAMMA_1*N_X[m]*VALUE12/C);
-
-                                INFLOW[2][0][m][p] = 0.5*MAG[m]*((ALPHA_C*V_C - W*N_Y[m])*VALUE123 + (ALPHA_C*N_Y[m] - V_C*W)*VALUE12);
-                                INFLOW[2][1][m][p] = 0.5*MAG[m]*((N_X[m]*N_Y[m] - GAMMA_1*U_C*V_C)*VALUE123 + (V_C*N_X[m] - GAMMA_1*U_C*N_Y[m])*VALUE12);
-                                INFLOW[2][2][m][p] = 0.5*MAG[m]*((N_Y[m]*N_Y[m] - GAMMA_1*V_C*V_C)*VALUE123 - (GAMMA_2*V_C*N_Y[m]*VALUE12) + VALUE3);
-                                INFLOW[2][3][m][p] = 0.5*MAG[m]*(GAMMA_1*V_C*VALUE123/C + GAMMA_1*N_Y[m]*VALUE12/C);
-
-                                INFLOW[3][0][m][p] = 0.5*MAG[m]*((ALPHA_C*H_C - W*W)*VALUE123 + W*(ALPHA_C - H_C)*VALUE12);
-                                INFLOW[3][1][m][p] = 0.5*MAG[m]*((W*N_X[m] - U - ALPHA_C*U_C)*VALUE123 + (H_C*N_X[m] - GAMMA_1*U_C*W)*VALUE12);
-                                INFLOW[3][2][m][p] = 0.5*MAG[m]*((W*N_Y[m] - V - ALPHA_C*V_C)*VALUE123 + (H_C*N_Y[m] - GAMMA_1*V_C*W)*VALUE12);
-                                INFLOW[3][3][m][p] = 0.5*MAG[m]*(GAMMA_1*H_C*VALUE123/C + GAMMA_1*W*VALUE12/C + VALUE3);
-
-#ifdef DEBUG
-                                for(i=0; i<4; ++i){
-                                        for (j=0; j<4; ++j){
-                                                std::cout << INFLOW[i][j][m][p] << "\t";
-                                        }
-                                        std::cout << std::endl;
-                                }
-                                std::cout << std::endl;
-#endif
-                        }
-                }
-
-
-#ifdef DEBUG
-                std::cout << "Lambda + =\t" << LAMBDA_PLUS[0][0] << "\t" << LAMBDA_PLUS[0][1] << "\t" << LAMBDA_PLUS[0][2] << std::endl;
-                std::cout << "Lambda + =\t" << LAMBDA_PLUS[1][0] << "\t" << LAMBDA_PLUS[1][1] << "\t" << LAMBDA_PLUS[1][2] << std::endl;
-                std::cout << "Lambda + =\t" << LAMBDA_PLUS[2][0] << "\t" << LAMBDA_PLUS[2][1] << "\t" << LAMBDA_PLUS[2][2] << std::endl;
-                std::cout << "Lambda + =\t" << LAMBDA_PLUS[3][0] << "\t" << LAMBDA_PLUS[3][1] << "\t" << LAMBDA_PLUS[3][2] << std::endl;
-
-                std::cout << "Lambda - =\t" << LAMBDA_MINUS[0][0] << "\t" << LAMBDA_MINUS[0][1] << "\t" << LAMBDA_MINUS[0][2] << std::endl;
-                std::cout << "Lambda - =\t" << LAMBDA_MINUS[1][0] << "\t" << LAMBDA_MINUS[1][1] << "\t" << LAMBDA_MINUS[1][2] << std::endl;
-                std::cout << "Lambda - =\t" << LAMBDA_MINUS[2][0] << "\t" << LAMBDA_MINUS[2][1] << "\t" << LAMBDA_MINUS[2][2] << std::endl;
-                std::cout << "Lambda - =\t" << LAMBDA_MINUS[3][0] << "\t" << LAMBDA_MINUS[3][1] << "\t" << LAMBDA_MINUS[3][2] << std::endl;
-
-                std::cout << "Lambda   =\t" << LAMBDA[0][0] << "\t" << LAMBDA[0][1] << "\t" << LAMBDA[0][2] << std::endl;
-                std::cout << "Lambda   =\t" << LAMBDA[1][0] << "\t" << LAMBDA[1][1] << "\t" << LAMBDA[1][2] << std::endl;
-                std::cout << "Lambda   =\t" << LAMBDA[2][0] << "\t" << LAMBDA[2][1] << "\t" << LAMBDA[2][2] << std::endl;
-                std::cout << "Lambda   =\t" << LAMBDA[3][0] << "\t" << LAMBDA[3][1] << "\t" << LAMBDA[3][2] << std::endl;
+#ifdef MOVING_MESH
+                double GCL_HALF[4][3];
+                if(not REUSE){ale_residual(U_HALF, PHI_HALF, GCL_HALF);}
+                if(REUSE){for(i=0;i<4;++i){for(m=0;m<3;++m){GCL_HALF[i][m] = GCL_SOURCE[i][m];}}}
 #endif
+                if(REUSE){for(i=0;i<4;++i){PHI_HALF[i] = PHI[i];}}
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
@@ -774,16 +732,8 @@ public:
 
 #if defined(LDA_SCHEME) or defined(BLENDED)
 
-                double PHI_HALF[4];
                 double SECOND_FLUC_LDA[4][3];
 
-                for(i=0;i<4;++i){
-                        PHI_HALF[i] = 0.0;
-                        for(m=0;m<3;++m){
-                                PHI_HALF[i] += INFLOW[i][0][m][2]*W_HAT[0][m] + INFLOW[i][1][m][2]*W_HAT[1][m] + INFLOW[i][2][m][2]*W_HAT[2][m] + INFLOW[i][3][m][2]*W_HAT[3][m];
-                        }
-                }
-
                 // Calculate spatial splitting for first half timestep
 
                 for(i=0;i<4;++i){
@@ -806,7 +756,7 @@ public:
 
                 for(i=0;i<4;++i){
                         for(j=0;j<4;++j){
-                                for(m=0;m<3;++m){MASS[i][j][m] = AREA * BETA[i][j][m]/3.0;}
+                                for(m=0;m<3;++m){MASS[i][j][m] = AREA_THIRD * BETA[i][j][m];}
                         }
                 }
 
@@ -865,46 +815,53 @@ public:
 
 #if defined(N_SCHEME) or defined(BLENDED)
 
-                double INFLOW_MINUS_SUM[4][4];
                 double SECOND_FLUC_N[4][3];
+                double AREA_DIFF[4][3];
 
-                for(i=0;i<4;++i){
-                        for(j=0;j<4;++j){
-                                INFLOW_MINUS_SUM[i][j] = 0.0;
-                                for(m=0;m<3;++m){
-                                        INFLOW_MINUS_SUM[i][j] += INFLOW[i][j][m][1];
-                                }
+                if(REUSE){
+                        for(i=0;i<4;++i){
+                                for(m=0;m<3;++m){FLUC_HALF_N[i][m] = FLUC_N[i][m];}
                         }
-                }
+                }else{
+#ifdef CHARACTERISTIC
+                        characteristic_distribution<2>(Z_BAR, LIN, HALF_MAG, NORMAL, W_HAT, PHI_HALF, FLUC_HALF_N, NULL, NULL);
+#else
+                        double INFLOW_MINUS_SUM[4][4];
+                        double BRACKET[4][3];
+                        double KZ_SUM[4];
 
-                mat_inv(&INFLOW_MINUS_SUM[0][0],4,X[0],Y[0],ID,2);
+                        for(i=0;i<4;++i){
+                                for(j=0;j<4;++j){
+                                        INFLOW_MINUS_SUM[i][j] = -1.0*(INFLOW[i][j][0] + INFLOW[i][j][1] + INFLOW[i][j][2]);
+                                }
+                        }
 
-                double AREA_DIFF[4][3];
-                double BRACKET[4][3];
-                double KZ_SUM[4];
+                        mat_inv(&INFLOW_MINUS_SUM[0][0],4,X[0],Y[0],ID,2);
 
-                for(i=0;i<4;++i){
-                        KZ_SUM[i] = 0.0;
-                        for(m=0;m<3;++m){
-                                KZ_SUM[i] += INFLOW[i][0][m][1] * W_HAT[0][m] + INFLOW[i][1][m][1] * W_HAT[1][m] + INFLOW[i][2][m][1] * W_HAT[2][m] + INFLOW[i][3][m][1] * W_HAT[3][m];
+                        for(i=0;i<4;++i){
+                                KZ_SUM[i] = PHI_HALF[i];
+                                for(m=0;m<3;++m){
+                                        KZ_SUM[i] -= INFLOW[i][0][m] * W_HAT[0][m] + INFLOW[i][1][m] * W_HAT[1][m] + INFLOW[i][2][m] * W_HAT[2][m] + INFLOW[i][3][m] * W_HAT[3][m];
+                                }
                         }
-                }
 
-                for(i=0;i<4;++i){
-                        for(m=0;m<3;++m){
-                                BRACKET[i][m] = W_HAT[i][m] - (INFLOW_MINUS_SUM[i][0]*KZ_SUM[0] + INFLOW_MINUS_SUM[i][1]*KZ_SUM[1] + INFLOW_MINUS_SUM[i][2]*KZ_SUM[2] + INFLOW_MINUS_SUM[i][3]*KZ_SUM[3]);
+                        for(i=0;i<4;++i){
+                                for(m=0;m<3;++m){
+                                        BRACKET[i][m] = W_HAT[i][m] - (INFLOW_MINUS_SUM[i][0]*KZ_SUM[0] + INFLOW_MINUS_SUM[i][1]*KZ_SUM[1] + INFLOW_MINUS_SUM[i][2]*KZ_SUM[2] + INFLOW_MINUS_SUM[i][3]*KZ_SUM[3]);
+                                }
                         }
-                }
 
-                for(i=0;i<4;++i){
-                        for(m=0;m<3;++m){
-                                FLUC_HALF_N[i][m] = INFLOW[i][0][m][0]*BRACKET[0][m] + INFLOW[i][1][m][0]*BRACKET[1][m] + INFLOW[i][2][m][0]*BRACKET[2][m] + INFLOW[i][3][m][0]*BRACKET[3][m];
+                        for(i=0;i<4;++i){
+                                for(m=0;m<3;++m){
+                                        FLUC_HALF_N[i][m] = INFLOW[i][0][m]*BRACKET[0][m] + INFLOW[i][1][m]*BRACKET[1][m] + INFLOW[i][2][m]*BRACKET[2][m] + INFLOW[i][3][m]*BRACKET[3][m];
+                                }
                         }
+#endif
                 }
 
                 for(i=0;i<4;++i){
                         for(m=0;m<3;++m){
-                                AREA_DIFF[i][m] = AREA*(U_HALF[i][m] - U_N[i][m])/3.0;
+                                AREA_DIFF[i][m] = AREA_THIRD*(U_HALF[i][m] - U_N[i][m]);
                         }
                 }
 
@@ -983,6 +940,14 @@ public:
                 }
 #endif
 
+#ifdef MOVING_MESH
+                for(i=0;i<4;i++){
+                        DU0[i] += DT*(GCL_SOURCE[i][0] + GCL_HALF[i][0])/(2.0*DUAL[0]);
+                        DU1[i] += DT*(GCL_SOURCE[i][1] + GCL_HALF[i][1])/(2.0*DUAL[1]);
+                        DU2[i] += DT*(GCL_SOURCE[i][2] + GCL_HALF[i][2])/(2.0*DUAL[2]);
+                }
+#endif
+
                 return ;
         }
 
@@ -993,36 +958,40 @@ public:
                 return ;
         }
 
-        // Returns Roe average of left and right states
-        double roe_avg(double L1, double L2, double R1, double R2){
-                double AVG;
-                AVG = (sqrt(L1)*L2+sqrt(R1)*R2)/(sqrt(L1)+sqrt(R1));
-                return AVG;
+        // scatter into a thread private DU buffer at the slots SLOT of its corners instead (DU_PRIVATE, scatter.cpp)
+        void pass_update(double *BUF, const int *SLOT){
+                for(int i=0;i<4;++i){
+                        BUF[4*SLOT[0] + i] += DU0[i];
+                        BUF[4*SLOT[1] + i] += DU1[i];
+                        BUF[4*SLOT[2] + i] += DU2[i];
+                }
         }
 
-        void setup_normals(){
-                // Calculate normals (just in first timestep for static grid)
-                int m;
+#ifdef MPI_RD
+        // residuals of the corners kept between evaluations (DRIFT scatters them again until the bin is next due), moved
+        // with the triangle when it changes rank (domain.cpp)
+        static int stored_size(){return 24;}
 
-                setup_positions();
-
-                for(int m=0; m<3; ++m){X_MOD[m] = X[m];Y_MOD[m] = Y[m];}
+        void get_stored(double *BUF){
+                for(int i=0;i<4;++i){
+                        BUF[i]    = DU0[i];      BUF[4+i]  = DU1[i];      BUF[8+i]  = DU2[i];
+                        BUF[12+i] = DU0_HALF[i]; BUF[16+i] = DU1_HALF[i]; BUF[20+i] = DU2_HALF[i];
+                }
+        }
 
-#ifdef PERIODIC_BOUNDARY
-                if(BOUNDARY == 1){
-                        for(int i=0; i<3; ++i){
-                                for(int j=0; j<3; ++j){
-                                        if(X[j] - X[i] > 0.5*SIDE_LENGTH_X){
-                                                X_MOD[i] = X[i] + SIDE_LENGTH_X;
-                                        }
-                                        if(Y[j] - Y[i] > 0.5*SIDE_LENGTH_Y){
-                                                Y_MOD[i] = Y[i] + SIDE_LENGTH_Y;
-                                        }
-                                }
-                        }
+        void set_stored(const double *BUF){
+                for(int i=0;i<4;++i){
+                        DU0[i]      = BUF[i];    DU1[i]      = BUF[4+i];  DU2[i]      = BUF[8+i];
+                        DU0_HALF[i] = BUF[12+i]; DU1_HALF[i] = BUF[16+i]; DU2_HALF[i] = BUF[20+i];
                 }
+        }
 #endif
 
+        void setup_normals(bool ADD_DUAL = true){
+                // Calculate normals (just in first timestep for static grid)
+                setup_positions();
+                setup_positions_mod();
+
                 // check vertices are ordered counter-clockwise
 
                 double X0,X1,X2,Y0,Y1,Y2;
@@ -1048,48 +1017,92 @@ public:
                         reorder_vertices();
                 }
                 
-                calculate_normals(X_MOD,Y_MOD);
+                calculate_normals(X_MOD,Y_MOD,ADD_DUAL);
 
                 return ;
 
         }
 
-        void calculate_normals(double X[3],double Y[3]){
-                int i;
-                double PERP[3][2];
+        // area, edge normals and the dual contributions (geometry.h)
+        void calculate_normals(double X[3],double Y[3],bool ADD_DUAL = true){
+                AREA = triangle_geometry(X, Y, NORMAL, MAG);
+                AREA_THIRD = AREA/3.0;
+
+                if(ADD_DUAL){add_dual();}
 
-                PERP[0][0] = (Y[1] - Y[2]);
-                PERP[0][1] = (X[2] - X[1]);
+                for(int i=0;i<3;i++){HALF_MAG[i] = 0.5*MAG[i];}
 
-                PERP[1][0] = (Y[2] - Y[0]);
-                PERP[1][1] = (X[0] - X[2]);
+                return ;
+        }
 
-                PERP[2][0] = (Y[0] - Y[1]);
-                PERP[2][1] = (X[1] - X[0]);
+        // pass 1/3 of the area to each vertex dual (left to the caller when the normals are set up in parallel)
+        void add_dual(){
+                VERTEX_0->calculate_dual(AREA_THIRD);
+                VERTEX_1->calculate_dual(AREA_THIRD);
+                VERTEX_2->calculate_dual(AREA_THIRD);
+        }
 
-                // calculate area of triangle and pass 1/3 to each vertex for dual
+#ifdef MOVING_MESH
+        // geometry at the current (moved) vertex positions, without reordering (inversion is left to quality()), and
+        // the rate of change of the area and the mean mesh velocity flux of each corner
+        void update_geometry(){
+                VERTEX *V[3] = {VERTEX_0, VERTEX_1, VERTEX_2};
 
-                double THETA0 = atan(PERP[0][1]/PERP[0][0]);
-                double THETA1 = atan(PERP[1][1]/PERP[1][0]);
+                setup_positions();
+                setup_positions_mod();
+                calculate_normals(X_MOD,Y_MOD,false);
+
+                AREA_RATE = W_BAR[0] = W_BAR[1] = 0.0;
+                for(int m=0;m<3;++m){
+                        W_MESH[m][0] = V[m]->get_mesh_vel(0);
+                        W_MESH[m][1] = V[m]->get_mesh_vel(1);
+                        AREA_RATE += HALF_MAG[m]*(NORMAL[m][0]*W_MESH[m][0] + NORMAL[m][1]*W_MESH[m][1]);
+                        W_BAR[0]  += W_MESH[m][0]/3.0;
+                        W_BAR[1]  += W_MESH[m][1]/3.0;
+                }
+                for(int m=0;m<3;++m){W_FLUX[m] = HALF_MAG[m]*(NORMAL[m][0]*W_BAR[0] + NORMAL[m][1]*W_BAR[1]);}
+        }
 
-                double THETA = std::abs(THETA0 - THETA1);
+        // take back the contribution of add_dual, before the triangle is replaced by an edge flip (moving_mesh.cpp)
+        void remove_dual(){
+                VERTEX_0->calculate_dual(-AREA_THIRD);
+                VERTEX_1->calculate_dual(-AREA_THIRD);
+                VERTEX_2->calculate_dual(-AREA_THIRD);
+        }
 
-                if(THETA > 3.14159/2.0){THETA = 3.14159 - THETA;}
+        void add_dual_rate(){
+                VERTEX_0->add_dual_rate(AREA_RATE/3.0);
+                VERTEX_1->add_dual_rate(AREA_RATE/3.0);
+                VERTEX_2->add_dual_rate(AREA_RATE/3.0);
+        }
 
-                AREA = 0.5*(sqrt(PERP[0][0]*PERP[0][0] + PERP[0][1]*PERP[0][1])*sqrt(PERP[1][0]*PERP[1][0] + PERP[1][1]*PERP[1][1]))*sin(THETA);
+        // part of each vertex dual in this triangle (AREA/3) times its centroid offset from the vertex: the centroid of
+        // the part is (22 X_i + 7 X_j + 7 X_k)/36
+        void add_centroid_offset(){
+                VERTEX *V[3] = {VERTEX_0, VERTEX_1, VERTEX_2};
 
-                VERTEX_0->calculate_dual(AREA/3.0);
-                VERTEX_1->calculate_dual(AREA/3.0);
-                VERTEX_2->calculate_dual(AREA/3.0);
+                setup_positions();
+                setup_positions_mod();
+                double AREA_7 = 7.0*std::abs((X_MOD[1] - X_MOD[0])*(Y_MOD[2] - Y_MOD[0]) - (Y_MOD[1] - Y_MOD[0])*(X_MOD[2] - X_MOD[0]))/216.0;
 
-                for(i=0;i<3;i++){
-                        MAG[i] = sqrt(PERP[i][0]*PERP[i][0]+PERP[i][1]*PERP[i][1]);
-                        NORMAL[i][0] = PERP[i][0]/MAG[i];
-                        NORMAL[i][1] = PERP[i][1]/MAG[i];
+                for(int m=0;m<3;++m){
+                        int J = (m + 1) % 3, K = (m + 2) % 3;
+                        V[m]->add_centroid_offset(AREA_7*(X_MOD[J] + X_MOD[K] - 2.0*X_MOD[m]), AREA_7*(Y_MOD[J] + Y_MOD[K] - 2.0*Y_MOD[m]));
                 }
+        }
 
-                return ;
+        // 4 sqrt(3) AREA over the sum of the squared edges: 1 equilateral, 0 degenerate, negative if inverted
+        double quality(){
+                setup_positions();
+                setup_positions_mod();
+
+                double L1X = X_MOD[1] - X_MOD[0], L1Y = Y_MOD[1] - Y_MOD[0];
+                double L2X = X_MOD[2] - X_MOD[0], L2Y = Y_MOD[2] - Y_MOD[0];
+                double L3X = X_MOD[2] - X_MOD[1], L3Y = Y_MOD[2] - Y_MOD[1];
+
+                return 2.0*sqrt(3.0)*(L1X*L2Y - L1Y*L2X)/(L1X*L1X + L1Y*L1Y + L2X*L2X + L2Y*L2Y + L3X*L3X + L3Y*L3Y);
         }
+#endif
 
         void calculate_len_vel_contribution(){
                 int m;
@@ -1111,17 +1124,43 @@ public:
 
                 // std::cout << LMAX << std::endl;
 
+#ifdef MOVING_MESH
+                VERTEX *V_M[3] = {VERTEX_0, VERTEX_1, VERTEX_2};
+#endif
+
                 for(m=0;m<3;++m){
                         H = (U_N[3][m] + PRESSURE[m])/U_N[0][m];
                         U = U_N[1][m]/U_N[0][m];
                         V = U_N[2][m]/U_N[0][m];
                         VEL[m] = sqrt(U*U + V*V);
-                        C_SOUND[m] = sqrt((GAMMA-1.0) * H - (GAMMA-1.0) * (U*U + V*V)/2.0);
+                        C_SOUND[m] = sqrt(EOS::sound_speed_sq_enthalpy(U_N[0][m], H, U*U + V*V));
+#ifdef MOVING_MESH
+                        U -= V_M[m]->get_mesh_vel(0);                           // signal speed relative to the moving vertex
+                        V -= V_M[m]->get_mesh_vel(1);
+                        VEL[m] = sqrt(U*U + V*V);
+#endif
                 }
 
                 VMAX = max_val((VEL[0] + C_SOUND[0]),(VEL[1] + C_SOUND[1]));
                 VMAX = max_val(VMAX,(VEL[2] + C_SOUND[2]));
 
+#ifdef MOVING_MESH
+                // the vertices must not overtake each other within a step, nor cross more than CFL of the smallest
+                // altitude (a thin triangle inverts long before its longest edge is crossed)
+                double DW_MAX = 0.0;
+                for(m=0;m<3;++m){
+                        int K = (m + 1) % 3;
+                        double DWX = V_M[K]->get_mesh_vel(0) - V_M[m]->get_mesh_vel(0);
+                        double DWY = V_M[K]->get_mesh_vel(1) - V_M[m]->get_mesh_vel(1);
+                        DW_MAX = max_val(DW_MAX, sqrt(DWX*DWX + DWY*DWY));
+                }
+                VMAX = max_val(VMAX, DW_MAX);
+                if(DW_MAX > 0.0){
+                        double H_MIN = std::abs((X_MOD[1] - X_MOD[0])*(Y_MOD[2] - Y_MOD[0]) - (Y_MOD[1] - Y_MOD[0])*(X_MOD[2] - X_MOD[0]))/LMAX;
+                        for(m=0;m<3;++m){V_M[m]->limit_dt_mesh(CFL*H_MIN/DW_MAX);}
+                }
+#endif
+
                 CONT = LMAX * VMAX;
 
                 VERTEX_0->update_len_vel_sum(CONT);
@@ -1156,6 +1195,8 @@ public:
                 VERTEX_1 = VERTEX_2;
                 VERTEX_2 = TEMP_VERTEX;
 
+                std::swap(SHIFT[1], SHIFT[2]);
+
                 return;
         }
 
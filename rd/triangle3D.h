@@ -4,6 +4,7 @@
         *VERTEX_1 => pointers to VERTEX 1 of triangle
         *VERTEX_2 => pointers to VERTEX 2 of triangle
         BOUNDARY  => 0 or 1, denoted whether triangle crosses boundary
+        SHIFT     => periodic image of each vertex, bit k adds the box side along axis k (set once at mesh load)
         AREA => area of triangle
         X,Y  => vertex coordinates for 0,1,2
         DUAL => area of dual cells corresponding to each vertex
@@ -19,9 +20,15 @@
         PRESSURE_HALF = pressure of iintermediate state at each vertex
         PHI => element residual
         BETA => distribution coefficient defined by chosen scheme
-        MAG => length of normal to each edge
+        MAG => length of normal to each face, twice its area
 */
 
+// The second half needs the Roe linearisation for the N scheme, and for the LDA scheme only when PHI_HALF is sum K W_HAT
+// (matrix scheme, ideal gas). Otherwise PHI_HALF comes from the Roe vectors and BETA is kept from the first half.
+#if defined(N_SCHEME) or defined(BLENDED) or !(defined(CHARACTERISTIC) or defined(EOS_NON_IDEAL))
+#define SECOND_HALF_LINEARISE
+#endif
+
 class TRIANGLE{
 
 private:
@@ -29,6 +36,7 @@ private:
         VERTEX *VERTEX_0,*VERTEX_1,*VERTEX_2,*VERTEX_3;
 
         int BOUNDARY;
+        int SHIFT[4];
         int TBIN;
 
         double VOLUME;
@@ -65,6 +73,7 @@ public:
         void set_vertex_3(VERTEX* NEW_VERTEX){VERTEX_3 = NEW_VERTEX;}
 
         void set_boundary(int NEW_BOUNDARY){BOUNDARY = NEW_BOUNDARY;}
+        void set_shift(int m, int NEW_SHIFT){SHIFT[m] = NEW_SHIFT;}
         void set_tbin(    int NEW_TBIN){TBIN = NEW_TBIN;}
 
         int get_id(){return ID;}
@@ -75,6 +84,7 @@ public:
         VERTEX* get_vertex_3(){return VERTEX_3;}
 
         int get_boundary(){return BOUNDARY;}
+        int get_shift(int m){return SHIFT[m];}
         int get_tbin(){ return TBIN;}
 
         double get_un00(){
@@ -203,8 +213,11 @@ public:
 
         // Calculate first half timestep change, passing change to vertice
         void calculate_first_half(double T, double DT){
-                int i,j,m,p;
+                int i,m;
+#ifndef CHARACTERISTIC
+                int j,p;
                 double INFLOW[5][5][4][3];        // K+, K-, K matrices for each vertex (m index for vertices, p index for +,-,0)
+#endif
 
                 // Import conditions and positions of vertices
 
@@ -216,12 +229,14 @@ public:
                 // Calculate inflow parameters
 
                 double H[4];
-                double RHO,C,VX,VX_C,VY,VY_C,VZ,VZ_C,H_AVG,H_C,ALPHA,ALPHA_C,W,NORM=1.0/3.0;
+                double RHO,C,VX,VY,VZ,H_AVG,ALPHA,NORM=1.0/3.0;
                 double Z_ROE[5][4];
+#ifndef CHARACTERISTIC
+                double VX_C,VY_C,VZ_C,H_C,ALPHA_C,W;
                 double VALUE1,VALUE2,VALUE3,VALUE12,VALUE123;
-                double PRESSURE_AVG;
                 double LAMBDA[5][4],LAMBDA_PLUS[5][4],LAMBDA_MINUS[5][4];
                 double N_X[4],N_Y[4],N_Z[4];
+#endif
 
                 double Z_BAR[5],W_HAT[5][4];
 
@@ -233,10 +248,11 @@ public:
                         Z_ROE[2][m] = U_N[2][m]/Z_ROE[0][m];
                         Z_ROE[3][m] = U_N[3][m]/Z_ROE[0][m];
                         Z_ROE[4][m] = (U_N[4][m] + PRESSURE[m])/Z_ROE[0][m];
-
+#ifndef CHARACTERISTIC
                         N_X[m]  = NORMAL[m][0];
                         N_Y[m]  = NORMAL[m][1];
                         N_Z[m]  = NORMAL[m][2];
+#endif
 
                         H[m] = (U_N[4][m] + PRESSURE[m])/U_N[0][m];
                 }
@@ -248,7 +264,9 @@ public:
                         W_HAT[1][m] =  Z_BAR[1]*Z_ROE[0][m] + Z_BAR[0]*Z_ROE[1][m];
                         W_HAT[2][m] =  Z_BAR[2]*Z_ROE[0][m] + Z_BAR[0]*Z_ROE[2][m];
                         W_HAT[3][m] =  Z_BAR[3]*Z_ROE[0][m] + Z_BAR[0]*Z_ROE[3][m];
+#ifndef EOS_NON_IDEAL
                         W_HAT[4][m] = (Z_BAR[4]*Z_ROE[0][m] + GAMMA_1*Z_BAR[1]*Z_ROE[1][m] + GAMMA_1*Z_BAR[2]*Z_ROE[2][m] + GAMMA_1*Z_BAR[3]*Z_ROE[3][m] + Z_BAR[0]*Z_ROE[4][m])/GAMMA;
+#endif
                 }
 
                 // Construct average state for element
@@ -259,19 +277,57 @@ public:
                 VZ    = (sqrt(U_N[0][0])*U_N[3][0]/U_N[0][0] + sqrt(U_N[0][1])*U_N[3][1]/U_N[0][1] + sqrt(U_N[0][2])*U_N[3][2]/U_N[0][2] + sqrt(U_N[0][3])*U_N[3][3]/U_N[0][3]) / (sqrt(U_N[0][0]) + sqrt(U_N[0][1]) + sqrt(U_N[0][2]) + sqrt(U_N[0][3]));
                 H_AVG = (sqrt(U_N[0][0])*H[0] + sqrt(U_N[0][1])*H[1] + sqrt(U_N[0][2])*H[2] + sqrt(U_N[0][3])*H[3]) / (sqrt(U_N[0][0]) + sqrt(U_N[0][1]) + sqrt(U_N[0][2]) + sqrt(U_N[0][3]));
 
-                PRESSURE_AVG = (PRESSURE[0] + PRESSURE[1] + PRESSURE[2] + PRESSURE[3])/4.0;
-                C = sqrt((GAMMA-1.0) * H_AVG - (GAMMA-1.0) * (VX*VX + VY*VY + VZ*VZ)/2.0);
+#ifdef EOS_NON_IDEAL
+                // pressure linearised with the EOS derivatives (see TRIANGLE::build_inflow in triangle2D.h)
+                double E_BAR = 0.0, KAPPA, C_SQ;
+                for(m=0;m<4;++m){E_BAR += Z_ROE[0][m]*(U_N[4][m] - 0.5*(U_N[1][m]*U_N[1][m] + U_N[2][m]*U_N[2][m] + U_N[3][m]*U_N[3][m])/U_N[0][m])/U_N[0][m];}
+                E_BAR /= 4.0*Z_BAR[0];
+                eos_linearise(RHO, E_BAR, H_AVG, VX*VX + VY*VY + VZ*VZ, ALPHA, KAPPA, C_SQ);
+                C = sqrt(C_SQ);
+
+                for(m=0;m<4;++m){W_HAT[4][m] = (Z_BAR[4]*Z_ROE[0][m] + Z_BAR[0]*Z_ROE[4][m] - ALPHA*W_HAT[0][m] + KAPPA*(VX*W_HAT[1][m] + VY*W_HAT[2][m] + VZ*W_HAT[3][m]))/(1.0 + KAPPA);}
+#else
+                double KAPPA = GAMMA_1;
+                C = sqrt(EOS::sound_speed_sq_enthalpy(RHO, H_AVG, VX*VX + VY*VY + VZ*VZ));
+#endif
+
+#ifndef EOS_NON_IDEAL
+                ALPHA   = GAMMA_1*(VX*VX + VY*VY + VZ*VZ)/2.0;
+#endif
 
+#ifndef CHARACTERISTIC
                 VX_C = VX/C;
                 VY_C = VY/C;
                 VZ_C = VZ/C;
 
                 H_C = H_AVG/C;
 
-                ALPHA   = GAMMA_1*(VX*VX + VY*VY + VZ*VZ)/2.0;
                 ALPHA_C = ALPHA/C;
+#endif
+
+#ifdef CHARACTERISTIC
+                // Residual from the Roe vectors and distribution in the characteristic variables (characteristic.cpp)
+
+                double WEIGHT[4], LIN[3] = {C, ALPHA, KAPPA};
+                for(m=0;m<4;++m){WEIGHT[m] = NORM*MAG[m];}
+
+                bilinear_flux_residual<3>(Z_BAR, Z_ROE, PRESSURE, WEIGHT, NORMAL, PHI);
 
+#if defined(LDA_SCHEME) or defined(BLENDED)
+                characteristic_distribution<3>(Z_BAR, LIN, WEIGHT, NORMAL, W_HAT, PHI, NULL, FLUC_LDA, BETA);
+                for(i=0;i<5;++i){for(m=0;m<4;++m){FLUC_LDA[i][m] = 0.5*FLUC_LDA[i][m];}}
+#endif
+#if defined(N_SCHEME) or defined(BLENDED)
+                characteristic_distribution<3>(Z_BAR, LIN, WEIGHT, NORMAL, W_HAT, PHI, FLUC_N, NULL, NULL);
+                for(i=0;i<5;++i){for(m=0;m<4;++m){FLUC_N[i][m] = 0.5*FLUC_N[i][m];}}
+#endif
+#else
                 // Calculate K+,K- and K matrices for each vertex i,j,k
+#ifdef EOS_NON_IDEAL
+                double KAPPA_2 = KAPPA - 1.0;
+#else
+                double KAPPA_2 = GAMMA_2;
+#endif
 
                 for(m=0;m<4;++m){
 
@@ -316,44 +372,57 @@ public:
                                 VALUE123 = (VALUE1 + VALUE2 - 2.0*VALUE3)/2.0;
 
                                 INFLOW[0][0][m][p] = NORM * MAG[m]*(ALPHA_C*VALUE123/C - W*VALUE12/C + VALUE3);
-                                INFLOW[0][1][m][p] = NORM * MAG[m]*(-1.0*GAMMA_1*VX_C*VALUE123/C + N_X[m]*VALUE12/C);
-                                INFLOW[0][2][m][p] = NORM * MAG[m]*(-1.0*GAMMA_1*VY_C*VALUE123/C + N_Y[m]*VALUE12/C);
-                                INFLOW[0][3][m][p] = NORM * MAG[m]*(-1.0*GAMMA_1*VZ_C*VALUE123/C + N_Z[m]*VALUE12/C);
-                                INFLOW[0][4][m][p] = NORM * MAG[m]*(GAMMA_1*VALUE123/(C*C));
+                                INFLOW[0][1][m][p] = NORM * MAG[m]*(-1.0*KAPPA*VX_C*VALUE123/C + N_X[m]*VALUE12/C);
+                                INFLOW[0][2][m][p] = NORM * MAG[m]*(-1.0*KAPPA*VY_C*VALUE123/C + N_Y[m]*VALUE12/C);
+                                INFLOW[0][3][m][p] = NORM * MAG[m]*(-1.0*KAPPA*VZ_C*VALUE123/C + N_Z[m]*VALUE12/C);
+                                INFLOW[0][4][m][p] = NORM * MAG[m]*(KAPPA*VALUE123/(C*C));
 
                                 INFLOW[1][0][m][p] = NORM * MAG[m]*((ALPHA_C*VX_C - W*N_X[m])*VALUE123 + (ALPHA_C*N_X[m] - VX_C*W)*VALUE12);
-                                INFLOW[1][1][m][p] = NORM * MAG[m]*((N_X[m]*N_X[m] - GAMMA_1*VX_C*VX_C)*VALUE123 - (GAMMA_2*VX_C*N_X[m]*VALUE12) + VALUE3);
-                                INFLOW[1][2][m][p] = NORM * MAG[m]*((N_X[m]*N_Y[m] - GAMMA_1*VX_C*VY_C)*VALUE123 + (VX_C*N_Y[m] - GAMMA_1*VY_C*N_X[m])*VALUE12);
-                                INFLOW[1][3][m][p] = NORM * MAG[m]*((N_X[m]*N_Z[m] - GAMMA_1*VX_C*VZ_C)*VALUE123 + (VX_C*N_Z[m] - GAMMA_1*VZ_C*N_X[m])*VALUE12);
-                                INFLOW[1][4][m][p] = NORM * MAG[m]*(GAMMA_1*VX_C*VALUE123/C + GAMMA_1*N_X[m]*VALUE12/C);
+                                INFLOW[1][1][m][p] = NORM * MAG[m]*((N_X[m]*N_X[m] - KAPPA*VX_C*VX_C)*VALUE123 - (KAPPA_2*VX_C*N_X[m]*VALUE12) + VALUE3);
+                                INFLOW[1][2][m][p] = NORM * MAG[m]*((N_X[m]*N_Y[m] - KAPPA*VX_C*VY_C)*VALUE123 + (VX_C*N_Y[m] - KAPPA*VY_C*N_X[m])*VALUE12);
+                                INFLOW[1][3][m][p] = NORM * MAG[m]*((N_X[m]*N_Z[m] - KAPPA*VX_C*VZ_C)*VALUE123 + (VX_C*N_Z[m] - KAPPA*VZ_C*N_X[m])*VALUE12);
+                                INFLOW[1][4][m][p] = NORM * MAG[m]*(KAPPA*VX_C*VALUE123/C + KAPPA*N_X[m]*VALUE12/C);
 
                                 INFLOW[2][0][m][p] = NORM * MAG[m]*((ALPHA_C*VY_C - W*N_Y[m])*VALUE123 + (ALPHA_C*N_Y[m] - VY_C*W)*VALUE12);
-                                INFLOW[2][1][m][p] = NORM * MAG[m]*((N_X[m]*N_Y[m] - GAMMA_1*VX_C*VY_C)*VALUE123 + (VY_C*N_X[m] - GAMMA_1*VX_C*N_Y[m])*VALUE12);
-                                INFLOW[2][2][m][p] = NORM * MAG[m]*((N_Y[m]*N_Y[m] - GAMMA_1*VY_C*VY_C)*VALUE123 - (GAMMA_2*VY_C*N_Y[m]*VALUE12) + VALUE3);
-                                INFLOW[2][3][m][p] = NORM * MAG[m]*((N_Z[m]*N_Y[m] - GAMMA_1*VZ_C*VY_C)*VALUE123 + (VY_C*N_Z[m] - GAMMA_1*VZ_C*N_Y[m])*VALUE12);
-                                INFLOW[2][4][m][p] = NORM * MAG[m]*(GAMMA_1*VY_C*VALUE123/C + GAMMA_1*N_Y[m]*VALUE12/C);
+                                INFLOW[2][1][m][p] = NORM * MAG[m]*((N_X[m]*N_Y[m] - KAPPA*VX_C*VY_C)*VALUE123 + (VY_C*N_X[m] - KAPPA*VX_C*N_Y[m])*VALUE12);
+                                INFLOW[2][2][m][p] = NORM * MAG[m]*((N_Y[m]*N_Y[m] - KAPPA*VY_C*VY_C)*VALUE123 - (KAPPA_2*VY_C*N_Y[m]*VALUE12) + VALUE3);
+                                INFLOW[2][3][m][p] = NORM * MAG[m]*((N_Z[m]*N_Y[m] - KAPPA*VZ_C*VY_C)*VALUE123 + (VY_C*N_Z[m] - KAPPA*VZ_C*N_Y[m])*VALUE12);
+                                INFLOW[2][4][m][p] = NORM * MAG[m]*(KAPPA*VY_C*VALUE123/C + KAPPA*N_Y[m]*VALUE12/C);
 
                                 INFLOW[3][0][m][p] = NORM * MAG[m]*((ALPHA_C*VZ_C - W*N_Z[m])*VALUE123 + (ALPHA_C*N_Z[m] - VZ_C*W)*VALUE12);
-                                INFLOW[3][1][m][p] = NORM * MAG[m]*((N_X[m]*N_Z[m] - GAMMA_1*VX_C*VZ_C)*VALUE123 + (VZ_C*N_X[m] - GAMMA_1*VX_C*N_Z[m])*VALUE12);
-                                INFLOW[3][2][m][p] = NORM * MAG[m]*((N_Y[m]*N_Z[m] - GAMMA_1*VY_C*VZ_C)*VALUE123 + (VZ_C*N_Y[m] - GAMMA_1*VY_C*N_Z[m])*VALUE12);
-                                INFLOW[3][3][m][p] = NORM * MAG[m]*((N_Z[m]*N_Z[m] - GAMMA_1*VZ_C*VZ_C)*VALUE123 - (GAMMA_2*VZ_C*N_Z[m]*VALUE12) + VALUE3);
-                                INFLOW[3][4][m][p] = NORM * MAG[m]*(GAMMA_1*VZ_C*VALUE123/C + GAMMA_1*N_Z[m]*VALUE12/C);
+                                INFLOW[3][1][m][p] = NORM * MAG[m]*((N_X[m]*N_Z[m] - KAPPA*VX_C*VZ_C)*VALUE123 + (VZ_C*N_X[m] - KAPPA*VX_C*N_Z[m])*VALUE12);
+                                INFLOW[3][2][m][p] = NORM * MAG[m]*((N_Y[m]*N_Z[m] - KAPPA*VY_C*VZ_C)*VALUE123 + (VZ_C*N_Y[m] - KAPPA*VY_C*N_Z[m])*VALUE12);
+                                INFLOW[3][3][m][p] = NORM * MAG[m]*((N_Z[m]*N_Z[m] - KAPPA*VZ_C*VZ_C)*VALUE123 - (KAPPA_2*VZ_C*N_Z[m]*VALUE12) + VALUE3);
+                                INFLOW[3][4][m][p] = NORM * MAG[m]*(KAPPA*VZ_C*VALUE123/C + KAPPA*N_Z[m]*VALUE12/C);
 
                                 INFLOW[4][0][m][p] = NORM * MAG[m]*((ALPHA_C*H_C - W*W)*VALUE123 + W*(ALPHA_C - H_C)*VALUE12);
-                                INFLOW[4][1][m][p] = NORM * MAG[m]*((W*N_X[m] - VX - ALPHA_C*VX_C)*VALUE123 + (H_C*N_X[m] - GAMMA_1*VX_C*W)*VALUE12);
-                                INFLOW[4][2][m][p] = NORM * MAG[m]*((W*N_Y[m] - VY - ALPHA_C*VY_C)*VALUE123 + (H_C*N_Y[m] - GAMMA_1*VY_C*W)*VALUE12);
-                                INFLOW[4][3][m][p] = NORM * MAG[m]*((W*N_Z[m] - VZ - ALPHA_C*VZ_C)*VALUE123 + (H_C*N_Z[m] - GAMMA_1*VZ_C*W)*VALUE12);
-                                INFLOW[4][4][m][p] = NORM * MAG[m]*(GAMMA_1*H_C*VALUE123/C + GAMMA_1*W*VALUE12/C + VALUE3);
+#ifdef EOS_NON_IDEAL
+                                INFLOW[4][1][m][p] = NORM * MAG[m]*((W*N_X[m] - KAPPA*H_C*VX_C)*VALUE123 + (H_C*N_X[m] - KAPPA*VX_C*W)*VALUE12);
+                                INFLOW[4][2][m][p] = NORM * MAG[m]*((W*N_Y[m] - KAPPA*H_C*VY_C)*VALUE123 + (H_C*N_Y[m] - KAPPA*VY_C*W)*VALUE12);
+                                INFLOW[4][3][m][p] = NORM * MAG[m]*((W*N_Z[m] - KAPPA*H_C*VZ_C)*VALUE123 + (H_C*N_Z[m] - KAPPA*VZ_C*W)*VALUE12);
+#else
+                                INFLOW[4][1][m][p] = NORM * MAG[m]*((W*N_X[m] - VX - ALPHA_C*VX_C)*VALUE123 + (H_C*N_X[m] - KAPPA*VX_C*W)*VALUE12);
+                                INFLOW[4][2][m][p] = NORM * MAG[m]*((W*N_Y[m] - VY - ALPHA_C*VY_C)*VALUE123 + (H_C*N_Y[m] - KAPPA*VY_C*W)*VALUE12);
+                                INFLOW[4][3][m][p] = NORM * MAG[m]*((W*N_Z[m] - VZ - ALPHA_C*VZ_C)*VALUE123 + (H_C*N_Z[m] - KAPPA*VZ_C*W)*VALUE12);
+#endif
+                                INFLOW[4][4][m][p] = NORM * MAG[m]*(KAPPA*H_C*VALUE123/C + KAPPA*W*VALUE12/C + VALUE3);
                         }
                 }
 
 
+#ifdef EOS_NON_IDEAL
+                double WEIGHT[4];                                       // sum K W_HAT is the flux integral only for the ideal gas
+                for(m=0;m<4;++m){WEIGHT[m] = NORM*MAG[m];}
+
+                bilinear_flux_residual<3>(Z_BAR, Z_ROE, PRESSURE, WEIGHT, NORMAL, PHI);
+#else
                 for(i=0;i<5;++i){
                         PHI[i] = 0.0;
                         for(m=0;m<4;++m){
                                 PHI[i] += INFLOW[i][0][m][2]*W_HAT[0][m] + INFLOW[i][1][m][2]*W_HAT[1][m] + INFLOW[i][2][m][2]*W_HAT[2][m] + INFLOW[i][3][m][2]*W_HAT[3][m] + INFLOW[i][4][m][2]*W_HAT[4][m];
                         }
                 }
+#endif
 
                 double INFLOW_MINUS_SUM[5][5];
 
@@ -395,10 +464,17 @@ public:
                 double KZ_SUM[5];
 
                 for(i=0;i<5;++i){
+#ifdef EOS_NON_IDEAL
+                        KZ_SUM[i] = PHI[i];                             // sum K- W_HAT = PHI - sum K+ W_HAT only holds for the ideal gas
+                        for(m=0;m<4;++m){
+                                KZ_SUM[i] -= INFLOW[i][0][m][0] * W_HAT[0][m] + INFLOW[i][1][m][0] * W_HAT[1][m] + INFLOW[i][2][m][0] * W_HAT[2][m] + INFLOW[i][3][m][0] * W_HAT[3][m] + INFLOW[i][4][m][0] * W_HAT[4][m];
+                        }
+#else
                         KZ_SUM[i] = 0.0;
                         for(m=0;m<4;++m){
                                 KZ_SUM[i] += INFLOW[i][0][m][1] * W_HAT[0][m] + INFLOW[i][1][m][1] * W_HAT[1][m] + INFLOW[i][2][m][1] * W_HAT[2][m] + INFLOW[i][3][m][1] * W_HAT[3][m] + INFLOW[i][4][m][1] * W_HAT[4][m];
                         }
+#endif
                 }
 
                 for(i=0;i<5;++i){
@@ -413,6 +489,7 @@ public:
                         }
                 }
 #endif
+#endif
 
 #ifdef BLENDED
                 double THETA_E[5][5];
@@ -499,12 +576,26 @@ public:
                 return ;
         }
 
+        // scatter into a thread private DU buffer at the slots SLOT of its corners instead (DU_PRIVATE, scatter.cpp)
+        void pass_update_half(double *BUF, const int *SLOT){
+                for(int i=0;i<5;++i){
+                        BUF[5*SLOT[0] + i] += DU0_HALF[i];
+                        BUF[5*SLOT[1] + i] += DU1_HALF[i];
+                        BUF[5*SLOT[2] + i] += DU2_HALF[i];
+                        BUF[5*SLOT[3] + i] += DU3_HALF[i];
+                }
+        }
+
         //**********************************************************************************************************************
 
         void calculate_second_half(double T, double DT){
-                int i,j,m,p;
+                int i,m;
+#if !defined(CHARACTERISTIC) and defined(SECOND_HALF_LINEARISE)
+                int j,p;
                 double INFLOW[5][5][4][3];
-                double DU0[5],DU1[5],DU2[5],DU3[5];
+#elif defined(LDA_SCHEME) or defined(BLENDED)
+                int j;
+#endif
 
                 // double DT = DT_TOT;
 
@@ -529,15 +620,16 @@ public:
                 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
                 // Calculate inflow parameters
 
-                double H[4];
-                double RHO,C,VX,VX_C,VY,VY_C,VZ,VZ_C,H_AVG,H_C,ALPHA,ALPHA_C,W,NORM=1.0/3.0;
+                double NORM=1.0/3.0;
                 double Z[5][4];
+#if !defined(CHARACTERISTIC) and defined(SECOND_HALF_LINEARISE)
+                double VX_C,VY_C,VZ_C,H_C,ALPHA_C,W;
                 double VALUE1,VALUE2,VALUE3,VALUE12,VALUE123;
-                double PRESSURE_AVG;
                 double LAMBDA[5][4],LAMBDA_PLUS[5][4],LAMBDA_MINUS[5][4];
                 double N_X[4],N_Y[4],N_Z[4];
+#endif
 
-                double Z_BAR[5],W_HAT[5][4];
+                double Z_BAR[5];
 
                 // Construct Roe vector Z
 
@@ -547,23 +639,30 @@ public:
                         Z[2][m] = U_HALF[2][m]/Z[0][m];
                         Z[3][m] = U_HALF[3][m]/Z[0][m];
                         Z[4][m] = (U_HALF[4][m] + PRESSURE_HALF[m])/Z[0][m];
-
+#if !defined(CHARACTERISTIC) and defined(SECOND_HALF_LINEARISE)
                         N_X[m]  = NORMAL[m][0];
                         N_Y[m]  = NORMAL[m][1];
                         N_Z[m]  = NORMAL[m][2];
-
-                        H[m] = (U_HALF[4][m] + PRESSURE_HALF[m])/U_HALF[0][m];
+#endif
                 }
 
                 for(i=0; i<5; ++i){Z_BAR[i] = (Z[i][0] + Z[i][1] + Z[i][2] + Z[i][3])/4.0;}
 
+#ifdef SECOND_HALF_LINEARISE
+                double H[4];
+                double RHO,C,VX,VY,VZ,H_AVG,ALPHA;
+                double W_HAT[5][4];
+
+                for(m=0;m<4;++m){H[m] = (U_HALF[4][m] + PRESSURE_HALF[m])/U_HALF[0][m];}
 
                 for(m=0; m<4; ++m){
                         W_HAT[0][m] =  2.0*Z_BAR[0]*Z[0][m];
                         W_HAT[1][m] =  Z_BAR[1]*Z[0][m] + Z_BAR[0]*Z[1][m];
                         W_HAT[2][m] =  Z_BAR[2]*Z[0][m] + Z_BAR[0]*Z[2][m];
                         W_HAT[3][m] =  Z_BAR[3]*Z[0][m] + Z_BAR[0]*Z[3][m];
+#ifndef EOS_NON_IDEAL
                         W_HAT[4][m] = (Z_BAR[4]*Z[0][m] + GAMMA_1*Z_BAR[1]*Z[1][m] + GAMMA_1*Z_BAR[2]*Z[2][m] + GAMMA_1*Z_BAR[3]*Z[3][m] + Z_BAR[0]*Z[4][m])/GAMMA;
+#endif
                         //std::cout << Z_BAR[1] << "\t" << Z[0][m] << "\t" << Z_BAR[0] << "\t" << Z[2][m] << std::endl;
                 }
 
@@ -575,22 +674,56 @@ public:
                 VZ    = (sqrt(U_HALF[0][0])*U_HALF[3][0]/U_HALF[0][0] + sqrt(U_HALF[0][1])*U_HALF[3][1]/U_HALF[0][1] + sqrt(U_HALF[0][2])*U_HALF[3][2]/U_HALF[0][2] + sqrt(U_HALF[0][3])*U_HALF[3][3]/U_HALF[0][3])/(sqrt(U_HALF[0][0]) + sqrt(U_HALF[0][1]) + sqrt(U_HALF[0][2]) + sqrt(U_HALF[0][3]));
                 H_AVG = (sqrt(U_HALF[0][0])*H[0] + sqrt(U_HALF[0][1])*H[1] + sqrt(U_HALF[0][2])*H[2] + sqrt(U_HALF[0][3])*H[3])/(sqrt(U_HALF[0][0]) + sqrt(U_HALF[0][1]) + sqrt(U_HALF[0][2]) + sqrt(U_HALF[0][3]));
 
-                PRESSURE_AVG = (PRESSURE_HALF[0] + PRESSURE_HALF[1] + PRESSURE_HALF[2])/4.0;
-                C = sqrt((GAMMA-1.0) * H_AVG - (GAMMA-1.0) * (VX*VX + VY*VY + VZ*VZ)/2.0);
+#ifdef EOS_NON_IDEAL
+                // pressure linearised with the EOS derivatives (see TRIANGLE::build_inflow in triangle2D.h)
+                double E_BAR = 0.0, KAPPA, C_SQ;
+                for(m=0;m<4;++m){E_BAR += Z[0][m]*(U_HALF[4][m] - 0.5*(U_HALF[1][m]*U_HALF[1][m] + U_HALF[2][m]*U_HALF[2][m] + U_HALF[3][m]*U_HALF[3][m])/U_HALF[0][m])/U_HALF[0][m];}
+                E_BAR /= 4.0*Z_BAR[0];
+                eos_linearise(RHO, E_BAR, H_AVG, VX*VX + VY*VY + VZ*VZ, ALPHA, KAPPA, C_SQ);
+                C = sqrt(C_SQ);
+
+                for(m=0;m<4;++m){W_HAT[4][m] = (Z_BAR[4]*Z[0][m] + Z_BAR[0]*Z[4][m] - ALPHA*W_HAT[0][m] + KAPPA*(VX*W_HAT[1][m] + VY*W_HAT[2][m] + VZ*W_HAT[3][m]))/(1.0 + KAPPA);}
+#else
+                double KAPPA = GAMMA_1;
+                C = sqrt(EOS::sound_speed_sq_enthalpy(RHO, H_AVG, VX*VX + VY*VY + VZ*VZ));
+#endif
                 // C_SOUND_AVG = sqrt(GAMMA*PRESSURE_AVG/RHO);
 
                 // Reassign variables to local equivalents
 
+#ifndef EOS_NON_IDEAL
+                ALPHA   = GAMMA_1*(VX*VX + VY*VY + VZ*VZ)/2.0;
+#endif
+
+#ifndef CHARACTERISTIC
                 VX_C = VX/C;
                 VY_C = VY/C;
                 VZ_C = VZ/C;
 
                 H_C = H_AVG/C;
 
-                ALPHA   = GAMMA_1*(VX*VX + VY*VY + VZ*VZ)/2.0;
                 ALPHA_C = ALPHA/C;
+#endif
+#endif
 
+#if defined(CHARACTERISTIC) or defined(LDA_SCHEME) or defined(BLENDED) or defined(EOS_NON_IDEAL)
+                double PHI_HALF[5];
+#endif
+
+#if defined(CHARACTERISTIC) or defined(EOS_NON_IDEAL)
+                double WEIGHT[4];                                       // sum K W_HAT is the flux integral only for the ideal gas
+                for(m=0;m<4;++m){WEIGHT[m] = NORM*MAG[m];}
+
+                bilinear_flux_residual<3>(Z_BAR, Z, PRESSURE_HALF, WEIGHT, NORMAL, PHI_HALF);
+#endif
+
+#if !defined(CHARACTERISTIC) and defined(SECOND_HALF_LINEARISE)
                 // Calculate K+,K- and K matrices for each vertex i,j,k
+#ifdef EOS_NON_IDEAL
+                double KAPPA_2 = KAPPA - 1.0;
+#else
+                double KAPPA_2 = GAMMA_2;
+#endif
 
                 for(m=0;m<4;++m){
 
@@ -635,51 +768,59 @@ public:
                                 VALUE123 = (VALUE1 + VALUE2 - 2.0*VALUE3)/2.0;
 
                                 INFLOW[0][0][m][p] = NORM * MAG[m]*(ALPHA_C*VALUE123/C - W*VALUE12/C + VALUE3);
-                                INFLOW[0][1][m][p] = NORM * MAG[m]*(-1.0*GAMMA_1*VX_C*VALUE123/C + N_X[m]*VALUE12/C);
-                                INFLOW[0][2][m][p] = NORM * MAG[m]*(-1.0*GAMMA_1*VY_C*VALUE123/C + N_Y[m]*VALUE12/C);
-                                INFLOW[0][3][m][p] = NORM * MAG[m]*(-1.0*GAMMA_1*VZ_C*VALUE123/C + N_Z[m]*VALUE12/C);
-                                INFLOW[0][4][m][p] = NORM * MAG[m]*(GAMMA_1*VALUE123/(C*C));
+                                INFLOW[0][1][m][p] = NORM * MAG[m]*(-1.0*KAPPA*VX_C*VALUE123/C + N_X[m]*VALUE12/C);
+                                INFLOW[0][2][m][p] = NORM * MAG[m]*(-1.0*KAPPA*VY_C*VALUE123/C + N_Y[m]*VALUE12/C);
+                                INFLOW[0][3][m][p] = NORM * MAG[m]*(-1.0*KAPPA*VZ_C*VALUE123/C + N_Z[m]*VALUE12/C);
+                                INFLOW[0][4][m][p] = NORM * MAG[m]*(KAPPA*VALUE123/(C*C));
 
                                 INFLOW[1][0][m][p] = NORM * MAG[m]*((ALPHA_C*VX_C - W*N_X[m])*VALUE123 + (ALPHA_C*N_X[m] - VX_C*W)*VALUE12);
-                                INFLOW[1][1][m][p] = NORM * MAG[m]*((N_X[m]*N_X[m] - GAMMA_1*VX_C*VX_C)*VALUE123 - (GAMMA_2*VX_C*N_X[m]*VALUE12) + VALUE3);
-                                INFLOW[1][2][m][p] = NORM * MAG[m]*((N_X[m]*N_Y[m] - GAMMA_1*VX_C*VY_C)*VALUE123 + (VX_C*N_Y[m] - GAMMA_1*VY_C*N_X[m])*VALUE12);
-                                INFLOW[1][3][m][p] = NORM * MAG[m]*((N_X[m]*N_Z[m] - GAMMA_1*VX_C*VZ_C)*VALUE123 + (VX_C*N_Z[m] - GAMMA_1*VZ_C*N_X[m])*VALUE12);
-                                INFLOW[1][4][m][p] = NORM * MAG[m]*(GAMMA_1*VX_C*VALUE123/C + GAMMA_1*N_X[m]*VALUE12/C);
+                                INFLOW[1][1][m][p] = NORM * MAG[m]*((N_X[m]*N_X[m] - KAPPA*VX_C*VX_C)*VALUE123 - (KAPPA_2*VX_C*N_X[m]*VALUE12) + VALUE3);
+                                INFLOW[1][2][m][p] = NORM * MAG[m]*((N_X[m]*N_Y[m] - KAPPA*VX_C*VY_C)*VALUE123 + (VX_C*N_Y[m] - KAPPA*VY_C*N_X[m])*VALUE12);
+                                INFLOW[1][3][m][p] = NORM * MAG[m]*((N_X[m]*N_Z[m] - KAPPA*VX_C*VZ_C)*VALUE123 + (VX_C*N_Z[m] - KAPPA*VZ_C*N_X[m])*VALUE12);
+                                INFLOW[1][4][m][p] = NORM * MAG[m]*(KAPPA*VX_C*VALUE123/C + KAPPA*N_X[m]*VALUE12/C);
 
                                 INFLOW[2][0][m][p] = NORM * MAG[m]*((ALPHA_C*VY_C - W*N_Y[m])*VALUE123 + (ALPHA_C*N_Y[m] - VY_C*W)*VALUE12);
-                                INFLOW[2][1][m][p] = NORM * MAG[m]*((N_X[m]*N_Y[m] - GAMMA_1*VX_C*VY_C)*VALUE123 + (VY_C*N_X[m] - GAMMA_1*VX_C*N_Y[m])*VALUE12);
-                                INFLOW[2][2][m][p] = NORM * MAG[m]*((N_Y[m]*N_Y[m] - GAMMA_1*VY_C*VY_C)*VALUE123 - (GAMMA_2*VY_C*N_Y[m]*VALUE12) + VALUE3);
-                                INFLOW[2][3][m][p] = NORM * MAG[m]*((N_Z[m]*N_Y[m] - GAMMA_1*VZ_C*VY_C)*VALUE123 + (VY_C*N_Z[m] - GAMMA_1*VZ_C*N_Y[m])*VALUE12);
-                                INFLOW[2][4][m][p] = NORM * MAG[m]*(GAMMA_1*VY_C*VALUE123/C + GAMMA_1*N_Y[m]*VALUE12/C);
+                                INFLOW[2][1][m][p] = NORM * MAG[m]*((N_X[m]*N_Y[m] - KAPPA*VX_C*VY_C)*VALUE123 + (VY_C*N_X[m] - KAPPA*VX_C*N_Y[m])*VALUE12);
+                                INFLOW[2][2][m][p] = NORM * MAG[m]*((N_Y[m]*N_Y[m] - KAPPA*VY_C*VY_C)*VALUE123 - (KAPPA_2*VY_C*N_Y[m]*VALUE12) + VALUE3);
+                                INFLOW[2][3][m][p] = NORM * MAG[m]*((N_Z[m]*N_Y[m] - KAPPA*VZ_C*VY_C)*VALUE123 + (VY_C*N_Z[m] - KAPPA*VZ_C*N_Y[m])*VALUE12);
+                                INFLOW[2][4][m][p] = NORM * MAG[m]*(KAPPA*VY_C*VALUE123/C + KAPPA*N_Y[m]*VALUE12/C);
 
                                 INFLOW[3][0][m][p] = NORM * MAG[m]*((ALPHA_C*VZ_C - W*N_Z[m])*VALUE123 + (ALPHA_C*N_Z[m] - VZ_C*W)*VALUE12);
-                                INFLOW[3][1][m][p] = NORM * MAG[m]*((N_X[m]*N_Z[m] - GAMMA_1*VX_C*VZ_C)*VALUE123 + (VZ_C*N_X[m] - GAMMA_1*VX_C*N_Z[m])*VALUE12);
-                                INFLOW[3][2][m][p] = NORM * MAG[m]*((N_Y[m]*N_Z[m] - GAMMA_1*VY_C*VZ_C)*VALUE123 + (VZ_C*N_Y[m] - GAMMA_1*VY_C*N_Z[m])*VALUE12);
-                                INFLOW[3][3][m][p] = NORM * MAG[m]*((N_Z[m]*N_Z[m] - GAMMA_1*VZ_C*VZ_C)*VALUE123 - (GAMMA_2*VZ_C*N_Z[m]*VALUE12) + VALUE3);
-                                INFLOW[3][4][m][p] = NORM * MAG[m]*(GAMMA_1*VZ_C*VALUE123/C + GAMMA_1*N_Z[m]*VALUE12/C);
+                                INFLOW[3][1][m][p] = NORM * MAG[m]*((N_X[m]*N_Z[m] - KAPPA*VX_C*VZ_C)*VALUE123 + (VZ_C*N_X[m] - KAPPA*VX_C*N_Z[m])*VALUE12);
+                                INFLOW[3][2][m][p] = NORM * MAG[m]*((N_Y[m]*N_Z[m] - KAPPA*VY_C*VZ_C)*VALUE123 + (VZ_C*N_Y[m] - KAPPA*VY_C*N_Z[m])*VALUE12);
+                                INFLOW[3][3][m][p] = NORM * MAG[m]*((N_Z[m]*N_Z[m] - KAPPA*VZ_C*VZ_C)*VALUE123 - (KAPPA_2*VZ_C*N_Z[m]*VALUE12) + VALUE3);
+                                INFLOW[3][4][m][p] = NORM * MAG[m]*(KAPPA*VZ_C*VALUE123/C + KAPPA*N_Z[m]*VALUE12/C);
 
                                 INFLOW[4][0][m][p] = NORM * MAG[m]*((ALPHA_C*H_C - W*W)*VALUE123 + W*(ALPHA_C - H_C)*VALUE12);
-                                INFLOW[4][1][m][p] = NORM * MAG[m]*((W*N_X[m] - VX - ALPHA_C*VX_C)*VALUE123 + (H_C*N_X[m] - GAMMA_1*VX_C*W)*VALUE12);
-                                INFLOW[4][2][m][p] = NORM * MAG[m]*((W*N_Y[m] - VY - ALPHA_C*VY_C)*VALUE123 + (H_C*N_Y[m] - GAMMA_1*VY_C*W)*VALUE12);
-                                INFLOW[4][3][m][p] = NORM * MAG[m]*((W*N_Z[m] - VZ - ALPHA_C*VZ_C)*VALUE123 + (H_C*N_Z[m] - GAMMA_1*VZ_C*W)*VALUE12);
-                                INFLOW[4][4][m][p] = NORM * MAG[m]*(GAMMA_1*H_C*VALUE123/C + GAMMA_1*W*VALUE12/C + VALUE3);
+#ifdef EOS_NON_IDEAL
+                                INFLOW[4][1][m][p] = NORM * MAG[m]*((W*N_X[m] - KAPPA*H_C*VX_C)*VALUE123 + (H_C*N_X[m] - KAPPA*VX_C*W)*VALUE12);
+                                INFLOW[4][2][m][p] = NORM * MAG[m]*((W*N_Y[m] - KAPPA*H_C*VY_C)*VALUE123 + (H_C*N_Y[m] - KAPPA*VY_C*W)*VALUE12);
+                                INFLOW[4][3][m][p] = NORM * MAG[m]*((W*N_Z[m] - KAPPA*H_C*VZ_C)*VALUE123 + (H_C*N_Z[m] - KAPPA*VZ_C*W)*VALUE12);
+#else
+                                INFLOW[4][1][m][p] = NORM * MAG[m]*((W*N_X[m] - VX - ALPHA_C*VX_C)*VALUE123 + (H_C*N_X[m] - KAPPA*VX_C*W)*VALUE12);
+                                INFLOW[4][2][m][p] = NORM * MAG[m]*((W*N_Y[m] - VY - ALPHA_C*VY_C)*VALUE123 + (H_C*N_Y[m] - KAPPA*VY_C*W)*VALUE12);
+                                INFLOW[4][3][m][p] = NORM * MAG[m]*((W*N_Z[m] - VZ - ALPHA_C*VZ_C)*VALUE123 + (H_C*N_Z[m] - KAPPA*VZ_C*W)*VALUE12);
+#endif
+                                INFLOW[4][4][m][p] = NORM * MAG[m]*(KAPPA*H_C*VALUE123/C + KAPPA*W*VALUE12/C + VALUE3);
                         }
                 }
+#endif
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 
 #if defined(LDA_SCHEME) or defined(BLENDED)
 
-                double PHI_HALF[5];
                 double SECOND_FLUC_LDA[5][4];
 
+#if !defined(CHARACTERISTIC) and !defined(EOS_NON_IDEAL)
                 for(i=0;i<5;++i){
                         PHI_HALF[i] = 0.0;
                         for(m=0;m<4;++m){
                                 PHI_HALF[i] += INFLOW[i][0][m][2]*W_HAT[0][m] + INFLOW[i][1][m][2]*W_HAT[1][m] + INFLOW[i][2][m][2]*W_HAT[2][m] + INFLOW[i][3][m][2]*W_HAT[3][m] + INFLOW[i][4][m][2]*W_HAT[4][m];
                         }
                 }
+#endif
 
                 // Calculate spatial splitting for first half timestep
 
@@ -732,8 +873,15 @@ public:
 
 #if defined(N_SCHEME) or defined(BLENDED)
 
-                double INFLOW_MINUS_SUM[5][5];
                 double SECOND_FLUC_N[5][4];
+                double AREA_DIFF[5][4];
+
+#ifdef CHARACTERISTIC
+                double LIN[3] = {C, ALPHA, KAPPA};
+                characteristic_distribution<3>(Z_BAR, LIN, WEIGHT, NORMAL, W_HAT, PHI_HALF, FLUC_HALF_N, NULL, NULL);
+                for(i=0;i<5;++i){for(m=0;m<4;++m){FLUC_HALF_N[i][m] = 0.5*FLUC_HALF_N[i][m];}}
+#else
+                double INFLOW_MINUS_SUM[5][5];
 
                 for(i=0;i<5;++i){
                         for(j=0;j<5;++j){
@@ -746,15 +894,21 @@ public:
 
                 mat_inv(&INFLOW_MINUS_SUM[0][0],5,X[0],Y[0],ID,2);
 
-                double AREA_DIFF[5][4];
                 double BRACKET[5][4];
                 double KZ_SUM[5];
 
                 for(i=0;i<5;++i){
+#ifdef EOS_NON_IDEAL
+                        KZ_SUM[i] = PHI_HALF[i];
+                        for(m=0;m<4;++m){
+                                KZ_SUM[i] -= INFLOW[i][0][m][0]*W_HAT[0][m] + INFLOW[i][1][m][0]*W_HAT[1][m] + INFLOW[i][2][m][0]*W_HAT[2][m] + INFLOW[i][3][m][0]*W_HAT[3][m] + INFLOW[i][4][m][0]*W_HAT[4][m];
+                        }
+#else
                         KZ_SUM[i] = 0.0;
                         for(m=0;m<4;++m){
                                 KZ_SUM[i] += INFLOW[i][0][m][1]*W_HAT[0][m] + INFLOW[i][1][m][1]*W_HAT[1][m] + INFLOW[i][2][m][1]*W_HAT[2][m] + INFLOW[i][3][m][1]*W_HAT[3][m] + INFLOW[i][4][m][1]*W_HAT[4][m];
                         }
+#endif
                 }
 
                 for(i=0;i<5;++i){
@@ -768,6 +922,7 @@ public:
                                 FLUC_HALF_N[i][m] = 0.5*(INFLOW[i][0][m][0]*BRACKET[0][m] + INFLOW[i][1][m][0]*BRACKET[1][m] + INFLOW[i][2][m][0]*BRACKET[2][m] + INFLOW[i][3][m][0]*BRACKET[3][m] + INFLOW[i][4][m][0]*BRACKET[4][m]);
                         }
                 }
+#endif
 
                 for(i=0;i<5;++i){
                         for(m=0;m<4;++m){
@@ -866,282 +1021,103 @@ public:
                 VERTEX_3->update_du(DU3);
         }
 
-        //**********************************************************************************************************************
+        // scatter into a thread private DU buffer at the slots SLOT of its corners instead (DU_PRIVATE, scatter.cpp)
+        void pass_update(double *BUF, const int *SLOT){
+                for(int i=0;i<5;++i){
+                        BUF[5*SLOT[0] + i] += DU0[i];
+                        BUF[5*SLOT[1] + i] += DU1[i];
+                        BUF[5*SLOT[2] + i] += DU2[i];
+                        BUF[5*SLOT[3] + i] += DU3[i];
+                }
+        }
 
-        // Returns Roe average of left and right states
-        // double roe_avg(double L1, double L2, double R1, double R2){
-        //         double AVG;
-        //         AVG = (sqrt(L1)*L2+sqrt(R1)*R2)/(sqrt(L1)+sqrt(R1));
-        //         return AVG;
-        // }
+#ifdef MPI_RD
+        // residuals of the corners kept between evaluations (DRIFT scatters them again until the bin is next due), moved
+        // with the triangle when it changes rank (domain.cpp)
+        static int stored_size(){return 40;}
 
-        void check_boundary(){
-#ifdef PERIODIC_BOUNDARY
-                if(BOUNDARY == 1){
-                        for(int i=0; i<4; ++i){
-                                for(int j=0; j<4; ++j){
-                                        if(X[j] - X[i] > BND_TOL*SIDE_LENGTH_X){
-                                                X_MOD[i] = X[i] + SIDE_LENGTH_X;
-                                        }
-                                        if(Y[j] - Y[i] > BND_TOL*SIDE_LENGTH_Y){
-                                                Y_MOD[i] = Y[i] + SIDE_LENGTH_Y;
-                                        }
-                                        if(Z[j] - Z[i] > BND_TOL*SIDE_LENGTH_Z){
-                                                Z_MOD[i] = Z[i] + SIDE_LENGTH_Z;
-                                        }
-                                }
-                        }
+        void get_stored(double *BUF){
+                for(int i=0;i<5;++i){
+                        BUF[i]    = DU0[i];      BUF[5+i]  = DU1[i];      BUF[10+i] = DU2[i];      BUF[15+i] = DU3[i];
+                        BUF[20+i] = DU0_HALF[i]; BUF[25+i] = DU1_HALF[i]; BUF[30+i] = DU2_HALF[i]; BUF[35+i] = DU3_HALF[i];
                 }
-#endif
-                return;
         }
 
-        void check_theta(double THETA){
-                if (THETA > 3.148/2.0 and THETA < 3.15/2.0){
-                        std::cout << "B ERROR: TRIANGLE EXTREMLY ELONGATED: THETA =\t" << THETA << "\tID =\t" << ID << std::endl;
-                        // exit(0);
+        void set_stored(const double *BUF){
+                for(int i=0;i<5;++i){
+                        DU0[i]      = BUF[i];    DU1[i]      = BUF[5+i];  DU2[i]      = BUF[10+i]; DU3[i]      = BUF[15+i];
+                        DU0_HALF[i] = BUF[20+i]; DU1_HALF[i] = BUF[25+i]; DU2_HALF[i] = BUF[30+i]; DU3_HALF[i] = BUF[35+i];
                 }
         }
+#endif
 
-        void setup_normals(){
-                // Calculate normals (just in first timestep for static grid)
-                int m;
+        //**********************************************************************************************************************
 
+        // shift codes from the vertex positions (a vertex more than BND_TOL of the box below another takes the image
+        // above), and the boundary flag from the codes. Only at mesh load, when the triangulation gives no offsets
+        void find_shift(){
                 setup_positions();
-
-                for(int m=0; m<4; ++m){X_MOD[m] = X[m]; Y_MOD[m] = Y[m]; Z_MOD[m] = Z[m];}
-
-                check_boundary();
-
-                calculate_normals(X_MOD,Y_MOD,Z_MOD);
-
-                return ;
-
+                BOUNDARY = 0;
+                for(int i=0; i<4; ++i){
+                        SHIFT[i] = 0;
+#ifdef PERIODIC_BOUNDARY
+                        for(int j=0; j<4; ++j){
+                                if(X[j] - X[i] > BND_TOL*SIDE_LENGTH_X){SHIFT[i] |= 1;}
+                                if(Y[j] - Y[i] > BND_TOL*SIDE_LENGTH_Y){SHIFT[i] |= 2;}
+                                if(Z[j] - Z[i] > BND_TOL*SIDE_LENGTH_Z){SHIFT[i] |= 4;}
+                        }
+#endif
+                        if(SHIFT[i] != 0){BOUNDARY = 1;}
+                }
         }
 
-        void calculate_normals(double X[4],double Y[4],double Z[4]){
-                int m;
-                double ADX,ADY,ADZ;
-                double BDX,BDY,BDZ;
-                double CDX,CDY,CDZ;
-                double CROSSX,CROSSY,CROSSZ;
-                double V0[3],V1[3],V2[3],V3[3];
-                double V21[3],V31[3],V20[3],V30[3],V10[3],V01[3];
-                double PERP[4][3];
-                double RPLUS[4],RMINUS[4];
-
-                // calculate volume of tetrahedron and pass 1/4 to each vertex for dual
-
-                V0[0] = X[0];                                // vertices
-                V0[1] = Y[0];
-                V0[2] = Z[0];
-
-                V1[0] = X[1];
-                V1[1] = Y[1];
-                V1[2] = Z[1];
-
-                V2[0] = X[2];
-                V2[1] = Y[2];
-                V2[2] = Z[2];
-
-                V3[0] = X[3];
-                V3[1] = Y[3];
-                V3[2] = Z[3];
-
-                V21[0] = V2[0] - V1[0];                        // edge vectors
-                V21[1] = V2[1] - V1[1];
-                V21[2] = V2[2] - V1[2];
-
-                V31[0] = V3[0] - V1[0];
-                V31[1] = V3[1] - V1[1];
-                V31[2] = V3[2] - V1[2];
-
-                V20[0] = V2[0] - V0[0];
-                V20[1] = V2[1] - V0[1];
-                V20[2] = V2[2] - V0[2];
-
-                V30[0] = V3[0] - V0[0];
-                V30[1] = V3[1] - V0[1];
-                V30[2] = V3[2] - V0[2];
-
-                V10[0] = V1[0] - V0[0];
-                V10[1] = V1[1] - V0[1];
-                V10[2] = V1[2] - V0[2];
-
-                V01[0] = V0[0] - V1[0];
-                V01[1] = V0[1] - V1[1];
-                V01[2] = V0[2] - V1[2];
-
-                PERP[0][0] = cross_product_x(V21,V31);        // normal opposite vertex 0
-                PERP[0][1] = cross_product_y(V21,V31);
-                PERP[0][2] = cross_product_z(V21,V31);
-
-                PERP[1][0] = cross_product_x(V20,V30);        // normal opposite vertex 1
-                PERP[1][1] = cross_product_y(V20,V30);
-                PERP[1][2] = cross_product_z(V20,V30);
-
-                PERP[2][0] = cross_product_x(V10,V30);        // normal opposite vertex 2
-                PERP[2][1] = cross_product_y(V10,V30);
-                PERP[2][2] = cross_product_z(V10,V30);
-
-                PERP[3][0] = cross_product_x(V20,V10);        // normal opposite vertex 3
-                PERP[3][1] = cross_product_y(V20,V10);
-                PERP[3][2] = cross_product_z(V20,V10);
-
-                // Check if normals point inwards or outwards
-
-                double DOT001,DOT110,DOT220,DOT330;
-                double THETA0,THETA1,THETA2,THETA3;
-
-                DOT001 = PERP[0][0]*V01[0] + PERP[0][1]*V01[1] + PERP[0][2]*V01[2];
-                DOT110 = PERP[1][0]*V10[0] + PERP[1][1]*V10[1] + PERP[1][2]*V10[2];
-                DOT220 = PERP[2][0]*V20[0] + PERP[2][1]*V20[1] + PERP[2][2]*V20[2];
-                DOT330 = PERP[3][0]*V30[0] + PERP[3][1]*V30[1] + PERP[3][2]*V30[2];
-
-                THETA0 = acos(DOT001/(sqrt(PERP[0][0]*PERP[0][0] + PERP[0][1]*PERP[0][1] + PERP[0][2]*PERP[0][2])*sqrt(V01[0]*V01[0] + V01[1]*V01[1] + V01[2]*V01[2])));
-                THETA1 = acos(DOT110/(sqrt(PERP[1][0]*PERP[1][0] + PERP[1][1]*PERP[1][1] + PERP[1][2]*PERP[1][2])*sqrt(V10[0]*V10[0] + V10[1]*V10[1] + V10[2]*V10[2])));
-                THETA2 = acos(DOT220/(sqrt(PERP[2][0]*PERP[2][0] + PERP[2][1]*PERP[2][1] + PERP[2][2]*PERP[2][2])*sqrt(V20[0]*V20[0] + V20[1]*V20[1] + V20[2]*V20[2])));
-                THETA3 = acos(DOT330/(sqrt(PERP[3][0]*PERP[3][0] + PERP[3][1]*PERP[3][1] + PERP[3][2]*PERP[3][2])*sqrt(V30[0]*V30[0] + V30[1]*V30[1] + V30[2]*V30[2])));
-
-                // std::cout << "n0\t" << PERP[0][0] << "\t" << PERP[0][1] << "\t" << PERP[0][2] << std::endl;
-                // std::cout << "n1\t" << PERP[1][0] << "\t" << PERP[1][1] << "\t" << PERP[1][2] << std::endl;
-                // std::cout << "n2\t" << PERP[2][0] << "\t" << PERP[2][1] << "\t" << PERP[2][2] << std::endl;
-                // std::cout << "n3\t" << PERP[3][0] << "\t" << PERP[3][1] << "\t" << PERP[3][2] << std::endl;
-                // std::cout << std::endl;
-
-                // check_theta(THETA0);
-                // check_theta(THETA1);
-                // check_theta(THETA2);
-                // check_theta(THETA3);
-
-                if(THETA0 > 3.1416/2.0){
-                        // std::cout << "Flipping 0th Normal" << std::endl;
-                        PERP[0][0] = -1.0*PERP[0][0];
-                        PERP[0][1] = -1.0*PERP[0][1];
-                        PERP[0][2] = -1.0*PERP[0][2];
-                }
-                if(THETA1 > 3.1416/2.0){
-                        // std::cout << "Flipping 1st Normal" << std::endl;
-                        PERP[1][0] = -1.0*PERP[1][0];
-                        PERP[1][1] = -1.0*PERP[1][1];
-                        PERP[1][2] = -1.0*PERP[1][2];
+        // vertex positions with the periodic images applied, by lookup of the shift codes
+        void setup_positions_mod(){
+                for(int m=0; m<4; ++m){
+                        X_MOD[m] = (SHIFT[m] & 1) ? X[m] + SIDE_LENGTH_X : X[m];
+                        Y_MOD[m] = (SHIFT[m] & 2) ? Y[m] + SIDE_LENGTH_Y : Y[m];
+                        Z_MOD[m] = (SHIFT[m] & 4) ? Z[m] + SIDE_LENGTH_Z : Z[m];
                 }
-                if(THETA2 > 3.1416/2.0){
-                        // std::cout << "Flipping 2nd Normal" << std::endl;
-                        PERP[2][0] = -1.0*PERP[2][0];
-                        PERP[2][1] = -1.0*PERP[2][1];
-                        PERP[2][2] = -1.0*PERP[2][2];
-                }
-                if(THETA3 > 3.1416/2.0){
-                        // std::cout << "Flipping 3rd Normal" << std::endl;
-                        PERP[3][0] = -1.0*PERP[3][0];
-                        PERP[3][1] = -1.0*PERP[3][1];
-                        PERP[3][2] = -1.0*PERP[3][2];
-                }
-
-                // std::cout << "V0\t" << V0[0] << "\t" << V0[1] << "\t" << V0[2] << std::endl;
-                // std::cout << "V1\t" << V1[0] << "\t" << V1[1] << "\t" << V1[2] << std::endl;
-                // std::cout << "V2\t" << V2[0] << "\t" << V2[1] << "\t" << V2[2] << std::endl;
-                // std::cout << "V3\t" << V3[0] << "\t" << V3[1] << "\t" << V3[2] << std::endl;
-                // std::cout << std::endl;
+        }
 
-                // std::cout << "n0\t" << PERP[0][0] << "\t" << PERP[0][1] << "\t" << PERP[0][2] << std::endl;
-                // std::cout << "n1\t" << PERP[1][0] << "\t" << PERP[1][1] << "\t" << PERP[1][2] << std::endl;
-                // std::cout << "n2\t" << PERP[2][0] << "\t" << PERP[2][1] << "\t" << PERP[2][2] << std::endl;
-                // std::cout << "n3\t" << PERP[3][0] << "\t" << PERP[3][1] << "\t" << PERP[3][2] << std::endl;
-                // std::cout << std::endl;
+        void setup_normals(bool ADD_DUAL = true){
+                // Calculate normals (just in first timestep for static grid)
+                setup_positions();
+                setup_positions_mod();
 
-                ADX = X[0] - X[3];
-                ADY = Y[0] - Y[3];
-                ADZ = Z[0] - Z[3];
+                calculate_normals(X_MOD,Y_MOD,Z_MOD,ADD_DUAL);
 
-                BDX = X[1] - X[3];
-                BDY = Y[1] - Y[3];
-                BDZ = Z[1] - Z[3];
+                return ;
 
-                CDX = X[2] - X[3];
-                CDY = Y[2] - Y[3];
-                CDZ = Z[2] - Z[3];
+        }
 
-                CROSSX = BDY*CDZ - BDZ*CDY;
-                CROSSY = -1.0*(BDX*CDZ - BDZ*CDX);
-                CROSSZ = BDX*CDY - BDY*CDX;
+        // volume, face normals and the dual contributions (geometry.h)
+        void calculate_normals(double X[4],double Y[4],double Z[4],bool ADD_DUAL = true){
+                VOLUME = tetrahedron_geometry(X, Y, Z, NORMAL, MAG);
 
-                VOLUME = std::abs(ADX*CROSSX + ADY*CROSSY + ADZ*CROSSZ)/6.0;
+                if(ADD_DUAL){add_dual();}
 
-                // std::cout << VOLUME << std::endl;
-                // exit(0);
+                return ;
+        }
 
+        // pass 1/4 of the volume to each vertex dual (left to the caller when the normals are set up in parallel)
+        void add_dual(){
                 VERTEX_0->calculate_dual(VOLUME/4.0);
                 VERTEX_1->calculate_dual(VOLUME/4.0);
                 VERTEX_2->calculate_dual(VOLUME/4.0);
                 VERTEX_3->calculate_dual(VOLUME/4.0);
-
-                for(m=0;m<4;++m){
-                        MAG[m] = sqrt(PERP[m][0]*PERP[m][0] + PERP[m][1]*PERP[m][1] + PERP[m][2]*PERP[m][2]);
-                        NORMAL[m][0] = PERP[m][0]/MAG[m];
-                        NORMAL[m][1] = PERP[m][1]/MAG[m];
-                        NORMAL[m][2] = PERP[m][2]/MAG[m];
-                        // std::cout << NORMAL[i][0] << "\t" << NORMAL[i][1] << "\t" << NORMAL[i][2] << "\t" << MAG[i] << std::endl;
-                }
-
-                return ;
-        }
-
-        double area_triangle(double V0[3], double V1[3], double V2[3]){
-                double AREA;
-
-                double L01 = sqrt((V1[0] - V0[0])*(V1[0] - V0[0]) + (V1[1] - V0[1])*(V1[1] - V0[1]) + (V1[2] - V0[2])*(V1[2] - V0[2]));
-                double L02 = sqrt((V2[0] - V0[0])*(V2[0] - V0[0]) + (V2[1] - V0[1])*(V2[1] - V0[1]) + (V2[2] - V0[2])*(V2[2] - V0[2]));
-
-                double THETA = acos(((V1[0] - V0[0])*(V2[0] - V0[0]) + (V1[1] - V0[1])*(V2[1] - V0[1]) + (V1[2] - V0[2])*(V2[2] - V0[2]))/(L01*L02));
-
-                if(THETA > 3.14159/2.0){THETA = 3.14159 - THETA;}
-
-                AREA = 0.5 * (sqrt((V1[0] - V0[0])*(V1[0] - V0[0]) + (V1[1] - V0[1])*(V1[1] - V0[1]) + (V1[2] - V0[2])*(V1[2] - V0[2])) * sqrt((V2[0] - V0[0])*(V2[0] - V0[0]) + (V2[1] - V0[1])*(V2[1] - V0[1]) + (V2[2] - V0[2])*(V2[2] - V0[2]))) * sin(THETA);
-
-                // std::cout << AREA << std::endl;
-
-                return AREA;
         }
 
         void calculate_len_vel_contribution(){
                 int m;
-                double A0,A1,A2,A3;
                 double H,VX,VY,VZ,VEL[4];
                 double C_SOUND[4];
                 double AMAX,VMAX,CONT;
 
                 setup_initial_state();
 
-                double V0[3],V1[3],V2[3],V3[3];
-
-                V0[0] = X_MOD[0];
-                V0[1] = Y_MOD[0];
-                V0[2] = Z_MOD[0];
-
-                V1[0] = X_MOD[1];
-                V1[1] = Y_MOD[1];
-                V1[2] = Z_MOD[1];
-
-                V2[0] = X_MOD[2];
-                V2[1] = Y_MOD[2];
-                V2[2] = Z_MOD[2];
-
-                V3[0] = X_MOD[3];
-                V3[1] = Y_MOD[3];
-                V3[2] = Z_MOD[3];
-
-                A0 = area_triangle(V1,V2,V3);
-                A1 = area_triangle(V0,V2,V3);
-                A2 = area_triangle(V0,V1,V3);
-                A3 = area_triangle(V0,V1,V2);
-
-                AMAX = max_val(A0,A1);
-                AMAX = max_val(AMAX,A2);
-                AMAX = max_val(AMAX,A3);
-
-                // std::cout << LMAX << std::endl;
+                // largest face, MAG being twice the face areas (geometry.h)
+                AMAX = 0.5*max_val(max_val(MAG[0],MAG[1]),max_val(MAG[2],MAG[3]));
 
                 for(m=0;m<4;++m){
                         H = (U_N[4][m] + PRESSURE[m])/U_N[0][m];
@@ -1149,7 +1125,7 @@ public:
                         VY = U_N[2][m]/U_N[0][m];
                         VZ = U_N[3][m]/U_N[0][m];
                         VEL[m] = sqrt(VX*VX + VY*VY + VZ*VZ);
-                        C_SOUND[m] = sqrt((GAMMA-1.0) * H - (GAMMA-1.0) * (VX*VX + VY*VY + VZ*VZ)/2.0);
+                        C_SOUND[m] = sqrt(EOS::sound_speed_sq_enthalpy(U_N[0][m], H, VX*VX + VY*VY + VZ*VZ));
                 }
 
                 VMAX = max_val((VEL[0] + C_SOUND[0]),(VEL[1] + C_SOUND[1]));
@@ -1166,17 +1142,6 @@ public:
                 return ;
         }
 
-        double cross_product_x(double A[3], double B[3]){
-                // std::cout << A[0] << "\t" << A[1] << "\t" << A[2] << "\t" << B[0] << "\t" << B[1] << "\t" << B[2] << "\t" <<  A[1]*B[2] - A[2]*B[1] << std::endl;
-                return A[1]*B[2] - A[2]*B[1];
-        }
-        double cross_product_y(double A[3], double B[3]){
-                return -1.0*(A[0]*B[2] - A[2]*B[0]);
-        }
-        double cross_product_z(double A[3], double B[3]){
-                return A[0]*B[1] - A[1]*B[0];
-        }
-
         void reorder_vertices(){
                 VERTEX *TEMP_VERTEX;
 
@@ -1184,6 +1149,8 @@ public:
                 VERTEX_1 = VERTEX_2;
                 VERTEX_2 = TEMP_VERTEX;
 
+                std::swap(SHIFT[1], SHIFT[2]);
+
                 return;
         }
 
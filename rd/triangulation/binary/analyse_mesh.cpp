@@ -0,0 +1,54 @@
+/*
+Pre-flight quality report of a binary mesh (../../mesh_quality.h), to reject a mesh before it is run.
+
+        ./analyse_mesh 2 ../../Delaunay2D.bin [CFL] [MAX_TBIN] [MIN_ANGLE]
+        ./analyse_mesh 3 ../../Delaunay3D.bin [CFL] [MAX_TBIN] [MIN_ANGLE]
+
+Text triangulations are converted first with convert_mesh. There is no fluid state here, so the timesteps are for a
+unit signal speed everywhere (defaults CFL 1 and MAX_TBIN 16): they scale with CFL/(|v| + c), and the time bin
+population holds for any uniform state. Exits with status 2 if an element is degenerate or an angle (dihedral angle
+in 3D) is below MIN_ANGLE degrees (default 0).
+*/
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+#include "../../mesh_binary.h"
+#include "../../mesh_quality.h"
+
+int main(int ARGC, char *ARGV[]){
+        if(ARGC < 3){
+                std::cout << "Usage: " << ARGV[0] << " DIM BINARY_FILE [CFL] [MAX_TBIN] [MIN_ANGLE]" << std::endl;
+                return 1;
+        }
+        int D = atoi(ARGV[1]);
+        double CFL       = ARGC > 3 ? atof(ARGV[3]) : 1.0;
+        int MAX_TBIN     = ARGC > 4 ? atoi(ARGV[4]) : 16;
+        double MIN_ANGLE = ARGC > 5 ? atof(ARGV[5]) : 0.0;
+        if(D != 2 and D != 3){
+                std::cout << "DIM must be 2 or 3" << std::endl;
+                return 1;
+        }
+
+        MESH_MAP MAP;
+        if(not mesh_map(ARGV[2], D, MAP)){return 1;}
+        const MESH_HEADER &H = *MAP.HEADER;
+        double L[3] = {0.0, 0.0, 0.0};
+        for(int k=0;k<D;++k){L[k] = H.HIGH[k] - H.LOW[k];}
+
+        QUALITY_REPORT Q = mesh_quality(D, H.N_POINTS, H.N_TRIANG, [&](long j, int m, double P[3]){
+                long i = MAP.VERTS[(D+1)*j + m];
+                for(int k=0;k<D;++k){P[k] = MAP.X[D*i + k] + (((MAP.SHIFT[(D+1)*j + m] >> k) & 1) ? L[k] : 0.0);}
+                return i;
+        }, [](long i){return 1.0;}, CFL, MAX_TBIN);
+        mesh_unmap(MAP);
+
+        mesh_quality_print(Q);
+        if(Q.N_DEGENERATE > 0 or Q.ANGLE_MIN < MIN_ANGLE){
+                std::cout << "Rejected: " << Q.N_DEGENERATE << " degenerate elements, minimum angle " << Q.ANGLE_MIN << " (MIN_ANGLE " << MIN_ANGLE << ")" << std::endl;
+                return 2;
+        }
+        return 0;
+}
@@ -0,0 +1 @@
+g++ -O3 -fopenmp analyse_mesh.cpp -o analyse_mesh
@@ -0,0 +1 @@
+g++ -O2 convert_mesh.cpp -o convert_mesh
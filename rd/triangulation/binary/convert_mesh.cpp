@@ -0,0 +1,107 @@
+/*
+One-off conversion of a CGAL periodic triangulation (operator<< output, 1-sheet, as written by cgal_periodic2D/3D) to
+the binary mesh format read with BINARY_IC (../../mesh_binary.h).
+
+        ./convert_mesh 2 ../../Delaunay2D.txt ../../Delaunay2D.bin
+        ./convert_mesh 3 ../../Delaunay3D.txt ../../Delaunay3D.bin [BND_TOL]
+
+Each triangle corner gets a periodic shift code: bit k is set when another vertex of the triangle lies more than BND_TOL
+(default 0.5) times the box side above it along axis k, as TRIANGLE::find_shift does for the text readers.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "../../mesh_binary.h"
+
+int main(int ARGC, char *ARGV[]){
+        if(ARGC < 4){
+                std::cout << "Usage: " << ARGV[0] << " DIM CGAL_FILE BINARY_FILE [BND_TOL]" << std::endl;
+                return 1;
+        }
+        int D = atoi(ARGV[1]), i, j, k, m, n, SHEETS;
+        double BND_TOL = ARGC > 4 ? atof(ARGV[4]) : 0.5;
+        if(D != 2 and D != 3){
+                std::cout << "DIM must be 2 or 3" << std::endl;
+                return 1;
+        }
+
+        std::ifstream CGAL_FILE(ARGV[2]);
+        if(not CGAL_FILE){
+                std::cout << "Cannot open " << ARGV[2] << std::endl;
+                return 1;
+        }
+
+        MESH_HEADER H;
+        memset(&H, 0, sizeof(H));
+        H.MAGIC   = MESH_MAGIC;
+        H.VERSION = MESH_VERSION;
+        H.DIM     = D;
+
+        for(k=0;k<D;++k){CGAL_FILE >> H.LOW[k];}
+        for(k=0;k<D;++k){CGAL_FILE >> H.HIGH[k];}
+        for(k=0;k<D;++k){
+                CGAL_FILE >> SHEETS;
+                if(SHEETS != 1){
+                        std::cout << "CGAL file not in 1-sheet format" << std::endl;
+                        return 1;
+                }
+        }
+
+        CGAL_FILE >> H.N_POINTS;
+        std::vector<double> X(D*H.N_POINTS);
+        for(i=0;i<D*int(H.N_POINTS);++i){CGAL_FILE >> X[i];}
+
+        CGAL_FILE >> H.N_TRIANG;
+        std::vector<uint32_t> VERTS((D+1)*H.N_TRIANG);
+        std::vector<uint8_t> SHIFT(8*(((D+1)*H.N_TRIANG + 7)/8), 0);
+        for(j=0;j<int(H.N_TRIANG);++j){
+                uint32_t *V = &VERTS[(D+1)*j];
+                for(m=0;m<=D;++m){CGAL_FILE >> V[m];}
+                if(not CGAL_FILE){
+                        std::cout << "Unexpected end of " << ARGV[2] << " at triangle " << j << std::endl;
+                        return 1;
+                }
+                for(m=0;m<=D;++m){
+                        if(V[m] >= H.N_POINTS){
+                                std::cout << "Vertex index " << V[m] << " out of range in triangle " << j << std::endl;
+                                return 1;
+                        }
+                }
+                for(m=0;m<=D;++m){
+                        for(n=m+1;n<=D;++n){
+                                if(V[m] == V[n]){
+                                        std::cout << "Repeated vertex in triangle " << j << std::endl;
+                                        return 1;
+                                }
+                                for(k=0;k<D;++k){
+                                        if(X[D*V[n]+k] - X[D*V[m]+k] > BND_TOL*(H.HIGH[k] - H.LOW[k])){SHIFT[(D+1)*j+m] |= 1 << k;}
+                                        if(X[D*V[m]+k] - X[D*V[n]+k] > BND_TOL*(H.HIGH[k] - H.LOW[k])){SHIFT[(D+1)*j+n] |= 1 << k;}
+                                }
+                        }
+                }
+        }
+
+        FILE *OUT = fopen(ARGV[3], "wb");
+        if(OUT == NULL){
+                std::cout << "Cannot write " << ARGV[3] << std::endl;
+                return 1;
+        }
+        if(VERTS.size() % 2 == 1){VERTS.push_back(0);}                  // pad the connectivity to 8 bytes
+        bool OK = fwrite(&H, sizeof(H), 1, OUT) == 1
+              and fwrite(X.data(), sizeof(double), X.size(), OUT) == X.size()
+              and fwrite(VERTS.data(), sizeof(uint32_t), VERTS.size(), OUT) == VERTS.size()
+              and fwrite(SHIFT.data(), 1, SHIFT.size(), OUT) == SHIFT.size();
+        OK = (fclose(OUT) == 0) and OK;
+        if(not OK){
+                std::cout << "Error writing " << ARGV[3] << std::endl;
+                return 1;
+        }
+
+        std::cout << "Wrote " << H.N_POINTS << " vertices and " << H.N_TRIANG << " triangles to " << ARGV[3] << std::endl;
+        return 0;
+}
@@ -0,0 +1,2 @@
+g++ -O3 -DNDEBUG -DCGAL_NDEBUG -c periodic_delaunay.cpp -o periodic_delaunay.o
+ar rcs libperiodic_delaunay.a periodic_delaunay.o
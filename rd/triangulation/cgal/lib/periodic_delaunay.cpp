@@ -0,0 +1,103 @@
+/*
+CGAL side of periodic_delaunay.h, compiled once into libperiodic_delaunay.a so the solver itself needs no CGAL headers.
+*/
+
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Periodic_2_Delaunay_triangulation_2.h>
+#include <CGAL/Periodic_2_Delaunay_triangulation_traits_2.h>
+#include <CGAL/Periodic_3_Delaunay_triangulation_traits_3.h>
+#include <CGAL/Periodic_3_Delaunay_triangulation_3.h>
+#include <CGAL/Unique_hash_map.h>
+#include <vector>
+#include <array>
+#include <map>
+#include <algorithm>
+
+#include "periodic_delaunay.h"
+
+// append the corner offsets of one element as shift codes, relative to the lowest offset along each axis
+template<class PERIODIC_SIMPLEX>
+void push_shift(const PERIODIC_SIMPLEX &S, int N_CORNERS, int DIM, std::vector<int> &SHIFT){
+        int LOWEST[3] = {0, 0, 0}, m, k;
+        for(k=0;k<DIM;++k){
+                LOWEST[k] = S[0].second[k];
+                for(m=1;m<N_CORNERS;++m){LOWEST[k] = std::min(LOWEST[k], int(S[m].second[k]));}
+        }
+        for(m=0;m<N_CORNERS;++m){
+                int CODE = 0;
+                for(k=0;k<DIM;++k){if(S[m].second[k] > LOWEST[k]){CODE |= 1 << k;}}
+                SHIFT.push_back(CODE);
+        }
+}
+
+// input index of each point by its coordinates (CGAL stores the points as given), -1 if a point is repeated
+int input_index(const std::vector<double> &X, int DIM, std::map<std::array<double,3>, int> &INPUT){
+        int N = X.size()/DIM;
+        for(int i=0;i<N;++i){
+                std::array<double,3> KEY = {X[DIM*i], X[DIM*i+1], DIM == 3 ? X[DIM*i+2] : 0.0};
+                if(not INPUT.emplace(KEY, i).second){return -1;}
+        }
+        return N;
+}
+
+typedef CGAL::Exact_predicates_inexact_constructions_kernel K;
+
+typedef CGAL::Periodic_2_Delaunay_triangulation_traits_2<K> GT2;
+typedef CGAL::Periodic_2_Delaunay_triangulation_2<GT2>      PDT2;
+
+typedef CGAL::Periodic_3_Delaunay_triangulation_traits_3<K> GT3;
+typedef CGAL::Periodic_3_Delaunay_triangulation_3<GT3>      PDT3;
+
+long periodic_delaunay_2d(const double LOW[2], const double HIGH[2], const std::vector<double> &X, std::vector<int> &VERTS, std::vector<int> &SHIFT){
+        std::vector<PDT2::Point> L;
+        L.reserve(X.size()/2);
+        for(size_t i=0;i+1<X.size();i+=2){L.push_back(PDT2::Point(X[i], X[i+1]));}
+
+        PDT2 T(L.begin(), L.end(), PDT2::Iso_rectangle(LOW[0], LOW[1], HIGH[0], HIGH[1]));   // spatially sorted insertion
+        T.convert_to_1_sheeted_covering();
+        if(not T.is_1_cover()){return -1;}
+
+        std::map<std::array<double,3>, int> INPUT;
+        if(input_index(X, 2, INPUT) < 0){return -1;}
+
+        CGAL::Unique_hash_map<PDT2::Vertex_handle, int> INDEX;
+        for(PDT2::Vertex_iterator VIT = T.vertices_begin(); VIT != T.vertices_end(); ++VIT){
+                INDEX[VIT] = INPUT[{VIT->point().x(), VIT->point().y(), 0.0}];
+        }
+
+        VERTS.clear();
+        SHIFT.clear();
+        for(PDT2::Face_iterator FIT = T.faces_begin(); FIT != T.faces_end(); ++FIT){
+                for(int m=0;m<3;++m){VERTS.push_back(INDEX[FIT->vertex(m)]);}
+                push_shift(T.periodic_triangle(FIT), 3, 2, SHIFT);
+        }
+
+        return VERTS.size()/3;
+}
+
+long periodic_delaunay_3d(const double LOW[3], const double HIGH[3], const std::vector<double> &X, std::vector<int> &VERTS, std::vector<int> &SHIFT){
+        std::vector<PDT3::Point> L;
+        L.reserve(X.size()/3);
+        for(size_t i=0;i+2<X.size();i+=3){L.push_back(PDT3::Point(X[i], X[i+1], X[i+2]));}
+
+        PDT3 T(L.begin(), L.end(), PDT3::Iso_cuboid(LOW[0], LOW[1], LOW[2], HIGH[0], HIGH[1], HIGH[2]));
+        T.convert_to_1_sheeted_covering();
+        if(not T.is_1_cover()){return -1;}
+
+        std::map<std::array<double,3>, int> INPUT;
+        if(input_index(X, 3, INPUT) < 0){return -1;}
+
+        CGAL::Unique_hash_map<PDT3::Vertex_handle, int> INDEX;
+        for(PDT3::Vertex_iterator VIT = T.vertices_begin(); VIT != T.vertices_end(); ++VIT){
+                INDEX[VIT] = INPUT[{VIT->point().x(), VIT->point().y(), VIT->point().z()}];
+        }
+
+        VERTS.clear();
+        SHIFT.clear();
+        for(PDT3::Cell_iterator CIT = T.cells_begin(); CIT != T.cells_end(); ++CIT){
+                for(int m=0;m<4;++m){VERTS.push_back(INDEX[CIT->vertex(m)]);}
+                push_shift(T.periodic_tetrahedron(CIT), 4, 3, SHIFT);
+        }
+
+        return VERTS.size()/4;
+}
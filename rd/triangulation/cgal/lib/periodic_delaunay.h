@@ -0,0 +1,20 @@
+/*
+In-process periodic Delaunay triangulation (libperiodic_delaunay.a, build with compile_lib.sh)
+        Wraps the CGAL periodic triangulations used by cgal_periodic2D/3D so the solver can triangulate its own points
+        without the Delaunay2D.txt/Delaunay3D.txt round trip (GENERATE_IC, MOVING_MESH). The result is the 1-sheeted covering, as
+        written by those programs.
+*/
+
+#ifndef PERIODIC_DELAUNAY_H
+#define PERIODIC_DELAUNAY_H
+
+#include <vector>
+
+// triangulate the points X (2 or 3 coordinates per point, inside the periodic box LOW..HIGH). On return VERTS holds 3
+// or 4 indices into X per element and SHIFT the periodic offset of each corner (bit k set when the corner's image lies
+// one box side up along axis k, as TRIANGLE::set_shift). Returns the number of elements, or -1 if a point is repeated
+// or the points are too few or too clustered for a 1-sheeted covering
+long periodic_delaunay_2d(const double LOW[2], const double HIGH[2], const std::vector<double> &X, std::vector<int> &VERTS, std::vector<int> &SHIFT);
+long periodic_delaunay_3d(const double LOW[3], const double HIGH[3], const std::vector<double> &X, std::vector<int> &VERTS, std::vector<int> &SHIFT);
+
+#endif
@@ -20,13 +20,27 @@
                 Y_VELOCITY_HALF = y velocity of material at vertex at intermediate state
                 PRESSURE_HALF = pressure at vertex at intermediate state
                 SPECIFIC_ENERGY_HALF = specific energy density at vertex at intermediate state
+                SBIN = source bin (expensive sources evaluated every SBIN steps)
+                DT_SRC = time elapsed since sources were last evaluated at vertex
+                MESH_VEL = velocity of the vertex (MOVING_MESH)
+                CENTROID_OFFSET = dual weighted offset of the dual cell centroid from the vertex (MOVING_MESH)
+                DUAL_OLD, DUAL_NEW = dual at the start and end of the step, DUAL holds the mid step dual (MOVING_MESH)
+                DUAL_RATE = rate of change of the dual over the step (MOVING_MESH)
+                DT_MESH = longest step before the vertex moves CFL of the smallest altitude of its triangles relative to
+                          their other corners (MOVING_MESH)
 */
 
+#ifdef MPI_RD
+enum{HALO_U, HALO_U_HALF, HALO_DU, HALO_DU_HALF, HALO_LEN_VEL, HALO_DT_REQ, HALO_DUAL, HALO_STATE};     // vertex data exchanged between ranks
+#endif
+
 class VERTEX{
 
 private:
 
         int ID,TBIN_LOCAL;
+        int SBIN = 1;
+        double DT_SRC = 0.0;
         double X, Y, DX, DY;
         double DT_REQ;
         double DUAL,LEN_VEL_SUM;
@@ -36,6 +50,12 @@ private:
         double U_HALF[4], DU_HALF[4];
         double MASS_DENSITY_HALF, X_VELOCITY_HALF, Y_VELOCITY_HALF;
         double PRESSURE_HALF, SPECIFIC_ENERGY_HALF;
+#ifdef MOVING_MESH
+        double MESH_VEL[2] = {0.0, 0.0};
+        double CENTROID_OFFSET[2];
+        double DUAL_OLD, DUAL_NEW, DUAL_RATE;
+        double DT_MESH = HUGE_VAL;
+#endif
 
         std::vector<int> ASSOC_TRIANG; // not used yet
 
@@ -45,6 +65,7 @@ public:
         // (no setter functions for U and F(U) as these are set by the other variables)
         void set_id(int NEW_ID){ID = NEW_ID;};
         void set_tbin_local(int NEW_TBIN){TBIN_LOCAL = NEW_TBIN;}
+        void set_sbin(int NEW_SBIN){SBIN = NEW_SBIN;}
         void set_x(   double NEW_X){X   = NEW_X;}
         void set_y(   double NEW_Y){Y   = NEW_Y;}
         void set_dx(  double NEW_DX){DX = NEW_DX;}
@@ -74,6 +95,8 @@ public:
         // getter functions for eXtracting values of variables
         int get_id(){return ID;}
         int get_tbin_local(){return TBIN_LOCAL;}
+        int get_sbin(){return SBIN;}
+        double get_dt_src(){return DT_SRC;}
         double get_x(){      return X;}
         double get_y(){      return Y;}
         double get_dx(){     return DX;}
@@ -105,24 +128,59 @@ public:
 
         // set up the specific energy varaible, as well as u and f arrays
         void setup_specific_energy(){
-                double VEL_SQ_SUM = X_VELOCITY*X_VELOCITY + Y_VELOCITY*Y_VELOCITY;
-                SPECIFIC_ENERGY = PRESSURE/((GAMMA-1.0)*MASS_DENSITY) + VEL_SQ_SUM/2.0; // calculate specific energy
+                double VEL[2] = {X_VELOCITY, Y_VELOCITY};
+                SPECIFIC_ENERGY = state_specific_energy(MASS_DENSITY, PRESSURE, state_velocity_sq<2>(VEL)); // calculate specific energy
         }
 
         void calculate_dual(double CONTRIBUTION){DUAL = DUAL + CONTRIBUTION;}
 
+#ifdef MOVING_MESH
+        double get_mesh_vel(int k){return MESH_VEL[k];}
+
+        void reset_centroid_offset(){CENTROID_OFFSET[0] = CENTROID_OFFSET[1] = 0.0;}
+        void add_centroid_offset(double OFF_X, double OFF_Y){CENTROID_OFFSET[0] += OFF_X; CENTROID_OFFSET[1] += OFF_Y;}
+        void add_dual_rate(double CONTRIBUTION){DUAL_RATE += CONTRIBUTION;}
+        void limit_dt_mesh(double LIMIT){if(LIMIT < DT_MESH){DT_MESH = LIMIT;}}
+
+        // fluid velocity, plus MESH_REG sound speeds towards the dual centroid once the vertex is more than MESH_ETA
+        // dual radii from it (keeps the dual cells round as the vertices follow the flow)
+        void set_mesh_velocity(){
+                double OFF_X = CENTROID_OFFSET[0]/DUAL, OFF_Y = CENTROID_OFFSET[1]/DUAL;
+                double D = sqrt(OFF_X*OFF_X + OFF_Y*OFF_Y), R = sqrt(DUAL/M_PI);
+                double V2 = X_VELOCITY*X_VELOCITY + Y_VELOCITY*Y_VELOCITY;
+                MESH_VEL[0] = X_VELOCITY;
+                MESH_VEL[1] = Y_VELOCITY;
+                if(D > MESH_ETA*R){
+                        double C = sqrt(EOS::sound_speed_sq_enthalpy(U_VARIABLES[0], (U_VARIABLES[3] + PRESSURE)/U_VARIABLES[0], V2));
+                        MESH_VEL[0] += MESH_REG*C*OFF_X/D;
+                        MESH_VEL[1] += MESH_REG*C*OFF_Y/D;
+                }
+        }
+
+        void drift(double DT){
+                X += DT*MESH_VEL[0];
+                Y += DT*MESH_VEL[1];
+        }
+
+        // duals of the step: DUAL is summed again at the mid step positions, DUAL_NEW follows from DUAL_RATE
+        void begin_dual_step(){
+                DUAL_OLD  = DUAL;
+                DUAL      = 0.0;
+                DUAL_RATE = 0.0;
+        }
+        void set_dual_new(double DT){DUAL_NEW = DUAL_OLD + DT*DUAL_RATE;}
+        void end_dual_step(){DUAL = DUAL_NEW;}
+#endif
+
+        // U0 = mass density, U1 = x momentum, U2 = y momentum, U3 = energy density
         void prim_to_con(){
-                U_VARIABLES[0] = MASS_DENSITY;                          // U0 = mass density
-                U_VARIABLES[1] = MASS_DENSITY * X_VELOCITY;             // U1 = x momentum
-                U_VARIABLES[2] = MASS_DENSITY * Y_VELOCITY;             // U2 = y momentum
-                U_VARIABLES[3] = MASS_DENSITY * SPECIFIC_ENERGY;        // U3 = energy density
+                double VEL[2] = {X_VELOCITY, Y_VELOCITY};
+                state_prim_to_con<2>(MASS_DENSITY, VEL, SPECIFIC_ENERGY, U_VARIABLES);
         }
 
         void prim_to_con_half(){
-                U_HALF[0] = MASS_DENSITY_HALF;                          // U0 = mass density
-                U_HALF[1] = MASS_DENSITY_HALF * X_VELOCITY_HALF;             // U1 = x momentum
-                U_HALF[2] = MASS_DENSITY_HALF * Y_VELOCITY_HALF;             // U2 = y momentum
-                U_HALF[3] = MASS_DENSITY_HALF * SPECIFIC_ENERGY_HALF;        // U3 = energy density
+                double VEL[2] = {X_VELOCITY_HALF, Y_VELOCITY_HALF};
+                state_prim_to_con<2>(MASS_DENSITY_HALF, VEL, SPECIFIC_ENERGY_HALF, U_HALF);
         }
 
         // reset half state to new intial state
@@ -133,22 +191,42 @@ public:
                 U_HALF[3] = U_VARIABLES[3];
         }
 
+        // conserved state in and primitive state out of the blocked conversion (con_to_prim_block, convert.cpp)
+        const double *get_u_variables(){return U_VARIABLES;}
+        const double *get_u_half(){return U_HALF;}
+
+        void set_prim(double RHO, const double *VEL, double NEW_SPECIFIC_ENERGY, double NEW_PRESSURE){
+                MASS_DENSITY = RHO;
+                X_VELOCITY = VEL[0];
+                Y_VELOCITY = VEL[1];
+                SPECIFIC_ENERGY = NEW_SPECIFIC_ENERGY;
+                PRESSURE = NEW_PRESSURE;
+        }
+
+        void set_prim_half(double RHO, const double *VEL, double NEW_SPECIFIC_ENERGY, double NEW_PRESSURE){
+                MASS_DENSITY_HALF = RHO;
+                X_VELOCITY_HALF = VEL[0];
+                Y_VELOCITY_HALF = VEL[1];
+                SPECIFIC_ENERGY_HALF = NEW_SPECIFIC_ENERGY;
+                PRESSURE_HALF = NEW_PRESSURE;
+        }
+
         // convert conserved variables to primitive variables
         void con_to_prim(){
-                MASS_DENSITY    = U_VARIABLES[0];
-                X_VELOCITY      = U_VARIABLES[1]/MASS_DENSITY;
-                Y_VELOCITY      = U_VARIABLES[2]/MASS_DENSITY;
-                SPECIFIC_ENERGY = U_VARIABLES[3]/MASS_DENSITY;
+                double VEL[2];
+                state_con_to_prim<2>(U_VARIABLES, MASS_DENSITY, VEL, SPECIFIC_ENERGY);
+                X_VELOCITY = VEL[0];
+                Y_VELOCITY = VEL[1];
                 recalculate_pressure();
                 // check_values();
                 // prim_to_con();
         }
 
         void con_to_prim_half(){
-                MASS_DENSITY_HALF    = U_HALF[0];
-                X_VELOCITY_HALF      = U_HALF[1]/MASS_DENSITY_HALF;
-                Y_VELOCITY_HALF      = U_HALF[2]/MASS_DENSITY_HALF;
-                SPECIFIC_ENERGY_HALF = U_HALF[3]/MASS_DENSITY_HALF;
+                double VEL[2];
+                state_con_to_prim<2>(U_HALF, MASS_DENSITY_HALF, VEL, SPECIFIC_ENERGY_HALF);
+                X_VELOCITY_HALF = VEL[0];
+                Y_VELOCITY_HALF = VEL[1];
                 recalculate_pressure_half();
                 // check_values();
                 // prim_to_con_half();
@@ -156,14 +234,14 @@ public:
 
         // recacluate pressure based on updated primitive varaibles
         void recalculate_pressure(){
-                double VEL_SQ_SUM = X_VELOCITY*X_VELOCITY + Y_VELOCITY*Y_VELOCITY;
-                PRESSURE = (GAMMA-1.0) * MASS_DENSITY * (SPECIFIC_ENERGY - VEL_SQ_SUM/2.0);
+                double VEL[2] = {X_VELOCITY, Y_VELOCITY};
+                PRESSURE = state_pressure(MASS_DENSITY, SPECIFIC_ENERGY, state_velocity_sq<2>(VEL));
                 if(PRESSURE < E_LIM){PRESSURE = E_LIM;}
         }
 
         void recalculate_pressure_half(){
-                double VEL_SQ_SUM = X_VELOCITY_HALF*X_VELOCITY_HALF + Y_VELOCITY_HALF*Y_VELOCITY_HALF;
-                PRESSURE_HALF = (GAMMA-1.0) * MASS_DENSITY_HALF * (SPECIFIC_ENERGY_HALF - VEL_SQ_SUM/2.0);
+                double VEL[2] = {X_VELOCITY_HALF, Y_VELOCITY_HALF};
+                PRESSURE_HALF = state_pressure(MASS_DENSITY_HALF, SPECIFIC_ENERGY_HALF, state_velocity_sq<2>(VEL));
                 if(PRESSURE_HALF < E_LIM){PRESSURE_HALF = E_LIM;}
         }
 
@@ -172,36 +250,79 @@ public:
         void reset_du_half(){DU_HALF[0] = DU_HALF[1] = DU_HALF[2] = DU_HALF[3] = 0.0;}
 
         // reset sum for timestep calculation
-        void reset_len_vel_sum(){LEN_VEL_SUM = 0.0;}
+        void reset_len_vel_sum(){
+                LEN_VEL_SUM = 0.0;
+#ifdef MOVING_MESH
+                DT_MESH = HUGE_VAL;
+#endif
+        }
 
         // update DU with value from face
         void update_du(double NEW_DU[4]){
                 // if(ID == 3587){std::cout << NEW_DU[0] << "\t" <<  NEW_DU[1] << "\t" <<  NEW_DU[2] << "\t" <<  NEW_DU[3] << std::endl;}
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU[0] = DU[0] + NEW_DU[0];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU[1] = DU[1] + NEW_DU[1];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU[2] = DU[2] + NEW_DU[2];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU[3] = DU[3] + NEW_DU[3];
         }
 
         void update_du_half(double NEW_DU[4]){
                 // if(ID == 3587){std::cout << NEW_DU[0] << "\t" <<  NEW_DU[1] << "\t" <<  NEW_DU[2] << "\t" <<  NEW_DU[3] << std::endl;}
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU_HALF[0] = DU_HALF[0] + NEW_DU[0];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU_HALF[1] = DU_HALF[1] + NEW_DU[1];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU_HALF[2] = DU_HALF[2] + NEW_DU[2];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU_HALF[3] = DU_HALF[3] + NEW_DU[3];
         }
 
+        // time since the last source evaluation
+        void add_dt_src(double NEW_DT){DT_SRC = DT_SRC + NEW_DT;}
+        void reset_dt_src(){DT_SRC = 0.0;}
+
+        double get_internal_energy(){
+                double VEL[2] = {X_VELOCITY, Y_VELOCITY};
+                return SPECIFIC_ENERGY - state_velocity_sq<2>(VEL)/2.0;
+        }
+
+        // apply source changes directly to the fluid state (kick before the RD stages)
+        void kick_u_variables(){
+                U_VARIABLES[0] = U_VARIABLES[0] + DU[0];
+                U_VARIABLES[1] = U_VARIABLES[1] + DU[1];
+                U_VARIABLES[2] = U_VARIABLES[2] + DU[2];
+                U_VARIABLES[3] = U_VARIABLES[3] + DU[3];
+        }
+
         // update fluid varaiables based on sum of changes
         void update_u_variables(){
                 // std::cout << "DU =\t" << DU[0] << "\t" << DU[1] << "\t" << DU[2] << "\t" << DU[3] << std::endl;
+#ifdef MOVING_MESH
+                // DUAL*DU is the change of DUAL*U over the step on the mid step dual, DUAL_OLD*U_VARIABLES the start
+                for(int i=0;i<4;++i){U_VARIABLES[i] = (DUAL_OLD*U_VARIABLES[i] + DUAL*(U_HALF[i] - U_VARIABLES[i] + DU[i]))/DUAL_NEW;}
+                return ;
+#endif
                 U_VARIABLES[0] = U_HALF[0] + DU[0];
                 U_VARIABLES[1] = U_HALF[1] + DU[1];
                 U_VARIABLES[2] = U_HALF[2] + DU[2];
@@ -212,6 +333,10 @@ public:
 
         void update_u_half(){
                 // std::cout << "DU_HALF  =\t" << DU_HALF[0] << "\t" << DU_HALF[1] << "\t" << DU_HALF[2] << "\t" << DU_HALF[3] << std::endl;
+#ifdef MOVING_MESH
+                for(int i=0;i<4;++i){U_HALF[i] = (DUAL_OLD*U_VARIABLES[i] + DUAL*DU_HALF[i])/DUAL_NEW;}
+                return ;
+#endif
                 U_HALF[0] = U_VARIABLES[0] + DU_HALF[0];
                 U_HALF[1] = U_VARIABLES[1] + DU_HALF[1];
                 U_HALF[2] = U_VARIABLES[2] + DU_HALF[2];
@@ -238,10 +363,16 @@ public:
                         // exit(0);
                 }
 
-                if (U_VARIABLES[3] < E_LIM){
+                // on the moving mesh floor the thermal part, a floored pressure with U3 below the kinetic energy gives
+                // imaginary sound speeds and so NaN mesh velocities (static meshes keep the total energy floor)
+                double KINETIC = 0.0;
+#ifdef MOVING_MESH
+                KINETIC = 0.5*(U_VARIABLES[1]*U_VARIABLES[1] + U_VARIABLES[2]*U_VARIABLES[2])/U_VARIABLES[0];
+#endif
+                if (U_VARIABLES[3] - KINETIC < E_LIM){
                         // std::cout << "B WARNING: Exiting on negative energy\t\t\t";
                         // std::cout << ID << "\tPosition =\t" << X << "\t" << Y << "\tSPECIFIC_ENERGY =\t" << U_VARIABLES[3] << std::endl;
-                        U_VARIABLES[3] = E_LIM;
+                        U_VARIABLES[3] = KINETIC + E_LIM;
                         // std::cout << "B WARNING: Exiting on negative energy\t\t\t";
                         // std::cout << ID << "\tPosition =\t" << X << "\t" << Y << "\tSPECIFIC_ENERGY =\t" << U_VARIABLES[3] << std::endl;
                         // exit(0);
@@ -259,11 +390,15 @@ public:
                         // exit(0);
                 }
 
-                if (U_HALF[3] < E_LIM){
+                double KINETIC = 0.0;
+#ifdef MOVING_MESH
+                KINETIC = 0.5*(U_HALF[1]*U_HALF[1] + U_HALF[2]*U_HALF[2])/U_HALF[0];
+#endif
+                if (U_HALF[3] - KINETIC < E_LIM){
                         // U_VARIABLES[3] = PRES_LIM;
                         // std::cout << "B WARNING: Exiting on negative half state energy\t\t\t";
                         // std::cout << ID << "\tPosition =\t" << X << "\t" << Y << "\tSPECIFIC_ENERGY_HALF =\t" << U_HALF[3] << std::endl;
-                        U_HALF[3] = E_LIM;
+                        U_HALF[3] = KINETIC + E_LIM;
                         // std::cout << "B WARNING: Exiting on negative half state energy\t\t\t";
                         // std::cout << ID << "\tPosition =\t" << X << "\t" << Y << "\tSPECIFIC_ENERGY_HALF =\t" << U_HALF[3] << std::endl;
                         // exit(0);
@@ -275,6 +410,9 @@ public:
         double calc_next_dt(){
                 double NEXT_DT;
                 NEXT_DT = CFL*2.0*DUAL/LEN_VEL_SUM;
+#ifdef MOVING_MESH
+                if(DT_MESH < NEXT_DT){NEXT_DT = DT_MESH;}
+#endif
                 DT_REQ  = NEXT_DT;
                 return NEXT_DT;
         }
@@ -283,4 +421,80 @@ public:
                 if(INC_TBIN < TBIN_LOCAL){TBIN_LOCAL = INC_TBIN;}
         }
 
+#ifdef MPI_RD
+        // vertex data exchanged between MPI ranks (domain.cpp), halo_size(FIELD) values of FIELD per vertex
+        static int halo_size(int FIELD){
+                if(FIELD == HALO_LEN_VEL or FIELD == HALO_DT_REQ or FIELD == HALO_DUAL){return 1;}
+                if(FIELD == HALO_STATE){return 14;}
+                return 4;
+        }
+
+        void get_halo(int FIELD, double *BUF){
+                int i;
+                switch(FIELD){
+                case HALO_U:       for(i=0;i<4;++i){BUF[i] = U_VARIABLES[i];} break;
+                case HALO_U_HALF:  for(i=0;i<4;++i){BUF[i] = U_HALF[i];} break;
+                case HALO_DU:      for(i=0;i<4;++i){BUF[i] = DU[i];} break;
+                case HALO_DU_HALF: for(i=0;i<4;++i){BUF[i] = DU_HALF[i];} break;
+                case HALO_LEN_VEL: BUF[0] = LEN_VEL_SUM; break;
+                case HALO_DT_REQ:  BUF[0] = DT_REQ; break;
+                case HALO_DUAL:    BUF[0] = DUAL; break;
+                case HALO_STATE:
+                        BUF[0] = X;
+                        BUF[1] = Y;
+                        BUF[2] = DX;
+                        BUF[3] = DY;
+                        BUF[4] = DUAL;
+                        BUF[5] = DT_REQ;
+                        BUF[6] = LEN_VEL_SUM;
+                        BUF[7] = DT_SRC;
+                        BUF[8] = SBIN;
+                        BUF[9] = TBIN_LOCAL;
+                        for(i=0;i<4;++i){BUF[10+i] = U_VARIABLES[i];}
+                        break;
+                }
+        }
+
+        // copy of the owner's data at a ghost (or a migrated vertex)
+        void set_halo(int FIELD, const double *BUF){
+                int i;
+                switch(FIELD){
+                case HALO_U:       for(i=0;i<4;++i){U_VARIABLES[i] = BUF[i];} con_to_prim(); break;
+                case HALO_U_HALF:  for(i=0;i<4;++i){U_HALF[i] = BUF[i];} con_to_prim_half(); break;
+                case HALO_DU:      for(i=0;i<4;++i){DU[i] = BUF[i];} break;
+                case HALO_DU_HALF: for(i=0;i<4;++i){DU_HALF[i] = BUF[i];} break;
+                case HALO_LEN_VEL: LEN_VEL_SUM = BUF[0]; break;
+                case HALO_DT_REQ:  DT_REQ = BUF[0]; break;
+                case HALO_DUAL:    DUAL = BUF[0]; break;
+                case HALO_STATE:
+                        X = BUF[0];
+                        Y = BUF[1];
+                        DX = BUF[2];
+                        DY = BUF[3];
+                        DUAL = BUF[4];
+                        DT_REQ = BUF[5];
+                        LEN_VEL_SUM = BUF[6];
+                        DT_SRC = BUF[7];
+                        SBIN       = int(BUF[8]);
+                        TBIN_LOCAL = int(BUF[9]);
+                        for(i=0;i<4;++i){U_VARIABLES[i] = BUF[10+i];}
+                        con_to_prim();
+                        reset_u_half();
+                        reset_du();
+                        reset_du_half();
+                        break;
+                }
+        }
+
+        // contributions of the ghost copies added at the owner (DU, DU_HALF, LEN_VEL_SUM, DUAL)
+        void add_halo(int FIELD, const double *BUF){
+                int i;
+                switch(FIELD){
+                case HALO_DU:      for(i=0;i<4;++i){DU[i] += BUF[i];} break;
+                case HALO_DU_HALF: for(i=0;i<4;++i){DU_HALF[i] += BUF[i];} break;
+                case HALO_LEN_VEL: LEN_VEL_SUM += BUF[0]; break;
+                case HALO_DUAL:    DUAL += BUF[0]; break;
+                }
+        }
+#endif
 };
\ No newline at end of file
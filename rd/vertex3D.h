@@ -20,13 +20,21 @@
                 Y_VELOCITY_HALF = y velocity of material at vertex at intermediate state
                 PRESSURE_HALF = pressure at vertex at intermediate state
                 SPECIFIC_ENERGY_HALF = specific energy density at vertex at intermediate state
+                SBIN = source bin (expensive sources evaluated every SBIN steps)
+                DT_SRC = time elapsed since sources were last evaluated at vertex
 */
 
+#ifdef MPI_RD
+enum{HALO_U, HALO_U_HALF, HALO_DU, HALO_DU_HALF, HALO_LEN_VEL, HALO_DT_REQ, HALO_DUAL, HALO_STATE};     // vertex data exchanged between ranks
+#endif
+
 class VERTEX{
 
 private:
 
         int ID,TBIN_LOCAL;
+        int SBIN = 1;
+        double DT_SRC = 0.0;
         double X, Y, Z, DX, DY, DZ;
         double DT_REQ;
         double DUAL,LEN_VEL_SUM;
@@ -45,6 +53,7 @@ public:
         // (no setter functions for U and F(U) as these are set by the other variables)
         void set_id(int NEW_ID){ID = NEW_ID;};
         void set_tbin_local(int NEW_TBIN){TBIN_LOCAL = NEW_TBIN;}
+        void set_sbin(int NEW_SBIN){SBIN = NEW_SBIN;}
         void set_x(   double NEW_X){X   = NEW_X;}
         void set_y(   double NEW_Y){Y   = NEW_Y;}
         void set_z(   double NEW_Z){Z   = NEW_Z;}
@@ -72,6 +81,8 @@ public:
         // getter functions for eXtracting values of variables
         int get_id(){return ID;}
         int get_tbin_local(){return TBIN_LOCAL;}
+        int get_sbin(){return SBIN;}
+        double get_dt_src(){return DT_SRC;}
         double get_x(){      return X;}
         double get_y(){      return Y;}
         double get_z(){      return Z;}
@@ -109,39 +120,34 @@ public:
 
         // set up the specific energy varaible, as well as u and f arrays
         void setup_specific_energy(){
-                double VEL_SQ_SUM = X_VELOCITY*X_VELOCITY + Y_VELOCITY*Y_VELOCITY + Z_VELOCITY*Z_VELOCITY;
-                SPECIFIC_ENERGY = PRESSURE/((GAMMA-1.0)*MASS_DENSITY) + VEL_SQ_SUM/2.0; // calculate specific energy
+                double VEL[3] = {X_VELOCITY, Y_VELOCITY, Z_VELOCITY};
+                SPECIFIC_ENERGY = state_specific_energy(MASS_DENSITY, PRESSURE, state_velocity_sq<3>(VEL)); // calculate specific energy
         }
 
         // recacluate pressure based on current primitive varaibles
         void recalculate_pressure(){
-                double VEL_SQ_SUM = X_VELOCITY*X_VELOCITY + Y_VELOCITY*Y_VELOCITY + Z_VELOCITY*Z_VELOCITY;
-                PRESSURE = (GAMMA-1.0) * MASS_DENSITY * (SPECIFIC_ENERGY - VEL_SQ_SUM/2.0);
+                double VEL[3] = {X_VELOCITY, Y_VELOCITY, Z_VELOCITY};
+                PRESSURE = state_pressure(MASS_DENSITY, SPECIFIC_ENERGY, state_velocity_sq<3>(VEL));
                 if(PRESSURE <= E_LIM){PRESSURE = E_LIM;}
         }
 
         void recalculate_pressure_half(){
-                double VEL_SQ_SUM = X_VELOCITY_HALF*X_VELOCITY_HALF + Y_VELOCITY_HALF*Y_VELOCITY_HALF + Z_VELOCITY_HALF*Z_VELOCITY_HALF;
-                PRESSURE_HALF = (GAMMA-1.0) * MASS_DENSITY_HALF * (SPECIFIC_ENERGY_HALF - VEL_SQ_SUM/2.0);
+                double VEL[3] = {X_VELOCITY_HALF, Y_VELOCITY_HALF, Z_VELOCITY_HALF};
+                PRESSURE_HALF = state_pressure(MASS_DENSITY_HALF, SPECIFIC_ENERGY_HALF, state_velocity_sq<3>(VEL));
                 if(PRESSURE_HALF <= E_LIM){PRESSURE_HALF = E_LIM;}
         }
 
         void calculate_dual(double CONTRIBUTION){DUAL = DUAL + CONTRIBUTION;}
 
+        // U0 = mass density, U1 = x momentum, U2 = y momentum, U3 = z momentum, U4 = energy density
         void prim_to_con(){
-                U_VARIABLES[0] = MASS_DENSITY;                          // U0 = mass density
-                U_VARIABLES[1] = MASS_DENSITY * X_VELOCITY;             // U1 = x momentum
-                U_VARIABLES[2] = MASS_DENSITY * Y_VELOCITY;             // U2 = y momentum
-                U_VARIABLES[3] = MASS_DENSITY * Z_VELOCITY;             // U3 = z momentum
-                U_VARIABLES[4] = MASS_DENSITY * SPECIFIC_ENERGY;        // U4 = energy density
+                double VEL[3] = {X_VELOCITY, Y_VELOCITY, Z_VELOCITY};
+                state_prim_to_con<3>(MASS_DENSITY, VEL, SPECIFIC_ENERGY, U_VARIABLES);
         }
 
         void prim_to_con_half(){
-                U_HALF[0] = MASS_DENSITY_HALF;                          // U0 = mass density
-                U_HALF[1] = MASS_DENSITY_HALF * X_VELOCITY_HALF;             // U1 = x momentum
-                U_HALF[2] = MASS_DENSITY_HALF * Y_VELOCITY_HALF;             // U2 = y momentum
-                U_HALF[3] = MASS_DENSITY_HALF * Z_VELOCITY_HALF;             // U3 = z momentum
-                U_HALF[4] = MASS_DENSITY_HALF * SPECIFIC_ENERGY_HALF;        // U4 = energy density
+                double VEL[3] = {X_VELOCITY_HALF, Y_VELOCITY_HALF, Z_VELOCITY_HALF};
+                state_prim_to_con<3>(MASS_DENSITY_HALF, VEL, SPECIFIC_ENERGY_HALF, U_HALF);
         }
 
         // reset half state to new intial state
@@ -153,23 +159,45 @@ public:
                 U_HALF[4] = U_VARIABLES[4];
         }
 
+        // conserved state in and primitive state out of the blocked conversion (con_to_prim_block, convert.cpp)
+        const double *get_u_variables(){return U_VARIABLES;}
+        const double *get_u_half(){return U_HALF;}
+
+        void set_prim(double RHO, const double *VEL, double NEW_SPECIFIC_ENERGY, double NEW_PRESSURE){
+                MASS_DENSITY = RHO;
+                X_VELOCITY = VEL[0];
+                Y_VELOCITY = VEL[1];
+                Z_VELOCITY = VEL[2];
+                SPECIFIC_ENERGY = NEW_SPECIFIC_ENERGY;
+                PRESSURE = NEW_PRESSURE;
+        }
+
+        void set_prim_half(double RHO, const double *VEL, double NEW_SPECIFIC_ENERGY, double NEW_PRESSURE){
+                MASS_DENSITY_HALF = RHO;
+                X_VELOCITY_HALF = VEL[0];
+                Y_VELOCITY_HALF = VEL[1];
+                Z_VELOCITY_HALF = VEL[2];
+                SPECIFIC_ENERGY_HALF = NEW_SPECIFIC_ENERGY;
+                PRESSURE_HALF = NEW_PRESSURE;
+        }
+
         // convert conserved variables to primitive variables
         void con_to_prim(){
-                MASS_DENSITY    = U_VARIABLES[0];
-                X_VELOCITY      = U_VARIABLES[1]/MASS_DENSITY;
-                Y_VELOCITY      = U_VARIABLES[2]/MASS_DENSITY;
-                Z_VELOCITY      = U_VARIABLES[3]/MASS_DENSITY;
-                SPECIFIC_ENERGY = U_VARIABLES[4]/MASS_DENSITY;
+                double VEL[3];
+                state_con_to_prim<3>(U_VARIABLES, MASS_DENSITY, VEL, SPECIFIC_ENERGY);
+                X_VELOCITY = VEL[0];
+                Y_VELOCITY = VEL[1];
+                Z_VELOCITY = VEL[2];
                 recalculate_pressure();
                 // prim_to_con();
         }
 
         void con_to_prim_half(){
-                MASS_DENSITY_HALF    = U_HALF[0];
-                X_VELOCITY_HALF      = U_HALF[1]/MASS_DENSITY_HALF;
-                Y_VELOCITY_HALF      = U_HALF[2]/MASS_DENSITY_HALF;
-                Z_VELOCITY_HALF      = U_HALF[3]/MASS_DENSITY_HALF;
-                SPECIFIC_ENERGY_HALF = U_HALF[4]/MASS_DENSITY_HALF;
+                double VEL[3];
+                state_con_to_prim<3>(U_HALF, MASS_DENSITY_HALF, VEL, SPECIFIC_ENERGY_HALF);
+                X_VELOCITY_HALF = VEL[0];
+                Y_VELOCITY_HALF = VEL[1];
+                Z_VELOCITY_HALF = VEL[2];
                 recalculate_pressure_half();
                 // prim_to_con_half();
         }
@@ -183,31 +211,69 @@ public:
 
         // update DU with value from face
         void update_du(double NEW_DU[5]){
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU[0] = DU[0] + NEW_DU[0];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU[1] = DU[1] + NEW_DU[1];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU[2] = DU[2] + NEW_DU[2];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU[3] = DU[3] + NEW_DU[3];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU[4] = DU[4] + NEW_DU[4];
         }
 
         void update_du_half(double NEW_DU[5]){
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU_HALF[0] = DU_HALF[0] + NEW_DU[0];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU_HALF[1] = DU_HALF[1] + NEW_DU[1];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU_HALF[2] = DU_HALF[2] + NEW_DU[2];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU_HALF[3] = DU_HALF[3] + NEW_DU[3];
-                // #pragma omp atomic update
+#ifdef DU_ATOMIC
+                #pragma omp atomic update
+#endif
                 DU_HALF[4] = DU_HALF[4] + NEW_DU[4];
         }
 
+        // time since the last source evaluation
+        void add_dt_src(double NEW_DT){DT_SRC = DT_SRC + NEW_DT;}
+        void reset_dt_src(){DT_SRC = 0.0;}
+
+        double get_internal_energy(){
+                double VEL[3] = {X_VELOCITY, Y_VELOCITY, Z_VELOCITY};
+                return SPECIFIC_ENERGY - state_velocity_sq<3>(VEL)/2.0;
+        }
+
+        // apply source changes directly to the fluid state (kick before the RD stages)
+        void kick_u_variables(){
+                U_VARIABLES[0] = U_VARIABLES[0] - DU[0];
+                U_VARIABLES[1] = U_VARIABLES[1] - DU[1];
+                U_VARIABLES[2] = U_VARIABLES[2] - DU[2];
+                U_VARIABLES[3] = U_VARIABLES[3] - DU[3];
+                U_VARIABLES[4] = U_VARIABLES[4] - DU[4];
+        }
+
         // update fluid varaiables based on sum of changes
         void update_u_variables(){
                 // std::cout << "DU =\t" << DU[0] << "\t" << DU[1] << "\t" << DU[2] << "\t" << DU[3] << std::endl;
@@ -327,4 +393,84 @@ public:
                 }
         }
 
+#ifdef MPI_RD
+        // vertex data exchanged between MPI ranks (domain.cpp), halo_size(FIELD) values of FIELD per vertex
+        static int halo_size(int FIELD){
+                if(FIELD == HALO_LEN_VEL or FIELD == HALO_DT_REQ or FIELD == HALO_DUAL){return 1;}
+                if(FIELD == HALO_STATE){return 17;}
+                return 5;
+        }
+
+        void get_halo(int FIELD, double *BUF){
+                int i;
+                switch(FIELD){
+                case HALO_U:       for(i=0;i<5;++i){BUF[i] = U_VARIABLES[i];} break;
+                case HALO_U_HALF:  for(i=0;i<5;++i){BUF[i] = U_HALF[i];} break;
+                case HALO_DU:      for(i=0;i<5;++i){BUF[i] = DU[i];} break;
+                case HALO_DU_HALF: for(i=0;i<5;++i){BUF[i] = DU_HALF[i];} break;
+                case HALO_LEN_VEL: BUF[0] = LEN_VEL_SUM; break;
+                case HALO_DT_REQ:  BUF[0] = DT_REQ; break;
+                case HALO_DUAL:    BUF[0] = DUAL; break;
+                case HALO_STATE:
+                        BUF[0] = X;
+                        BUF[1] = Y;
+                        BUF[2] = Z;
+                        BUF[3] = DX;
+                        BUF[4] = DY;
+                        BUF[5] = DZ;
+                        BUF[6] = DUAL;
+                        BUF[7] = DT_REQ;
+                        BUF[8] = LEN_VEL_SUM;
+                        BUF[9] = DT_SRC;
+                        BUF[10] = SBIN;
+                        BUF[11] = TBIN_LOCAL;
+                        for(i=0;i<5;++i){BUF[12+i] = U_VARIABLES[i];}
+                        break;
+                }
+        }
+
+        // copy of the owner's data at a ghost (or a migrated vertex)
+        void set_halo(int FIELD, const double *BUF){
+                int i;
+                switch(FIELD){
+                case HALO_U:       for(i=0;i<5;++i){U_VARIABLES[i] = BUF[i];} con_to_prim(); break;
+                case HALO_U_HALF:  for(i=0;i<5;++i){U_HALF[i] = BUF[i];} con_to_prim_half(); break;
+                case HALO_DU:      for(i=0;i<5;++i){DU[i] = BUF[i];} break;
+                case HALO_DU_HALF: for(i=0;i<5;++i){DU_HALF[i] = BUF[i];} break;
+                case HALO_LEN_VEL: LEN_VEL_SUM = BUF[0]; break;
+                case HALO_DT_REQ:  DT_REQ = BUF[0]; break;
+                case HALO_DUAL:    DUAL = BUF[0]; break;
+                case HALO_STATE:
+                        X = BUF[0];
+                        Y = BUF[1];
+                        Z = BUF[2];
+                        DX = BUF[3];
+                        DY = BUF[4];
+                        DZ = BUF[5];
+                        DUAL = BUF[6];
+                        DT_REQ = BUF[7];
+                        LEN_VEL_SUM = BUF[8];
+                        DT_SRC = BUF[9];
+                        SBIN       = int(BUF[10]);
+                        TBIN_LOCAL = int(BUF[11]);
+                        for(i=0;i<5;++i){U_VARIABLES[i] = BUF[12+i];}
+                        con_to_prim();
+                        reset_u_half();
+                        reset_du();
+                        reset_du_half();
+                        break;
+                }
+        }
+
+        // contributions of the ghost copies added at the owner (DU, DU_HALF, LEN_VEL_SUM, DUAL)
+        void add_halo(int FIELD, const double *BUF){
+                int i;
+                switch(FIELD){
+                case HALO_DU:      for(i=0;i<5;++i){DU[i] += BUF[i];} break;
+                case HALO_DU_HALF: for(i=0;i<5;++i){DU_HALF[i] += BUF[i];} break;
+                case HALO_LEN_VEL: LEN_VEL_SUM += BUF[0]; break;
+                case HALO_DUAL:    DUAL += BUF[0]; break;
+                }
+        }
+#endif
 };
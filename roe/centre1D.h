@@ -21,6 +21,8 @@ private:
 
 public:
 
+        static const int n_dim = 1;                 // velocity components
+
         // setter functions preventing varaibles being changed accidentally
         // (no setter functions for U and F(U) as these are set by the other variables)
         void set_x(double new_x){
@@ -92,13 +94,11 @@ public:
 
         // functions to set up the specific energy varaible, as well as u and f arrays
         void setup_specific_energy(){
-                specific_energy = pressure/((GAMMA-1.0)*mass_density)+velocity*velocity/2.0;
+                specific_energy = state_specific_energy(mass_density, pressure, state_velocity_sq<1>(&velocity));
         }
 
         void prim_to_con(){
-                u_variables[0] = mass_density;
-                u_variables[1] = mass_density*velocity;
-                u_variables[2] = mass_density*specific_energy;
+                state_prim_to_con<1>(mass_density, &velocity, specific_energy, u_variables);
         }
 
         void setup_f_variables(){
@@ -107,16 +107,26 @@ public:
                 f_variables[2] = (mass_density * specific_energy + pressure) * velocity;
         }
 
+        // conserved variables and primitive setter for the blocked conversion in main.cpp (batch_con_to_prim, physics.h)
+        const double *get_u_variables(){
+                return u_variables;
+        }
+
+        void set_primitive(double new_mass_density, const double *new_velocity, double new_specific_energy, double new_pressure){
+                mass_density = new_mass_density;
+                velocity = new_velocity[0];
+                specific_energy = new_specific_energy;
+                pressure = new_pressure;
+        }
+
         // convert conserved variables to primitive variables
         void con_to_prim(){
-                mass_density = u_variables[0];
-                velocity = u_variables[1]/mass_density;
-                specific_energy = u_variables[2]/mass_density;
+                state_con_to_prim<1>(u_variables, mass_density, &velocity, specific_energy);
         }
 
         // recacluate pressure based on updated primitive varaibles
         void recalculate_pressure(){
-                pressure = (GAMMA-1.0) * mass_density * (specific_energy - (velocity*velocity)/2.0);
+                pressure = state_pressure(mass_density, specific_energy, state_velocity_sq<1>(&velocity));
         }
 
         // reset the changes in primative variables
@@ -143,7 +153,7 @@ public:
         // calculate min timestep this cell requires
         void calc_next_dt(double dx, double cfl, double &next_dt){
                 double c_sound;
-                c_sound = sqrt(GAMMA*pressure/mass_density);
+                c_sound = sqrt(EOS::sound_speed_sq(mass_density, specific_energy - velocity*velocity/2.0, pressure));
                 next_dt = cfl*(dx/(c_sound+abs(velocity)));
         }
 
@@ -22,6 +22,8 @@ private:
 
 public:
 
+        static const int n_dim = 3;                 // velocity components
+
         // setter functions preventing varaibles being changed accidentally
         // (no setter functions for U and F(U) as these are set by the other variables)
         void set_x(double new_x){
@@ -141,16 +143,13 @@ public:
 
         // functions to set up the specific energy varaible, as well as u and f arrays
         void setup_specific_energy(){
-                double vel_sq_sum = x_velocity*x_velocity + y_velocity*y_velocity + z_velocity*z_velocity;
-                specific_energy = pressure/((GAMMA-1.0)*mass_density) + vel_sq_sum/2.0;
+                double vel[3] = {x_velocity, y_velocity, z_velocity};
+                specific_energy = state_specific_energy(mass_density, pressure, state_velocity_sq<3>(vel));
         }
 
         void prim_to_con(){
-                u_variables[0] = mass_density;
-                u_variables[1] = mass_density * x_velocity;
-                u_variables[2] = mass_density * y_velocity;
-                u_variables[3] = mass_density * z_velocity;
-                u_variables[4] = mass_density * specific_energy;
+                double vel[3] = {x_velocity, y_velocity, z_velocity};
+                state_prim_to_con<3>(mass_density, vel, specific_energy, u_variables);
         }
 
         void setup_f_variables(){
@@ -161,19 +160,33 @@ public:
                 f_variables[4] = (mass_density * specific_energy + pressure) * x_velocity;
         }
 
+        // conserved variables and primitive setter for the blocked conversion in main.cpp (batch_con_to_prim, physics.h)
+        const double *get_u_variables(){
+                return u_variables;
+        }
+
+        void set_primitive(double new_mass_density, const double *new_velocity, double new_specific_energy, double new_pressure){
+                mass_density = new_mass_density;
+                x_velocity = new_velocity[0];
+                y_velocity = new_velocity[1];
+                z_velocity = new_velocity[2];
+                specific_energy = new_specific_energy;
+                pressure = new_pressure;
+        }
+
         // convert conserved variables to primitive variables
         void con_to_prim(){
-                mass_density = u_variables[0];
-                x_velocity = u_variables[1]/mass_density;
-                y_velocity = u_variables[2]/mass_density;
-                z_velocity = u_variables[3]/mass_density;
-                specific_energy = u_variables[4]/mass_density;
+                double vel[3];
+                state_con_to_prim<3>(u_variables, mass_density, vel, specific_energy);
+                x_velocity = vel[0];
+                y_velocity = vel[1];
+                z_velocity = vel[2];
         }
 
         // recacluate pressure based on updated primitive varaibles
         void recalculate_pressure(){
-                double vel_sq_sum = x_velocity*x_velocity + y_velocity*y_velocity + z_velocity*z_velocity;
-                pressure = (GAMMA-1.0) * mass_density * (specific_energy - (vel_sq_sum)/2.0);
+                double vel[3] = {x_velocity, y_velocity, z_velocity};
+                pressure = state_pressure(mass_density, specific_energy, state_velocity_sq<3>(vel));
         }
 
         // reset the changes in primative variables
@@ -208,7 +221,8 @@ public:
                 int i;
                 double c_sound;
                 double next_dt_pick[3];
-                c_sound = sqrt(GAMMA*pressure/mass_density);
+                double vel[3] = {x_velocity, y_velocity, z_velocity};
+                c_sound = sqrt(EOS::sound_speed_sq(mass_density, specific_energy - state_velocity_sq<3>(vel)/2.0, pressure));
                 next_dt_pick[0] = cfl*(dx/(c_sound+abs(x_velocity)));
                 next_dt_pick[1] = cfl*(dx/(c_sound+abs(y_velocity)));
                 next_dt_pick[2] = cfl*(dx/(c_sound+abs(z_velocity)));
@@ -13,7 +13,15 @@
 
 #define N_SNAP 10
 
+#define BINARY_OUTPUT 1                 // also write binary blocks (3D only)
+#define SLICE_AXIS 2                    // axis of extra binary slice, 0 = x, 1 = y, 2 = z (-1 for none)
+
+// #define EOS_ISOTHERMAL                  // equation of state (none for ideal gas)
+// #define EOS_POLYTROPIC
+// #define EOS_TABLE
+
 int N_POINTS = 200;
+int SLICE_INDEX = N_POINTS/2;           // cell index of slice along SLICE_AXIS
 
 // Sod Shcok Tube
 #if IC == 0
@@ -78,3 +86,16 @@ double t_tot = 0.038;
 double GAMMA = 1.4;
 double SIDE_LENGTH = 1.0;
 #endif
+
+#ifdef EOS_ISOTHERMAL
+double EOS_C_ISO = 1.0;                 // isothermal sound speed
+#endif
+
+#ifdef EOS_POLYTROPIC
+double EOS_K_POLY = 1.0;                // P = K_POLY rho^GAMMA_POLY
+double EOS_GAMMA_POLY = 4.0/3.0;
+#endif
+
+#ifdef EOS_TABLE
+std::string EOS_TABLE_FILE = "eos_table.txt";
+#endif
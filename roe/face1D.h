@@ -49,6 +49,9 @@ public:
                 double density_avg,u_avg,e_tot_avg,pressure_avg,h_tot_avg,e_kin_avg;
                 double e_vec[3][3],e_val[3];
                 double c_sound,correction;
+#ifdef EOS_NON_IDEAL
+                double e_int_avg,alpha_p,kappa_p,c_sq;
+#endif
                 double e_delta_q[3],delta_q[3],f0[3],f1[3],f_int[3],du0[3],du1[3];
                 double r_lower[3][3],r_upper[3][3],alpha[3];
                 double delta_p,delta_u,delta_d;
@@ -119,7 +122,15 @@ public:
                         q[j][2] = density[j]*e_tot[j];
                 }
 
-                c_sound = sqrt((GAMMA-1.0)*(h_tot_avg - e_kin_avg));
+#ifdef EOS_NON_IDEAL
+                // linearised pressure about the Roe state (eos.h): the sound speed and the eigenvectors below are those
+                // of the same Jacobian, dP = alpha_p drho - kappa_p u d(rho u) + kappa_p dE
+                e_int_avg = roe_avg(density[0], e_tot[0] - 0.5*u[0]*u[0], density[1], e_tot[1] - 0.5*u[1]*u[1]);
+                eos_linearise(density_avg, e_int_avg, h_tot_avg, 2.0*e_kin_avg, alpha_p, kappa_p, c_sq);
+                c_sound = sqrt(c_sq);
+#else
+                c_sound = sqrt(EOS::sound_speed_sq_enthalpy(density_avg, h_tot_avg, 2.0*e_kin_avg));
+#endif
 
                 e_val[0] = u_avg - c_sound;                             // calculate eigenvalues
                 e_val[1] = u_avg;
@@ -194,6 +205,17 @@ public:
                 r_lower[2][1] = 0.5*u_avg*u_avg;
                 r_lower[2][2] = h_tot_avg + u_avg*c_sound;
 
+#ifdef EOS_NON_IDEAL
+                // entropy wave scaled by kappa_p/c^2, so it stays an eigenvector (a pure energy wave) for a barotropic
+                // EOS with kappa_p = 0, with the wave strengths from the left eigenvectors of the same Jacobian
+                r_lower[0][1] = kappa_p/c_sq;
+                r_lower[1][1] = kappa_p*u_avg/c_sq;
+                r_lower[2][1] = kappa_p*h_tot_avg/c_sq - 1.0;
+
+                alpha[0] = ((u_avg*c_sound + alpha_p)*delta_q[0] - (c_sound + kappa_p*u_avg)*delta_q[1] + kappa_p*delta_q[2])/(2.0*c_sq);
+                alpha[1] = (h_tot_avg - u_avg*u_avg)*delta_q[0] + u_avg*delta_q[1] - delta_q[2];
+                alpha[2] = ((alpha_p - u_avg*c_sound)*delta_q[0] + (c_sound - kappa_p*u_avg)*delta_q[1] + kappa_p*delta_q[2])/(2.0*c_sq);
+#else
                 /****** Calculate alpha  ******/
 
                 delta_p = pressure[1]-pressure[0];
@@ -203,6 +225,7 @@ public:
                 alpha[0] = (delta_p - c_sound*density_avg*delta_u)/(2.0*c_sound*c_sound);
                 alpha[1] = (delta_d - delta_p/(c_sound*c_sound));
                 alpha[2] = (delta_p + c_sound*density_avg*delta_u)/(2.0*c_sound*c_sound);
+#endif
 
                 /****** Constuct fluxes either side of face ******/
 
@@ -299,13 +322,6 @@ public:
                 }
         }
 
-        // returns Roe average of left and right states
-        double roe_avg(double l1, double l2, double r1, double r2){
-                double avg;
-                avg = (sqrt(l1)*l2+sqrt(r1)*r2)/(sqrt(l1)+sqrt(r1));
-                return avg;
-        }
-
         double construct_flux_limiter(double r){
                 double phi,twor;
 
@@ -56,6 +56,9 @@ public:
                 double density_avg,spec_energy_avg,pressure_avg,h_tot_avg,e_kin_avg;
                 double x_vel_avg,y_vel_avg,z_vel_avg;
                 double gamma_bar,m_bar_sq,c_sq;
+#ifdef EOS_NON_IDEAL
+                double e_int_avg,alpha_p,kappa_p;
+#endif
                 double e_val[5];
                 double c_sound,correction;
                 double e_delta_q[5],delta_q[5],f0[5],f1[5],f_int[5],du0[5],du1[5];
@@ -184,7 +187,16 @@ public:
                         q[j][4] = density[j]*spec_energy[j];
                 }
 
-                c_sound = sqrt((GAMMA-1.0)*(h_tot_avg - e_kin_avg));
+#ifdef EOS_NON_IDEAL
+                // linearised pressure about the Roe state (eos.h): the sound speed and the eigenvectors below are those
+                // of the same Jacobian, dP = alpha_p drho - kappa_p vel.d(rho vel) + kappa_p dE
+                e_int_avg = roe_avg(density[0], spec_energy[0] - 0.5*(x_vel[0]*x_vel[0] + y_vel[0]*y_vel[0] + z_vel[0]*z_vel[0]),
+                                    density[1], spec_energy[1] - 0.5*(x_vel[1]*x_vel[1] + y_vel[1]*y_vel[1] + z_vel[1]*z_vel[1]));
+                eos_linearise(density_avg, e_int_avg, h_tot_avg, 2.0*e_kin_avg, alpha_p, kappa_p, c_sq);
+                c_sound = sqrt(c_sq);
+#else
+                c_sound = sqrt(EOS::sound_speed_sq_enthalpy(density_avg, h_tot_avg, 2.0*e_kin_avg));
+#endif
 
                 e_val[0] = x_vel_avg - c_sound;                             // calculate eigenvalues
                 e_val[1] = x_vel_avg;
@@ -298,6 +310,49 @@ public:
                 r_lower[4][3] = z_vel_avg;
                 r_lower[4][4] = h_tot_avg + x_vel_avg*c_sound;
 
+#ifdef EOS_NON_IDEAL
+                // entropy wave scaled by kappa_p/c^2, so it stays an eigenvector (a pure energy wave) for a barotropic
+                // EOS with kappa_p = 0, and the left eigenvectors have no division by kappa_p. Equal to the ideal gas
+                // matrices below up to that scaling.
+                r_lower[0][1] = kappa_p/c_sq;
+                r_lower[1][1] = kappa_p*x_vel_avg/c_sq;
+                r_lower[2][1] = kappa_p*y_vel_avg/c_sq;
+                r_lower[3][1] = kappa_p*z_vel_avg/c_sq;
+                r_lower[4][1] = kappa_p*h_tot_avg/c_sq - 1.0;
+
+                gamma_bar = kappa_p;
+                m_bar_sq = (x_vel_avg*x_vel_avg + y_vel_avg*y_vel_avg + z_vel_avg*z_vel_avg)/(c_sq);
+
+                r_upper[0][0] = (x_vel_avg*c_sound + alpha_p)/(2.0*c_sq);
+                r_upper[0][1] = -1.0*(c_sound + kappa_p*x_vel_avg)/(2.0*c_sq);
+                r_upper[0][2] = -1.0*kappa_p * y_vel_avg/(2.0*c_sq);
+                r_upper[0][3] = -1.0*kappa_p * z_vel_avg/(2.0*c_sq);
+                r_upper[0][4] = kappa_p/(2.0*c_sq);
+
+                r_upper[1][0] = h_tot_avg - 2.0*e_kin_avg;
+                r_upper[1][1] = x_vel_avg;
+                r_upper[1][2] = y_vel_avg;
+                r_upper[1][3] = z_vel_avg;
+                r_upper[1][4] = -1.0;
+
+                r_upper[2][0] = -1.0*y_vel_avg;
+                r_upper[2][1] = 0.0;
+                r_upper[2][2] = 1.0;
+                r_upper[2][3] = 0.0;
+                r_upper[2][4] = 0.0;
+
+                r_upper[3][0] = -1.0*z_vel_avg;
+                r_upper[3][1] = 0.0;
+                r_upper[3][2] = 0.0;
+                r_upper[3][3] = 1.0;
+                r_upper[3][4] = 0.0;
+
+                r_upper[4][0] = (alpha_p - x_vel_avg*c_sound)/(2.0*c_sq);
+                r_upper[4][1] = (c_sound - kappa_p*x_vel_avg)/(2.0*c_sq);
+                r_upper[4][2] = -1.0*kappa_p * y_vel_avg/(2.0*c_sq);
+                r_upper[4][3] = -1.0*kappa_p * z_vel_avg/(2.0*c_sq);
+                r_upper[4][4] = kappa_p/(2.0*c_sq);
+#else
                 gamma_bar = GAMMA-1.0;
                 c_sq = c_sound*c_sound;
                 m_bar_sq = (x_vel_avg*x_vel_avg + y_vel_avg*y_vel_avg + z_vel_avg*z_vel_avg)/(c_sq);
@@ -331,6 +386,7 @@ public:
                 r_upper[4][2] = -1.0*gamma_bar * y_vel_avg/(2.0*c_sq);
                 r_upper[4][3] = -1.0*gamma_bar * z_vel_avg/(2.0*c_sq);
                 r_upper[4][4] = gamma_bar/(2.0*c_sq);
+#endif
 
                 /****** Check matrices give identity matrix when multiplied together ******/
 
@@ -494,13 +550,6 @@ public:
                 }
         }
 
-        // returns Roe average of left and right states
-        double roe_avg(double l1, double l2, double r1, double r2){
-                double avg;
-                avg = (sqrt(l1)*l2+sqrt(r1)*r2)/(sqrt(l1)+sqrt(r1));
-                return avg;
-        }
-
         double construct_flux_limiter(double r){
                 double phi,twor;
 
@@ -13,24 +13,22 @@ void close_files(ofstream &density_map, ofstream &pressure_map, ofstream &veloci
         density_map.close();
         pressure_map.close();
         velocity_map.close();
+        density_slice.close();
         du_file.close();
         return;
 }
 
-void output_state(ofstream &density_map, ofstream &pressure_map, ofstream &velocity_map, ofstream &density_slice, ofstream &du_file, vector<centre> points, double t, double dt, double dx){
-        int i;
-        double total_density, rand_offset;
-        vector<centre>::iterator it_vert;
+void output_state(ofstream &density_map, ofstream &pressure_map, ofstream &velocity_map, ofstream &density_slice, ofstream &du_file, vector<centre> &points, double t, double dt, double dx){
+        int i,k;
+        double total_density = 0.0;
 
-        
-
-        for(it_vert=points.begin(),i=0;it_vert<points.end();it_vert++,i++){
-                rand_offset = rand()/(10.0*double(RAND_MAX));
-                density_map << points[i].get_x() << "\t" << points[i].get_y() << "\t" << points[i].get_z() << "\t" << points[i].get_mass_density() << endl;
-                pressure_map << points[i].get_x() << "\t" << points[i].get_pressure() << endl;
-                velocity_map << points[i].get_x() << "\t" << points[i].get_x_velocity() << "\t" << points[i].get_y_velocity() << "\t" << points[i].get_z_velocity() << endl;
-                if(points[i].get_z() > SIDE_LENGTH - 0.9*dx and points[i].get_z() < SIDE_LENGTH + 0.9*dx){
-                        density_slice << points[i].get_x()+rand_offset << "\t" << points[i].get_y()-rand_offset << "\t" << points[i].get_mass_density() << endl;
+        for(i=0;i<int(points.size());i++){
+                k = i % N_POINTS;                                                                       // z index of cell (points ordered x, y, z)
+                density_map << points[i].get_x() << "\t" << points[i].get_y() << "\t" << points[i].get_z() << "\t" << points[i].get_mass_density() << "\n";
+                pressure_map << points[i].get_x() << "\t" << points[i].get_pressure() << "\n";
+                velocity_map << points[i].get_x() << "\t" << points[i].get_x_velocity() << "\t" << points[i].get_y_velocity() << "\t" << points[i].get_z_velocity() << "\n";
+                if(k == N_POINTS-1){                                                                    // top z layer, selected by index
+                        density_slice << points[i].get_x() << "\t" << points[i].get_y() << "\t" << points[i].get_mass_density() << "\n";
                 }
                 total_density += points[i].get_mass_density()*dx;
         }
@@ -40,4 +38,72 @@ void output_state(ofstream &density_map, ofstream &pressure_map, ofstream &veloc
         pressure_map << " " << endl;
         velocity_map << " " << endl;
         return;
-}
\ No newline at end of file
+}
+
+/* binary block output (one block appended per call)
+        header:  char[8] "RDBLOCK", int version, int n_x, n_y, n_z, int slice_axis (-1 = full box), int slice_index,
+                 int n_fields, double t, dt, dx, side_length, n_fields x char[16] field names
+        data:    n_fields arrays of n_x*n_y*n_z doubles, x index slowest and z index fastest (same order as points)
+*/
+
+const int N_BLOCK_FIELDS = 6;
+const char BLOCK_FIELDS[N_BLOCK_FIELDS][16] = {"mass_density", "pressure", "x_velocity", "y_velocity", "z_velocity", "specific_energy"};
+
+double block_field(centre &cell, int field){
+        switch(field){
+                case 0: return cell.get_mass_density();
+                case 1: return cell.get_pressure();
+                case 2: return cell.get_x_velocity();
+                case 3: return cell.get_y_velocity();
+                case 4: return cell.get_z_velocity();
+                default: return cell.get_specific_energy();
+        }
+}
+
+void write_block(output_buffer &block_file, vector<centre> &points, double t, double dt, double dx, int slice_axis, int slice_index){
+        int i,j,k,field;
+        int lo[3] = {0, 0, 0}, hi[3] = {N_POINTS, N_POINTS, N_POINTS};
+        vector<double> values;
+
+        if(slice_axis >= 0 and slice_axis < 3){                                                        // restrict one axis to the slice layer
+                if(slice_index < 0 or slice_index >= N_POINTS){
+                        cout << "B ERROR: SLICE INDEX OUT OF RANGE\t" << slice_index << "\t(0 to " << N_POINTS-1 << ")" << endl;
+                        exit(1);
+                }
+                lo[slice_axis] = slice_index;
+                hi[slice_axis] = slice_index + 1;
+        }else{
+                slice_axis = -1;
+                slice_index = -1;
+        }
+
+        values.reserve((hi[0]-lo[0])*(hi[1]-lo[1])*(hi[2]-lo[2]));
+
+        block_file.write("RDBLOCK", 8);
+        block_file.write_int(1);
+        block_file.write_int(hi[0]-lo[0]);
+        block_file.write_int(hi[1]-lo[1]);
+        block_file.write_int(hi[2]-lo[2]);
+        block_file.write_int(slice_axis);
+        block_file.write_int(slice_index);
+        block_file.write_int(N_BLOCK_FIELDS);
+        block_file.write_double(t);
+        block_file.write_double(dt);
+        block_file.write_double(dx);
+        block_file.write_double(SIDE_LENGTH);
+        for(field=0;field<N_BLOCK_FIELDS;field++){block_file.write_name(BLOCK_FIELDS[field], 16);}
+
+        for(field=0;field<N_BLOCK_FIELDS;field++){
+                values.clear();
+                for(i=lo[0];i<hi[0];i++){
+                        for(j=lo[1];j<hi[1];j++){
+                                for(k=lo[2];k<hi[2];k++){
+                                        values.push_back(block_field(points[(i*N_POINTS + j)*N_POINTS + k], field));
+                                }
+                        }
+                }
+                block_file.write(values.data(), values.size()*sizeof(double));
+        }
+        block_file.flush();                                                                             // writer thread drains it while the solver continues
+        return;
+}
@@ -5,6 +5,7 @@
 #include <cstdlib>
 
 #include "constants.h"
+#include "../common/physics.h"
 
 #ifdef ONE_D
 
@@ -19,6 +20,7 @@
 
 #include "centre3D.h"
 #include "face3D.h"
+#include "output_buffer.h"
 #include "setup3D.cpp"
 #include "io3D.cpp"
 
@@ -44,6 +46,10 @@ int main(){
         dx = SIDE_LENGTH/double(N_POINTS);                             // calculate cell width
         next_dt = t_tot;
 
+#ifdef EOS_TABLE
+        if(not eos_table::load(EOS_TABLE_FILE)){exit(1);}
+#endif
+
         /****** Setup initial conditions of one dimensional tube ******/
 
         cout << "Building grid of cells ..." << endl;
@@ -104,6 +110,11 @@ int main(){
 #ifdef THREE_D
         ofstream density_map, pressure_map, velocity_map, density_slice, du_file;
         open_files(density_map, pressure_map, velocity_map, density_slice, du_file);           // open output files
+#if BINARY_OUTPUT
+        output_buffer block_file, slice_file;
+        block_file.open("blocks.bin");
+        if(SLICE_AXIS >= 0){slice_file.open("slice.bin");}
+#endif
 #endif
 
         cout << "Evolving fluid ..." << endl;
@@ -123,6 +134,10 @@ int main(){
 
 #ifdef THREE_D
                         output_state(density_map, pressure_map, velocity_map, density_slice, du_file, points, t, dt, dx);
+#if BINARY_OUTPUT
+                        write_block(block_file, points, t, dt, dx, -1, -1);
+                        if(SLICE_AXIS >= 0){write_block(slice_file, points, t, dt, dx, SLICE_AXIS, SLICE_INDEX);}
+#endif
 #endif
                 }
 
@@ -132,15 +147,29 @@ int main(){
 
                 next_dt = t_tot - (t + dt);     // set next timestep to max possible value (time remaining to end)
 
-                for(it_vert=points.begin(),i=0;it_vert<points.end();it_vert++,i++){             // loop over all vertices
-                        points[i].update_u_variables();                                         // update the u variables with the collected du
-                        points[i].con_to_prim();                                                // convert these to their corresponding conserved
-                        points[i].recalculate_pressure();                                       // caclulate pressure from new conserved values
-                        points[i].prim_to_con();                                                // convert back to guarentee correct values are used
-                        points[i].setup_f_variables();                                          // set flux variables with new values
-                        points[i].reset_du();                                                   // reset du value to zero for next timestep
-                        points[i].calc_next_dt(dx,cfl,possible_dt);                             // calculate next timestep
-                        if(possible_dt<next_dt){next_dt = possible_dt;}
+                for(int b=0;b<int(points.size());b+=PHYSICS_BLOCK){                              // loop over all vertices in blocks
+                        const int n_dim = centre::n_dim;
+                        int n_block = min(int(points.size())-b, PHYSICS_BLOCK);
+                        double u[n_dim+2][PHYSICS_BLOCK], vel[n_dim][PHYSICS_BLOCK];
+                        double rho[PHYSICS_BLOCK], spec_energy[PHYSICS_BLOCK], pres[PHYSICS_BLOCK];
+
+                        for(i=0;i<n_block;i++){
+                                points[b+i].update_u_variables();                               // update the u variables with the collected du
+                                for(j=0;j<n_dim+2;j++){u[j][i] = points[b+i].get_u_variables()[j];}
+                        }
+
+                        batch_con_to_prim<n_dim>(n_block, u, rho, vel, spec_energy, pres, -HUGE_VAL);   // convert these to primitive and pressure
+
+                        for(i=0;i<n_block;i++){
+                                double vel_i[n_dim];
+                                for(j=0;j<n_dim;j++){vel_i[j] = vel[j][i];}
+                                points[b+i].set_primitive(rho[i], vel_i, spec_energy[i], pres[i]);
+                                points[b+i].prim_to_con();                                      // convert back to guarentee correct values are used
+                                points[b+i].setup_f_variables();                                // set flux variables with new values
+                                points[b+i].reset_du();                                         // reset du value to zero for next timestep
+                                points[b+i].calc_next_dt(dx,cfl,possible_dt);                   // calculate next timestep
+                                if(possible_dt<next_dt){next_dt = possible_dt;}
+                        }
                 }
 
                 t+=dt;                                                                          // increment time
@@ -155,6 +184,12 @@ int main(){
 #ifdef THREE_D
         output_state(density_map, pressure_map, velocity_map, density_slice, du_file, points, t, dt, dx);      // write out final state
         close_files(density_map, pressure_map, velocity_map, density_slice, du_file);
+#if BINARY_OUTPUT
+        write_block(block_file, points, t, dt, dx, -1, -1);
+        if(SLICE_AXIS >= 0){write_block(slice_file, points, t, dt, dx, SLICE_AXIS, SLICE_INDEX);}
+        block_file.close();
+        slice_file.close();
+#endif
 #endif
         
 
@@ -0,0 +1,141 @@
+/*      class collecting binary output in a large memory buffer and writing it to disk on a separate thread
+                file = file the buffer is flushed to
+                front = buffer currently being filled by the solver
+                back = buffer currently being written by the writer thread
+                capacity = size of each buffer in bytes (flushed when full), allocated as the output grows
+                writer = thread writing the back buffer, running from open to close
+                lock, ready = guard and signal for handing the back buffer between the solver and the writer
+                pending = true while the back buffer holds data still to be written
+                stop = true once close has asked the writer to finish
+*/
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class output_buffer{
+
+private:
+
+        FILE *file;
+        vector<char> front,back;
+        size_t capacity;
+        thread writer;
+        mutex lock;
+        condition_variable ready;
+        bool pending,stop;
+
+        // writer thread: write the back buffer whenever one is handed over, until close
+        void run(){
+                unique_lock<mutex> guard(lock);
+                while(true){
+                        ready.wait(guard, [this](){return pending or stop;});
+                        if(not pending){return;}
+                        guard.unlock();
+                        fwrite(back.data(), 1, back.size(), file);
+                        guard.lock();
+                        pending = false;
+                        ready.notify_all();
+                }
+        }
+
+        // wait for the writer thread to finish with the back buffer
+        void wait(){
+                unique_lock<mutex> guard(lock);
+                ready.wait(guard, [this](){return not pending;});
+        }
+
+        // hand the filled buffer to the writer thread and keep filling the other one
+        void swap_and_write(){
+                wait();
+                {
+                        lock_guard<mutex> guard(lock);
+                        front.swap(back);
+                        pending = true;
+                }
+                ready.notify_all();
+                front.clear();
+        }
+
+public:
+
+        output_buffer(size_t new_capacity = 64*1024*1024){
+                file = NULL;
+                capacity = new_capacity;
+                pending = false;
+                stop = false;
+        }
+
+        ~output_buffer(){
+                close();
+        }
+
+        bool open(string file_name){
+                close();
+                file = fopen(file_name.c_str(), "wb");
+                if(file == NULL){
+                        cout << "B WARNING: CANNOT OPEN BINARY OUTPUT FILE\t" << file_name << endl;
+                        return false;
+                }
+                stop = false;
+                writer = thread(&output_buffer::run, this);
+                return true;
+        }
+
+        // copy raw bytes into the buffer, handing full buffers to the writer thread
+        void write(const void *data, size_t n_bytes){
+                const char *bytes = (const char*) data;
+                size_t chunk;
+                if(file == NULL){return;}
+                while(n_bytes > 0){
+                        chunk = capacity - front.size();
+                        if(chunk > n_bytes){chunk = n_bytes;}
+                        // grow geometrically up to capacity, so small outputs never allocate the full buffer
+                        if(front.size() + chunk > front.capacity()){
+                                size_t grow = 2*front.capacity() > front.size() + chunk ? 2*front.capacity() : front.size() + chunk;
+                                front.reserve(grow < capacity ? grow : capacity);
+                        }
+                        front.insert(front.end(), bytes, bytes + chunk);
+                        bytes += chunk;
+                        n_bytes -= chunk;
+                        if(front.size() == capacity){swap_and_write();}
+                }
+        }
+
+        void write_int(int value){write(&value, sizeof(int));}
+        void write_double(double value){write(&value, sizeof(double));}
+
+        // write a fixed width (zero padded) name so the header stays self-describing
+        void write_name(string name, size_t width){
+                char padded[64];
+                memset(padded, 0, sizeof(padded));
+                strncpy(padded, name.c_str(), width < sizeof(padded) ? width : sizeof(padded));
+                write(padded, width);
+        }
+
+        // start writing whatever is in the buffer without blocking the solver
+        void flush(){
+                if(file == NULL or front.empty()){return;}
+                swap_and_write();
+        }
+
+        void close(){
+                if(file == NULL){return;}
+                flush();
+                {
+                        lock_guard<mutex> guard(lock);
+                        stop = true;
+                }
+                ready.notify_all();
+                writer.join();
+                fclose(file);
+                file = NULL;
+        }
+
+};
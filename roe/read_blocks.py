@@ -0,0 +1,24 @@
+import numpy as np
+
+# read every block written by write_block (blocks.bin / slice.bin) into a list of (header, fields) pairs
+
+def read_blocks(file_name):
+        blocks = []
+        with open(file_name, "rb") as f:
+                while True:
+                        magic = f.read(8)
+                        if len(magic) < 8:
+                                break
+                        version, n_x, n_y, n_z, slice_axis, slice_index, n_fields = np.fromfile(f, dtype = np.int32, count = 7)
+                        t, dt, dx, side_length = np.fromfile(f, dtype = np.float64, count = 4)
+                        names = [f.read(16).rstrip(b"\0").decode() for i in range(n_fields)]
+                        fields = {}
+                        for name in names:
+                                fields[name] = np.fromfile(f, dtype = np.float64, count = n_x*n_y*n_z).reshape((n_x, n_y, n_z))
+                        header = {"t": t, "dt": dt, "dx": dx, "side_length": side_length, "slice_axis": slice_axis, "slice_index": slice_index}
+                        blocks.append((header, fields))
+        return blocks
+
+if __name__ == "__main__":
+        for header, fields in read_blocks("blocks.bin"):
+                print(header["t"], fields["mass_density"].shape, fields["mass_density"].sum()*header["dx"])